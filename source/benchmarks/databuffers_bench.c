@@ -0,0 +1,714 @@
+/**
+ * @file  databuffers_bench.c
+ * @brief Host micro-benchmarks for the data buffers, with regression budgets
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Times the operations on the ingest and upload paths:
+ *
+ *   list_insert_*      SensorDataList_insert() of 1024 samples, in order,
+ *                      reversed, shuffled within a window of 8 or 64, and
+ *                      shuffled completely
+ *   pool_*             SensorDataPool_get()/SensorDataPool_return() in pairs,
+ *                      and emptying then refilling the whole pool
+ *   snl_find_*         SNL_find() of a node that is in the list (hit) and one
+ *                      that isn't (miss), with 1, 10, 25 and 50 nodes in use
+ *   next_node_*        determine_which_node_should_send_data() when only the
+ *                      last node in the search has data
+ *   node_add_*         Adding 1024 samples in order to a node, one at a time
+ *                      with SensorNode_add_data(), or in bursts of 16 with
+ *                      SensorNode_add_data_batch()
+ *   ready_pass_*       One pass of the upload loop over the ready list, when
+ *                      one of 10 or 50 nodes has been given a sample -- the
+ *                      idle nodes shouldn't cost anything
+ *
+ * Each case is run a number of times and the best and mean times per
+ * operation are printed as "key=value" pairs, one line per case. If a budget
+ * file is given, a case whose best time is over its budget fails, and the
+ * program exits with 1 -- so it can gate a change to the data buffers.
+ *
+ * Usage: databuffers_bench [-n repeats] [-b budgets.txt] [-k factor] [-f filter]
+ *
+ *   -n repeats     Times each case is run (default 20)
+ *   -b file        Budgets, one "<case> <ns_per_op>" per line
+ *   -k factor      Multiply the budgets by this (for a slower machine)
+ *   -f filter      Only run the cases whose name contains this
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host_stubs.h"
+
+#include "sensor_data_list.h"
+#include "sensor_data_pool.h"
+#include "sensor_node_list.h"
+#include "sensor_node.h"
+#include "sensor_node_pool.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+#define DEFAULT_REPEATS         20U
+#define MAX_BUDGETS             64U
+
+#define LIST_LEN                1024U       /**< @brief Samples inserted in each list_insert case */
+#define POOL_PAIRS              10000U      /**< @brief get/return pairs in pool_get_return */
+#define NUM_LOOKUPS             10000U      /**< @brief Calls in each snl_find and next_node case */
+
+/** @brief Window that shuffles the whole list */
+#define WINDOW_ALL              LIST_LEN
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+typedef struct {
+    char const *name;
+    double    (*fn)(uint32_t arg, uint32_t *p_ops);   /**< @brief Runs the case once, returns the time in seconds */
+    uint32_t    arg;
+} BenchCase;
+
+
+typedef struct {
+    char   name[48];
+    double ns_per_op;
+} Budget;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static double run_list_insert__(uint32_t window, uint32_t *p_ops);
+static double run_list_insert_reversed__(uint32_t arg, uint32_t *p_ops);
+static double run_pool_get_return__(uint32_t arg, uint32_t *p_ops);
+static double run_pool_drain_refill__(uint32_t arg, uint32_t *p_ops);
+static double run_snl_find_hit__(uint32_t num_nodes, uint32_t *p_ops);
+static double run_snl_find_miss__(uint32_t num_nodes, uint32_t *p_ops);
+static double run_next_node__(uint32_t num_nodes, uint32_t *p_ops);
+static double run_node_add__(uint32_t burst, uint32_t *p_ops);
+static double run_ready_pass__(uint32_t num_nodes, uint32_t *p_ops);
+static double time_list_insert__(uint32_t const *p_order);
+static void fill_node_list__(uint32_t num_nodes);
+static void set_ipaddr__(uip_ipaddr_t *p_ipaddr, uint32_t index);
+static bool load_budgets__(char const *p_filename);
+static Budget const* find_budget__(char const *p_name);
+static double now_sec__(void);
+static uint32_t rand__(void);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+static BenchCase const s_cases[] = {
+    { "list_insert_in_order",   &run_list_insert__,             1U                      },
+    { "list_insert_reversed",   &run_list_insert_reversed__,    0U                      },
+    { "list_insert_window_8",   &run_list_insert__,             8U                      },
+    { "list_insert_window_64",  &run_list_insert__,             64U                     },
+    { "list_insert_random",     &run_list_insert__,             WINDOW_ALL              },
+    { "pool_get_return",        &run_pool_get_return__,         0U                      },
+    { "pool_drain_refill",      &run_pool_drain_refill__,       0U                      },
+    { "snl_find_hit_1",         &run_snl_find_hit__,            1U                      },
+    { "snl_find_hit_10",        &run_snl_find_hit__,            10U                     },
+    { "snl_find_hit_25",        &run_snl_find_hit__,            25U                     },
+    { "snl_find_hit_50",        &run_snl_find_hit__,            SENSOR_NODE_LIST_SIZE   },
+    { "snl_find_miss_1",        &run_snl_find_miss__,           1U                      },
+    { "snl_find_miss_10",       &run_snl_find_miss__,           10U                     },
+    { "snl_find_miss_25",       &run_snl_find_miss__,           25U                     },
+    { "snl_find_miss_50",       &run_snl_find_miss__,           SENSOR_NODE_LIST_SIZE   },
+    { "next_node_1",            &run_next_node__,               1U                      },
+    { "next_node_10",           &run_next_node__,               10U                     },
+    { "next_node_25",           &run_next_node__,               25U                     },
+    { "next_node_50",           &run_next_node__,               SENSOR_NODE_LIST_SIZE   },
+    { "node_add_single",        &run_node_add__,                1U                      },
+    { "node_add_batch_16",      &run_node_add__,                16U                     },
+    { "ready_pass_10",          &run_ready_pass__,              10U                     },
+    { "ready_pass_50",          &run_ready_pass__,              SENSOR_NODE_LIST_SIZE   },
+};
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+static struct SensorData s_samples[LIST_LEN];
+static SensorNode        s_node;
+static uint32_t          s_order[LIST_LEN];
+
+static Budget   s_budgets[MAX_BUDGETS];
+static uint32_t s_num_budgets;
+
+static uint32_t s_rand_state=1U;
+
+/** @brief Stops the compiler dropping the lookups */
+static volatile uintptr_t s_sink;
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+int main(int argc, char *argv[])
+{
+    uint32_t    repeats=DEFAULT_REPEATS;
+    double      factor=1.0;
+    char const *p_filter=NULL;
+    uint32_t    num_cases=0U;
+    uint32_t    num_failed=0U;
+    int         opt;
+
+    while( ( opt = getopt(argc, argv, "n:b:k:f:") ) != -1 )
+    {
+        switch(opt)
+        {
+        case 'n':
+            repeats = (uint32_t) strtoul(optarg, NULL, 10);
+            break;
+
+        case 'b':
+            if( !load_budgets__(optarg) )
+            {
+                fprintf(stderr, "Failed to read the budgets in '%s'\n", optarg);
+                return 1;
+            }
+            break;
+
+        case 'k':
+            factor = strtod(optarg, NULL);
+            break;
+
+        case 'f':
+            p_filter = optarg;
+            break;
+
+        default:
+            repeats = 0U;
+            break;
+        }
+    }
+
+    if( ( repeats == 0U ) || ( factor <= 0.0 ) )
+    {
+        fprintf(stderr, "Usage: %s [-n repeats] [-b budgets.txt] [-k factor] [-f filter]\n", argv[0]);
+        return 2;
+    }
+
+    if( !HostStubs_init() )
+    {
+        fprintf(stderr, "HostStubs_init() failed\n");
+        return 1;
+    }
+
+    /* The benchmarks initialise a node of their own, outside the list */
+    if( !SensorNode_init_locks() )
+    {
+        fprintf(stderr, "SensorNode_init_locks() failed\n");
+        return 1;
+    }
+
+    SensorDataPool_init();
+
+    for(uint32_t ii=0U; ii<( sizeof(s_cases) / sizeof(s_cases[0]) ); ii++)
+    {
+        BenchCase const *p_case = &s_cases[ii];
+        Budget const    *p_budget = find_budget__(p_case->name);
+        double           best=0.0;
+        double           total=0.0;
+        uint32_t         ops=0U;
+        char const      *p_result="-";
+        char             budget_str[24]="-";
+
+        if(
+                ( p_filter ) &&
+                ( strstr(p_case->name, p_filter) == NULL )
+        )
+        {
+            continue;
+        }
+
+        for(uint32_t rep=0U; rep<repeats; rep++)
+        {
+            double elapsed = p_case->fn(p_case->arg, &ops);
+
+            total += elapsed;
+
+            if( ( rep == 0U ) || ( elapsed < best ) )
+            {
+                best = elapsed;
+            }
+        }
+
+        double best_ns = ( best * 1e9 ) / (double) ops;
+        double mean_ns = ( total * 1e9 ) / ( (double) ops * (double) repeats );
+
+        if(p_budget)
+        {
+            double budget_ns = p_budget->ns_per_op * factor;
+
+            snprintf(budget_str, sizeof(budget_str), "%.1f", budget_ns);
+
+            if( best_ns > budget_ns )
+            {
+                p_result = "fail";
+                num_failed++;
+            }
+            else
+            {
+                p_result = "pass";
+            }
+        }
+
+        printf("bench=%s ops=%u repeats=%u ns_per_op_min=%.1f ns_per_op_mean=%.1f budget_ns=%s result=%s\n",
+               p_case->name,
+               ops,
+               repeats,
+               best_ns,
+               mean_ns,
+               budget_str,
+               p_result);
+
+        num_cases++;
+    }
+
+    printf("cases=%u budgets=%u failed=%u\n", num_cases, s_num_budgets, num_failed);
+
+    return ( num_failed > 0U ) ? 1 : 0;
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+/* Shuffles the sequence numbers within each window -- how the mesh delivers
+ * them when packets take different routes.
+ */
+static double run_list_insert__(uint32_t window, uint32_t *p_ops)
+{
+    for(uint32_t ii=0U; ii<LIST_LEN; ii++)
+    {
+        s_order[ii] = ii;
+    }
+
+    for(uint32_t start=0U; ( window > 1U ) && ( start < LIST_LEN ); start+=window)
+    {
+        uint32_t len = ( ( LIST_LEN - start ) < window ) ? ( LIST_LEN - start ) : window;
+
+        for(uint32_t ii=len - 1U; ii>0U; ii--)
+        {
+            uint32_t jj  = rand__() % ( ii + 1U );
+            uint32_t tmp = s_order[start + ii];
+
+            s_order[start + ii] = s_order[start + jj];
+            s_order[start + jj] = tmp;
+        }
+    }
+
+    *p_ops = LIST_LEN;
+
+    return time_list_insert__(s_order);
+}
+/******************************************************************************/
+static double run_list_insert_reversed__(uint32_t arg, uint32_t *p_ops)
+{
+    (void) arg;
+
+    for(uint32_t ii=0U; ii<LIST_LEN; ii++)
+    {
+        s_order[ii] = LIST_LEN - 1U - ii;
+    }
+
+    *p_ops = LIST_LEN;
+
+    return time_list_insert__(s_order);
+}
+/******************************************************************************/
+static double run_pool_get_return__(uint32_t arg, uint32_t *p_ops)
+{
+    (void) arg;
+
+    double start = now_sec__();
+
+    for(uint32_t ii=0U; ii<POOL_PAIRS; ii++)
+    {
+        struct SensorData *p_data = SensorDataPool_get();
+
+        SensorDataPool_return(p_data);
+    }
+
+    double elapsed = now_sec__() - start;
+
+    *p_ops = 2U * POOL_PAIRS;
+
+    return elapsed;
+}
+/******************************************************************************/
+static double run_pool_drain_refill__(uint32_t arg, uint32_t *p_ops)
+{
+    static struct SensorData *s_taken[SENSOR_DATA_POOL_SIZE];
+
+    uint32_t num_taken=0U;
+
+    (void) arg;
+
+    double start = now_sec__();
+
+    while( num_taken < SENSOR_DATA_POOL_SIZE )
+    {
+        struct SensorData *p_data = SensorDataPool_get();
+
+        if( p_data == NULL )
+        {
+            break;
+        }
+
+        s_taken[num_taken] = p_data;
+        num_taken++;
+    }
+
+    for(uint32_t ii=0U; ii<num_taken; ii++)
+    {
+        SensorDataPool_return(s_taken[ii]);
+    }
+
+    double elapsed = now_sec__() - start;
+
+    *p_ops = 2U * num_taken;
+
+    return elapsed;
+}
+/******************************************************************************/
+static double run_snl_find_hit__(uint32_t num_nodes, uint32_t *p_ops)
+{
+    uip_ipaddr_t ipaddrs[SENSOR_NODE_LIST_SIZE];
+
+    fill_node_list__(num_nodes);
+
+    for(uint32_t ii=0U; ii<num_nodes; ii++)
+    {
+        set_ipaddr__(&ipaddrs[ii], ii);
+    }
+
+    double start = now_sec__();
+
+    for(uint32_t ii=0U; ii<NUM_LOOKUPS; ii++)
+    {
+        s_sink = (uintptr_t) SNL_find(&ipaddrs[ii % num_nodes], false, NULL);
+    }
+
+    double elapsed = now_sec__() - start;
+
+    *p_ops = NUM_LOOKUPS;
+
+    return elapsed;
+}
+/******************************************************************************/
+static double run_snl_find_miss__(uint32_t num_nodes, uint32_t *p_ops)
+{
+    uip_ipaddr_t ipaddr;
+
+    fill_node_list__(num_nodes);
+    set_ipaddr__(&ipaddr, SENSOR_NODE_LIST_SIZE);
+
+    double start = now_sec__();
+
+    for(uint32_t ii=0U; ii<NUM_LOOKUPS; ii++)
+    {
+        s_sink = (uintptr_t) SNL_find(&ipaddr, false, NULL);
+    }
+
+    double elapsed = now_sec__() - start;
+
+    *p_ops = NUM_LOOKUPS;
+
+    return elapsed;
+}
+/******************************************************************************/
+/* The node that has data is the one just before the current node, so the
+ * search goes all the way round the list.
+ */
+static double run_next_node__(uint32_t num_nodes, uint32_t *p_ops)
+{
+    uip_ipaddr_t ipaddr;
+    SensorNode  *p_current;
+    SensorNode  *p_waiting;
+
+    fill_node_list__(num_nodes);
+
+    set_ipaddr__(&ipaddr, 0U);
+    p_current = SNL_find(&ipaddr, false, NULL);
+
+    set_ipaddr__(&ipaddr, num_nodes - 1U);
+    p_waiting = SNL_find(&ipaddr, false, NULL);
+
+    if( p_current != p_waiting )
+    {
+        SensorNode_set_num_samples_waiting(p_waiting, 1U);
+    }
+
+    double start = now_sec__();
+
+    for(uint32_t ii=0U; ii<NUM_LOOKUPS; ii++)
+    {
+        s_sink = (uintptr_t) determine_which_node_should_send_data(p_current);
+    }
+
+    double elapsed = now_sec__() - start;
+
+    *p_ops = NUM_LOOKUPS;
+
+    return elapsed;
+}
+/******************************************************************************/
+/* The bursts are built up in local lists first, as the radio receive path
+ * would, and that isn't timed.
+ */
+static double run_node_add__(uint32_t burst, uint32_t *p_ops)
+{
+    static SensorDataList s_batches[LIST_LEN];
+
+    uint32_t num_batches=0U;
+    double   start;
+
+    /* s_node joined the ready list last time, and is about to be initialised */
+    SensorNode_clear_ready_list();
+    SensorNode_init(&s_node);
+
+    for(uint32_t ii=0U; ii<LIST_LEN; ii++)
+    {
+        s_samples[ii].p_prev = NULL;
+        s_samples[ii].p_next = NULL;
+        s_samples[ii].seq32  = ii;
+    }
+
+    if( burst == 1U )
+    {
+        start = now_sec__();
+
+        for(uint32_t ii=0U; ii<LIST_LEN; ii++)
+        {
+            (void) SensorNode_add_data(&s_node, &s_samples[ii]);
+        }
+    }
+    else
+    {
+        for(uint32_t ii=0U; ii<LIST_LEN; ii++)
+        {
+            if( ( ii % burst ) == 0U )
+            {
+                SensorDataList_init(&s_batches[num_batches]);
+                num_batches++;
+            }
+
+            SensorDataList_push_back(&s_batches[num_batches - 1U], &s_samples[ii]);
+        }
+
+        start = now_sec__();
+
+        for(uint32_t ii=0U; ii<num_batches; ii++)
+        {
+            (void) SensorNode_add_data_batch(&s_node, &s_batches[ii], NULL);
+        }
+    }
+
+    double elapsed = now_sec__() - start;
+
+    *p_ops = LIST_LEN;
+
+    return elapsed;
+}
+/******************************************************************************/
+/* A sample goes to the last node, and the pass takes it off again */
+static double run_ready_pass__(uint32_t num_nodes, uint32_t *p_ops)
+{
+    uip_ipaddr_t ipaddr;
+    SensorNode  *p_waiting;
+
+    fill_node_list__(num_nodes);
+
+    /* The new nodes are ready (their long message is due) */
+    while( SensorNode_pop_ready() != NULL )
+    {
+    }
+
+    set_ipaddr__(&ipaddr, num_nodes - 1U);
+    p_waiting = SNL_find(&ipaddr, false, NULL);
+
+    double start = now_sec__();
+
+    for(uint32_t ii=0U; ii<NUM_LOOKUPS; ii++)
+    {
+        s_samples[0].p_prev = NULL;
+        s_samples[0].p_next = NULL;
+        s_samples[0].seq32  = ii;
+
+        (void) SensorNode_add_data(p_waiting, &s_samples[0]);
+
+        for(uint32_t num_ready = SensorNode_get_num_ready(); num_ready > 0U; num_ready--)
+        {
+            SensorNode *p_node = SensorNode_pop_ready();
+
+            while( p_node )
+            {
+                struct SensorData *p_data = SensorNode_remove_data(p_node);
+
+                if( p_data == NULL )
+                {
+                    break;
+                }
+
+                s_sink = (uintptr_t) p_data;
+            }
+        }
+    }
+
+    double elapsed = now_sec__() - start;
+
+    *p_ops = NUM_LOOKUPS;
+
+    return elapsed;
+}
+/******************************************************************************/
+static double time_list_insert__(uint32_t const *p_order)
+{
+    SensorDataList list;
+
+    SensorDataList_init(&list);
+
+    for(uint32_t ii=0U; ii<LIST_LEN; ii++)
+    {
+        s_samples[ii].p_prev = NULL;
+        s_samples[ii].p_next = NULL;
+        s_samples[ii].seq32  = p_order[ii];
+    }
+
+    double start = now_sec__();
+
+    for(uint32_t ii=0U; ii<LIST_LEN; ii++)
+    {
+        (void) SensorDataList_insert(&list, &s_samples[ii]);
+    }
+
+    return now_sec__() - start;
+}
+/******************************************************************************/
+static void fill_node_list__(uint32_t num_nodes)
+{
+    uip_ipaddr_t ipaddr;
+
+    SNL_init();
+
+    for(uint32_t ii=0U; ii<num_nodes; ii++)
+    {
+        set_ipaddr__(&ipaddr, ii);
+        (void) SNL_find(&ipaddr, true, NULL);
+    }
+}
+/******************************************************************************/
+/* fd00::212:4b00:0:<n> -- only the last bytes differ, as on a real mesh */
+static void set_ipaddr__(uip_ipaddr_t *p_ipaddr, uint32_t index)
+{
+    memset(p_ipaddr, 0, sizeof(*p_ipaddr));
+
+    p_ipaddr->u8[0]  = 0xfdU;
+    p_ipaddr->u8[9]  = 0x12U;
+    p_ipaddr->u8[10] = 0x4bU;
+    p_ipaddr->u8[14] = (uint8_t) ( ( index + 1U ) >> 8 );
+    p_ipaddr->u8[15] = (uint8_t) ( index + 1U );
+}
+/******************************************************************************/
+static bool load_budgets__(char const *p_filename)
+{
+    FILE *fp = fopen(p_filename, "r");
+    char  line[128];
+
+    if( fp == NULL )
+    {
+        return false;
+    }
+
+    while(
+            ( fgets(line, sizeof(line), fp) ) &&
+            ( s_num_budgets < MAX_BUDGETS )
+    )
+    {
+        Budget *p_budget = &s_budgets[s_num_budgets];
+
+        if(
+                ( line[0] != '#' ) &&
+                ( sscanf(line, "%47s %lf", p_budget->name, &p_budget->ns_per_op) == 2 )
+        )
+        {
+            s_num_budgets++;
+        }
+    }
+
+    fclose(fp);
+
+    return true;
+}
+/******************************************************************************/
+static Budget const* find_budget__(char const *p_name)
+{
+    for(uint32_t ii=0U; ii<s_num_budgets; ii++)
+    {
+        if( strcmp(s_budgets[ii].name, p_name) == 0 )
+        {
+            return &s_budgets[ii];
+        }
+    }
+
+    return NULL;
+}
+/******************************************************************************/
+static double now_sec__(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + ( (double) ts.tv_nsec * 1e-9 );
+}
+/******************************************************************************/
+/* xorshift32 -- the same orders on every run */
+static uint32_t rand__(void)
+{
+    s_rand_state ^= s_rand_state << 13;
+    s_rand_state ^= s_rand_state >> 17;
+    s_rand_state ^= s_rand_state << 5;
+
+    return s_rand_state;
+}
+/******************************************************************************/
@@ -0,0 +1,803 @@
+/**
+ * @file  databuffers_stress.c
+ * @brief Host stress test of the sensor node and data pool mutexes, on real threads
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Ingest producers and an upload consumer run on their own pthreads, as the
+ * 6LoWPAN receive path and the data upload client do on the target:
+ *
+ *   producer       Takes a sample with SensorDataPool_get(), gives it the next
+ *                  seq32 of one of its nodes and adds it with
+ *                  SensorNode_add_data(). A sample that isn't added goes back
+ *                  to the pool.
+ *   consumer       Takes the nodes in the ready list in turn, as the data
+ *                  upload client does, takes up to a batch of samples from
+ *                  each with SensorNode_remove_data() and returns them with
+ *                  SensorDataPool_return() -- optionally sleeping for each
+ *                  batch, as the modem write would. A node that still has
+ *                  data goes back in the ready list. After a pass that found
+ *                  nothing it sleeps for 1 ms.
+ *   status         Copies every node's metadata with SensorNode_read_info(),
+ *                  as the shell and the long messages do, then sleeps for
+ *                  100 us.
+ *
+ * For each sample the producer also updates its node's metadata, as the
+ * ingest path does for each packet, so that the copies can be checked: a
+ * copy that SensorNode_read_info() says is consistent but mixes two updates
+ * is torn, and fails the run.
+ *
+ * Each node belongs to one producer. When the run ends the consumer empties
+ * the nodes in the ready list, and each seq32 that was added is checked off
+ * against the ones that were removed: a sample added but never removed is
+ * lost (so is one left in a node that dropped out of the ready list), one
+ * removed twice is a duplicate, and one removed that was never added is
+ * unexpected. A sample that isn't back in the pool at the end has leaked. Any of these
+ * fails the run (exit 1), as does a torn copy.
+ *
+ * The POSIX RTOS shim times every lock of the node locks and the pool mutex,
+ * so the number of locks, how many had to wait, how many timed out and the
+ * wait and hold times are printed too, with the nodes' dropped sample and
+ * lock timeout counts. Running with more
+ * producers, nodes or a faster rate shows where the ingest path saturates.
+ *
+ * Usage: databuffers_stress [-t secs] [-p producers] [-n nodes] [-r sps]
+ *                           [-w window] [-b batch] [-u upload_us] [-s seed]
+ *
+ *   -t secs        How long the producers run for (default 10)
+ *   -p producers   Number of producer threads (default 4)
+ *   -n nodes       Number of sensor nodes (default SENSOR_NODE_LIST_SIZE)
+ *   -r sps         Samples per second from each node, 0 to run flat out
+ *                  (default 0)
+ *   -w window      Shuffle each node's seq32 within windows of this size, as
+ *                  the mesh does (default 1 -- in order)
+ *   -b batch       Samples the consumer takes from a node on each visit
+ *                  (default 21, as the data upload client)
+ *   -u upload_us   Time the consumer sleeps for each batch (default 0)
+ *   -s seed        Seed for the shuffles
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cmsis_os.h"
+#include "host_stubs.h"
+
+#include "sensor_data_pool.h"
+#include "sensor_node.h"
+#include "sensor_node_list.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+#define DEFAULT_RUN_TIME_S      10U
+#define DEFAULT_PRODUCERS       4U
+#define DEFAULT_BATCH           21U
+
+/** @brief The consumer's sleep after a pass that found nothing */
+#define CONSUMER_IDLE_US        1000U
+
+/** @brief The status thread's sleep after reading every node */
+#define STATUS_PERIOD_US        100U
+
+#define MAX_PRODUCERS           64U
+#define MAX_WINDOW              256U
+
+/** @brief seq32s each node can send in one run -- the size of its bitmap */
+#define MAX_SEQ_PER_NODE        ( 1UL << 22 )
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+/** @brief A node, and what has been added to it and removed from it */
+typedef struct {
+    SensorNode *p_node;
+
+    /* Written by the node's producer */
+    struct {
+        uint32_t next_seq;              /**< @brief First seq32 not yet in a window */
+        uint32_t order[MAX_WINDOW];     /**< @brief The current window, shuffled */
+        uint32_t order_len;
+        uint32_t order_pos;
+        uint64_t num_added;
+        uint64_t num_rejected;          /**< @brief SensorNode_add_data() failed */
+    } in;
+
+    /* Written by the consumer */
+    struct {
+        uint8_t *p_seen;                /**< @brief Bitmap of the seq32s removed */
+        uint32_t last_seq;
+        bool     have_last;
+        uint64_t num_removed;
+        uint64_t num_duplicates;
+        uint64_t num_unexpected;
+        uint64_t num_late;              /**< @brief Removed after a later seq32 */
+    } out;
+} NodeTrack;
+
+
+typedef struct {
+    pthread_t thread;
+    uint32_t  index;
+    uint32_t  rand_state;
+    uint64_t  num_pool_empty;           /**< @brief SensorDataPool_get() returned NULL */
+} Producer;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static void* producer_thread__(void *p_arg);
+static void* consumer_thread__(void *p_arg);
+static void* status_thread__(void *p_arg);
+static bool produce_one__(Producer *p_producer, uint32_t node_index);
+static uint32_t consume_pass__(void);
+static void check_off__(NodeTrack *p_track, uint32_t node_index, struct SensorData const *p_data);
+static void print_mutex_stats__(char const *p_name, osMutexId const *p_ids, uint32_t num_ids, double run_s);
+static void set_ipaddr__(uip_ipaddr_t *p_ipaddr, uint32_t index);
+static void add_ns__(struct timespec *p_ts, uint64_t ns);
+static double now_sec__(void);
+static uint32_t rand__(uint32_t *p_state);
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+extern osMutexId g_sensor_data_pool_mutexHandle;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+static struct {
+    uint32_t num_producers;
+    uint32_t num_nodes;
+    uint32_t rate_sps;
+    uint32_t window;
+    uint32_t batch;
+    uint32_t upload_us;
+} s_cfg = {
+    .num_producers = DEFAULT_PRODUCERS,
+    .num_nodes     = SENSOR_NODE_LIST_SIZE,
+    .rate_sps      = 0U,
+    .window        = 1U,
+    .batch         = DEFAULT_BATCH,
+    .upload_us     = 0U,
+};
+
+
+static NodeTrack s_nodes[SENSOR_NODE_LIST_SIZE];
+
+static osMutexId s_node_locks[SENSOR_NODE_LIST_SIZE];
+static uint32_t  s_num_node_locks;
+static Producer  s_producers[MAX_PRODUCERS];
+
+static volatile bool s_stop_producers;
+static volatile bool s_stop_consumer;
+
+
+/* Written by the status thread */
+static struct {
+    uint64_t num_reads;
+    uint64_t num_inconsistent;          /**< @brief SensorNode_read_info() gave up */
+    uint64_t num_torn;                  /**< @brief Said it was consistent, but wasn't */
+} s_status;
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+int main(int argc, char *argv[])
+{
+    uint32_t  run_time_s=DEFAULT_RUN_TIME_S;
+    uint32_t  seed=(uint32_t) time(NULL);
+    bool      args_ok=true;
+    pthread_t consumer;
+    pthread_t status;
+    int       opt;
+
+    while( ( opt = getopt(argc, argv, "t:p:n:r:w:b:u:s:") ) != -1 )
+    {
+        switch(opt)
+        {
+        case 't': run_time_s            = (uint32_t) strtoul(optarg, NULL, 10); break;
+        case 'p': s_cfg.num_producers   = (uint32_t) strtoul(optarg, NULL, 10); break;
+        case 'n': s_cfg.num_nodes       = (uint32_t) strtoul(optarg, NULL, 10); break;
+        case 'r': s_cfg.rate_sps        = (uint32_t) strtoul(optarg, NULL, 10); break;
+        case 'w': s_cfg.window          = (uint32_t) strtoul(optarg, NULL, 10); break;
+        case 'b': s_cfg.batch           = (uint32_t) strtoul(optarg, NULL, 10); break;
+        case 'u': s_cfg.upload_us       = (uint32_t) strtoul(optarg, NULL, 10); break;
+        case 's': seed                  = (uint32_t) strtoul(optarg, NULL, 10); break;
+        default:  args_ok               = false;                                break;
+        }
+    }
+
+    if(
+            ( !args_ok ) ||
+            ( run_time_s == 0U ) ||
+            ( s_cfg.num_producers == 0U ) || ( s_cfg.num_producers > MAX_PRODUCERS ) ||
+            ( s_cfg.num_nodes == 0U ) || ( s_cfg.num_nodes > SENSOR_NODE_LIST_SIZE ) ||
+            ( s_cfg.window == 0U ) || ( s_cfg.window > MAX_WINDOW ) ||
+            ( s_cfg.batch == 0U )
+    )
+    {
+        fprintf(stderr,
+                "Usage: %s [-t secs] [-p producers] [-n nodes] [-r sps] [-w window] [-b batch] [-u upload_us] [-s seed]\n",
+                argv[0]);
+        return 2;
+    }
+
+    if( !HostStubs_init() )
+    {
+        fprintf(stderr, "HostStubs_init() failed\n");
+        return 1;
+    }
+
+    SensorDataPool_init();
+    SNL_init();
+
+    for(uint32_t ii=0U; ii<s_cfg.num_nodes; ii++)
+    {
+        uip_ipaddr_t ipaddr;
+
+        set_ipaddr__(&ipaddr, ii);
+
+        s_nodes[ii].p_node     = SNL_find(&ipaddr, true, NULL);
+        s_nodes[ii].out.p_seen = calloc(MAX_SEQ_PER_NODE / 8U, 1U);
+
+        if( ( s_nodes[ii].p_node == NULL ) || ( s_nodes[ii].out.p_seen == NULL ) )
+        {
+            fprintf(stderr, "Failed to set up node %u\n", ii);
+            return 1;
+        }
+
+        (void) SensorNode_reset_data_stream(s_nodes[ii].p_node, (uint16_t) ii, 0U);
+    }
+
+    /* The different locks the nodes use */
+    for(uint32_t ii=0U; ii<s_cfg.num_nodes; ii++)
+    {
+        osMutexId lock = SensorNode_get_lock(s_nodes[ii].p_node);
+        uint32_t  jj;
+
+        for(jj=0U; ( jj < s_num_node_locks ) && ( s_node_locks[jj] != lock ); jj++)
+        {
+        }
+
+        if( jj == s_num_node_locks )
+        {
+            s_node_locks[s_num_node_locks] = lock;
+            s_num_node_locks++;
+        }
+    }
+
+    for(uint32_t ii=0U; ii<s_num_node_locks; ii++)
+    {
+        HostRtos_reset_mutex_stats(s_node_locks[ii]);
+    }
+
+    HostRtos_reset_mutex_stats(g_sensor_data_pool_mutexHandle);
+    SensorDataPool_reset_min_size();
+
+    double start = now_sec__();
+
+    pthread_create(&consumer, NULL, &consumer_thread__, NULL);
+    pthread_create(&status, NULL, &status_thread__, NULL);
+
+    for(uint32_t ii=0U; ii<s_cfg.num_producers; ii++)
+    {
+        s_producers[ii].index      = ii;
+        s_producers[ii].rand_state = ( seed * 2654435761U ) + ii + 1U;
+
+        pthread_create(&s_producers[ii].thread, NULL, &producer_thread__, &s_producers[ii]);
+    }
+
+    sleep(run_time_s);
+
+    s_stop_producers = true;
+
+    for(uint32_t ii=0U; ii<s_cfg.num_producers; ii++)
+    {
+        pthread_join(s_producers[ii].thread, NULL);
+    }
+
+    double run_s = now_sec__() - start;
+
+    /* Everything the producers added is in the nodes now -- let the consumer
+     * empty them before it stops.
+     */
+    s_stop_consumer = true;
+    pthread_join(consumer, NULL);
+    pthread_join(status, NULL);
+
+    uint64_t added=0U;
+    uint64_t rejected=0U;
+    uint64_t pool_empty=0U;
+    uint64_t removed=0U;
+    uint64_t duplicates=0U;
+    uint64_t unexpected=0U;
+    uint64_t late=0U;
+    uint64_t lost=0U;
+    uint64_t dropped=0U;
+
+    for(uint32_t ii=0U; ii<s_cfg.num_nodes; ii++)
+    {
+        NodeTrack const *p_track = &s_nodes[ii];
+        uint64_t         unique  = p_track->out.num_removed - p_track->out.num_duplicates - p_track->out.num_unexpected;
+
+        added      += p_track->in.num_added;
+        rejected   += p_track->in.num_rejected;
+        removed    += p_track->out.num_removed;
+        duplicates += p_track->out.num_duplicates;
+        unexpected += p_track->out.num_unexpected;
+        late       += p_track->out.num_late;
+        dropped    += SensorNode_get_num_dropped(p_track->p_node);
+
+        if( p_track->in.num_added > unique )
+        {
+            lost += p_track->in.num_added - unique;
+        }
+    }
+
+    for(uint32_t ii=0U; ii<s_cfg.num_producers; ii++)
+    {
+        pool_empty += s_producers[ii].num_pool_empty;
+    }
+
+    uint32_t leaked = SENSOR_DATA_POOL_SIZE - SensorDataPool_get_size();
+    bool     passed = ( lost == 0U ) && ( duplicates == 0U ) && ( unexpected == 0U ) && ( leaked == 0U ) &&
+                      ( s_status.num_torn == 0U );
+
+    printf("producers=%u nodes=%u rate_sps=%u window=%u batch=%u upload_us=%u run_s=%.2f\n",
+           s_cfg.num_producers,
+           s_cfg.num_nodes,
+           s_cfg.rate_sps,
+           s_cfg.window,
+           s_cfg.batch,
+           s_cfg.upload_us,
+           run_s);
+
+    print_mutex_stats__("sensor_node", s_node_locks, s_num_node_locks, run_s);
+    print_mutex_stats__("sensor_data_pool", &g_sensor_data_pool_mutexHandle, 1U, run_s);
+
+    printf("added=%llu rejected=%llu dropped=%llu lock_timeouts=%u pool_empty=%llu pool_min=%u removed=%llu "
+           "duplicates=%llu unexpected=%llu late=%llu lost=%llu leaked=%u "
+           "ingest_sps=%.0f info_reads=%llu info_inconsistent=%llu info_torn=%llu result=%s\n",
+           (unsigned long long) added,
+           (unsigned long long) rejected,
+           (unsigned long long) dropped,
+           SensorNode_get_num_lock_timeouts(),
+           (unsigned long long) pool_empty,
+           SensorDataPool_get_min_size(),
+           (unsigned long long) removed,
+           (unsigned long long) duplicates,
+           (unsigned long long) unexpected,
+           (unsigned long long) late,
+           (unsigned long long) lost,
+           leaked,
+           (double) added / run_s,
+           (unsigned long long) s_status.num_reads,
+           (unsigned long long) s_status.num_inconsistent,
+           (unsigned long long) s_status.num_torn,
+           ( passed ) ? "pass" : "fail");
+
+    return ( passed ) ? 0 : 1;
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+/* Producer n has nodes n, n + P, n + 2P... and sends one sample from each of
+ * them per round. With a rate, each round starts 1/rate seconds after the
+ * last.
+ */
+static void* producer_thread__(void *p_arg)
+{
+    Producer       *p_self = (Producer*) p_arg;
+    uint64_t        period_ns = ( s_cfg.rate_sps > 0U ) ? ( 1000000000ULL / s_cfg.rate_sps ) : 0U;
+    struct timespec next_round;
+
+    clock_gettime(CLOCK_MONOTONIC, &next_round);
+
+    while( !s_stop_producers )
+    {
+        for(uint32_t ii=p_self->index; ( ii < s_cfg.num_nodes ) && ( !s_stop_producers ); ii+=s_cfg.num_producers)
+        {
+            /* When the pool is empty the sample is sent again on the next
+             * round, as the node would resend it.
+             */
+            while( ( !produce_one__(p_self, ii) ) && ( !s_stop_producers ) )
+            {
+                if( period_ns > 0U )
+                {
+                    break;
+                }
+                sched_yield();
+            }
+        }
+
+        if( period_ns > 0U )
+        {
+            add_ns__(&next_round, period_ns);
+
+            while( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_round, NULL) == EINTR )
+            {
+            }
+        }
+    }
+
+    return NULL;
+}
+/******************************************************************************/
+/* One pass over all the nodes until told to stop, then until they're empty */
+static void* consumer_thread__(void *p_arg)
+{
+    (void) p_arg;
+
+    for(;;)
+    {
+        bool     stopping = s_stop_consumer;
+        uint32_t num      = consume_pass__();
+
+        if( ( stopping ) && ( num == 0U ) )
+        {
+            break;
+        }
+
+        if( num == 0U )
+        {
+            usleep(CONSUMER_IDLE_US);
+        }
+    }
+
+    return NULL;
+}
+/******************************************************************************/
+/* Returns false if there was no sample in the pool (nothing was sent) */
+static bool produce_one__(Producer *p_producer, uint32_t node_index)
+{
+    NodeTrack *p_track = &s_nodes[node_index];
+
+    if( p_track->in.order_pos >= p_track->in.order_len )
+    {
+        uint32_t base = p_track->in.next_seq;
+        uint32_t len  = s_cfg.window;
+
+        if( base >= MAX_SEQ_PER_NODE )
+        {
+            /* This node has sent all it can in one run */
+            return true;
+        }
+
+        if( ( MAX_SEQ_PER_NODE - base ) < len )
+        {
+            len = MAX_SEQ_PER_NODE - base;
+        }
+
+        for(uint32_t ii=0U; ii<len; ii++)
+        {
+            p_track->in.order[ii] = base + ii;
+        }
+
+        for(uint32_t ii=len - 1U; ii>0U; ii--)
+        {
+            uint32_t jj  = rand__(&p_producer->rand_state) % ( ii + 1U );
+            uint32_t tmp = p_track->in.order[ii];
+
+            p_track->in.order[ii] = p_track->in.order[jj];
+            p_track->in.order[jj] = tmp;
+        }
+
+        p_track->in.next_seq  = base + len;
+        p_track->in.order_len = len;
+        p_track->in.order_pos = 0U;
+    }
+
+    struct SensorData *p_data = SensorDataPool_get();
+
+    if( p_data == NULL )
+    {
+        p_producer->num_pool_empty++;
+        return false;
+    }
+
+    p_data->seq32 = p_track->in.order[p_track->in.order_pos];
+    p_data->mag_x = (int16_t) node_index;
+    p_track->in.order_pos++;
+
+    if( SensorNode_add_data(p_track->p_node, p_data) )
+    {
+        p_track->in.num_added++;
+    }
+    else
+    {
+        p_track->in.num_rejected++;
+        SensorDataPool_return(p_data);
+    }
+
+    /* Related values, so the status thread can tell a torn copy */
+    SensorNode *p_node = p_track->p_node;
+
+    SensorNode_begin_info_update(p_node);
+    p_node->num_rx_packets++;
+    p_node->num_samples_waiting = p_node->num_rx_packets;
+    p_node->lat                 = (double) p_node->num_rx_packets;
+    p_node->lon                 = -p_node->lat;
+    SensorNode_end_info_update(p_node);
+
+    return true;
+}
+/******************************************************************************/
+static void* status_thread__(void *p_arg)
+{
+    (void) p_arg;
+
+    while( !s_stop_consumer )
+    {
+        for(uint32_t ii=0U; ii<s_cfg.num_nodes; ii++)
+        {
+            SensorNodeInfo info;
+
+            if( !SensorNode_read_info(s_nodes[ii].p_node, &info) )
+            {
+                s_status.num_inconsistent++;
+            }
+            else if(
+                    ( info.num_samples_waiting != info.num_rx_packets ) ||
+                    ( info.lat != (double) info.num_rx_packets ) ||
+                    ( info.lon != -info.lat )
+            )
+            {
+                s_status.num_torn++;
+            }
+            else
+            {
+                /* A good copy */
+            }
+
+            s_status.num_reads++;
+        }
+
+        usleep(STATUS_PERIOD_US);
+    }
+
+    return NULL;
+}
+/******************************************************************************/
+/* Takes up to a batch from each node, as the data upload client does.
+ * Returns the number of samples taken.
+ */
+static uint32_t consume_pass__(void)
+{
+    uint32_t total=0U;
+
+    for(uint32_t num_ready = SensorNode_get_num_ready(); num_ready > 0U; num_ready--)
+    {
+        SensorNode *p_node = SensorNode_pop_ready();
+        NodeTrack  *p_track;
+        uint32_t    ii;
+        uint32_t    num=0U;
+
+        if( p_node == NULL )
+        {
+            break;
+        }
+
+        /* The nodes were the first created, so are in the same places in the
+         * node list as in s_nodes[]
+         */
+        if(
+                ( !SNL_get_index(p_node, &ii) ) ||
+                ( ii >= s_cfg.num_nodes )
+        )
+        {
+            continue;
+        }
+
+        p_track = &s_nodes[ii];
+
+        while( num < s_cfg.batch )
+        {
+            struct SensorData *p_data = SensorNode_remove_data(p_track->p_node);
+
+            if( p_data == NULL )
+            {
+                break;
+            }
+
+            check_off__(p_track, ii, p_data);
+            SensorDataPool_return(p_data);
+            num++;
+        }
+
+        if( SensorNode_get_data_size(p_node) > 0U )
+        {
+            SensorNode_mark_as_ready(p_node);
+        }
+
+        if( ( num > 0U ) && ( s_cfg.upload_us > 0U ) )
+        {
+            usleep(s_cfg.upload_us);
+        }
+
+        total += num;
+    }
+
+    return total;
+}
+/******************************************************************************/
+static void check_off__(NodeTrack *p_track, uint32_t node_index, struct SensorData const *p_data)
+{
+    uint32_t seq = p_data->seq32;
+
+    p_track->out.num_removed++;
+
+    if(
+            ( p_data->mag_x != (int16_t) node_index ) ||
+            ( seq >= MAX_SEQ_PER_NODE )
+    )
+    {
+        /* Not a sample this node's producer made */
+        p_track->out.num_unexpected++;
+        return;
+    }
+
+    uint8_t mask = (uint8_t) ( 1U << ( seq & 7U ) );
+
+    if( p_track->out.p_seen[seq >> 3] & mask )
+    {
+        p_track->out.num_duplicates++;
+        return;
+    }
+
+    p_track->out.p_seen[seq >> 3] |= mask;
+
+    if( ( p_track->out.have_last ) && ( seq < p_track->out.last_seq ) )
+    {
+        /* Arrived after a later seq32 had been uploaded -- it can only
+         * happen with a window.
+         */
+        p_track->out.num_late++;
+    }
+    else
+    {
+        p_track->out.last_seq  = seq;
+        p_track->out.have_last = true;
+    }
+}
+/******************************************************************************/
+/* The figures for a set of mutexes (the node locks) are added together, with
+ * the maximums the largest of any of them. busy_pct can be over 100 for a set.
+ */
+static void print_mutex_stats__(char const *p_name, osMutexId const *p_ids, uint32_t num_ids, double run_s)
+{
+    HostMutexStats stats;
+
+    memset(&stats, 0, sizeof(stats));
+
+    for(uint32_t ii=0U; ii<num_ids; ii++)
+    {
+        HostMutexStats one;
+
+        HostRtos_get_mutex_stats(p_ids[ii], &one);
+
+        stats.num_locks     += one.num_locks;
+        stats.num_contended += one.num_contended;
+        stats.num_timeouts  += one.num_timeouts;
+        stats.wait_total_ns += one.wait_total_ns;
+        stats.hold_total_ns += one.hold_total_ns;
+
+        if( one.wait_max_ns > stats.wait_max_ns )
+        {
+            stats.wait_max_ns = one.wait_max_ns;
+        }
+
+        if( one.hold_max_ns > stats.hold_max_ns )
+        {
+            stats.hold_max_ns = one.hold_max_ns;
+        }
+    }
+
+    double contended_pct = ( stats.num_locks > 0U ) ? ( ( 100.0 * (double) stats.num_contended ) / (double) stats.num_locks ) : 0.0;
+    double wait_mean_us  = ( stats.num_contended > 0U ) ? ( (double) stats.wait_total_ns / ( 1e3 * (double) stats.num_contended ) ) : 0.0;
+    double hold_mean_us  = ( stats.num_locks > 0U ) ? ( (double) stats.hold_total_ns / ( 1e3 * (double) stats.num_locks ) ) : 0.0;
+    double busy_pct      = ( 100.0 * (double) stats.hold_total_ns ) / ( 1e9 * run_s );
+
+    printf("mutex=%s mutexes=%u locks=%llu contended=%llu contended_pct=%.1f timeouts=%llu "
+           "wait_mean_us=%.2f wait_max_us=%.1f hold_mean_us=%.3f hold_max_us=%.1f busy_pct=%.1f\n",
+           p_name,
+           num_ids,
+           (unsigned long long) stats.num_locks,
+           (unsigned long long) stats.num_contended,
+           contended_pct,
+           (unsigned long long) stats.num_timeouts,
+           wait_mean_us,
+           (double) stats.wait_max_ns / 1e3,
+           hold_mean_us,
+           (double) stats.hold_max_ns / 1e3,
+           busy_pct);
+}
+/******************************************************************************/
+/* fd00::212:4b00:0:<n> -- only the last bytes differ, as on a real mesh */
+static void set_ipaddr__(uip_ipaddr_t *p_ipaddr, uint32_t index)
+{
+    memset(p_ipaddr, 0, sizeof(*p_ipaddr));
+
+    p_ipaddr->u8[0]  = 0xfdU;
+    p_ipaddr->u8[9]  = 0x12U;
+    p_ipaddr->u8[10] = 0x4bU;
+    p_ipaddr->u8[14] = (uint8_t) ( ( index + 1U ) >> 8 );
+    p_ipaddr->u8[15] = (uint8_t) ( index + 1U );
+}
+/******************************************************************************/
+static void add_ns__(struct timespec *p_ts, uint64_t ns)
+{
+    ns += (uint64_t) p_ts->tv_nsec;
+
+    p_ts->tv_sec  += (time_t) ( ns / 1000000000ULL );
+    p_ts->tv_nsec  = (long) ( ns % 1000000000ULL );
+}
+/******************************************************************************/
+static double now_sec__(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + ( (double) ts.tv_nsec / 1e9 );
+}
+/******************************************************************************/
+/* xorshift32 -- each producer has its own state */
+static uint32_t rand__(uint32_t *p_state)
+{
+    uint32_t x = *p_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    *p_state = x;
+
+    return x;
+}
+/******************************************************************************/
@@ -0,0 +1,1186 @@
+/**
+ * @file  gateway_loadgen.c
+ * @brief Host load generator and traffic replay for the whole upload path
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Runs the gateway's upload path on the POSIX RTOS shim -- ModemDrv_task(),
+ * ModemCtrl_start_task() and DataUploadClient_task(), with the real data
+ * buffers -- against the SIM808 emulator, and feeds the data buffers with
+ * sample streams from a number of emulated nodes, as the 6LoWPAN side does on
+ * the target.
+ *
+ * The streams are either synthetic (a fixed rate per node) or replayed from a
+ * file, and are shaped on their way in by the emulated mesh:
+ *
+ *   - loss      a sample is lost on the radio link
+ *   - reorder   samples are delivered in random order within a window
+ *   - burst     a node goes quiet for a while, then delivers its backlog at once
+ *
+ * The emulator's links go to a sink built in here, which decodes the "da"
+ * lines the gateway uploads and matches each sample to the time it was
+ * generated. The node index and sequence number travel in the mag_x, gyro_x
+ * and gyro_y fields of the sample. The sink takes UDP datagrams on the same
+ * port, and acknowledges each one with "ack,<seq>", as the server does.
+ *
+ * Injection starts once the gateway has opened its link to the server (the
+ * modem controller and the data upload client have their own start-up delays),
+ * and after the run the gateway is given time to drain its buffers.
+ *
+ * Usage: gateway_loadgen [options]
+ *
+ *   -t seconds     Injection time (default 60)
+ *   -d seconds     Drain time after injection (default 30)
+ *   -n nodes       Number of nodes (default 10)
+ *   -r samples/s   Sample rate per node (default 10)
+ *   -o window      Reorder window in samples (default 1 = in order)
+ *   -L permille    Chance a sample is lost on the radio link
+ *   -B permille    Chance each second that a node starts a burst
+ *   -b seconds     Length of a burst (default 5)
+ *   -f seconds     Server closes the link every this many seconds (0 = never)
+ *   -w bytes/s     Uplink bandwidth (default 8000)
+ *   -q             Quick send mode (AT+CIPQSEND=1)
+ *   -T             Transparent mode (AT+CIPMODE=1)
+ *   -s seed        Seed for the mesh and the emulator
+ *   -m module      Modem module: sim808 (default) or ec2x
+ *   -u             Upload over UDP (see DataUploadClient_set_udp())
+ *   -D permille    Chance a UDP datagram is lost (each way)
+ *   -R file        Replay the samples in file, one "<ms> <node> <seq>" per line
+ *   -v             Print the gateway's log messages
+ *
+ * A line of results is printed for each node, followed by a summary as
+ * "key=value" pairs on one line, so runs can be compared by a script.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "host_stubs.h"
+#include "sim808_emu.h"
+
+#include "alc_ipaddr_snprintf.h"
+#include "cmsis_os.h"
+#include "data_upload_client.h"
+#include "deferred_log.h"
+#include "modem_drv.h"
+#include "sensor_data_pool.h"
+#include "sensor_node_list.h"
+#include "sys/clock.h"
+#include "upload_metrics.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+#define DEFAULT_RUN_TIME_S      60U
+#define DEFAULT_DRAIN_TIME_S    30U
+#define DEFAULT_NUM_NODES       10U
+#define DEFAULT_RATE            10U
+#define DEFAULT_BURST_LEN_S     5U
+#define DEFAULT_BANDWIDTH_BPS   8000U
+
+#define MAX_NODES               SENSOR_NODE_LIST_SIZE
+#define MAX_HELD                4096U       /**< @brief Samples a node can hold back (in a burst or reorder window) */
+#define TRACK_LEN               16384U      /**< @brief Samples per node whose generation time is remembered */
+
+#define INGEST_PERIOD_MS        10U
+#define WARMUP_TIMEOUT_S        180U
+
+#define LATENCY_BUCKET_MS       10U
+#define NUM_LATENCY_BUCKETS     6000U       /**< @brief Up to 60 seconds, the rest go in the last bucket */
+
+/** @brief Timestamp of the first sample (any UTC time will do) */
+#define TS_EPOCH_S              1500000000UL
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+typedef struct {
+    uint32_t    run_time_s;
+    uint32_t    drain_time_s;
+    uint32_t    num_nodes;
+    uint32_t    rate;               /**< @brief Samples/s per node */
+    uint32_t    reorder_window;
+    uint32_t    loss_permille;
+    uint32_t    burst_permille;
+    uint32_t    burst_len_s;
+    uint32_t    flap_period_s;
+    bool        quick_send;
+    bool        transparent;
+    bool        udp;
+    bool        verbose;
+    char const *replay_file;
+} LoadOptions;
+
+
+typedef struct {
+    uint32_t ms;                    /**< @brief When the node generates the sample (from the start) */
+    uint32_t node;
+    uint32_t seq;
+} ReplaySample;
+
+
+typedef struct {
+    uint32_t seq;
+    uint32_t tick;                  /**< @brief When the sample was generated */
+} HeldSample;
+
+
+typedef enum {
+    TRACK_EMPTY=0,
+    TRACK_PENDING,                  /**< Generated, not yet seen by the sink */
+    TRACK_LOST,                     /**< Lost on its way to the gateway */
+    TRACK_RECEIVED
+} TrackState;
+
+
+typedef struct {
+    uint32_t seq;
+    uint32_t tick;
+    uint8_t  state;                 /**< @brief A TrackState */
+} TrackEntry;
+
+
+typedef struct {
+    uip_ipaddr_t ipaddr;
+    char         addr_str[40];
+
+    /* The emulated mesh */
+    uint32_t     num_generated;
+    HeldSample   held[MAX_HELD];
+    uint32_t     num_held;
+    bool         in_burst;
+    uint32_t     burst_end_tick;
+    uint32_t     last_burst_check_s;
+
+    /* Results */
+    uint32_t     num_radio_lost;    /**< @brief Lost on the radio link (-L) */
+    uint32_t     num_overflow;      /**< @brief Lost because the node's backlog was full */
+    uint32_t     num_pool_drops;    /**< @brief SensorDataPool_get() was empty */
+    uint32_t     num_rejected;      /**< @brief SensorNode_add_data() refused the sample */
+    uint32_t     num_accepted;      /**< @brief In the gateway's data buffers */
+    uint32_t     num_received;      /**< @brief Seen by the sink (once each) */
+    uint32_t     num_duplicates;    /**< @brief Seen by the sink more than once */
+    uint64_t     latency_total_ms;
+    uint32_t     latency_max_ms;
+} NodeState;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+static NodeState  s_nodes[MAX_NODES];
+static TrackEntry *s_track;         /**< @brief TRACK_LEN entries for each node */
+
+static struct {
+    ReplaySample *p_samples;
+    uint32_t      num_samples;
+    uint32_t      next;
+} s_replay;
+
+
+/** @brief Everything the sink thread shares with the ingest loop */
+static struct {
+    pthread_mutex_t   mutex;
+    int               listen_fd;
+    int               udp_fd;
+    uint16_t          port;
+    volatile bool     running;
+    pthread_t         thread;
+    pthread_t         udp_thread;
+    volatile uint32_t num_connects;
+    volatile uint64_t bytes;
+    uint32_t          num_gw_msgs;
+    uint32_t          num_nd_msgs;
+    uint32_t          num_um_msgs;
+    uint32_t          num_datagrams;
+    uint32_t          num_acks;
+    uint32_t          num_bad_lines;
+    uint32_t          num_untracked;    /**< @brief Received, but too old (or unknown) to match */
+    uint32_t          num_received;
+    uint32_t          num_received_in_run;
+    uint32_t          run_end_tick;
+    uint32_t          latency[NUM_LATENCY_BUCKETS];
+    uint32_t          latency_max_ms;
+} s_sink;
+
+
+static uint32_t s_rand_state;
+
+
+/* Not in a header -- the platform's start-up code declares it */
+void ModemCtrl_start_task(void const * argument);
+
+osThreadDef(modem_drv, ModemDrv_task, osPriorityNormal, 0, 512);
+osThreadDef(modem_ctrl, ModemCtrl_start_task, osPriorityNormal, 0, 512);
+osThreadDef(data_upload_client, DataUploadClient_task, osPriorityNormal, 0, 1024);
+osThreadDef(deferred_log, DeferredLog_task, osPriorityLow, 0, 512);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static bool parse_args__(int argc, char *argv[], LoadOptions *p_opts, Sim808EmuConfig *p_conf);
+static bool load_replay__(char const *p_filename, LoadOptions *p_opts);
+static void init_nodes__(uint32_t num_nodes);
+static bool start_gateway__(LoadOptions const *p_opts, Sim808EmuConfig const *p_conf);
+static void run__(LoadOptions const *p_opts);
+static void generate__(LoadOptions const *p_opts, uint32_t index, uint32_t seq, uint32_t now);
+static void release__(LoadOptions const *p_opts, uint32_t index, bool flush);
+static void deliver__(uint32_t index, HeldSample const *p_held);
+static bool all_received__(uint32_t num_nodes);
+static bool sink_start__(void);
+static void* sink_thread__(void *p_arg);
+static void* sink_udp_thread__(void *p_arg);
+static void sink_line__(int fd, char const *p_line);
+static void sink_data_line__(char const *p_line);
+static uint32_t latency_percentile__(uint32_t permille);
+static void print_results__(LoadOptions const *p_opts, uint32_t warmup_ms);
+static uint32_t rand__(void);
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+int main(int argc, char *argv[])
+{
+    LoadOptions     opts;
+    Sim808EmuConfig conf;
+    uint32_t        start_tick;
+    uint32_t        warmup_ms;
+
+    Sim808Emu_default_config(&conf);
+    conf.bandwidth_Bps = DEFAULT_BANDWIDTH_BPS;
+
+    if( !parse_args__(argc, argv, &opts, &conf) )
+    {
+        fprintf(stderr, "Usage: %s [-t s] [-d s] [-n nodes] [-r samples/s] [-o window] [-L permille]\n"
+                        "          [-B permille] [-b s] [-f s] [-w Bps] [-q] [-T] [-s seed] [-R file] [-v]\n"
+                        "          [-m sim808|ec2x] [-u] [-D permille]\n", argv[0]);
+        return 2;
+    }
+
+    if(
+            ( opts.replay_file ) &&
+            ( !load_replay__(opts.replay_file, &opts) )
+    )
+    {
+        fprintf(stderr, "Failed to read the replay file '%s'\n", opts.replay_file);
+        return 1;
+    }
+
+    s_rand_state = ( conf.seed ) ? conf.seed : 1U;
+    s_track      = calloc(opts.num_nodes * TRACK_LEN, sizeof(TrackEntry));
+
+    if(
+            ( s_track == NULL ) ||
+            ( !sink_start__() )
+    )
+    {
+        fprintf(stderr, "Failed to start the TCP sink\n");
+        return 1;
+    }
+
+    conf.sink_host = "127.0.0.1";
+    conf.sink_port = s_sink.port;
+
+    start_tick = osKernelSysTick();
+
+    if( !start_gateway__(&opts, &conf) )
+    {
+        fprintf(stderr, "Failed to start the gateway tasks\n");
+        return 1;
+    }
+
+    init_nodes__(opts.num_nodes);
+
+    /* Wait for the data upload client to open its link */
+    while( s_sink.num_connects == 0U )
+    {
+        if( ( osKernelSysTick() - start_tick ) >= ( WARMUP_TIMEOUT_S * 1000U ) )
+        {
+            fprintf(stderr, "The gateway did not connect to the server in %u s\n", WARMUP_TIMEOUT_S);
+            return 1;
+        }
+
+        osDelay(100U);
+    }
+
+    warmup_ms = osKernelSysTick() - start_tick;
+
+    run__(&opts);
+
+    /* So the log counts include the messages still waiting in the ring */
+    DeferredLog_flush(DEFERRED_LOG_RING_SIZE);
+    print_results__(&opts, warmup_ms);
+
+    Sim808Emu_stop();
+    s_sink.running = false;
+
+    return 0;
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static bool parse_args__(int argc, char *argv[], LoadOptions *p_opts, Sim808EmuConfig *p_conf)
+{
+    int opt;
+
+    memset(p_opts, 0, sizeof(*p_opts));
+
+    p_opts->run_time_s     = DEFAULT_RUN_TIME_S;
+    p_opts->drain_time_s   = DEFAULT_DRAIN_TIME_S;
+    p_opts->num_nodes      = DEFAULT_NUM_NODES;
+    p_opts->rate           = DEFAULT_RATE;
+    p_opts->reorder_window = 1U;
+    p_opts->burst_len_s    = DEFAULT_BURST_LEN_S;
+
+    while( ( opt = getopt(argc, argv, "t:d:n:r:o:L:B:b:f:w:qTs:R:vm:uD:") ) != -1 )
+    {
+        uint32_t val = ( optarg ) ? (uint32_t) strtoul(optarg, NULL, 10) : 0U;
+
+        switch(opt)
+        {
+        case 't': p_opts->run_time_s     = val;         break;
+        case 'd': p_opts->drain_time_s   = val;         break;
+        case 'n': p_opts->num_nodes      = val;         break;
+        case 'r': p_opts->rate           = val;         break;
+        case 'o': p_opts->reorder_window = val;         break;
+        case 'L': p_opts->loss_permille  = val;         break;
+        case 'B': p_opts->burst_permille = val;         break;
+        case 'b': p_opts->burst_len_s    = val;         break;
+        case 'f': p_opts->flap_period_s  = val;         break;
+        case 'w': p_conf->bandwidth_Bps  = val;         break;
+        case 'q': p_opts->quick_send     = true;        break;
+        case 'T': p_opts->transparent    = true;        break;
+        case 's': p_conf->seed           = val;         break;
+        case 'R': p_opts->replay_file    = optarg;      break;
+        case 'v': p_opts->verbose        = true;        break;
+        case 'u': p_opts->udp            = true;        break;
+        case 'D': p_conf->datagram_loss_permille = val; break;
+        case 'm':
+            if( strcmp(optarg, "ec2x") == 0 )
+            {
+                p_conf->dialect = SIM808_EMU_DIALECT_EC2X;
+            }
+            else if( strcmp(optarg, "sim808") != 0 )
+            {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+
+    if( p_opts->reorder_window == 0U )
+    {
+        p_opts->reorder_window = 1U;
+    }
+
+    return ( p_opts->run_time_s > 0U ) &&
+           ( p_opts->num_nodes > 0U ) &&
+           ( p_opts->num_nodes <= MAX_NODES ) &&
+           ( p_opts->reorder_window <= MAX_HELD ) &&
+           ( p_opts->loss_permille <= 1000U ) &&
+           ( p_opts->burst_permille <= 1000U ) &&
+           ( p_conf->datagram_loss_permille <= 1000U );
+}
+/******************************************************************************/
+static bool load_replay__(char const *p_filename, LoadOptions *p_opts)
+{
+    FILE        *p_file = fopen(p_filename, "r");
+    char         line[128];
+    uint32_t     capacity=0U;
+    uint32_t     max_node=0U;
+
+    if( p_file == NULL )
+    {
+        return false;
+    }
+
+    while( fgets(line, sizeof(line), p_file) )
+    {
+        unsigned int ms;
+        unsigned int node;
+        unsigned int seq;
+
+        if(
+                ( line[0] == '#' ) ||
+                ( sscanf(line, "%u %u %u", &ms, &node, &seq) != 3 ) ||
+                ( node >= MAX_NODES )
+        )
+        {
+            continue;
+        }
+
+        if( s_replay.num_samples == capacity )
+        {
+            capacity = ( capacity ) ? ( capacity * 2U ) : 1024U;
+            s_replay.p_samples = realloc(s_replay.p_samples, capacity * sizeof(ReplaySample));
+
+            if( s_replay.p_samples == NULL )
+            {
+                fclose(p_file);
+                return false;
+            }
+        }
+
+        s_replay.p_samples[s_replay.num_samples].ms   = ms;
+        s_replay.p_samples[s_replay.num_samples].node = node;
+        s_replay.p_samples[s_replay.num_samples].seq  = seq;
+        s_replay.num_samples++;
+
+        if( node > max_node )
+        {
+            max_node = node;
+        }
+    }
+
+    fclose(p_file);
+
+    /* The recording sets the number of nodes */
+    p_opts->num_nodes = max_node + 1U;
+
+    return ( s_replay.num_samples > 0U );
+}
+/******************************************************************************/
+static void init_nodes__(uint32_t num_nodes)
+{
+    for(uint32_t ii=0U; ii<num_nodes; ii++)
+    {
+        NodeState *p_node = &s_nodes[ii];
+
+        /* fd00::212:4b00:0:<n> -- a unique local address, as the mesh uses */
+        memset(&p_node->ipaddr, 0, sizeof(p_node->ipaddr));
+        p_node->ipaddr.u8[0]  = 0xfdU;
+        p_node->ipaddr.u8[9]  = 0x12U;
+        p_node->ipaddr.u8[10] = 0x4bU;
+        p_node->ipaddr.u8[14] = (uint8_t) ( ( ii + 1U ) >> 8 );
+        p_node->ipaddr.u8[15] = (uint8_t) ( ii + 1U );
+
+        alc_ipaddr_snprintf(p_node->addr_str, sizeof(p_node->addr_str), &p_node->ipaddr);
+    }
+}
+/******************************************************************************/
+static bool start_gateway__(LoadOptions const *p_opts, Sim808EmuConfig const *p_conf)
+{
+    static uint8_t const server_ipv4[4] = { 127U, 0U, 0U, 1U };
+
+    HostStubs_set_log_verbose(p_opts->verbose);
+    HostStubs_set_cloud_server(server_ipv4, 4000U);
+
+    if(
+            ( p_conf->dialect == SIM808_EMU_DIALECT_EC2X ) &&
+            ( !Modem_select_driver(&g_modem_drv_ec2x) )
+    )
+    {
+        return false;
+    }
+
+    if(
+            ( !HostStubs_init() ) ||
+            ( !Sim808Emu_start(p_conf) )
+    )
+    {
+        return false;
+    }
+
+    SensorDataPool_init();
+    SNL_init();
+
+    if(
+            ( osThreadCreate(osThread(deferred_log), NULL) == NULL ) ||
+            ( osThreadCreate(osThread(modem_drv), NULL) == NULL )
+    )
+    {
+        return false;
+    }
+
+    /* The driver task resets the modes when it starts -- so set them once it
+     * has. The modem controller sets up the link to suit them.
+     */
+    osDelay(100U);
+    Modem_set_transparent_mode(p_opts->transparent);
+    Modem_set_quick_send(p_opts->quick_send);
+    DataUploadClient_set_udp(p_opts->udp);
+
+    return ( osThreadCreate(osThread(modem_ctrl), NULL) != NULL ) &&
+           ( osThreadCreate(osThread(data_upload_client), NULL) != NULL );
+}
+/******************************************************************************/
+static void run__(LoadOptions const *p_opts)
+{
+    uint32_t start_tick = osKernelSysTick();
+    uint32_t last_flap  = start_tick;
+    uint32_t now        = start_tick;
+
+    s_sink.run_end_tick = start_tick + ( p_opts->run_time_s * 1000U );
+
+    while( ( now - start_tick ) < ( p_opts->run_time_s * 1000U ) )
+    {
+        uint32_t elapsed = now - start_tick;
+
+        if( s_replay.num_samples > 0U )
+        {
+            while(
+                    ( s_replay.next < s_replay.num_samples ) &&
+                    ( s_replay.p_samples[s_replay.next].ms <= elapsed )
+            )
+            {
+                ReplaySample const *p_sample = &s_replay.p_samples[s_replay.next];
+
+                generate__(p_opts, p_sample->node, p_sample->seq, now);
+                s_replay.next++;
+            }
+        }
+        else
+        {
+            uint32_t due = (uint32_t) ( ( (uint64_t) elapsed * p_opts->rate ) / 1000U );
+
+            for(uint32_t ii=0U; ii<p_opts->num_nodes; ii++)
+            {
+                while( s_nodes[ii].num_generated < due )
+                {
+                    generate__(p_opts, ii, s_nodes[ii].num_generated, now);
+                }
+            }
+        }
+
+        for(uint32_t ii=0U; ii<p_opts->num_nodes; ii++)
+        {
+            release__(p_opts, ii, false);
+        }
+
+        if(
+                ( p_opts->flap_period_s > 0U ) &&
+                ( ( now - last_flap ) >= ( p_opts->flap_period_s * 1000U ) )
+        )
+        {
+            Sim808Emu_inject(SIM808_FAULT_CLOSE);
+            last_flap = now;
+        }
+
+        osDelay(INGEST_PERIOD_MS);
+        now = osKernelSysTick();
+    }
+
+    /* The mesh gives up what it is still holding */
+    for(uint32_t ii=0U; ii<p_opts->num_nodes; ii++)
+    {
+        release__(p_opts, ii, true);
+    }
+
+    /* Give the gateway time to upload the rest */
+    start_tick = osKernelSysTick();
+
+    while(
+            ( !all_received__(p_opts->num_nodes) ) &&
+            ( ( osKernelSysTick() - start_tick ) < ( p_opts->drain_time_s * 1000U ) )
+    )
+    {
+        osDelay(100U);
+    }
+}
+/******************************************************************************/
+static void generate__(LoadOptions const *p_opts, uint32_t index, uint32_t seq, uint32_t now)
+{
+    NodeState  *p_node  = &s_nodes[index];
+    TrackEntry *p_track = &s_track[( index * TRACK_LEN ) + ( seq % TRACK_LEN )];
+    bool        lost    = ( ( rand__() % 1000U ) < p_opts->loss_permille );
+
+    p_node->num_generated++;
+
+    pthread_mutex_lock(&s_sink.mutex);
+    p_track->seq   = seq;
+    p_track->tick  = now;
+    p_track->state = ( lost ) ? TRACK_LOST : TRACK_PENDING;
+    pthread_mutex_unlock(&s_sink.mutex);
+
+    if(lost)
+    {
+        p_node->num_radio_lost++;
+    }
+    else if( p_node->num_held >= MAX_HELD )
+    {
+        pthread_mutex_lock(&s_sink.mutex);
+        p_track->state = TRACK_LOST;
+        pthread_mutex_unlock(&s_sink.mutex);
+
+        p_node->num_overflow++;
+    }
+    else
+    {
+        p_node->held[p_node->num_held].seq  = seq;
+        p_node->held[p_node->num_held].tick = now;
+        p_node->num_held++;
+    }
+}
+/******************************************************************************/
+static void release__(LoadOptions const *p_opts, uint32_t index, bool flush)
+{
+    NodeState *p_node  = &s_nodes[index];
+    uint32_t   now     = osKernelSysTick();
+    uint32_t   now_s   = now / 1000U;
+
+    /* Bursts start on a whole second */
+    if(
+            ( !flush ) &&
+            ( !p_node->in_burst ) &&
+            ( p_opts->burst_permille > 0U ) &&
+            ( now_s != p_node->last_burst_check_s )
+    )
+    {
+        p_node->last_burst_check_s = now_s;
+
+        if( ( rand__() % 1000U ) < p_opts->burst_permille )
+        {
+            p_node->in_burst       = true;
+            p_node->burst_end_tick = now + ( p_opts->burst_len_s * 1000U );
+        }
+    }
+
+    if(
+            ( p_node->in_burst ) &&
+            ( ( flush ) || ( (int32_t) ( now - p_node->burst_end_tick ) >= 0 ) )
+    )
+    {
+        p_node->in_burst = false;
+    }
+
+    if( p_node->in_burst )
+    {
+        return;
+    }
+
+    /* Samples leave the mesh in random order within the reorder window (and
+     * in order if the window is 1).
+     */
+    while(
+            ( p_node->num_held > 0U ) &&
+            ( ( flush ) || ( p_node->num_held >= p_opts->reorder_window ) )
+    )
+    {
+        uint32_t window = ( p_node->num_held < p_opts->reorder_window ) ? p_node->num_held : p_opts->reorder_window;
+        uint32_t idx    = ( window > 1U ) ? ( rand__() % window ) : 0U;
+
+        deliver__(index, &p_node->held[idx]);
+
+        memmove(&p_node->held[idx], &p_node->held[idx + 1U], ( p_node->num_held - idx - 1U ) * sizeof(HeldSample));
+        p_node->num_held--;
+    }
+}
+/******************************************************************************/
+/* What the 6LoWPAN side does with a sample from a node */
+static void deliver__(uint32_t index, HeldSample const *p_held)
+{
+    NodeState         *p_node = &s_nodes[index];
+    bool               created;
+    SensorNode        *p_sensor_node = SNL_find(&p_node->ipaddr, true, &created);
+    struct SensorData *p_data;
+
+    if( p_sensor_node == NULL )
+    {
+        p_node->num_rejected++;
+        return;
+    }
+
+    if(created)
+    {
+        (void) SensorNode_reset_data_stream(p_sensor_node, 1U, p_held->seq);
+    }
+
+    SensorNode_update_last_msg_rx_time(p_sensor_node);
+
+    p_data = SensorDataPool_get();
+
+    if( p_data == NULL )
+    {
+        p_node->num_pool_drops++;
+        return;
+    }
+
+    p_data->seq32        = p_held->seq;
+    p_data->ts_seconds   = (uint32_t) ( TS_EPOCH_S + ( p_held->tick / 1000U ) );
+    p_data->ts_hundreths = (uint8_t) ( ( p_held->tick % 1000U ) / 10U );
+    p_data->accel_fs     = 1U;
+    p_data->accel_x      = 0;
+    p_data->accel_y      = 0;
+    p_data->accel_z      = 1000;
+    p_data->gyro_x       = (int16_t) (uint16_t) ( p_held->seq >> 16 );
+    p_data->gyro_y       = (int16_t) (uint16_t) ( p_held->seq & 0xFFFFU );
+    p_data->gyro_z       = 0;
+    p_data->mag_x        = (int16_t) index;
+    p_data->mag_y        = 0;
+    p_data->mag_z        = 0;
+
+    if( SensorNode_add_data(p_sensor_node, p_data) )
+    {
+        p_node->num_accepted++;
+    }
+    else
+    {
+        /* Already in the buffer (or the node is busy) */
+        SensorDataPool_return(p_data);
+        p_node->num_rejected++;
+    }
+}
+/******************************************************************************/
+static bool all_received__(uint32_t num_nodes)
+{
+    bool done=true;
+
+    pthread_mutex_lock(&s_sink.mutex);
+
+    for(uint32_t ii=0U; ( ii < num_nodes ) && ( done ); ii++)
+    {
+        done = ( s_nodes[ii].num_received >= s_nodes[ii].num_accepted );
+    }
+
+    pthread_mutex_unlock(&s_sink.mutex);
+
+    return done;
+}
+/******************************************************************************/
+static bool sink_start__(void)
+{
+    struct sockaddr_in addr;
+    socklen_t          addrlen = sizeof(addr);
+
+    pthread_mutex_init(&s_sink.mutex, NULL);
+
+    s_sink.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if( s_sink.listen_fd < 0 )
+    {
+        return false;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = 0;
+
+    if(
+            ( bind(s_sink.listen_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ) ||
+            ( listen(s_sink.listen_fd, 4) != 0 ) ||
+            ( getsockname(s_sink.listen_fd, (struct sockaddr*) &addr, &addrlen) != 0 )
+    )
+    {
+        close(s_sink.listen_fd);
+        return false;
+    }
+
+    s_sink.port    = ntohs(addr.sin_port);
+    s_sink.running = true;
+
+    /* The datagrams come to the same port number */
+    s_sink.udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if(
+            ( s_sink.udp_fd < 0 ) ||
+            ( bind(s_sink.udp_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 )
+    )
+    {
+        return false;
+    }
+
+    if(
+            ( pthread_create(&s_sink.thread, NULL, &sink_thread__, NULL) != 0 ) ||
+            ( pthread_create(&s_sink.udp_thread, NULL, &sink_udp_thread__, NULL) != 0 )
+    )
+    {
+        return false;
+    }
+
+    pthread_detach(s_sink.thread);
+    pthread_detach(s_sink.udp_thread);
+
+    return true;
+}
+/******************************************************************************/
+static void* sink_thread__(void *p_arg)
+{
+    (void) p_arg;
+
+    while(s_sink.running)
+    {
+        int fd = accept(s_sink.listen_fd, NULL, NULL);
+
+        if( fd < 0 )
+        {
+            continue;
+        }
+
+        s_sink.num_connects++;
+
+        /* One link at a time -- the emulator closes the old one first. A line
+         * cut short by a closed link is lost, as it is on the real server.
+         */
+        char     line[256];
+        uint32_t len=0U;
+        uint8_t  buff[4096];
+        ssize_t  rx_len;
+
+        while( ( rx_len = recv(fd, buff, sizeof(buff), 0) ) > 0 )
+        {
+            s_sink.bytes += (uint64_t) rx_len;
+
+            for(ssize_t ii=0; ii<rx_len; ii++)
+            {
+                char ch = (char) buff[ii];
+
+                if( ch == '\n' )
+                {
+                    line[len] = '\0';
+                    sink_line__(fd, line);
+                    len = 0U;
+                }
+                else if( ( ch != '\r' ) && ( len < ( sizeof(line) - 1U ) ) )
+                {
+                    line[len] = ch;
+                    len++;
+                }
+            }
+        }
+
+        close(fd);
+    }
+
+    return NULL;
+}
+/******************************************************************************/
+/* Each datagram is "id,..." then "sq,<seq>", then the messages. A new link
+ * comes from a new port, and is sent the time as a new TCP link is.
+ */
+static void* sink_udp_thread__(void *p_arg)
+{
+    struct sockaddr_in peer;
+    uint16_t           last_port=0U;
+
+    (void) p_arg;
+
+    while(s_sink.running)
+    {
+        char      buff[2048];
+        socklen_t peerlen = sizeof(peer);
+        ssize_t   rx_len  = recvfrom(s_sink.udp_fd, buff, ( sizeof(buff) - 1U ), 0, (struct sockaddr*) &peer, &peerlen);
+
+        if( rx_len <= 0 )
+        {
+            continue;
+        }
+
+        buff[rx_len] = '\0';
+
+        s_sink.bytes += (uint64_t) rx_len;
+        s_sink.num_datagrams++;
+
+        char     reply[64];
+        int      reply_len=0;
+        bool     is_new_link = ( peer.sin_port != last_port );
+        char    *p_save=NULL;
+
+        last_port = peer.sin_port;
+
+        if(is_new_link)
+        {
+            s_sink.num_connects++;
+            reply_len = snprintf(reply, sizeof(reply), "tim,%lu\r\n", TS_EPOCH_S + ( osKernelSysTick() / 1000U ));
+        }
+
+        for(char *p_line=strtok_r(buff, "\r\n", &p_save); p_line!=NULL; p_line=strtok_r(NULL, "\r\n", &p_save))
+        {
+            unsigned int seq;
+
+            if( sscanf(p_line, "sq,%u", &seq) == 1 )
+            {
+                reply_len += snprintf(&reply[reply_len], ( sizeof(reply) - (size_t) reply_len ), "ack,%u\r\n", seq);
+                s_sink.num_acks++;
+            }
+            else if( strncmp(p_line, "id,", 3U) != 0 )
+            {
+                sink_line__(-1, p_line);
+            }
+            else
+            {
+                /* Every datagram carries the security string */
+            }
+        }
+
+        if( reply_len > 0 )
+        {
+            (void) sendto(s_sink.udp_fd, reply, (size_t) reply_len, 0, (struct sockaddr*) &peer, peerlen);
+        }
+    }
+
+    return NULL;
+}
+/******************************************************************************/
+static void sink_line__(int fd, char const *p_line)
+{
+    if( strncmp(p_line, "da,", 3U) == 0 )
+    {
+        sink_data_line__(p_line);
+    }
+    else if( strncmp(p_line, "nd,", 3U) == 0 )
+    {
+        s_sink.num_nd_msgs++;
+    }
+    else if( strncmp(p_line, "gw,", 3U) == 0 )
+    {
+        s_sink.num_gw_msgs++;
+    }
+    else if( strncmp(p_line, "um,", 3U) == 0 )
+    {
+        s_sink.num_um_msgs++;
+    }
+    else if( strncmp(p_line, "id,", 3U) == 0 )
+    {
+        /* The server sends the time when the gateway identifies itself */
+        char reply[32];
+        int  len = snprintf(reply, sizeof(reply), "tim,%lu\r\n", TS_EPOCH_S + ( osKernelSysTick() / 1000U ));
+
+        (void) send(fd, reply, (size_t) len, MSG_NOSIGNAL);
+    }
+    else if( p_line[0] != '\0' )
+    {
+        s_sink.num_bad_lines++;
+    }
+}
+/******************************************************************************/
+static void sink_data_line__(char const *p_line)
+{
+    unsigned int ts_seconds;
+    unsigned int ts_hundreths;
+    int          accel_x, accel_y, accel_z;
+    int          gyro_x, gyro_y, gyro_z;
+    int          mag_x, mag_y, mag_z;
+
+    if( sscanf(p_line, "da,%u.%u,%d,%d,%d,%d,%d,%d,%d,%d,%d",
+               &ts_seconds, &ts_hundreths,
+               &accel_x, &accel_y, &accel_z,
+               &gyro_x, &gyro_y, &gyro_z,
+               &mag_x, &mag_y, &mag_z) != 11 )
+    {
+        s_sink.num_bad_lines++;
+        return;
+    }
+
+    uint32_t now   = osKernelSysTick();
+    uint32_t index = (uint32_t) mag_x;
+    uint32_t seq   = ( (uint32_t) (uint16_t) gyro_x << 16 ) | (uint32_t) (uint16_t) gyro_y;
+
+    pthread_mutex_lock(&s_sink.mutex);
+
+    TrackEntry *p_track = ( ( mag_x >= 0 ) && ( index < MAX_NODES ) && ( s_nodes[index].num_generated > 0U ) )
+                        ? &s_track[( index * TRACK_LEN ) + ( seq % TRACK_LEN )]
+                        : NULL;
+
+    if(
+            ( p_track == NULL ) ||
+            ( p_track->seq != seq ) ||
+            ( p_track->state == TRACK_EMPTY )
+    )
+    {
+        s_sink.num_untracked++;
+    }
+    else if( p_track->state == TRACK_RECEIVED )
+    {
+        s_nodes[index].num_duplicates++;
+    }
+    else
+    {
+        NodeState *p_node     = &s_nodes[index];
+        uint32_t   latency_ms = now - p_track->tick;
+        uint32_t   bucket     = latency_ms / LATENCY_BUCKET_MS;
+
+        p_track->state = TRACK_RECEIVED;
+
+        p_node->num_received++;
+        p_node->latency_total_ms += latency_ms;
+
+        if( latency_ms > p_node->latency_max_ms )
+        {
+            p_node->latency_max_ms = latency_ms;
+        }
+
+        if( latency_ms > s_sink.latency_max_ms )
+        {
+            s_sink.latency_max_ms = latency_ms;
+        }
+
+        s_sink.latency[( bucket < NUM_LATENCY_BUCKETS ) ? bucket : ( NUM_LATENCY_BUCKETS - 1U )]++;
+        s_sink.num_received++;
+
+        if( (int32_t) ( now - s_sink.run_end_tick ) < 0 )
+        {
+            s_sink.num_received_in_run++;
+        }
+    }
+
+    pthread_mutex_unlock(&s_sink.mutex);
+}
+/******************************************************************************/
+static uint32_t latency_percentile__(uint32_t permille)
+{
+    uint64_t target = ( ( (uint64_t) s_sink.num_received * permille ) + 999U ) / 1000U;
+    uint64_t count  = 0U;
+
+    for(uint32_t ii=0U; ii<NUM_LATENCY_BUCKETS; ii++)
+    {
+        count += s_sink.latency[ii];
+
+        if( ( count >= target ) && ( count > 0U ) )
+        {
+            return ( ii + 1U ) * LATENCY_BUCKET_MS;
+        }
+    }
+
+    return 0U;
+}
+/******************************************************************************/
+static void print_results__(LoadOptions const *p_opts, uint32_t warmup_ms)
+{
+    Sim808EmuStats stats;
+    NodeState      total;
+    UploadMetrics  metrics;
+
+    Sim808Emu_get_stats(&stats);
+    UploadMetrics_get(clock_seconds(), &metrics);
+    memset(&total, 0, sizeof(total));
+
+    pthread_mutex_lock(&s_sink.mutex);
+
+    for(uint32_t ii=0U; ii<p_opts->num_nodes; ii++)
+    {
+        NodeState const *p_node = &s_nodes[ii];
+
+        printf("node=%u addr=%s generated=%u radio_lost=%u mesh_overflow=%u pool_drops=%u rejected=%u "
+               "accepted=%u received=%u duplicates=%u latency_mean_ms=%u latency_max_ms=%u\n",
+               ii,
+               p_node->addr_str,
+               p_node->num_generated,
+               p_node->num_radio_lost,
+               p_node->num_overflow,
+               p_node->num_pool_drops,
+               p_node->num_rejected,
+               p_node->num_accepted,
+               p_node->num_received,
+               p_node->num_duplicates,
+               ( p_node->num_received > 0U ) ? (uint32_t) ( p_node->latency_total_ms / p_node->num_received ) : 0U,
+               p_node->latency_max_ms);
+
+        total.num_generated  += p_node->num_generated;
+        total.num_radio_lost += p_node->num_radio_lost;
+        total.num_overflow   += p_node->num_overflow;
+        total.num_pool_drops += p_node->num_pool_drops;
+        total.num_rejected   += p_node->num_rejected;
+        total.num_accepted   += p_node->num_accepted;
+        total.num_received   += p_node->num_received;
+        total.num_duplicates += p_node->num_duplicates;
+    }
+
+    printf("mode=%s transport=%s nodes=%u rate=%u reorder=%u loss_permille=%u burst_permille=%u burst_s=%u flap_s=%u replay=%s "
+           "warmup_ms=%u run_s=%u generated=%u accepted=%u received=%u samples_per_s=%.1f "
+           "latency_p50_ms=%u latency_p99_ms=%u latency_max_ms=%u "
+           "radio_lost=%u mesh_overflow=%u pool_drops=%u rejected=%u undelivered=%u duplicates=%u untracked=%u "
+           "pool_min=%u log_errors=%u server_timestamps=%u links=%u gw_msgs=%u nd_msgs=%u um_msgs=%u bad_lines=%u "
+           "duc_uploads=%u duc_failures=%u duc_retransmits=%u duc_lag_p50_s=%u duc_lag_p99_s=%u "
+           "emu_closes=%u emu_send_failures=%u emu_datagrams_lost=%u sink_datagrams=%u sink_acks=%u sink_bytes=%llu\n",
+           ( ( Modem_get_driver() == &g_modem_drv_ec2x ) ? "ec2x" : ( p_opts->transparent ? "transparent" : ( p_opts->quick_send ? "qsend" : "mux" ) ) ),
+           ( ( p_opts->udp ) && ( !p_opts->transparent ) ) ? "udp" : "tcp",
+           p_opts->num_nodes,
+           ( s_replay.num_samples > 0U ) ? 0U : p_opts->rate,
+           p_opts->reorder_window,
+           p_opts->loss_permille,
+           p_opts->burst_permille,
+           p_opts->burst_len_s,
+           p_opts->flap_period_s,
+           ( p_opts->replay_file ) ? p_opts->replay_file : "-",
+           warmup_ms,
+           p_opts->run_time_s,
+           total.num_generated,
+           total.num_accepted,
+           total.num_received,
+           (double) s_sink.num_received_in_run / (double) p_opts->run_time_s,
+           latency_percentile__(500U),
+           latency_percentile__(990U),
+           s_sink.latency_max_ms,
+           total.num_radio_lost,
+           total.num_overflow,
+           total.num_pool_drops,
+           total.num_rejected,
+           ( total.num_accepted > total.num_received ) ? ( total.num_accepted - total.num_received ) : 0U,
+           total.num_duplicates,
+           s_sink.num_untracked,
+           SensorDataPool_get_min_size(),
+           HostStubs_get_num_log_errors(),
+           HostStubs_get_num_server_timestamps(),
+           s_sink.num_connects,
+           s_sink.num_gw_msgs,
+           s_sink.num_nd_msgs,
+           s_sink.num_um_msgs,
+           s_sink.num_bad_lines,
+           metrics.num_uploads,
+           metrics.num_upload_failures,
+           metrics.num_retransmissions,
+           UploadMetrics_lag_percentile_s(&metrics.lag, 50U),
+           UploadMetrics_lag_percentile_s(&metrics.lag, 99U),
+           stats.num_closes,
+           stats.num_send_failures,
+           stats.num_datagrams_lost,
+           s_sink.num_datagrams,
+           s_sink.num_acks,
+           (unsigned long long) s_sink.bytes);
+
+    pthread_mutex_unlock(&s_sink.mutex);
+}
+/******************************************************************************/
+/* xorshift32 -- repeatable for a given seed */
+static uint32_t rand__(void)
+{
+    s_rand_state ^= s_rand_state << 13;
+    s_rand_state ^= s_rand_state >> 17;
+    s_rand_state ^= s_rand_state << 5;
+
+    return s_rand_state;
+}
+/******************************************************************************/
@@ -0,0 +1,350 @@
+/**
+ * @file  modem_urc_matcher_bench.c
+ * @brief Host benchmark for the modem URC matcher
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Replays SIM808 UART captures through the line handling used by
+ * process_rx_char__() and reports the throughput in bytes/s. Each capture is
+ * run twice:
+ *
+ *   matcher    - the ModemUrcMatcher trie (as used by the driver now)
+ *   reference  - one AlcTestCharSeq per URC, then a chain of strcmp() calls
+ *                for the result codes (as the driver used to do it)
+ *
+ * Usage: modem_urc_matcher_bench [-n iterations] capture.txt [capture.txt ...]
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "modem_urc_matcher.h"
+
+#include "alc_test_char_seq.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+#define DEFAULT_ITERATIONS      200U
+#define MAX_LINE_LEN            255U
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+typedef struct {
+    uint32_t num_tokens;        /**< Result codes and URC's found */
+    uint32_t num_receive;       /**< +RECEIVE URC's found */
+    uint32_t num_lines;
+} BenchCounts;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static uint8_t* load_file__(char const *p_filename, size_t *p_len);
+static double now_sec__(void);
+static size_t skip_receive_data__(uint8_t const *p_buff, size_t len, size_t pos, uint32_t numbytes);
+static void run_matcher__(uint8_t const *p_buff, size_t len, BenchCounts *p_counts);
+static void run_reference__(uint8_t const *p_buff, size_t len, BenchCounts *p_counts);
+static void bench__(char const *p_name, char const *p_filename, uint8_t const *p_buff, size_t len, uint32_t iterations,
+                    void (*fn)(uint8_t const *p_buff, size_t len, BenchCounts *p_counts));
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+int main(int argc, char *argv[])
+{
+    uint32_t iterations=DEFAULT_ITERATIONS;
+    int      argi=1;
+
+    if( ( argc > 2 ) && ( strcmp(argv[1], "-n") == 0 ) )
+    {
+        iterations = (uint32_t) strtoul(argv[2], NULL, 10);
+        argi = 3;
+    }
+
+    if( ( argi >= argc ) || ( iterations == 0U ) )
+    {
+        fprintf(stderr, "Usage: %s [-n iterations] capture.txt [capture.txt ...]\n", argv[0]);
+        return 2;
+    }
+
+    if( !ModemUrcMatcher_init() )
+    {
+        fprintf(stderr, "ModemUrcMatcher_init() failed\n");
+        return 1;
+    }
+
+    for(; argi<argc; argi++)
+    {
+        size_t   len;
+        uint8_t *p_buff = load_file__(argv[argi], &len);
+
+        if( !p_buff )
+        {
+            fprintf(stderr, "Failed to read '%s'\n", argv[argi]);
+            return 1;
+        }
+
+        bench__("matcher",   argv[argi], p_buff, len, iterations, &run_matcher__);
+        bench__("reference", argv[argi], p_buff, len, iterations, &run_reference__);
+
+        free(p_buff);
+    }
+
+    return 0;
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static uint8_t* load_file__(char const *p_filename, size_t *p_len)
+{
+    uint8_t *p_buff=NULL;
+    FILE    *fp = fopen(p_filename, "rb");
+
+    if(fp)
+    {
+        if( fseek(fp, 0, SEEK_END) == 0 )
+        {
+            long len = ftell(fp);
+
+            if( ( len > 0 ) && ( fseek(fp, 0, SEEK_SET) == 0 ) )
+            {
+                p_buff = malloc((size_t) len);
+
+                if( ( p_buff ) && ( fread(p_buff, 1U, (size_t) len, fp) == (size_t) len ) )
+                {
+                    *p_len = (size_t) len;
+                }
+                else
+                {
+                    free(p_buff);
+                    p_buff = NULL;
+                }
+            }
+        }
+
+        fclose(fp);
+    }
+
+    return p_buff;
+}
+/******************************************************************************/
+static double now_sec__(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + ( (double) ts.tv_nsec * 1e-9 );
+}
+/******************************************************************************/
+static size_t skip_receive_data__(uint8_t const *p_buff, size_t len, size_t pos, uint32_t numbytes)
+{
+    /* The driver reads the CR/LF after the ':' and then the data, without
+     * passing them through the parser.
+     */
+    (void) p_buff;
+
+    pos += 2U + numbytes;
+
+    return ( pos < len ) ? pos : len;
+}
+/******************************************************************************/
+static void run_matcher__(uint8_t const *p_buff, size_t len, BenchCounts *p_counts)
+{
+    static AlcTestCharSeq s_command;
+    ModemUrcMatcher       matcher;
+
+    AlcTestCharSeq_clear(&s_command);
+    AlcTestCharSeq_set(&s_command, "AT+CIPSEND");
+    ModemUrcMatcher_reset(&matcher);
+
+    for(size_t pos=0U; pos<len; pos++)
+    {
+        uint8_t ch = p_buff[pos];
+
+        if( ch == '\r' )
+        {
+            p_counts->num_lines++;
+
+            AlcTestCharSeq_restart(&s_command);
+
+            if( ModemUrcMatcher_end_of_line(&matcher) != MODEM_TOKEN_NONE )
+            {
+                p_counts->num_tokens++;
+            }
+        }
+        else if( ch != '\n' )
+        {
+            AlcTestCharSeq_test_char(&s_command, ch);
+
+            if( ModemUrcMatcher_feed(&matcher, ch) == MODEM_TOKEN_RECEIVE )
+            {
+                p_counts->num_receive++;
+                pos = skip_receive_data__(p_buff, len, pos, ModemUrcMatcher_get_capture(&matcher, 1U)) - 1U;
+            }
+        }
+    }
+}
+/******************************************************************************/
+static void run_reference__(uint8_t const *p_buff, size_t len, BenchCounts *p_counts)
+{
+    static AlcTestCharSeq s_command;
+    static AlcTestCharSeq s_ipd;
+    static AlcTestCharSeq s_open;
+    static AlcTestCharSeq s_closed;
+
+    static char const * const result_codes[] = {
+        "OK", "FAIL", "ERROR", "busy p...", "SHUT OK", "5, CLOSE OK"
+    };
+
+    char     line[MAX_LINE_LEN + 1U];
+    size_t   line_len=0U;
+
+    AlcTestCharSeq_clear(&s_command);
+    AlcTestCharSeq_clear(&s_ipd);
+    AlcTestCharSeq_clear(&s_open);
+    AlcTestCharSeq_clear(&s_closed);
+
+    AlcTestCharSeq_set(&s_command, "AT+CIPSEND");
+    AlcTestCharSeq_set(&s_ipd,     "+RECEIVE,");
+    AlcTestCharSeq_set(&s_open,    "%d, CONNECT OK");
+    AlcTestCharSeq_set(&s_closed,  "%d, CLOSE OK");
+
+    for(size_t pos=0U; pos<len; pos++)
+    {
+        uint8_t ch = p_buff[pos];
+
+        if( ch == '\r' )
+        {
+            p_counts->num_lines++;
+
+            line[line_len] = '\0';
+
+            for(size_t ii=0U; ii<( sizeof(result_codes) / sizeof(result_codes[0]) ); ii++)
+            {
+                if( strcmp(line, result_codes[ii]) == 0 )
+                {
+                    p_counts->num_tokens++;
+                    break;
+                }
+            }
+
+            line_len = 0U;
+
+            AlcTestCharSeq_restart(&s_command);
+            AlcTestCharSeq_restart(&s_ipd);
+            AlcTestCharSeq_restart(&s_open);
+            AlcTestCharSeq_restart(&s_closed);
+        }
+        else if( ch != '\n' )
+        {
+            if( line_len < MAX_LINE_LEN )
+            {
+                line[line_len++] = (char) ch;
+            }
+
+            AlcTestCharSeq_test_char(&s_command, ch);
+
+            AlcTestCharSeq_test_char(&s_open, ch);
+            if( AlcTestCharSeq_is_found(&s_open) )
+            {
+                AlcTestCharSeq_restart(&s_open);
+                p_counts->num_tokens++;
+            }
+
+            AlcTestCharSeq_test_char(&s_closed, ch);
+            if( AlcTestCharSeq_is_found(&s_closed) )
+            {
+                AlcTestCharSeq_restart(&s_closed);
+            }
+
+            AlcTestCharSeq_test_char(&s_ipd, ch);
+            if( AlcTestCharSeq_is_found(&s_ipd) )
+            {
+                uint32_t portnum=0U;
+                uint32_t numbytes=0U;
+
+                AlcTestCharSeq_restart(&s_ipd);
+                p_counts->num_receive++;
+
+                /* The IPD_PORTNUM and IPD_NUMBYTES states */
+                for(pos++; ( pos < len ) && ( p_buff[pos] >= '0' ) && ( p_buff[pos] <= '9' ); pos++)
+                {
+                    portnum = ( portnum * 10U ) + (uint32_t) ( p_buff[pos] - '0' );
+                }
+                for(pos++; ( pos < len ) && ( p_buff[pos] >= '0' ) && ( p_buff[pos] <= '9' ); pos++)
+                {
+                    numbytes = ( numbytes * 10U ) + (uint32_t) ( p_buff[pos] - '0' );
+                }
+                (void) portnum;
+
+                pos = skip_receive_data__(p_buff, len, pos, numbytes) - 1U;
+                line_len = 0U;
+            }
+        }
+    }
+}
+/******************************************************************************/
+static void bench__(char const *p_name, char const *p_filename, uint8_t const *p_buff, size_t len, uint32_t iterations,
+                    void (*fn)(uint8_t const *p_buff, size_t len, BenchCounts *p_counts))
+{
+    BenchCounts counts;
+
+    memset(&counts, 0, sizeof(counts));
+
+    double start = now_sec__();
+
+    for(uint32_t ii=0U; ii<iterations; ii++)
+    {
+        fn(p_buff, len, &counts);
+    }
+
+    double elapsed = now_sec__() - start;
+    double bytes   = (double) len * (double) iterations;
+
+    printf("%-10s %s: %zu bytes x %u, %.3f s, %.0f bytes/s, %u lines, %u tokens, %u receive\n",
+            p_name,
+            p_filename,
+            len,
+            iterations,
+            elapsed,
+            ( elapsed > 0.0 ) ? ( bytes / elapsed ) : 0.0,
+            counts.num_lines / iterations,
+            counts.num_tokens / iterations,
+            counts.num_receive / iterations);
+}
+/******************************************************************************/
@@ -0,0 +1,535 @@
+/**
+ * @file  sim808_upload_bench.c
+ * @brief Host benchmark of upload throughput and reconnects through the SIM808 driver
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Runs ModemDrv_task() against the SIM808 emulator (or its EC2x dialect) and sends blocks of data
+ * on the data upload channel for a set time. The emulator's links go to a TCP
+ * sink -- either the one built in here, or one given with -H/-P. When a write
+ * fails the link is closed and opened again, and the time taken to get back
+ * to a working link is recorded.
+ *
+ * Usage: sim808_upload_bench [options]
+ *
+ *   -t seconds     Run time (default 10)
+ *   -b bytes       Block size for each write (default 1000)
+ *   -l ms          Modem reply latency
+ *   -r ms          Network round trip
+ *   -w bytes/s     Uplink bandwidth (0 = unlimited)
+ *   -q             Quick send mode (AT+CIPQSEND=1)
+ *   -T             Transparent mode (AT+CIPMODE=1)
+ *   -s seed        Seed for the random faults
+ *   -C permille    Chance AT+CIPSTART fails
+ *   -F permille    Chance AT+CIPSEND fails
+ *   -N permille    Chance a command gets no final result code
+ *   -x bytes       Server closes each link after this many bytes
+ *   -e bytes       Built-in sink sends a line back every this many bytes
+ *   -H host -P port  Use an external TCP sink
+ *   -m module      Modem module: sim808 (default) or ec2x
+ *
+ * The results are printed as "key=value" pairs on one line, so runs can be
+ * compared by a script.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "host_stubs.h"
+#include "http_server.h"
+#include "modem_drv.h"
+#include "modem_drv_conf.h"
+#include "sim808_emu.h"
+
+#include "cmsis_os.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+#define DEFAULT_RUN_TIME_S      10U
+#define DEFAULT_BLOCK_SIZE      1000U
+#define MAX_BLOCK_SIZE          1460U
+
+#define OPEN_TIMEOUT_MS         10000U
+#define WRITE_TIMEOUT_MS        4000U
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+typedef struct {
+    uint32_t run_time_s;
+    uint32_t block_size;
+    bool     quick_send;
+    bool     transparent;
+    uint32_t echo_every;        /**< @brief Built-in sink replies every N bytes */
+} BenchOptions;
+
+
+typedef struct {
+    uint64_t bytes_written;
+    uint64_t bytes_received;
+    uint32_t num_writes;
+    uint32_t num_write_failures;
+    uint32_t num_opens;
+    uint32_t num_open_failures;
+    uint32_t num_reconnects;
+    uint32_t reconnect_total_ms;
+    uint32_t reconnect_max_ms;
+} BenchResults;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+static struct {
+    int              listen_fd;
+    uint16_t         port;
+    uint32_t         echo_every;
+    volatile bool    running;
+    pthread_t        thread;
+    volatile uint64_t bytes;
+} s_sink;
+
+
+osThreadDef(modem_drv, ModemDrv_task, osPriorityNormal, 0, 512);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static bool parse_args__(int argc, char *argv[], BenchOptions *p_opts, Sim808EmuConfig *p_conf);
+static bool sink_start__(uint32_t echo_every);
+static void* sink_thread__(void *p_arg);
+static bool modem_setup__(BenchOptions const *p_opts);
+static void run__(BenchOptions const *p_opts, BenchResults *p_results);
+static uint32_t drain_rx_queue__(void);
+static void print_results__(BenchOptions const *p_opts, Sim808EmuConfig const *p_conf, BenchResults const *p_results);
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+int main(int argc, char *argv[])
+{
+    BenchOptions    opts;
+    BenchResults    results;
+    Sim808EmuConfig conf;
+
+    Sim808Emu_default_config(&conf);
+
+    if( !parse_args__(argc, argv, &opts, &conf) )
+    {
+        fprintf(stderr, "Usage: %s [-t s] [-b bytes] [-l ms] [-r ms] [-w Bps] [-q] [-T] [-s seed]\n"
+                        "          [-C permille] [-F permille] [-N permille] [-x bytes] [-e bytes]\n"
+                        "          [-H host -P port] [-m sim808|ec2x]\n", argv[0]);
+        return 2;
+    }
+
+    if( conf.sink_port == 0U )
+    {
+        if( !sink_start__(opts.echo_every) )
+        {
+            fprintf(stderr, "Failed to start the TCP sink\n");
+            return 1;
+        }
+
+        conf.sink_host = "127.0.0.1";
+        conf.sink_port = s_sink.port;
+    }
+
+    if(
+            ( conf.dialect == SIM808_EMU_DIALECT_EC2X ) &&
+            ( !Modem_select_driver(&g_modem_drv_ec2x) )
+    )
+    {
+        fprintf(stderr, "Failed to select the EC2x driver\n");
+        return 1;
+    }
+
+    if(
+            ( !HostStubs_init() ) ||
+            ( !Sim808Emu_start(&conf) ) ||
+            ( osThreadCreate(osThread(modem_drv), NULL) == NULL )
+    )
+    {
+        fprintf(stderr, "Failed to start the modem driver\n");
+        return 1;
+    }
+
+    if( !modem_setup__(&opts) )
+    {
+        fprintf(stderr, "Failed to set up the modem\n");
+        return 1;
+    }
+
+    memset(&results, 0, sizeof(results));
+
+    run__(&opts, &results);
+    print_results__(&opts, &conf, &results);
+
+    Sim808Emu_stop();
+    s_sink.running = false;
+
+    return 0;
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               FIRMWARE STAND-INS
+*******************************************************************************/
+
+/******************************************************************************/
+/* The driver tells the data upload client about its link -- nothing to do
+ * here, the results come from the write calls.
+ */
+void HttpServer_connection_opened(void)
+{
+}
+/******************************************************************************/
+void HttpServer_connection_closed(void)
+{
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static bool parse_args__(int argc, char *argv[], BenchOptions *p_opts, Sim808EmuConfig *p_conf)
+{
+    int opt;
+
+    memset(p_opts, 0, sizeof(*p_opts));
+
+    p_opts->run_time_s = DEFAULT_RUN_TIME_S;
+    p_opts->block_size = DEFAULT_BLOCK_SIZE;
+
+    while( ( opt = getopt(argc, argv, "t:b:l:r:w:qTs:C:F:N:x:e:H:P:m:") ) != -1 )
+    {
+        uint32_t val = ( optarg ) ? (uint32_t) strtoul(optarg, NULL, 10) : 0U;
+
+        switch(opt)
+        {
+        case 't': p_opts->run_time_s          = val;                break;
+        case 'b': p_opts->block_size          = val;                break;
+        case 'l': p_conf->latency_ms          = val;                break;
+        case 'r': p_conf->rtt_ms              = val;                break;
+        case 'w': p_conf->bandwidth_Bps       = val;                break;
+        case 'q': p_opts->quick_send          = true;               break;
+        case 'T': p_opts->transparent         = true;               break;
+        case 's': p_conf->seed                = val;                break;
+        case 'C': p_conf->connect_fail_permille = val;              break;
+        case 'F': p_conf->send_fail_permille  = val;                break;
+        case 'N': p_conf->no_reply_permille   = val;                break;
+        case 'x': p_conf->close_after_bytes   = val;                break;
+        case 'e': p_opts->echo_every          = val;                break;
+        case 'H': p_conf->sink_host           = optarg;             break;
+        case 'P': p_conf->sink_port           = (uint16_t) val;     break;
+        case 'm':
+            if( strcmp(optarg, "ec2x") == 0 )
+            {
+                p_conf->dialect = SIM808_EMU_DIALECT_EC2X;
+            }
+            else if( strcmp(optarg, "sim808") != 0 )
+            {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+
+    return ( p_opts->run_time_s > 0U ) &&
+           ( p_opts->block_size > 0U ) &&
+           ( p_opts->block_size <= MAX_BLOCK_SIZE ) &&
+           ( ( p_conf->sink_host == NULL ) || ( p_conf->sink_port > 0U ) );
+}
+/******************************************************************************/
+static bool sink_start__(uint32_t echo_every)
+{
+    struct sockaddr_in addr;
+    socklen_t          addrlen = sizeof(addr);
+
+    s_sink.listen_fd  = socket(AF_INET, SOCK_STREAM, 0);
+    s_sink.echo_every = echo_every;
+
+    if( s_sink.listen_fd < 0 )
+    {
+        return false;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = 0;
+
+    if(
+            ( bind(s_sink.listen_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ) ||
+            ( listen(s_sink.listen_fd, 4) != 0 ) ||
+            ( getsockname(s_sink.listen_fd, (struct sockaddr*) &addr, &addrlen) != 0 )
+    )
+    {
+        close(s_sink.listen_fd);
+        return false;
+    }
+
+    s_sink.port    = ntohs(addr.sin_port);
+    s_sink.running = true;
+
+    if( pthread_create(&s_sink.thread, NULL, &sink_thread__, NULL) != 0 )
+    {
+        return false;
+    }
+
+    pthread_detach(s_sink.thread);
+
+    return true;
+}
+/******************************************************************************/
+static void* sink_thread__(void *p_arg)
+{
+    (void) p_arg;
+
+    while(s_sink.running)
+    {
+        int fd = accept(s_sink.listen_fd, NULL, NULL);
+
+        if( fd < 0 )
+        {
+            continue;
+        }
+
+        /* One link at a time -- the emulator closes the old one first */
+        uint64_t since_echo=0U;
+        uint8_t  buff[4096];
+        ssize_t  len;
+
+        while( ( len = recv(fd, buff, sizeof(buff), 0) ) > 0 )
+        {
+            s_sink.bytes += (uint64_t) len;
+            since_echo   += (uint64_t) len;
+
+            while(
+                    ( s_sink.echo_every > 0U ) &&
+                    ( since_echo >= s_sink.echo_every )
+            )
+            {
+                static char const reply[] = "ack\r\n";
+
+                since_echo -= s_sink.echo_every;
+                (void) send(fd, reply, sizeof(reply) - 1U, MSG_NOSIGNAL);
+            }
+        }
+
+        close(fd);
+    }
+
+    return NULL;
+}
+/******************************************************************************/
+static bool modem_setup__(BenchOptions const *p_opts)
+{
+    bool success=false;
+
+    /* The driver task clears its command queue when it starts -- so let it
+     * start before anything is queued.
+     */
+    osDelay(100U);
+
+    for(uint32_t ii=0U; ( ii < 10U ) && ( !success ); ii++)
+    {
+        success = Modem_send_at();
+    }
+
+    Modem_set_transparent_mode(p_opts->transparent);
+    Modem_set_quick_send(p_opts->quick_send);
+
+    if( Modem_get_driver() == &g_modem_drv_ec2x )
+    {
+        /* The EC2x sockets need no set up */
+        return success;
+    }
+
+    /* The part of Modem_enable_gprs() that sets up the TCP mode (the rest
+     * needs the APN from the non-volatile settings, and waits for the
+     * network).
+     */
+    if(p_opts->transparent)
+    {
+        success &= Modem_run_command("AT+CIPMUX=0", SEARCH_OK|SEARCH_ERROR, 1000U);
+        success &= Modem_run_command("AT+CIPMODE=1", SEARCH_OK|SEARCH_ERROR, 1000U);
+        success &= Modem_set_echo(false);
+    }
+    else
+    {
+        success &= Modem_run_command("AT+CIPMODE=0", SEARCH_OK|SEARCH_ERROR, 1000U);
+        success &= Modem_run_command("AT+CIPMUX=1", SEARCH_OK|SEARCH_ERROR, 1000U);
+        success &= Modem_run_command( ( p_opts->quick_send ? "AT+CIPQSEND=1" : "AT+CIPQSEND=0" ), SEARCH_OK|SEARCH_ERROR, 1000U);
+    }
+
+    return success;
+}
+/******************************************************************************/
+static void run__(BenchOptions const *p_opts, BenchResults *p_results)
+{
+    static char block[MAX_BLOCK_SIZE];
+
+    uint32_t start_time = osKernelSysTick();
+    uint32_t lost_time  = start_time;
+    bool     is_open    = false;
+    bool     was_open   = false;
+
+    for(uint32_t ii=0U; ii<sizeof(block); ii++)
+    {
+        block[ii] = (char) ( 'A' + ( ii % 26U ) );
+    }
+
+    while( ( osKernelSysTick() - start_time ) < ( p_opts->run_time_s * 1000U ) )
+    {
+        if( !is_open )
+        {
+            p_results->num_opens++;
+
+            if( Modem_tcp_open(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, "127.0.0.1", 80U, OPEN_TIMEOUT_MS) )
+            {
+                is_open = true;
+
+                if(was_open)
+                {
+                    uint32_t ms = osKernelSysTick() - lost_time;
+
+                    p_results->num_reconnects++;
+                    p_results->reconnect_total_ms += ms;
+
+                    if( ms > p_results->reconnect_max_ms )
+                    {
+                        p_results->reconnect_max_ms = ms;
+                    }
+                }
+
+                was_open = true;
+            }
+            else
+            {
+                p_results->num_open_failures++;
+                osDelay(100U);
+            }
+            continue;
+        }
+
+        p_results->num_writes++;
+
+        if( Modem_tcp_write_buff(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, block, p_opts->block_size, WRITE_TIMEOUT_MS) )
+        {
+            p_results->bytes_written += p_opts->block_size;
+        }
+        else
+        {
+            /* Lost the link -- close it (it may already be closed) and
+             * open it again.
+             */
+            p_results->num_write_failures++;
+            lost_time = osKernelSysTick();
+            is_open   = false;
+            (void) Modem_tcp_close(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, 2000U);
+        }
+
+        p_results->bytes_received += drain_rx_queue__();
+    }
+
+    if(is_open)
+    {
+        (void) Modem_tcp_close(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, 2000U);
+    }
+
+    p_results->bytes_received += drain_rx_queue__();
+}
+/******************************************************************************/
+static uint32_t drain_rx_queue__(void)
+{
+    extern osMessageQId g_data_upload_client_rx_queueHandle;
+
+    uint32_t count=0U;
+    uint8_t  ch;
+
+    while( xQueueReceive(g_data_upload_client_rx_queueHandle, &ch, 0U) == pdTRUE )
+    {
+        count++;
+    }
+
+    return count;
+}
+/******************************************************************************/
+static void print_results__(BenchOptions const *p_opts, Sim808EmuConfig const *p_conf, BenchResults const *p_results)
+{
+    Sim808EmuStats stats;
+
+    Sim808Emu_get_stats(&stats);
+
+    printf("mode=%s block=%u latency_ms=%u rtt_ms=%u bandwidth_Bps=%u seed=%u "
+           "bytes=%llu throughput_Bps=%.0f writes=%u write_failures=%u "
+           "opens=%u open_failures=%u reconnects=%u reconnect_mean_ms=%u reconnect_max_ms=%u "
+           "rx_bytes=%llu emu_commands=%u emu_closes=%u emu_send_failures=%u emu_no_replies=%u "
+           "sink_bytes=%llu\n",
+           ( ( p_conf->dialect == SIM808_EMU_DIALECT_EC2X ) ? "ec2x" : ( p_opts->transparent ? "transparent" : ( p_opts->quick_send ? "qsend" : "mux" ) ) ),
+           p_opts->block_size,
+           p_conf->latency_ms,
+           p_conf->rtt_ms,
+           p_conf->bandwidth_Bps,
+           p_conf->seed,
+           (unsigned long long) p_results->bytes_written,
+           (double) p_results->bytes_written / (double) p_opts->run_time_s,
+           p_results->num_writes,
+           p_results->num_write_failures,
+           p_results->num_opens,
+           p_results->num_open_failures,
+           p_results->num_reconnects,
+           ( p_results->num_reconnects > 0U ) ? ( p_results->reconnect_total_ms / p_results->num_reconnects ) : 0U,
+           p_results->reconnect_max_ms,
+           (unsigned long long) p_results->bytes_received,
+           stats.num_commands,
+           stats.num_closes,
+           stats.num_send_failures,
+           stats.num_no_replies,
+           (unsigned long long) s_sink.bytes);
+}
+/******************************************************************************/
@@ -0,0 +1,56 @@
+/**
+ * @file  FreeRTOS.h
+ * @brief Host (POSIX) stand-in for the FreeRTOS types used by the firmware
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Only used by the host builds (see host_sim.mke). The include path puts
+ * source/host/inc before the platform folders, so this file is found instead
+ * of the real FreeRTOS header.
+ */
+
+#ifndef SOURCE_HOST_INC_FREERTOS_H_
+#define SOURCE_HOST_INC_FREERTOS_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+#define configTICK_RATE_HZ      1000U           /**< 1 tick = 1 ms, as on the target */
+
+#define pdFALSE                 ( (BaseType_t) 0 )
+#define pdTRUE                  ( (BaseType_t) 1 )
+#define pdPASS                  ( pdTRUE )
+#define pdFAIL                  ( pdFALSE )
+
+#define portMAX_DELAY           ( (TickType_t) 0xffffffffUL )
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+typedef long          BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t      TickType_t;
+
+
+
+
+#endif /* SOURCE_HOST_INC_FREERTOS_H_ */
@@ -0,0 +1,32 @@
+/**
+ * @file  alc_assert.h
+ * @brief Host (POSIX) stand-in for the firmware's assert
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+#ifndef SOURCE_HOST_INC_ALC_ASSERT_H_
+#define SOURCE_HOST_INC_ALC_ASSERT_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <assert.h>
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+#define ALC_ASSERT(cond)        assert(cond)
+
+
+
+
+#endif /* SOURCE_HOST_INC_ALC_ASSERT_H_ */
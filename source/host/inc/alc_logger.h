@@ -0,0 +1,63 @@
+/**
+ * @file  alc_logger.h
+ * @brief Host (POSIX) stand-in for the event logger
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * The target's logger writes to the external EEPROM. On the host the messages
+ * are counted, and printed to stderr if HostStubs_set_log_verbose() is set.
+ */
+
+#ifndef SOURCE_HOST_INC_ALC_LOGGER_H_
+#define SOURCE_HOST_INC_ALC_LOGGER_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdint.h>
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+typedef enum {
+    ALC_LOGGER_INFO=0,
+    ALC_LOGGER_WARNING,
+    ALC_LOGGER_ERROR,
+    ALC_LOGGER_CRITICAL,
+    NUM_ALC_LOGGER_LEVELS
+} AlcLoggerLevel;
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+void AlcLogger_log_info(char const *p_str);
+void AlcLogger_log_warning(char const *p_str);
+void AlcLogger_log_error(char const *p_str);
+void AlcLogger_log_critical(char const *p_str);
+void AlcLogger_log_printf(AlcLoggerLevel level, char const *p_fmt, ...) __attribute__((format(printf, 2, 3)));
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+#endif /* SOURCE_HOST_INC_ALC_LOGGER_H_ */
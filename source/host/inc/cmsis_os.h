@@ -0,0 +1,161 @@
+/**
+ * @file  cmsis_os.h
+ * @brief Host (POSIX) stand-in for the CMSIS-RTOS calls used by the firmware
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Implements the part of the CMSIS-RTOS (v1) API that the firmware modules
+ * use (threads and their signals, mutexes and queues), on top of pthreads, so the modules can be run unchanged on a PC. The
+ * system tick is CLOCK_MONOTONIC in milliseconds.
+ */
+
+#ifndef SOURCE_HOST_INC_CMSIS_OS_H_
+#define SOURCE_HOST_INC_CMSIS_OS_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "task.h"
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+#define osWaitForever               0xFFFFFFFFU
+#define osKernelSysTickFrequency    configTICK_RATE_HZ
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+typedef enum {
+    osOK                    = 0,
+    osEventSignal           = 0x08,
+    osEventMessage          = 0x10,
+    osEventTimeout          = 0x40,
+    osErrorParameter        = 0x80,
+    osErrorResource         = 0x81,
+    osErrorTimeoutResource  = 0xC1,
+    osErrorOS               = 0xFF
+} osStatus;
+
+
+typedef enum {
+    osPriorityIdle          = -3,
+    osPriorityLow           = -2,
+    osPriorityBelowNormal   = -1,
+    osPriorityNormal        = 0,
+    osPriorityAboveNormal   = 1,
+    osPriorityHigh          = 2,
+    osPriorityRealtime      = 3
+} osPriority;
+
+
+typedef void (*os_pthread)(void const *argument);
+
+typedef struct HostThread* osThreadId;
+typedef struct HostMutex*  osMutexId;
+typedef QueueHandle_t      osMessageQId;
+
+
+/** @brief What osSignalWait() returns */
+typedef struct {
+    osStatus      status;
+    union {
+        uint32_t  v;
+        void     *p;
+        int32_t   signals;
+    } value;
+} osEvent;
+
+
+typedef struct {
+    char const   *name;
+    os_pthread    pthread;
+    osPriority    tpriority;
+    uint32_t      instances;
+    uint32_t      stacksize;
+} osThreadDef_t;
+
+typedef struct {
+    uint32_t      dummy;
+} osMutexDef_t;
+
+
+/** @brief Host only -- how a mutex has been used since it was created (or
+ *         since HostRtos_reset_mutex_stats()).
+ */
+typedef struct {
+    uint64_t      num_locks;            /**< @brief Successful osMutexWait() calls */
+    uint64_t      num_contended;        /**< @brief ...that had to wait for another thread */
+    uint64_t      num_timeouts;         /**< @brief osMutexWait() calls that timed out */
+    uint64_t      wait_total_ns;        /**< @brief Time spent waiting, in the contended locks */
+    uint64_t      wait_max_ns;
+    uint64_t      hold_total_ns;        /**< @brief Time from each lock to its release */
+    uint64_t      hold_max_ns;
+} HostMutexStats;
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+#define osThreadDef(name, thread, priority, instances, stacksz)  \
+    const osThreadDef_t os_thread_def_##name = { #name, (thread), (priority), (instances), (stacksz) }
+#define osThread(name)              ( &os_thread_def_##name )
+
+#define osMutexDef(name)            const osMutexDef_t os_mutex_def_##name = { 0U }
+#define osMutex(name)               ( &os_mutex_def_##name )
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+uint32_t   osKernelSysTick(void);
+osStatus   osDelay(uint32_t millisec);
+
+osThreadId osThreadCreate(osThreadDef_t const *thread_def, void *argument);
+osThreadId osThreadGetId(void);
+
+int32_t    osSignalSet(osThreadId thread_id, int32_t signals);
+osEvent    osSignalWait(int32_t signals, uint32_t millisec);
+
+osMutexId  osMutexCreate(osMutexDef_t const *mutex_def);
+osStatus   osMutexWait(osMutexId mutex_id, uint32_t millisec);
+osStatus   osMutexRelease(osMutexId mutex_id);
+
+
+/* Host only -- for the benchmarks */
+void HostRtos_get_mutex_stats(osMutexId mutex_id, HostMutexStats *p_stats);
+void HostRtos_reset_mutex_stats(osMutexId mutex_id);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+#endif /* SOURCE_HOST_INC_CMSIS_OS_H_ */
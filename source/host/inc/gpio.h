@@ -0,0 +1,67 @@
+/**
+ * @file  gpio.h
+ * @brief Host (POSIX) stand-in for the GPIO pins used by the firmware
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Pulsing the modem reset pin resets the SIM808 emulator.
+ */
+
+#ifndef SOURCE_HOST_INC_GPIO_H_
+#define SOURCE_HOST_INC_GPIO_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdint.h>
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+#define MODEM_RST_GPIO_Port     ( (GPIO_TypeDef*) 0 )
+#define MODEM_RST_Pin           ( (uint16_t) 0x0001U )
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+typedef struct GPIO_TypeDef GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+#endif /* SOURCE_HOST_INC_GPIO_H_ */
@@ -0,0 +1,63 @@
+/**
+ * @file  host_stubs.h
+ * @brief Host (PC) stand-ins for the firmware objects the host builds don't link
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+#ifndef SOURCE_HOST_INC_HOST_STUBS_H_
+#define SOURCE_HOST_INC_HOST_STUBS_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief Create the mutexes and queues that the platform start-up code
+ *         creates on the target.
+ */
+bool HostStubs_init(void);
+
+
+/** @brief Set the cloud server address returned by Store_read_cloud_ipv4()
+ *         and Store_read_cloud_portnum().
+ */
+void HostStubs_set_cloud_server(uint8_t const ipv4[4], uint16_t portnum);
+
+
+/** @brief Print log messages to stderr (they are only counted otherwise) */
+void HostStubs_set_log_verbose(bool verbose);
+
+/** @brief Number of error (and critical) log messages so far */
+uint32_t HostStubs_get_num_log_errors(void);
+
+
+/** @brief Number of calls to have_timestamp_from_server() */
+uint32_t HostStubs_get_num_server_timestamps(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+#endif /* SOURCE_HOST_INC_HOST_STUBS_H_ */
@@ -0,0 +1,55 @@
+/**
+ * @file  queue.h
+ * @brief Host (POSIX) stand-in for the FreeRTOS queue functions used by the firmware
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+#ifndef SOURCE_HOST_INC_QUEUE_H_
+#define SOURCE_HOST_INC_QUEUE_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "FreeRTOS.h"
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+typedef struct HostQueue* QueueHandle_t;
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void          vQueueDelete(QueueHandle_t queue);
+BaseType_t    xQueueReset(QueueHandle_t queue);
+BaseType_t    xQueueSendToBack(QueueHandle_t queue, void const *p_item, TickType_t ticks_to_wait);
+BaseType_t    xQueueReceive(QueueHandle_t queue, void *p_item, TickType_t ticks_to_wait);
+UBaseType_t   uxQueueMessagesWaiting(QueueHandle_t queue);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+#endif /* SOURCE_HOST_INC_QUEUE_H_ */
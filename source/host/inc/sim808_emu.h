@@ -0,0 +1,154 @@
+/**
+ * @file  sim808_emu.h
+ * @brief Host (PC) emulator of the SIM808 modem, behind the UART6 driver.
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * The emulator runs in its own thread and provides UART6_read() and
+ * UART6_write(), so modem_drv_sim808.c talks to it exactly as it would talk to
+ * the modem. It implements the AT commands that the driver uses, in both the
+ * multi-connection (AT+CIPMUX=1) and transparent (AT+CIPMODE=1) modes.
+ * AT+CIPSTART opens a real TCP connection (or UDP socket), to a local sink if
+ * one is set in the configuration, and data from the sink comes back as
+ * "+RECEIVE". UDP datagrams can be lost on the way, in either direction.
+ *
+ * Timing (reply latency, network round trip and uplink bandwidth) and faults
+ * are set in Sim808EmuConfig. Faults that are drawn at random use a seeded
+ * generator, so a run can be repeated exactly. Faults can also be injected at
+ * any time with Sim808Emu_inject().
+ *
+ * With the EC2x dialect it speaks the Quectel socket commands used by
+ * modem_drv_ec2x.c instead (AT+QIOPEN, AT+QISEND, ...). A send is done once
+ * the data is written to the socket, and data from the sink comes back as
+ * '+QIURC: "recv"'.
+ */
+
+#ifndef SOURCE_HOST_INC_SIM808_EMU_H_
+#define SOURCE_HOST_INC_SIM808_EMU_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+#define SIM808_EMU_NUM_CHANNELS     6U
+#define SIM808_EMU_EC2X_CHANNELS    12U     /**< @brief Sockets in the EC2x dialect */
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+typedef enum {
+    SIM808_EMU_DIALECT_SIM808=0,        /**< SIMCom AT+CIP... commands */
+    SIM808_EMU_DIALECT_EC2X             /**< Quectel AT+QI... commands (always multi-connection) */
+} Sim808EmuDialect;
+
+
+typedef struct {
+    Sim808EmuDialect dialect;           /**< @brief The AT command set of the module */
+    uint32_t    latency_ms;             /**< @brief Delay before the modem replies to a command */
+    uint32_t    rtt_ms;                 /**< @brief Network round trip (CONNECT OK, SEND OK) */
+    uint32_t    bandwidth_Bps;          /**< @brief Uplink rate in bytes/s, 0 = unlimited */
+    uint32_t    send_size;              /**< @brief Size reported by AT+CIPSEND? */
+    uint32_t    creg_stat;              /**< @brief Registration status reported by AT+CREG? (AT+CEREG?) */
+    bool        echo;                   /**< @brief Echo after a reset (ATE1) */
+
+    char const *sink_host;              /**< @brief Connect here instead of the AT+CIPSTART address (may be NULL) */
+    uint16_t    sink_port;              /**< @brief Connect here instead of the AT+CIPSTART port (0 = don't) */
+
+    uint32_t    seed;                   /**< @brief Seed for the random faults */
+    uint32_t    connect_fail_permille;  /**< @brief Chance AT+CIPSTART fails */
+    uint32_t    send_fail_permille;     /**< @brief Chance AT+CIPSEND replies "SEND FAIL" */
+    uint32_t    no_reply_permille;      /**< @brief Chance a command gets no final result code */
+    uint32_t    close_after_bytes;      /**< @brief Server closes each TCP link after this many bytes (0 = never) */
+    uint32_t    datagram_loss_permille; /**< @brief Chance a UDP datagram is lost (each way) */
+} Sim808EmuConfig;
+
+
+typedef enum {
+    SIM808_FAULT_CLOSE=0,               /**< The server closes all open links now */
+    SIM808_FAULT_SEND_FAIL,             /**< The next AT+CIPSEND replies "SEND FAIL" */
+    SIM808_FAULT_NO_REPLY,              /**< The next command gets no final result code */
+    SIM808_FAULT_CONNECT_FAIL,          /**< The next AT+CIPSTART fails */
+    SIM808_FAULT_DEREGISTER,            /**< AT+CREG? reports not registered (until reset) */
+    SIM808_FAULT_DATAGRAM_LOSS,         /**< The next UDP datagram (either way) is lost */
+    NUM_SIM808_FAULTS
+} Sim808Fault;
+
+
+typedef struct {
+    uint32_t    num_commands;           /**< @brief AT commands received */
+    uint32_t    num_connects;           /**< @brief Links opened */
+    uint32_t    num_connect_failures;   /**< @brief AT+CIPSTART failures */
+    uint32_t    num_closes;             /**< @brief Links closed by the server (or a fault) */
+    uint32_t    num_sends;              /**< @brief AT+CIPSEND commands (or data mode writes) */
+    uint32_t    num_send_failures;      /**< @brief "SEND FAIL" replies */
+    uint32_t    num_no_replies;         /**< @brief Final result codes dropped */
+    uint32_t    num_resets;             /**< @brief Hard resets */
+    uint32_t    num_datagrams_lost;     /**< @brief UDP datagrams dropped (each way) */
+    uint64_t    bytes_to_server;        /**< @brief Data written to the server */
+    uint64_t    bytes_from_server;      /**< @brief Data passed back to the driver */
+} Sim808EmuStats;
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief Fill in the defaults: 20 ms latency, 100 ms round trip, 8 kB/s
+ *         uplink, echo on, no faults.
+ */
+void Sim808Emu_default_config(Sim808EmuConfig *p_conf);
+
+
+/** @brief Start the emulator thread.
+ * @note Must be called before ModemDrv_task() is started.
+ */
+bool Sim808Emu_start(Sim808EmuConfig const *p_conf);
+
+
+/** @brief Stop the emulator thread and close all links */
+void Sim808Emu_stop(void);
+
+
+/** @brief Reset the emulated modem (as the modem reset pin does) */
+void Sim808Emu_reset(void);
+
+
+/** @brief Inject a fault (see Sim808Fault) */
+void Sim808Emu_inject(Sim808Fault fault);
+
+
+/** @brief Take a copy of the emulator's counters */
+void Sim808Emu_get_stats(Sim808EmuStats *p_stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+#endif /* SOURCE_HOST_INC_SIM808_EMU_H_ */
@@ -0,0 +1,44 @@
+/**
+ * @file  stm32xxxx_hal.h
+ * @brief Host (POSIX) stand-in for the parts of the STM32 HAL the firmware uses
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+#ifndef SOURCE_HOST_INC_STM32XXXX_HAL_H_
+#define SOURCE_HOST_INC_STM32XXXX_HAL_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdint.h>
+
+#include "stm32xxxx_hal_cortex.h"
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief Milliseconds since start-up (the same clock as osKernelSysTick()) */
+uint32_t HAL_GetTick(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+#endif /* SOURCE_HOST_INC_STM32XXXX_HAL_H_ */
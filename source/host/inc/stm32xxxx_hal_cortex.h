@@ -0,0 +1,34 @@
+/**
+ * @file  stm32xxxx_hal_cortex.h
+ * @brief Host (POSIX) stand-in for the Cortex-M HAL calls the firmware uses
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+#ifndef SOURCE_HOST_INC_STM32XXXX_HAL_CORTEX_H_
+#define SOURCE_HOST_INC_STM32XXXX_HAL_CORTEX_H_
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief A task asked for a reboot -- the host build exits with an error */
+void HAL_NVIC_SystemReset(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+#endif /* SOURCE_HOST_INC_STM32XXXX_HAL_CORTEX_H_ */
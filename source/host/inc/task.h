@@ -0,0 +1,58 @@
+/**
+ * @file  task.h
+ * @brief Host (POSIX) stand-in for the FreeRTOS task functions used by the firmware
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * A critical section is one process-wide recursive mutex. That is enough to
+ * keep the short critical sections in the firmware atomic with respect to the
+ * other host threads.
+ */
+
+#ifndef SOURCE_HOST_INC_TASK_H_
+#define SOURCE_HOST_INC_TASK_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "FreeRTOS.h"
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+#define taskENTER_CRITICAL()        HostRtos_enter_critical()
+#define taskEXIT_CRITICAL()         HostRtos_exit_critical()
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+void HostRtos_enter_critical(void);
+void HostRtos_exit_critical(void);
+
+TickType_t xTaskGetTickCount(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+#endif /* SOURCE_HOST_INC_TASK_H_ */
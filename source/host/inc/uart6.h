@@ -0,0 +1,49 @@
+/**
+ * @file  uart6.h
+ * @brief Host (POSIX) stand-in for the modem UART driver
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * On the host the other end of UART6 is the SIM808 emulator (see
+ * sim808_emu.h) rather than the modem.
+ *
+ * UART6_read() returns early, with nothing read, when the reading thread is
+ * signalled.
+ */
+
+#ifndef SOURCE_HOST_INC_UART6_H_
+#define SOURCE_HOST_INC_UART6_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdint.h>
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+void    UART6_start(void);
+int32_t UART6_read(uint8_t *p_buff, uint32_t len, uint32_t timeout_ms);
+int32_t UART6_write(void const *p_buff, uint32_t len, uint32_t timeout_ms);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+#endif /* SOURCE_HOST_INC_UART6_H_ */
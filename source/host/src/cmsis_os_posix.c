@@ -0,0 +1,594 @@
+/**
+ * @file  cmsis_os_posix.c
+ * @brief Host (POSIX) implementation of the CMSIS-RTOS calls used by the firmware
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Threads are pthreads, mutexes are pthread mutexes with a timed lock, and
+ * queues are a fixed size ring of items guarded by a mutex and two condition
+ * variables. Thread priorities are ignored. Each thread has its signal flags
+ * guarded by a mutex, with a condition variable to wait on them.
+ *
+ * Each mutex keeps counts of its locks, contention and timeouts, and of the
+ * time spent waiting for it and holding it, for the benchmarks.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cmsis_os.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+struct HostThread {
+    pthread_t            thread;
+    os_pthread           fn;
+    void                *argument;
+    pthread_mutex_t      signal_mutex;
+    pthread_cond_t       signal_cond;
+    int32_t              signals;
+};
+
+
+struct HostMutex {
+    pthread_mutex_t      mutex;
+    uint64_t             lock_ns;       /**< @brief When the holder locked it */
+    HostMutexStats       stats;         /**< @brief Updated by the holder (timeouts atomically) */
+};
+
+
+struct HostQueue {
+    pthread_mutex_t      mutex;
+    pthread_cond_t       not_empty;
+    pthread_cond_t       not_full;
+    uint8_t             *p_items;
+    UBaseType_t          length;
+    UBaseType_t          item_size;
+    UBaseType_t          head;
+    UBaseType_t          count;
+};
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+static pthread_mutex_t s_critical_mutex;
+static pthread_once_t  s_critical_once = PTHREAD_ONCE_INIT;
+
+/* The calling thread -- set by thread_entry__(), or by osThreadGetId() for a
+ * thread that was not created by osThreadCreate() (e.g. main)
+ */
+static __thread struct HostThread *s_p_this_thread;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static void init_critical_mutex__(void);
+static void* thread_entry__(void *p_arg);
+static void init_thread_signals__(struct HostThread *p_thread);
+static void deadline_from_ms__(struct timespec *p_ts, uint32_t millisec);
+static uint64_t now_ns__(void);
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+uint32_t osKernelSysTick(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint32_t) ( ( (uint64_t) ts.tv_sec * 1000U ) + ( (uint64_t) ts.tv_nsec / 1000000U ) );
+}
+/******************************************************************************/
+osStatus osDelay(uint32_t millisec)
+{
+    struct timespec ts;
+
+    ts.tv_sec  = (time_t) ( millisec / 1000U );
+    ts.tv_nsec = (long) ( ( millisec % 1000U ) * 1000000U );
+
+    while( ( nanosleep(&ts, &ts) != 0 ) && ( errno == EINTR ) )
+    {
+        /* Interrupted by a signal -- sleep for the rest of the time */
+    }
+
+    return osEventTimeout;
+}
+/******************************************************************************/
+TickType_t xTaskGetTickCount(void)
+{
+    return osKernelSysTick();
+}
+/******************************************************************************/
+void HostRtos_enter_critical(void)
+{
+    pthread_once(&s_critical_once, &init_critical_mutex__);
+    pthread_mutex_lock(&s_critical_mutex);
+}
+/******************************************************************************/
+void HostRtos_exit_critical(void)
+{
+    pthread_mutex_unlock(&s_critical_mutex);
+}
+/******************************************************************************/
+osThreadId osThreadCreate(osThreadDef_t const *thread_def, void *argument)
+{
+    struct HostThread *p_thread=NULL;
+
+    if( ( thread_def ) && ( thread_def->pthread ) )
+    {
+        p_thread = calloc(1U, sizeof(*p_thread));
+
+        if(p_thread)
+        {
+            p_thread->fn       = thread_def->pthread;
+            p_thread->argument = argument;
+            init_thread_signals__(p_thread);
+
+            if( pthread_create(&p_thread->thread, NULL, &thread_entry__, p_thread) != 0 )
+            {
+                free(p_thread);
+                p_thread = NULL;
+            }
+            else
+            {
+                pthread_detach(p_thread->thread);
+            }
+        }
+    }
+
+    return p_thread;
+}
+/******************************************************************************/
+osThreadId osThreadGetId(void)
+{
+    if( s_p_this_thread == NULL )
+    {
+        /* Not created by osThreadCreate() -- never freed, like a task */
+        s_p_this_thread = calloc(1U, sizeof(*s_p_this_thread));
+
+        if(s_p_this_thread)
+        {
+            s_p_this_thread->thread = pthread_self();
+            init_thread_signals__(s_p_this_thread);
+        }
+    }
+
+    return s_p_this_thread;
+}
+/******************************************************************************/
+int32_t osSignalSet(osThreadId thread_id, int32_t signals)
+{
+    int32_t previous;
+
+    if( thread_id == NULL )
+    {
+        return (int32_t) 0x80000000U;
+    }
+
+    pthread_mutex_lock(&thread_id->signal_mutex);
+    previous = thread_id->signals;
+    thread_id->signals |= signals;
+    pthread_cond_broadcast(&thread_id->signal_cond);
+    pthread_mutex_unlock(&thread_id->signal_mutex);
+
+    return previous;
+}
+/******************************************************************************/
+osEvent osSignalWait(int32_t signals, uint32_t millisec)
+{
+    struct HostThread *p_thread = osThreadGetId();
+    osEvent         event = { .status = osEventTimeout, .value = { .signals = 0 } };
+    struct timespec deadline;
+
+    if( p_thread == NULL )
+    {
+        event.status = osErrorOS;
+        return event;
+    }
+
+    deadline_from_ms__(&deadline, millisec);
+
+    pthread_mutex_lock(&p_thread->signal_mutex);
+
+    for(;;)
+    {
+        /* 0 waits for any signal */
+        int32_t set = ( signals == 0 ) ? p_thread->signals : ( p_thread->signals & signals );
+
+        if(
+                ( ( signals == 0 ) && ( set != 0 ) ) ||
+                ( ( signals != 0 ) && ( set == signals ) )
+        )
+        {
+            p_thread->signals &= ~set;
+            event.status = osEventSignal;
+            event.value.signals = set;
+            break;
+        }
+
+        if( millisec == 0U )
+        {
+            event.status = osOK;
+            break;
+        }
+
+        if( millisec == osWaitForever )
+        {
+            pthread_cond_wait(&p_thread->signal_cond, &p_thread->signal_mutex);
+        }
+        else if( pthread_cond_timedwait(&p_thread->signal_cond, &p_thread->signal_mutex, &deadline) == ETIMEDOUT )
+        {
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&p_thread->signal_mutex);
+
+    return event;
+}
+/******************************************************************************/
+osMutexId osMutexCreate(osMutexDef_t const *mutex_def)
+{
+    struct HostMutex *p_mutex = calloc(1U, sizeof(*p_mutex));
+
+    (void) mutex_def;
+
+    if(p_mutex)
+    {
+        pthread_mutexattr_t attr;
+
+        /* FreeRTOS mutexes created by osMutexCreate() are not recursive, but
+         * an error check mutex catches a task locking one twice.
+         */
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
+        pthread_mutex_init(&p_mutex->mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+    }
+
+    return p_mutex;
+}
+/******************************************************************************/
+osStatus osMutexWait(osMutexId mutex_id, uint32_t millisec)
+{
+    uint64_t start_ns;
+    int      ret;
+
+    if( mutex_id == NULL )
+    {
+        return osErrorParameter;
+    }
+
+    /* Try first, so an uncontended lock isn't counted as a wait */
+    ret      = pthread_mutex_trylock(&mutex_id->mutex);
+    start_ns = now_ns__();
+
+    if( ( ret == EBUSY ) && ( millisec > 0U ) )
+    {
+        if( millisec == osWaitForever )
+        {
+            ret = pthread_mutex_lock(&mutex_id->mutex);
+        }
+        else
+        {
+            struct timespec deadline;
+
+            deadline_from_ms__(&deadline, millisec);
+            ret = pthread_mutex_timedlock(&mutex_id->mutex, &deadline);
+        }
+
+        if( ret == 0 )
+        {
+            uint64_t wait_ns = now_ns__() - start_ns;
+
+            mutex_id->stats.num_contended++;
+            mutex_id->stats.wait_total_ns += wait_ns;
+
+            if( wait_ns > mutex_id->stats.wait_max_ns )
+            {
+                mutex_id->stats.wait_max_ns = wait_ns;
+            }
+        }
+    }
+
+    if( ret == 0 )
+    {
+        mutex_id->stats.num_locks++;
+        mutex_id->lock_ns = now_ns__();
+
+        return osOK;
+    }
+
+    if( ( ret == ETIMEDOUT ) || ( ret == EBUSY ) )
+    {
+        __atomic_add_fetch(&mutex_id->stats.num_timeouts, 1U, __ATOMIC_RELAXED);
+
+        return osErrorTimeoutResource;
+    }
+
+    return osErrorResource;
+}
+/******************************************************************************/
+osStatus osMutexRelease(osMutexId mutex_id)
+{
+    if( mutex_id == NULL )
+    {
+        return osErrorParameter;
+    }
+
+    uint64_t hold_ns = now_ns__() - mutex_id->lock_ns;
+
+    mutex_id->stats.hold_total_ns += hold_ns;
+
+    if( hold_ns > mutex_id->stats.hold_max_ns )
+    {
+        mutex_id->stats.hold_max_ns = hold_ns;
+    }
+
+    return ( pthread_mutex_unlock(&mutex_id->mutex) == 0 ) ? osOK : osErrorResource;
+}
+/******************************************************************************/
+void HostRtos_get_mutex_stats(osMutexId mutex_id, HostMutexStats *p_stats)
+{
+    if( ( mutex_id ) && ( p_stats ) )
+    {
+        pthread_mutex_lock(&mutex_id->mutex);
+        *p_stats = mutex_id->stats;
+        pthread_mutex_unlock(&mutex_id->mutex);
+
+        p_stats->num_timeouts = __atomic_load_n(&mutex_id->stats.num_timeouts, __ATOMIC_RELAXED);
+    }
+}
+/******************************************************************************/
+void HostRtos_reset_mutex_stats(osMutexId mutex_id)
+{
+    if(mutex_id)
+    {
+        pthread_mutex_lock(&mutex_id->mutex);
+        memset(&mutex_id->stats, 0, sizeof(mutex_id->stats));
+        pthread_mutex_unlock(&mutex_id->mutex);
+    }
+}
+/******************************************************************************/
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct HostQueue *p_queue=NULL;
+
+    if( ( length > 0U ) && ( item_size > 0U ) )
+    {
+        p_queue = calloc(1U, sizeof(*p_queue));
+
+        if(p_queue)
+        {
+            p_queue->p_items = calloc(length, item_size);
+
+            if( p_queue->p_items == NULL )
+            {
+                free(p_queue);
+                return NULL;
+            }
+
+            p_queue->length    = length;
+            p_queue->item_size = item_size;
+
+            pthread_mutex_init(&p_queue->mutex, NULL);
+            pthread_cond_init(&p_queue->not_empty, NULL);
+            pthread_cond_init(&p_queue->not_full, NULL);
+        }
+    }
+
+    return p_queue;
+}
+/******************************************************************************/
+void vQueueDelete(QueueHandle_t queue)
+{
+    if(queue)
+    {
+        pthread_cond_destroy(&queue->not_full);
+        pthread_cond_destroy(&queue->not_empty);
+        pthread_mutex_destroy(&queue->mutex);
+        free(queue->p_items);
+        free(queue);
+    }
+}
+/******************************************************************************/
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    if(queue)
+    {
+        pthread_mutex_lock(&queue->mutex);
+        queue->head  = 0U;
+        queue->count = 0U;
+        pthread_cond_broadcast(&queue->not_full);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+
+    return pdPASS;
+}
+/******************************************************************************/
+BaseType_t xQueueSendToBack(QueueHandle_t queue, void const *p_item, TickType_t ticks_to_wait)
+{
+    BaseType_t      ret=pdFAIL;
+    struct timespec deadline;
+
+    if( ( queue == NULL ) || ( p_item == NULL ) )
+    {
+        return pdFAIL;
+    }
+
+    deadline_from_ms__(&deadline, ticks_to_wait);
+
+    pthread_mutex_lock(&queue->mutex);
+
+    while( ( queue->count >= queue->length ) && ( ticks_to_wait > 0U ) )
+    {
+        if( ticks_to_wait == portMAX_DELAY )
+        {
+            pthread_cond_wait(&queue->not_full, &queue->mutex);
+        }
+        else if( pthread_cond_timedwait(&queue->not_full, &queue->mutex, &deadline) == ETIMEDOUT )
+        {
+            break;
+        }
+    }
+
+    if( queue->count < queue->length )
+    {
+        UBaseType_t tail = ( queue->head + queue->count ) % queue->length;
+
+        memcpy(&queue->p_items[tail * queue->item_size], p_item, queue->item_size);
+        queue->count++;
+
+        pthread_cond_signal(&queue->not_empty);
+        ret = pdPASS;
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    return ret;
+}
+/******************************************************************************/
+BaseType_t xQueueReceive(QueueHandle_t queue, void *p_item, TickType_t ticks_to_wait)
+{
+    BaseType_t      ret=pdFALSE;
+    struct timespec deadline;
+
+    if( ( queue == NULL ) || ( p_item == NULL ) )
+    {
+        return pdFALSE;
+    }
+
+    deadline_from_ms__(&deadline, ticks_to_wait);
+
+    pthread_mutex_lock(&queue->mutex);
+
+    while( ( queue->count == 0U ) && ( ticks_to_wait > 0U ) )
+    {
+        if( ticks_to_wait == portMAX_DELAY )
+        {
+            pthread_cond_wait(&queue->not_empty, &queue->mutex);
+        }
+        else if( pthread_cond_timedwait(&queue->not_empty, &queue->mutex, &deadline) == ETIMEDOUT )
+        {
+            break;
+        }
+    }
+
+    if( queue->count > 0U )
+    {
+        memcpy(p_item, &queue->p_items[queue->head * queue->item_size], queue->item_size);
+        queue->head = ( queue->head + 1U ) % queue->length;
+        queue->count--;
+
+        pthread_cond_signal(&queue->not_full);
+        ret = pdTRUE;
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    return ret;
+}
+/******************************************************************************/
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    UBaseType_t count=0U;
+
+    if(queue)
+    {
+        pthread_mutex_lock(&queue->mutex);
+        count = queue->count;
+        pthread_mutex_unlock(&queue->mutex);
+    }
+
+    return count;
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static void init_critical_mutex__(void)
+{
+    pthread_mutexattr_t attr;
+
+    /* Recursive -- firmware critical sections may nest */
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&s_critical_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+/******************************************************************************/
+static void* thread_entry__(void *p_arg)
+{
+    struct HostThread *p_thread = p_arg;
+
+    s_p_this_thread = p_thread;
+    p_thread->fn(p_thread->argument);
+
+    return NULL;
+}
+/******************************************************************************/
+static void init_thread_signals__(struct HostThread *p_thread)
+{
+    pthread_mutex_init(&p_thread->signal_mutex, NULL);
+    pthread_cond_init(&p_thread->signal_cond, NULL);
+    p_thread->signals = 0;
+}
+/******************************************************************************/
+static uint64_t now_ns__(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ( (uint64_t) ts.tv_sec * 1000000000U ) + (uint64_t) ts.tv_nsec;
+}
+/******************************************************************************/
+static void deadline_from_ms__(struct timespec *p_ts, uint32_t millisec)
+{
+    clock_gettime(CLOCK_REALTIME, p_ts);
+
+    p_ts->tv_sec  += (time_t) ( millisec / 1000U );
+    p_ts->tv_nsec += (long) ( ( millisec % 1000U ) * 1000000U );
+
+    if( p_ts->tv_nsec >= 1000000000L )
+    {
+        p_ts->tv_sec++;
+        p_ts->tv_nsec -= 1000000000L;
+    }
+}
+/******************************************************************************/
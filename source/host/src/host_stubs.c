@@ -0,0 +1,319 @@
+/**
+ * @file  host_stubs.c
+ * @brief Host (PC) stand-ins for the firmware objects the host builds don't link
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * On the target the RTOS objects below are created by the platform start-up
+ * code. On the host, HostStubs_init() creates them before any task is run.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_stubs.h"
+
+#include "alc_logger.h"
+#include "alc_rtcc.h"
+#include "bt/external_ble_interface.h"
+#include "cmsis_os.h"
+#include "gps_time_ctrl.h"
+#include "nv_settings.h"
+#include "stm32xxxx_hal.h"
+#include "sys/clock.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+/** @brief Size of the queue of bytes from the server, as on the target */
+#define DATA_UPLOAD_CLIENT_RX_QUEUE_LEN     1024U
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+osMutexId    g_modem_drv_mutexHandle;
+osMutexId    g_sensor_node_mutexHandle;
+osMutexId    g_sensor_data_pool_mutexHandle;
+osMutexId    g_gps_data_mutexHandle;
+osMessageQId g_data_upload_client_rx_queueHandle;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+static struct {
+    uint8_t  ipv4[4];
+    uint16_t portnum;
+    bool     is_set;
+} s_cloud_server;
+
+
+static struct {
+    bool              verbose;
+    volatile uint32_t count[NUM_ALC_LOGGER_LEVELS];
+} s_log;
+
+
+static volatile uint32_t s_num_server_timestamps;
+
+
+/** @brief The RTCC is not emulated -- the time is the last timestamp from the
+ *         server, moved on by the tick since.
+ */
+static struct {
+    uint32_t          seconds;
+    uint32_t          tick_ms;
+    volatile bool     is_set;
+} s_server_time;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static void log_str__(AlcLoggerLevel level, char const *p_str);
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+bool HostStubs_init(void)
+{
+    osMutexDef(modem_drv_mutex);
+    osMutexDef(sensor_node_mutex);
+    osMutexDef(sensor_data_pool_mutex);
+    osMutexDef(gps_data_mutex);
+
+    g_modem_drv_mutexHandle             = osMutexCreate(osMutex(modem_drv_mutex));
+    g_sensor_node_mutexHandle           = osMutexCreate(osMutex(sensor_node_mutex));
+    g_sensor_data_pool_mutexHandle      = osMutexCreate(osMutex(sensor_data_pool_mutex));
+    g_gps_data_mutexHandle              = osMutexCreate(osMutex(gps_data_mutex));
+    g_data_upload_client_rx_queueHandle = xQueueCreate(DATA_UPLOAD_CLIENT_RX_QUEUE_LEN, sizeof(uint8_t));
+
+    return ( g_modem_drv_mutexHandle ) &&
+           ( g_sensor_node_mutexHandle ) &&
+           ( g_sensor_data_pool_mutexHandle ) &&
+           ( g_gps_data_mutexHandle ) &&
+           ( g_data_upload_client_rx_queueHandle );
+}
+/******************************************************************************/
+void HostStubs_set_cloud_server(uint8_t const ipv4[4], uint16_t portnum)
+{
+    memcpy(s_cloud_server.ipv4, ipv4, sizeof(s_cloud_server.ipv4));
+    s_cloud_server.portnum = portnum;
+    s_cloud_server.is_set  = true;
+}
+/******************************************************************************/
+void HostStubs_set_log_verbose(bool verbose)
+{
+    s_log.verbose = verbose;
+}
+/******************************************************************************/
+uint32_t HostStubs_get_num_log_errors(void)
+{
+    return s_log.count[ALC_LOGGER_ERROR] + s_log.count[ALC_LOGGER_CRITICAL];
+}
+/******************************************************************************/
+uint32_t HostStubs_get_num_server_timestamps(void)
+{
+    return s_num_server_timestamps;
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               FIRMWARE STAND-INS
+*******************************************************************************/
+
+/******************************************************************************/
+uint32_t HAL_GetTick(void)
+{
+    return osKernelSysTick();
+}
+/******************************************************************************/
+void HAL_NVIC_SystemReset(void)
+{
+    fprintf(stderr, "HAL_NVIC_SystemReset() -- a task asked for a reboot\n");
+    exit(3);
+}
+/******************************************************************************/
+clock_time_t clock_time(void)
+{
+    return (clock_time_t) ( ( (uint64_t) osKernelSysTick() * CLOCK_SECOND ) / 1000U );
+}
+/******************************************************************************/
+unsigned long clock_seconds(void)
+{
+    return (unsigned long) ( osKernelSysTick() / 1000U );
+}
+/******************************************************************************/
+bool Store_read_cloud_ipv4(uint8_t *p_buff4)
+{
+    if( ( p_buff4 ) && ( s_cloud_server.is_set ) )
+    {
+        memcpy(p_buff4, s_cloud_server.ipv4, sizeof(s_cloud_server.ipv4));
+        return true;
+    }
+
+    return false;
+}
+/******************************************************************************/
+bool Store_read_cloud_portnum(uint16_t *p_portnum)
+{
+    if( ( p_portnum ) && ( s_cloud_server.is_set ) )
+    {
+        *p_portnum = s_cloud_server.portnum;
+        return true;
+    }
+
+    return false;
+}
+/******************************************************************************/
+/* The modem settings come from the EEPROM on the target */
+bool Store_read_modem_apn_str(uint8_t *p_string, uint32_t maxlen)
+{
+    return ( p_string ) && ( snprintf((char*) p_string, maxlen, "internet") < (int) maxlen );
+}
+/******************************************************************************/
+bool Store_read_modem_username_str(uint8_t *p_string, uint32_t maxlen)
+{
+    if( ( p_string ) && ( maxlen > 0U ) )
+    {
+        p_string[0] = '\0';
+    }
+
+    return false;
+}
+/******************************************************************************/
+bool Store_read_modem_password_str(uint8_t *p_string, uint32_t maxlen)
+{
+    return Store_read_modem_username_str(p_string, maxlen);
+}
+/******************************************************************************/
+void have_timestamp_from_server(uint32_t timestamp)
+{
+    s_server_time.seconds = timestamp;
+    s_server_time.tick_ms = osKernelSysTick();
+    s_server_time.is_set  = true;
+
+    s_num_server_timestamps++;
+}
+/******************************************************************************/
+AlcRtccStatus AlcRtcc_get_status(void)
+{
+    return ( s_server_time.is_set ) ? ALC_RTCC_SYNC : ALC_RTCC_INVALID;
+}
+/******************************************************************************/
+void AlcRtcc_get(AlcRtccData *p_data)
+{
+    if(p_data)
+    {
+        uint32_t elapsed_ms = osKernelSysTick() - s_server_time.tick_ms;
+
+        p_data->seconds    = s_server_time.seconds + ( elapsed_ms / 1000U );
+        p_data->subseconds = 0U;
+    }
+}
+/******************************************************************************/
+/* The gateway's own address comes from the 6LoWPAN stack on the target */
+void getIPv6Address(uint8_t *p_ipv6_address)
+{
+    static uint8_t const address[16] = {
+        0xfdU, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U,
+        0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x01U
+    };
+
+    if(p_ipv6_address)
+    {
+        memcpy(p_ipv6_address, address, sizeof(address));
+    }
+}
+/******************************************************************************/
+void AlcLogger_log_info(char const *p_str)
+{
+    log_str__(ALC_LOGGER_INFO, p_str);
+}
+/******************************************************************************/
+void AlcLogger_log_warning(char const *p_str)
+{
+    log_str__(ALC_LOGGER_WARNING, p_str);
+}
+/******************************************************************************/
+void AlcLogger_log_error(char const *p_str)
+{
+    log_str__(ALC_LOGGER_ERROR, p_str);
+}
+/******************************************************************************/
+void AlcLogger_log_critical(char const *p_str)
+{
+    log_str__(ALC_LOGGER_CRITICAL, p_str);
+}
+/******************************************************************************/
+void AlcLogger_log_printf(AlcLoggerLevel level, char const *p_fmt, ...)
+{
+    char    str[200];
+    va_list args;
+
+    va_start(args, p_fmt);
+    vsnprintf(str, sizeof(str), p_fmt, args);
+    va_end(args);
+
+    log_str__(level, str);
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static void log_str__(AlcLoggerLevel level, char const *p_str)
+{
+    static char const * const names[NUM_ALC_LOGGER_LEVELS] = {
+        "info", "warning", "error", "critical"
+    };
+
+    if( level < NUM_ALC_LOGGER_LEVELS )
+    {
+        taskENTER_CRITICAL();
+        s_log.count[level]++;
+        taskEXIT_CRITICAL();
+
+        if(s_log.verbose)
+        {
+            fprintf(stderr, "%8u log %s: %s\n", osKernelSysTick(), names[level], ( p_str ) ? p_str : "");
+        }
+    }
+}
+/******************************************************************************/
@@ -0,0 +1,1443 @@
+/**
+ * @file  sim808_emu.c
+ * @brief Host (PC) emulator of the SIM808 modem, behind the UART6 driver.
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * The UART is two byte FIFO's: UART6_write() fills the one that the emulator
+ * thread reads, and the emulator thread fills the one that UART6_read()
+ * empties. The emulator thread is serial like the modem -- while it waits
+ * out a reply latency, the bytes from the driver queue up in the FIFO.
+ *
+ * The emulator only covers what modem_drv_sim808.c and modem_drv_ec2x.c use.
+ * Commands it does not know are answered with "OK".
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <ctype.h>
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim808_emu.h"
+
+#include "cmsis_os.h"
+#include "gpio.h"
+#include "uart6.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+#define FIFO_SIZE               65536U
+
+/** @brief Bytes the modem will take from the UART before the writer has to
+ *         wait (as hardware flow control would make it), so the uplink rate
+ *         holds back the driver in data mode too.
+ */
+#define TO_MODEM_FIFO_LEN       2048U
+#define MAX_LINE_LEN            255U
+#define MAX_SEND_LEN            1460U       /**< Largest AT+CIPSEND the modem accepts */
+#define SOCKET_READ_LEN         1460U
+
+/** @brief Silence needed either side of "+++". A little less than the
+ *         driver's MODEM_TRANSPARENT_GUARD_MS, to allow for host scheduling.
+ */
+#define DATA_MODE_GUARD_MS      900U
+
+/** @brief The single link in transparent mode is kept in this slot */
+#define SINGLE_LINK             0U
+
+#define MAX_CHANNELS            SIM808_EMU_EC2X_CHANNELS
+
+/** @brief "+QIOPEN: <ch>,<err>" when the connection fails */
+#define EC2X_ERR_CONNECT_FAIL   566U
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t  not_empty;
+    pthread_cond_t  not_full;
+    uint8_t         buff[FIFO_SIZE];
+    uint32_t        size;
+    uint32_t        head;
+    uint32_t        count;
+    uint32_t       *p_ticks;            /**< @brief When each byte was written ("on the wire"), may be NULL */
+} ByteFifo;
+
+
+typedef struct {
+    int             fd;                 /**< @brief Socket, -1 when closed */
+    uint32_t        link_bytes;         /**< @brief Bytes sent since the link was opened */
+    bool            is_udp;             /**< @brief Datagram socket -- the server doesn't acknowledge or close it */
+} EmuLink;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+static ByteFifo s_to_modem;             /**< @brief Driver -> emulator */
+static uint32_t s_to_modem_ticks[TO_MODEM_FIFO_LEN];
+static ByteFifo s_to_host;              /**< @brief Emulator -> driver */
+
+
+/** @brief Shared between the emulator thread and the other threads */
+static struct {
+    pthread_mutex_t mutex;
+    Sim808EmuStats  stats;
+    uint32_t        pending_faults;     /**< @brief ( 1u << Sim808Fault ) */
+    bool            reset_requested;
+} s_shared;
+
+
+/** @brief Only used by the emulator thread */
+static struct {
+    Sim808EmuConfig conf;
+    pthread_t       thread;
+    volatile bool   running;
+    uint32_t        rand_state;
+
+    bool            echo;
+    bool            mux;
+    bool            transparent;
+    bool            qsend;
+    bool            data_mode;
+    bool            deregistered;
+
+    char            line[MAX_LINE_LEN + 1U];
+    uint32_t        line_len;
+    bool            skip_lf;
+
+    EmuLink         links[MAX_CHANNELS];
+
+    /* AT+CIPSEND data, or data mode data, on its way to the server */
+    struct {
+        bool        active;
+        uint32_t    channel;
+        uint32_t    remaining;
+        uint32_t    len;
+        uint8_t     buff[FIFO_SIZE];
+    } tx;
+
+    /* "+++" escape from data mode */
+    uint32_t        last_rx_tick;
+    uint32_t        num_plus;
+} s_emu;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static void fifo_init__(ByteFifo *p_fifo, uint32_t size, uint32_t *p_ticks);
+static uint32_t fifo_write__(ByteFifo *p_fifo, uint8_t const *p_buff, uint32_t len, uint32_t timeout_ms);
+static uint32_t fifo_read__(ByteFifo *p_fifo, uint8_t *p_buff, uint32_t *p_ticks, uint32_t len, uint32_t timeout_ms);
+static void fifo_clear__(ByteFifo *p_fifo);
+
+static void* emu_thread__(void *p_arg);
+static void reset_modem__(void);
+static bool take_fault__(Sim808Fault fault, uint32_t permille);
+static void count__(uint32_t *p_counter);
+
+static void send_raw__(void const *p_buff, uint32_t len);
+static void reply__(char const *p_fmt, ...);
+static void final__(char const *p_result);
+
+static void process_char__(uint8_t ch);
+static void process_data_mode_char__(uint8_t ch, uint32_t rx_tick);
+static void process_command__(char const *p_cmd);
+static void cmd_cipstart__(char const *p_args);
+static void cmd_cipsend__(char const *p_args);
+static void cmd_cipsend_query__(void);
+static void cmd_cipclose__(char const *p_args);
+static void cmd_cclk__(void);
+static bool process_ec2x_command__(char const *p_cmd);
+static void cmd_qiopen__(char const *p_args);
+static void cmd_qisend__(char const *p_args);
+static void finish_send__(void);
+static void flush_data_mode__(void);
+
+static bool open_link__(uint32_t channel, char const *p_proto, char const *p_host, char const *p_port);
+static void close_link__(uint32_t channel, bool report);
+static void close_all_links__(bool report);
+static void poll_links__(void);
+static bool is_open__(uint32_t channel);
+static bool is_protocol__(char const *p_proto);
+static bool is_ec2x__(void);
+static uint32_t num_channels__(void);
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+void Sim808Emu_default_config(Sim808EmuConfig *p_conf)
+{
+    if(p_conf)
+    {
+        memset(p_conf, 0, sizeof(*p_conf));
+
+        p_conf->latency_ms    = 20U;
+        p_conf->rtt_ms        = 100U;
+        p_conf->bandwidth_Bps = 8000U;
+        p_conf->send_size     = MAX_SEND_LEN;
+        p_conf->creg_stat     = 1U;
+        p_conf->echo          = true;
+        p_conf->seed          = 1U;
+    }
+}
+/******************************************************************************/
+bool Sim808Emu_start(Sim808EmuConfig const *p_conf)
+{
+    if( ( p_conf == NULL ) || ( s_emu.running ) )
+    {
+        return false;
+    }
+
+    memset(&s_emu, 0, sizeof(s_emu));
+    memset(&s_shared, 0, sizeof(s_shared));
+
+    s_emu.conf       = *p_conf;
+    s_emu.rand_state = ( p_conf->seed != 0U ) ? p_conf->seed : 1U;
+
+    for(uint32_t ii=0U; ii<MAX_CHANNELS; ii++)
+    {
+        s_emu.links[ii].fd = -1;
+    }
+
+    pthread_mutex_init(&s_shared.mutex, NULL);
+    fifo_init__(&s_to_modem, TO_MODEM_FIFO_LEN, s_to_modem_ticks);
+    fifo_init__(&s_to_host, FIFO_SIZE, NULL);
+
+    reset_modem__();
+
+    s_emu.running = true;
+
+    if( pthread_create(&s_emu.thread, NULL, &emu_thread__, NULL) != 0 )
+    {
+        s_emu.running = false;
+    }
+
+    return s_emu.running;
+}
+/******************************************************************************/
+void Sim808Emu_stop(void)
+{
+    if(s_emu.running)
+    {
+        s_emu.running = false;
+        pthread_join(s_emu.thread, NULL);
+        close_all_links__(false);
+    }
+}
+/******************************************************************************/
+void Sim808Emu_reset(void)
+{
+    pthread_mutex_lock(&s_shared.mutex);
+    s_shared.reset_requested = true;
+    pthread_mutex_unlock(&s_shared.mutex);
+}
+/******************************************************************************/
+void Sim808Emu_inject(Sim808Fault fault)
+{
+    if( fault < NUM_SIM808_FAULTS )
+    {
+        pthread_mutex_lock(&s_shared.mutex);
+        s_shared.pending_faults |= ( 1u << fault );
+        pthread_mutex_unlock(&s_shared.mutex);
+    }
+}
+/******************************************************************************/
+void Sim808Emu_get_stats(Sim808EmuStats *p_stats)
+{
+    if(p_stats)
+    {
+        pthread_mutex_lock(&s_shared.mutex);
+        *p_stats = s_shared.stats;
+        pthread_mutex_unlock(&s_shared.mutex);
+    }
+}
+/******************************************************************************/
+void UART6_start(void)
+{
+    fifo_clear__(&s_to_host);
+}
+/******************************************************************************/
+int32_t UART6_read(uint8_t *p_buff, uint32_t len, uint32_t timeout_ms)
+{
+    uint32_t start = osKernelSysTick();
+
+    if( ( p_buff == NULL ) || ( len == 0U ) )
+    {
+        return 0;
+    }
+
+    for(;;)
+    {
+        uint32_t elapsed = osKernelSysTick() - start;
+        uint32_t count   = fifo_read__(&s_to_host, p_buff, NULL, len, ( ( timeout_ms - elapsed ) < 1U ) ? ( timeout_ms - elapsed ) : 1U);
+        osEvent  event;
+
+        if(
+                ( count > 0U ) ||
+                ( ( osKernelSysTick() - start ) >= timeout_ms )
+        )
+        {
+            return (int32_t) count;
+        }
+
+        /* A signal to the reading thread ends the wait, as the modem driver
+         * needs (see MODEM_DRV_WAKE_SIGNAL). It is left set for the thread.
+         */
+        event = osSignalWait(0, 0U);
+
+        if( event.status == osEventSignal )
+        {
+            osSignalSet(osThreadGetId(), event.value.signals);
+            return 0;
+        }
+    }
+}
+/******************************************************************************/
+int32_t UART6_write(void const *p_buff, uint32_t len, uint32_t timeout_ms)
+{
+    if( ( p_buff == NULL ) || ( len == 0U ) )
+    {
+        return 0;
+    }
+
+    return (int32_t) fifo_write__(&s_to_modem, p_buff, len, timeout_ms);
+}
+/******************************************************************************/
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    if(
+            ( GPIOx == MODEM_RST_GPIO_Port ) &&
+            ( GPIO_Pin == MODEM_RST_Pin ) &&
+            ( PinState == GPIO_PIN_RESET )
+    )
+    {
+        Sim808Emu_reset();
+    }
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static void fifo_init__(ByteFifo *p_fifo, uint32_t size, uint32_t *p_ticks)
+{
+    pthread_mutex_init(&p_fifo->mutex, NULL);
+    pthread_cond_init(&p_fifo->not_empty, NULL);
+    pthread_cond_init(&p_fifo->not_full, NULL);
+    p_fifo->size    = size;
+    p_fifo->p_ticks = p_ticks;
+    p_fifo->head  = 0U;
+    p_fifo->count = 0U;
+}
+/******************************************************************************/
+static uint32_t fifo_write__(ByteFifo *p_fifo, uint8_t const *p_buff, uint32_t len, uint32_t timeout_ms)
+{
+    uint32_t start = osKernelSysTick();
+    uint32_t count = 0U;
+
+    pthread_mutex_lock(&p_fifo->mutex);
+
+    while( count < len )
+    {
+        if( p_fifo->count < p_fifo->size )
+        {
+            uint32_t index = ( p_fifo->head + p_fifo->count ) % p_fifo->size;
+
+            p_fifo->buff[index] = p_buff[count];
+            if( p_fifo->p_ticks )
+            {
+                p_fifo->p_ticks[index] = osKernelSysTick();
+            }
+            p_fifo->count++;
+            count++;
+        }
+        else if( ( osKernelSysTick() - start ) >= timeout_ms )
+        {
+            break;
+        }
+        else
+        {
+            struct timespec ts;
+
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += 1000000L;
+            if( ts.tv_nsec >= 1000000000L )
+            {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+
+            pthread_cond_signal(&p_fifo->not_empty);
+            pthread_cond_timedwait(&p_fifo->not_full, &p_fifo->mutex, &ts);
+        }
+    }
+
+    pthread_cond_signal(&p_fifo->not_empty);
+    pthread_mutex_unlock(&p_fifo->mutex);
+
+    return count;
+}
+/******************************************************************************/
+static uint32_t fifo_read__(ByteFifo *p_fifo, uint8_t *p_buff, uint32_t *p_ticks, uint32_t len, uint32_t timeout_ms)
+{
+    uint32_t start = osKernelSysTick();
+    uint32_t count = 0U;
+
+    pthread_mutex_lock(&p_fifo->mutex);
+
+    while( ( p_fifo->count == 0U ) && ( ( osKernelSysTick() - start ) < timeout_ms ) )
+    {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += 1000000L;
+        if( ts.tv_nsec >= 1000000000L )
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+
+        pthread_cond_timedwait(&p_fifo->not_empty, &p_fifo->mutex, &ts);
+    }
+
+    while( ( count < len ) && ( p_fifo->count > 0U ) )
+    {
+        if( ( p_ticks ) && ( p_fifo->p_ticks ) )
+        {
+            p_ticks[count] = p_fifo->p_ticks[p_fifo->head];
+        }
+
+        p_buff[count++] = p_fifo->buff[p_fifo->head];
+        p_fifo->head = ( p_fifo->head + 1U ) % p_fifo->size;
+        p_fifo->count--;
+    }
+
+    if( count > 0U )
+    {
+        pthread_cond_signal(&p_fifo->not_full);
+    }
+
+    pthread_mutex_unlock(&p_fifo->mutex);
+
+    return count;
+}
+/******************************************************************************/
+static void fifo_clear__(ByteFifo *p_fifo)
+{
+    pthread_mutex_lock(&p_fifo->mutex);
+    p_fifo->head  = 0U;
+    p_fifo->count = 0U;
+    pthread_cond_broadcast(&p_fifo->not_full);
+    pthread_mutex_unlock(&p_fifo->mutex);
+}
+/******************************************************************************/
+static void* emu_thread__(void *p_arg)
+{
+    (void) p_arg;
+
+    while(s_emu.running)
+    {
+        uint8_t  buff[256];
+        uint32_t ticks[256];
+        bool    do_reset;
+
+        pthread_mutex_lock(&s_shared.mutex);
+        do_reset = s_shared.reset_requested;
+        s_shared.reset_requested = false;
+        pthread_mutex_unlock(&s_shared.mutex);
+
+        if(do_reset)
+        {
+            count__(&s_shared.stats.num_resets);
+            reset_modem__();
+            fifo_clear__(&s_to_modem);
+            if( is_ec2x__() )
+            {
+                reply__("\r\nRDY\r\n\r\n+CFUN: 1\r\n\r\n+CPIN: READY\r\n\r\n+QUSIM: 1\r\n\r\n+QIND: SMS DONE\r\n");
+            }
+            else
+            {
+                reply__("\r\nRDY\r\n\r\n+CFUN: 1\r\n\r\n+CPIN: READY\r\n\r\nCall Ready\r\n\r\nSMS Ready\r\n");
+            }
+        }
+
+        uint32_t len = fifo_read__(&s_to_modem, buff, ticks, sizeof(buff), 1U);
+
+        for(uint32_t ii=0U; ii<len; ii++)
+        {
+            if(s_emu.data_mode)
+            {
+                process_data_mode_char__(buff[ii], ticks[ii]);
+            }
+            else
+            {
+                process_char__(buff[ii]);
+            }
+        }
+
+        if(s_emu.data_mode)
+        {
+            flush_data_mode__();
+
+            if(
+                    ( s_emu.num_plus == 3U ) &&
+                    ( ( osKernelSysTick() - s_emu.last_rx_tick ) >= DATA_MODE_GUARD_MS )
+            )
+            {
+                /* "+++" with silence either side -- back to command mode */
+                s_emu.num_plus  = 0U;
+                s_emu.data_mode = false;
+                final__("OK");
+            }
+        }
+
+        if( !s_emu.tx.active )
+        {
+            poll_links__();
+        }
+
+        if( take_fault__(SIM808_FAULT_CLOSE, 0U) )
+        {
+            close_all_links__(true);
+        }
+
+        if( take_fault__(SIM808_FAULT_DEREGISTER, 0U) )
+        {
+            /* Lost the network -- the links go with it */
+            s_emu.deregistered = true;
+            close_all_links__(true);
+        }
+    }
+
+    return NULL;
+}
+/******************************************************************************/
+static void reset_modem__(void)
+{
+    close_all_links__(false);
+
+    s_emu.echo         = s_emu.conf.echo;
+    s_emu.mux          = is_ec2x__();
+    s_emu.transparent  = false;
+    s_emu.qsend        = false;
+    s_emu.data_mode    = false;
+    s_emu.deregistered = false;
+    s_emu.line_len     = 0U;
+    s_emu.skip_lf      = false;
+    s_emu.tx.active    = false;
+    s_emu.tx.len       = 0U;
+    s_emu.num_plus     = 0U;
+}
+/******************************************************************************/
+static bool take_fault__(Sim808Fault fault, uint32_t permille)
+{
+    bool taken;
+
+    pthread_mutex_lock(&s_shared.mutex);
+    taken = ( ( s_shared.pending_faults & ( 1u << fault ) ) != 0U );
+    s_shared.pending_faults &= ~( 1u << fault );
+    pthread_mutex_unlock(&s_shared.mutex);
+
+    if( ( !taken ) && ( permille > 0U ) )
+    {
+        /* xorshift32 -- the same seed gives the same faults */
+        s_emu.rand_state ^= s_emu.rand_state << 13;
+        s_emu.rand_state ^= s_emu.rand_state >> 17;
+        s_emu.rand_state ^= s_emu.rand_state << 5;
+
+        taken = ( ( s_emu.rand_state % 1000U ) < permille );
+    }
+
+    return taken;
+}
+/******************************************************************************/
+static void count__(uint32_t *p_counter)
+{
+    pthread_mutex_lock(&s_shared.mutex);
+    (*p_counter)++;
+    pthread_mutex_unlock(&s_shared.mutex);
+}
+/******************************************************************************/
+static void send_raw__(void const *p_buff, uint32_t len)
+{
+    (void) fifo_write__(&s_to_host, p_buff, len, 1000U);
+}
+/******************************************************************************/
+static void reply__(char const *p_fmt, ...)
+{
+    char    str[MAX_LINE_LEN + 1U];
+    va_list args;
+
+    va_start(args, p_fmt);
+    int len = vsnprintf(str, sizeof(str), p_fmt, args);
+    va_end(args);
+
+    if( len > 0 )
+    {
+        send_raw__(str, ( (uint32_t) len < sizeof(str) ) ? (uint32_t) len : ( sizeof(str) - 1U ));
+    }
+}
+/******************************************************************************/
+static void final__(char const *p_result)
+{
+    if( take_fault__(SIM808_FAULT_NO_REPLY, s_emu.conf.no_reply_permille) )
+    {
+        count__(&s_shared.stats.num_no_replies);
+        return;
+    }
+
+    reply__("\r\n%s\r\n", p_result);
+}
+/******************************************************************************/
+static void process_char__(uint8_t ch)
+{
+    if( ( s_emu.skip_lf ) && ( ch == '\n' ) )
+    {
+        /* The LF after the command's CR -- it arrives after the "> " prompt
+         * of AT+CIPSEND, but is not part of the data.
+         */
+        s_emu.skip_lf = false;
+
+        if(s_emu.echo)
+        {
+            send_raw__(&ch, 1U);
+        }
+        return;
+    }
+    s_emu.skip_lf = false;
+
+    if(s_emu.tx.active)
+    {
+        /****************************************************************
+         * AT+CIPSEND data
+         ***************************************************************/
+        if(s_emu.echo)
+        {
+            send_raw__(&ch, 1U);
+        }
+
+        s_emu.tx.buff[s_emu.tx.len++] = ch;
+        s_emu.tx.remaining--;
+
+        if( s_emu.tx.remaining == 0U )
+        {
+            finish_send__();
+        }
+        return;
+    }
+
+    if(s_emu.echo)
+    {
+        send_raw__(&ch, 1U);
+    }
+
+    if( ch == '\r' )
+    {
+        s_emu.line[s_emu.line_len] = '\0';
+        s_emu.line_len = 0U;
+        s_emu.skip_lf  = true;
+
+        if( strncasecmp(s_emu.line, "AT", 2U) == 0 )
+        {
+            count__(&s_shared.stats.num_commands);
+
+            if( s_emu.conf.latency_ms > 0U )
+            {
+                osDelay(s_emu.conf.latency_ms);
+            }
+
+            process_command__(s_emu.line);
+        }
+    }
+    else if( ( ch != '\n' ) && ( s_emu.line_len < MAX_LINE_LEN ) )
+    {
+        s_emu.line[s_emu.line_len++] = (char) ch;
+    }
+}
+/******************************************************************************/
+static void process_data_mode_char__(uint8_t ch, uint32_t rx_tick)
+{
+    if( ( s_emu.skip_lf ) && ( ch == '\n' ) )
+    {
+        /* The LF after the CR of the command that started data mode */
+        s_emu.skip_lf = false;
+        return;
+    }
+    s_emu.skip_lf = false;
+
+    /* The guard time is measured from when the bytes were written to the
+     * UART, not from when this thread got round to them -- the uplink rate
+     * can hold them back for a while.
+     */
+    if(
+            ( ch == '+' ) &&
+            ( s_emu.num_plus < 3U ) &&
+            (
+                    ( s_emu.num_plus > 0U ) ||
+                    ( ( rx_tick - s_emu.last_rx_tick ) >= DATA_MODE_GUARD_MS )
+            )
+    )
+    {
+        /* Could be the start of "+++" -- hold it back for now */
+        s_emu.num_plus++;
+    }
+    else
+    {
+        /* Not an escape -- any '+' held back was data */
+        for(; s_emu.num_plus>0U; s_emu.num_plus--)
+        {
+            s_emu.tx.buff[s_emu.tx.len++] = '+';
+        }
+
+        s_emu.tx.buff[s_emu.tx.len++] = ch;
+
+        if( s_emu.tx.len >= ( FIFO_SIZE - 4U ) )
+        {
+            flush_data_mode__();
+        }
+    }
+
+    s_emu.last_rx_tick = rx_tick;
+}
+/******************************************************************************/
+static void process_command__(char const *p_cmd)
+{
+    p_cmd = &p_cmd[2];
+
+    if( *p_cmd == '\0' )
+    {
+        final__("OK");
+    }
+    else if( ( is_ec2x__() ) && ( process_ec2x_command__(p_cmd) ) )
+    {
+        /* Done */
+    }
+    else if( ( strcasecmp(p_cmd, "E0") == 0 ) || ( strcasecmp(p_cmd, "E1") == 0 ) )
+    {
+        s_emu.echo = ( p_cmd[1] == '1' );
+        final__("OK");
+    }
+    else if( strcasecmp(p_cmd, "O") == 0 )
+    {
+        if( ( s_emu.transparent ) && ( is_open__(SINGLE_LINK) ) )
+        {
+            final__("CONNECT");
+            s_emu.data_mode    = true;
+            s_emu.last_rx_tick = osKernelSysTick();
+        }
+        else
+        {
+            final__("ERROR");
+        }
+    }
+    else if( strncasecmp(p_cmd, "+CIPMUX=", 8U) == 0 )
+    {
+        s_emu.mux = ( atoi(&p_cmd[8]) != 0 );
+        final__("OK");
+    }
+    else if( strncasecmp(p_cmd, "+CIPMODE=", 9U) == 0 )
+    {
+        s_emu.transparent = ( atoi(&p_cmd[9]) != 0 );
+        final__("OK");
+    }
+    else if( strncasecmp(p_cmd, "+CIPQSEND=", 10U) == 0 )
+    {
+        s_emu.qsend = ( atoi(&p_cmd[10]) != 0 );
+        final__("OK");
+    }
+    else if( strcasecmp(p_cmd, "+CREG?") == 0 )
+    {
+        reply__("\r\n+CREG: 0,%u\r\n", (s_emu.deregistered) ? 0U : s_emu.conf.creg_stat);
+        final__("OK");
+    }
+    else if( strcasecmp(p_cmd, "+CGATT?") == 0 )
+    {
+        reply__("\r\n+CGATT: %u\r\n", s_emu.deregistered ? 0U : 1U);
+        final__("OK");
+    }
+    else if( strcasecmp(p_cmd, "+CSQ") == 0 )
+    {
+        reply__("\r\n+CSQ: 20,0\r\n");
+        final__("OK");
+    }
+    else if( strcasecmp(p_cmd, "+CCLK?") == 0 )
+    {
+        cmd_cclk__();
+    }
+    else if( strcasecmp(p_cmd, "+CIFSR") == 0 )
+    {
+        /* No final result code for this one */
+        reply__("\r\n10.64.0.2\r\n");
+    }
+    else if( strcasecmp(p_cmd, "+CIPSHUT") == 0 )
+    {
+        close_all_links__(false);
+        final__("SHUT OK");
+    }
+    else if( strncasecmp(p_cmd, "+CIPSTART=", 10U) == 0 )
+    {
+        cmd_cipstart__(&p_cmd[10]);
+    }
+    else if( strcasecmp(p_cmd, "+CIPSEND?") == 0 )
+    {
+        cmd_cipsend_query__();
+    }
+    else if( strncasecmp(p_cmd, "+CIPSEND=", 9U) == 0 )
+    {
+        cmd_cipsend__(&p_cmd[9]);
+    }
+    else if( strncasecmp(p_cmd, "+CIPCLOSE", 9U) == 0 )
+    {
+        cmd_cipclose__( ( p_cmd[9] == '=' ) ? &p_cmd[10] : NULL );
+    }
+    else if( strncasecmp(p_cmd, "+CIPACK=", 8U) == 0 )
+    {
+        uint32_t channel = (uint32_t) atoi(&p_cmd[8]);
+
+        if( channel < num_channels__() )
+        {
+            /* Everything written to the socket counts as acknowledged */
+            reply__("\r\n+CIPACK: %u,%u,0\r\n", s_emu.links[channel].link_bytes, s_emu.links[channel].link_bytes);
+            final__("OK");
+        }
+        else
+        {
+            final__("ERROR");
+        }
+    }
+    else
+    {
+        final__("OK");
+    }
+}
+/******************************************************************************/
+static void cmd_cipstart__(char const *p_args)
+{
+    /* Multi-connection: <n>,"TCP","host","port"
+     * Single link:      "TCP","host","port"
+     * ("UDP" in place of "TCP" for a UDP link)
+     */
+    char     proto[8];
+    char     host[128];
+    char     port[16];
+    uint32_t channel=SINGLE_LINK;
+    bool     valid;
+
+    if(s_emu.mux)
+    {
+        unsigned int n;
+        valid = ( sscanf(p_args, "%u,\"%7[^\"]\",\"%127[^\"]\",\"%15[^\"]\"", &n, proto, host, port) == 4 );
+        channel = n;
+    }
+    else
+    {
+        valid = ( sscanf(p_args, "\"%7[^\"]\",\"%127[^\"]\",\"%15[^\"]\"", proto, host, port) == 3 );
+    }
+
+    if(
+            ( !valid ) ||
+            ( channel >= num_channels__() ) ||
+            ( !is_protocol__(proto) ) ||
+            ( is_open__(channel) )
+    )
+    {
+        final__("ERROR");
+        return;
+    }
+
+    final__("OK");
+
+    if( s_emu.conf.rtt_ms > 0U )
+    {
+        osDelay(s_emu.conf.rtt_ms);
+    }
+
+    if(
+            ( !take_fault__(SIM808_FAULT_CONNECT_FAIL, s_emu.conf.connect_fail_permille) ) &&
+            ( open_link__(channel, proto, host, port) )
+    )
+    {
+        count__(&s_shared.stats.num_connects);
+
+        if(s_emu.mux)
+        {
+            reply__("\r\n%u, CONNECT OK\r\n", channel);
+        }
+        else if(s_emu.transparent)
+        {
+            reply__("\r\nCONNECT\r\n");
+            s_emu.data_mode    = true;
+            s_emu.last_rx_tick = osKernelSysTick();
+        }
+        else
+        {
+            reply__("\r\nCONNECT OK\r\n");
+        }
+    }
+    else
+    {
+        count__(&s_shared.stats.num_connect_failures);
+
+        if(s_emu.mux)
+        {
+            reply__("\r\n%u, CONNECT FAIL\r\n", channel);
+        }
+        else
+        {
+            reply__("\r\nCONNECT FAIL\r\n");
+        }
+    }
+}
+/******************************************************************************/
+static void cmd_cipsend__(char const *p_args)
+{
+    unsigned int channel=SINGLE_LINK;
+    unsigned int len=0U;
+    bool         valid;
+
+    if(s_emu.mux)
+    {
+        valid = ( sscanf(p_args, "%u,%u", &channel, &len) == 2 );
+    }
+    else
+    {
+        valid = ( sscanf(p_args, "%u", &len) == 1 );
+    }
+
+    if(
+            ( !valid ) ||
+            ( channel >= num_channels__() ) ||
+            ( len == 0U ) ||
+            ( len > MAX_SEND_LEN ) ||
+            ( !is_open__(channel) )
+    )
+    {
+        final__("ERROR");
+        return;
+    }
+
+    count__(&s_shared.stats.num_sends);
+
+    s_emu.tx.active    = true;
+    s_emu.tx.channel   = channel;
+    s_emu.tx.remaining = len;
+    s_emu.tx.len       = 0U;
+
+    reply__("\r\n> ");
+}
+/******************************************************************************/
+static void cmd_cipsend_query__(void)
+{
+    if(s_emu.mux)
+    {
+        for(uint32_t ii=0U; ii<num_channels__(); ii++)
+        {
+            reply__("\r\n+CIPSEND: %u,%u", ii, is_open__(ii) ? s_emu.conf.send_size : 0U);
+        }
+        reply__("\r\n");
+    }
+    else
+    {
+        reply__("\r\n+CIPSEND: %u\r\n", is_open__(SINGLE_LINK) ? s_emu.conf.send_size : 0U);
+    }
+
+    final__("OK");
+}
+/******************************************************************************/
+static void cmd_cipclose__(char const *p_args)
+{
+    uint32_t channel = ( p_args ) ? (uint32_t) atoi(p_args) : SINGLE_LINK;
+
+    if( ( channel < num_channels__() ) && ( is_open__(channel) ) )
+    {
+        close_link__(channel, false);
+
+        if(s_emu.mux)
+        {
+            reply__("\r\n%u, CLOSE OK\r\n", channel);
+        }
+        else
+        {
+            reply__("\r\nCLOSE OK\r\n");
+        }
+    }
+    else
+    {
+        final__("ERROR");
+    }
+}
+/******************************************************************************/
+static void cmd_cclk__(void)
+{
+    time_t    now = time(NULL);
+    struct tm tm;
+
+    gmtime_r(&now, &tm);
+
+    reply__("\r\n+CCLK: \"%02d/%02d/%02d,%02d:%02d:%02d+00\"\r\n",
+            tm.tm_year % 100, tm.tm_mon + 1, tm.tm_mday,
+            tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+    final__("OK");
+}
+/******************************************************************************/
+/* The EC2x commands -- false if the command is common to both dialects */
+static bool process_ec2x_command__(char const *p_cmd)
+{
+    if( strncasecmp(p_cmd, "+QICSGP=", 8U) == 0 )
+    {
+        final__("OK");
+    }
+    else if( strcasecmp(p_cmd, "+QIACT?") == 0 )
+    {
+        reply__("\r\n+QIACT: 1,1,1,\"10.64.0.2\"\r\n");
+        final__("OK");
+    }
+    else if( strncasecmp(p_cmd, "+QIACT=", 7U) == 0 )
+    {
+        final__( ( s_emu.deregistered ) ? "ERROR" : "OK" );
+    }
+    else if( strncasecmp(p_cmd, "+QIDEACT=", 9U) == 0 )
+    {
+        close_all_links__(false);
+        final__("OK");
+    }
+    else if( strncasecmp(p_cmd, "+QIOPEN=", 8U) == 0 )
+    {
+        cmd_qiopen__(&p_cmd[8]);
+    }
+    else if( strncasecmp(p_cmd, "+QISEND=", 8U) == 0 )
+    {
+        cmd_qisend__(&p_cmd[8]);
+    }
+    else if( strncasecmp(p_cmd, "+QICLOSE=", 9U) == 0 )
+    {
+        close_link__((uint32_t) atoi(&p_cmd[9]), false);
+        final__("OK");
+    }
+    else if( strcasecmp(p_cmd, "+CEREG?") == 0 )
+    {
+        reply__("\r\n+CEREG: 0,%u\r\n", (s_emu.deregistered) ? 0U : s_emu.conf.creg_stat);
+        final__("OK");
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+/******************************************************************************/
+static void cmd_qiopen__(char const *p_args)
+{
+    /* <ctx>,<ch>,"TCP"|"UDP","host",<port>,<local port>,<access mode> */
+    unsigned int ctx;
+    unsigned int channel;
+    char         proto[8];
+    char         host[128];
+    char         port[16];
+
+    if(
+            ( sscanf(p_args, "%u,%u,\"%7[^\"]\",\"%127[^\"]\",%15[0-9]", &ctx, &channel, proto, host, port) != 5 ) ||
+            ( channel >= num_channels__() ) ||
+            ( !is_protocol__(proto) ) ||
+            ( is_open__(channel) )
+    )
+    {
+        final__("ERROR");
+        return;
+    }
+
+    final__("OK");
+
+    if( s_emu.conf.rtt_ms > 0U )
+    {
+        osDelay(s_emu.conf.rtt_ms);
+    }
+
+    if(
+            ( !take_fault__(SIM808_FAULT_CONNECT_FAIL, s_emu.conf.connect_fail_permille) ) &&
+            ( open_link__(channel, proto, host, port) )
+    )
+    {
+        count__(&s_shared.stats.num_connects);
+        reply__("\r\n+QIOPEN: %u,0\r\n", channel);
+    }
+    else
+    {
+        count__(&s_shared.stats.num_connect_failures);
+        reply__("\r\n+QIOPEN: %u,%u\r\n", channel, EC2X_ERR_CONNECT_FAIL);
+    }
+}
+/******************************************************************************/
+static void cmd_qisend__(char const *p_args)
+{
+    unsigned int channel;
+    unsigned int len;
+
+    if(
+            ( sscanf(p_args, "%u,%u", &channel, &len) != 2 ) ||
+            ( !is_open__(channel) ) ||
+            ( channel >= num_channels__() ) ||
+            ( len > MAX_SEND_LEN )
+    )
+    {
+        final__("ERROR");
+    }
+    else if( len == 0U )
+    {
+        /* Everything written to the socket counts as acknowledged */
+        reply__("\r\n+QISEND: %u,%u,0\r\n", s_emu.links[channel].link_bytes, s_emu.links[channel].link_bytes);
+        final__("OK");
+    }
+    else
+    {
+        count__(&s_shared.stats.num_sends);
+
+        s_emu.tx.active    = true;
+        s_emu.tx.channel   = channel;
+        s_emu.tx.remaining = len;
+        s_emu.tx.len       = 0U;
+
+        reply__("\r\n> ");
+    }
+}
+/******************************************************************************/
+static void finish_send__(void)
+{
+    uint32_t channel = s_emu.tx.channel;
+    uint32_t len     = s_emu.tx.len;
+
+    s_emu.tx.active = false;
+    s_emu.tx.len    = 0U;
+
+    if( take_fault__(SIM808_FAULT_SEND_FAIL, s_emu.conf.send_fail_permille) )
+    {
+        count__(&s_shared.stats.num_send_failures);
+        reply__( ( is_ec2x__() ) ? "\r\nSEND FAIL\r\n" : "\r\n%u, SEND FAIL\r\n", channel);
+        return;
+    }
+
+    if( s_emu.conf.bandwidth_Bps > 0U )
+    {
+        osDelay( (uint32_t) ( ( (uint64_t) len * 1000U ) / s_emu.conf.bandwidth_Bps ) );
+    }
+
+    if( s_emu.links[channel].is_udp )
+    {
+        /* Nothing comes back to say a datagram was lost (or refused) */
+        if( take_fault__(SIM808_FAULT_DATAGRAM_LOSS, s_emu.conf.datagram_loss_permille) )
+        {
+            count__(&s_shared.stats.num_datagrams_lost);
+        }
+        else
+        {
+            (void) send(s_emu.links[channel].fd, s_emu.tx.buff, len, MSG_NOSIGNAL);
+        }
+    }
+    else if( send(s_emu.links[channel].fd, s_emu.tx.buff, len, MSG_NOSIGNAL) != (ssize_t) len )
+    {
+        reply__( ( is_ec2x__() ) ? "\r\nSEND FAIL\r\n" : "\r\n%u, SEND FAIL\r\n", channel);
+        count__(&s_shared.stats.num_send_failures);
+        close_link__(channel, true);
+        return;
+    }
+
+    s_emu.links[channel].link_bytes += len;
+
+    pthread_mutex_lock(&s_shared.mutex);
+    s_shared.stats.bytes_to_server += len;
+    pthread_mutex_unlock(&s_shared.mutex);
+
+    if( is_ec2x__() )
+    {
+        /* The data is in the module's buffer -- AT+QISEND=<ch>,0 says when
+         * the server has it.
+         */
+        reply__("\r\nSEND OK\r\n");
+    }
+    else if(s_emu.qsend)
+    {
+        /* The data is in the modem's buffer -- don't wait for the server */
+        reply__("\r\nDATA ACCEPT:%u,%u\r\n", channel, len);
+    }
+    else
+    {
+        /* Nothing comes back for a datagram -- so no round trip to wait for */
+        if(
+                ( s_emu.conf.rtt_ms > 0U ) &&
+                ( !s_emu.links[channel].is_udp )
+        )
+        {
+            osDelay(s_emu.conf.rtt_ms);
+        }
+
+        reply__("\r\n%u, SEND OK\r\n", channel);
+    }
+
+    if(
+            ( s_emu.conf.close_after_bytes > 0U ) &&
+            ( !s_emu.links[channel].is_udp ) &&
+            ( s_emu.links[channel].link_bytes >= s_emu.conf.close_after_bytes )
+    )
+    {
+        close_link__(channel, true);
+    }
+}
+/******************************************************************************/
+static void flush_data_mode__(void)
+{
+    uint32_t len = s_emu.tx.len;
+
+    if( len == 0U )
+    {
+        return;
+    }
+
+    s_emu.tx.len = 0U;
+
+    count__(&s_shared.stats.num_sends);
+
+    if( s_emu.conf.bandwidth_Bps > 0U )
+    {
+        osDelay( (uint32_t) ( ( (uint64_t) len * 1000U ) / s_emu.conf.bandwidth_Bps ) );
+    }
+
+    if(
+            ( !is_open__(SINGLE_LINK) ) ||
+            ( send(s_emu.links[SINGLE_LINK].fd, s_emu.tx.buff, len, MSG_NOSIGNAL) != (ssize_t) len )
+    )
+    {
+        count__(&s_shared.stats.num_send_failures);
+        close_link__(SINGLE_LINK, true);
+        return;
+    }
+
+    s_emu.links[SINGLE_LINK].link_bytes += len;
+
+    pthread_mutex_lock(&s_shared.mutex);
+    s_shared.stats.bytes_to_server += len;
+    pthread_mutex_unlock(&s_shared.mutex);
+
+    if(
+            ( s_emu.conf.close_after_bytes > 0U ) &&
+            ( s_emu.links[SINGLE_LINK].link_bytes >= s_emu.conf.close_after_bytes )
+    )
+    {
+        close_link__(SINGLE_LINK, true);
+    }
+}
+/******************************************************************************/
+static bool open_link__(uint32_t channel, char const *p_proto, char const *p_host, char const *p_port)
+{
+    struct addrinfo  hints;
+    struct addrinfo *p_res=NULL;
+    char             port[16];
+    int              fd=-1;
+
+    if( s_emu.conf.sink_host )
+    {
+        p_host = s_emu.conf.sink_host;
+    }
+
+    if( s_emu.conf.sink_port > 0U )
+    {
+        snprintf(port, sizeof(port), "%u", s_emu.conf.sink_port);
+        p_port = port;
+    }
+
+    bool is_udp = ( strcasecmp(p_proto, "UDP") == 0 );
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = ( is_udp ) ? SOCK_DGRAM : SOCK_STREAM;
+
+    if( getaddrinfo(p_host, p_port, &hints, &p_res) == 0 )
+    {
+        for(struct addrinfo *p_ai=p_res; p_ai!=NULL; p_ai=p_ai->ai_next)
+        {
+            fd = socket(p_ai->ai_family, p_ai->ai_socktype, p_ai->ai_protocol);
+
+            if( fd >= 0 )
+            {
+                if( connect(fd, p_ai->ai_addr, p_ai->ai_addrlen) == 0 )
+                {
+                    break;
+                }
+
+                close(fd);
+                fd = -1;
+            }
+        }
+
+        freeaddrinfo(p_res);
+    }
+
+    s_emu.links[channel].fd         = fd;
+    s_emu.links[channel].link_bytes = 0U;
+    s_emu.links[channel].is_udp     = is_udp;
+
+    return ( fd >= 0 );
+}
+/******************************************************************************/
+static void close_link__(uint32_t channel, bool report)
+{
+    if( is_open__(channel) )
+    {
+        close(s_emu.links[channel].fd);
+        s_emu.links[channel].fd = -1;
+
+        if(report)
+        {
+            /* The server (or the network) closed the link */
+            count__(&s_shared.stats.num_closes);
+
+            if( is_ec2x__() )
+            {
+                reply__("\r\n+QIURC: \"closed\",%u\r\n", channel);
+            }
+            else if(s_emu.mux)
+            {
+                reply__("\r\n%u, CLOSED\r\n", channel);
+            }
+            else
+            {
+                reply__("\r\nCLOSED\r\n");
+                s_emu.data_mode = false;
+            }
+        }
+    }
+}
+/******************************************************************************/
+static void close_all_links__(bool report)
+{
+    for(uint32_t ii=0U; ii<MAX_CHANNELS; ii++)
+    {
+        close_link__(ii, report);
+    }
+}
+/******************************************************************************/
+static void poll_links__(void)
+{
+    for(uint32_t ii=0U; ii<num_channels__(); ii++)
+    {
+        if(
+                ( is_open__(ii) ) &&
+                (
+                        ( s_emu.mux ) ||
+                        ( s_emu.data_mode )
+                )
+        )
+        {
+            uint8_t buff[SOCKET_READ_LEN];
+            ssize_t len = recv(s_emu.links[ii].fd, buff, sizeof(buff), MSG_DONTWAIT);
+
+            if(
+                    ( s_emu.links[ii].is_udp ) &&
+                    ( len > 0 ) &&
+                    ( take_fault__(SIM808_FAULT_DATAGRAM_LOSS, s_emu.conf.datagram_loss_permille) )
+            )
+            {
+                count__(&s_shared.stats.num_datagrams_lost);
+            }
+            else if( len > 0 )
+            {
+                pthread_mutex_lock(&s_shared.mutex);
+                s_shared.stats.bytes_from_server += (uint64_t) len;
+                pthread_mutex_unlock(&s_shared.mutex);
+
+                if( is_ec2x__() )
+                {
+                    reply__("\r\n+QIURC: \"recv\",%u,%u\r\n", ii, (uint32_t) len);
+                }
+                else if(s_emu.mux)
+                {
+                    reply__("\r\n+RECEIVE,%u,%u:\r\n", ii, (uint32_t) len);
+                }
+
+                send_raw__(buff, (uint32_t) len);
+            }
+            else if( s_emu.links[ii].is_udp )
+            {
+                /* An empty datagram, or an ICMP error from an earlier send --
+                 * neither closes a UDP link.
+                 */
+            }
+            else if(
+                    ( len == 0 ) ||
+                    ( ( errno != EAGAIN ) && ( errno != EWOULDBLOCK ) )
+            )
+            {
+                close_link__(ii, true);
+            }
+            else
+            {
+                /* Nothing to read */
+            }
+        }
+    }
+}
+/******************************************************************************/
+static bool is_open__(uint32_t channel)
+{
+    return ( channel < MAX_CHANNELS ) && ( s_emu.links[channel].fd >= 0 );
+}
+/******************************************************************************/
+static bool is_protocol__(char const *p_proto)
+{
+    return ( strcasecmp(p_proto, "TCP") == 0 ) ||
+           ( strcasecmp(p_proto, "UDP") == 0 );
+}
+/******************************************************************************/
+static bool is_ec2x__(void)
+{
+    return ( s_emu.conf.dialect == SIM808_EMU_DIALECT_EC2X );
+}
+/******************************************************************************/
+static uint32_t num_channels__(void)
+{
+    return ( is_ec2x__() ) ? SIM808_EMU_EC2X_CHANNELS : SIM808_EMU_NUM_CHANNELS;
+}
+/******************************************************************************/
@@ -0,0 +1,183 @@
+/**
+ * @file  resend_request.h
+ * @brief Requests to the nodes to resend the samples missing from their queues
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * A node's data is only acknowledged up to the first seq32 missing from its
+ * queue, so one lost radio frame holds back everything behind it. Each poll
+ * looks at the first missing run of every node and, once it has been missing
+ * for RESEND_REQUEST_1ST_DELAY (a late sample may still fill it), asks the
+ * node to resend it -- then again every RESEND_REQUEST_REPEAT_DELAY, up to
+ * RESEND_REQUEST_MAX_TX_COUNT times. After that the run is skipped, so the
+ * samples behind it can be acknowledged.
+ *
+ * Only one run per node is requested at a time, and requests are spaced at
+ * least RESEND_REQUEST_MIN_INTERVAL apart across all the nodes.
+ *
+ * The requests are sent by the pole data-link root, which registers its
+ * sender with ResendRequest_set_send_fn(). The timing follows its command
+ * timing in project-conf.h. Until a sender is registered nothing is requested
+ * and nothing is skipped -- a run that can't be asked for is not given up on.
+ */
+
+#ifndef SOURCE_INC_DATABUFFERS_RESEND_REQUEST_H_
+#define SOURCE_INC_DATABUFFERS_RESEND_REQUEST_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "net/ip/uip.h"
+#include "sys/clock.h"
+
+
+
+
+/*******************************************************************************
+*                               DEFAULT CONFIGURATION
+*******************************************************************************/
+
+/** @def   RESEND_REQUEST_1ST_DELAY
+ *  @brief How long (in clock ticks) a run must be missing before it is requested
+ */
+#ifndef RESEND_REQUEST_1ST_DELAY
+#ifdef ALC_PDLR_CMD_1ST_DELAY_MS
+#define RESEND_REQUEST_1ST_DELAY        ( ( ALC_PDLR_CMD_1ST_DELAY_MS * CLOCK_SECOND ) / 1000U )
+#else
+#define RESEND_REQUEST_1ST_DELAY        ( 5U * CLOCK_SECOND )
+#endif
+#endif
+
+/** @def   RESEND_REQUEST_REPEAT_DELAY
+ *  @brief How long (in clock ticks) to wait for a run before requesting it again
+ */
+#ifndef RESEND_REQUEST_REPEAT_DELAY
+#ifdef ALC_PDLR_CMD_REPEAT_DELAY_MS
+#define RESEND_REQUEST_REPEAT_DELAY     ( ( ALC_PDLR_CMD_REPEAT_DELAY_MS * CLOCK_SECOND ) / 1000U )
+#else
+#define RESEND_REQUEST_REPEAT_DELAY     ( 20U * CLOCK_SECOND )
+#endif
+#endif
+
+/** @def   RESEND_REQUEST_MAX_TX_COUNT
+ *  @brief How many times a run is requested before it is skipped
+ */
+#ifndef RESEND_REQUEST_MAX_TX_COUNT
+#ifdef ALC_PDLR_CMD_MAX_TX_COUNT
+#define RESEND_REQUEST_MAX_TX_COUNT     ALC_PDLR_CMD_MAX_TX_COUNT
+#else
+#define RESEND_REQUEST_MAX_TX_COUNT     10U
+#endif
+#endif
+
+/** @def   RESEND_REQUEST_MIN_INTERVAL
+ *  @brief The least time (in clock ticks) between two requests, to any nodes
+ */
+#ifndef RESEND_REQUEST_MIN_INTERVAL
+#define RESEND_REQUEST_MIN_INTERVAL     ( CLOCK_SECOND / 4U )
+#endif
+
+/** @def   RESEND_REQUEST_MAX_COUNT
+ *  @brief The most seq32s asked for in one request -- a longer run is asked
+ *         for a piece at a time.
+ */
+#ifndef RESEND_REQUEST_MAX_COUNT
+#define RESEND_REQUEST_MAX_COUNT        64U
+#endif
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+/** @brief Sends a request to the node to resend count samples from first_seq32
+ *         in the stream id16. Returns false if it couldn't be sent (it is
+ *         tried again on the next poll).
+ */
+typedef bool (*ResendRequestSendFn)(uip_ipaddr_t const *p_ipaddr, uint16_t id16, uint32_t first_seq32, uint32_t count);
+
+
+typedef struct {
+    uint32_t num_sent;              /**< @brief Requests sent */
+    uint32_t num_unsent;            /**< @brief Polls with a request due and no sender registered */
+    uint32_t num_rate_limited;      /**< @brief Requests held back by RESEND_REQUEST_MIN_INTERVAL */
+    uint32_t num_resolved;          /**< @brief Runs that stopped being missing */
+    uint32_t num_given_up;          /**< @brief Runs requested RESEND_REQUEST_MAX_TX_COUNT times */
+    uint32_t num_skipped;           /**< @brief Runs skipped after giving up */
+} ResendRequestStats;
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+void ResendRequest_init(void);
+void ResendRequest_set_send_fn(ResendRequestSendFn fn);
+
+/** @brief Check every node in the node list, and send the requests that are
+ *         due. Called about once a second.
+ */
+void ResendRequest_poll(clock_time_t now);
+
+void ResendRequest_get_stats(ResendRequestStats *p_stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+/*******************************************************************************
+*                               CONFIGURATION ERRORS
+*******************************************************************************/
+
+#if ( RESEND_REQUEST_MAX_TX_COUNT < 1U )
+#error "RESEND_REQUEST_MAX_TX_COUNT must be at least 1"
+#endif
+
+#if ( RESEND_REQUEST_MAX_COUNT < 1U )
+#error "RESEND_REQUEST_MAX_COUNT must be at least 1"
+#endif
+
+
+
+
+#endif /* SOURCE_INC_DATABUFFERS_RESEND_REQUEST_H_ */
@@ -79,6 +79,11 @@ uint32_t SensorDataList_get_size(SensorDataList const *p_self);
 
 bool SensorDataList_insert(SensorDataList *p_self, struct SensorData *p_data);
 
+/* Moves the objects in p_batch (in ascending order) into the list, and leaves
+ * the duplicates in p_batch. Returns the number moved.
+ */
+uint32_t SensorDataList_merge(SensorDataList *p_self, SensorDataList *p_batch);
+
 uint32_t SensorDataList_max_pop_len(SensorDataList const *p_self, uint32_t limit);
 struct SensorData* SensorDataList_pop_front(SensorDataList *p_self);
 void SensorDataList_push_back(SensorDataList *p_self, struct SensorData *p_data);
@@ -17,6 +17,7 @@
 *******************************************************************************/
 #include <stdbool.h>
 
+#include "cmsis_os.h"
 #include "net/ip/uip.h"
 #include "sensor_data_list.h"
 
@@ -27,6 +28,36 @@
 *                               DEFAULT CONFIGURATION
 *******************************************************************************/
 
+/** @brief Number of mutexes shared out between the nodes (by address). Nodes
+ *         on different locks can be added to and drained in parallel.
+ */
+#ifndef SENSOR_NODE_NUM_LOCKS
+#define SENSOR_NODE_NUM_LOCKS           8U
+#endif
+
+/** @brief How long an operation waits for its node's lock before it fails */
+#ifndef SENSOR_NODE_LOCK_TIMEOUT_MS
+#define SENSOR_NODE_LOCK_TIMEOUT_MS     1000U
+#endif
+
+/** @brief Times SensorNode_read_info() tries for a copy no writer has changed */
+#ifndef SENSOR_NODE_INFO_READ_ATTEMPTS
+#define SENSOR_NODE_INFO_READ_ATTEMPTS  100U
+#endif
+
+/** @brief Number of buckets in the reorder depth histogram. Bucket 0 holds the
+ *         samples that arrived in order, bucket k those 2^(k-1) to 2^k - 1
+ *         behind the newest, and the last bucket everything further behind.
+ */
+#ifndef SENSOR_NODE_REORDER_NUM_BUCKETS
+#define SENSOR_NODE_REORDER_NUM_BUCKETS 8U
+#endif
+
+/** @brief The period (in seconds) the ingest rate is measured over */
+#ifndef SENSOR_NODE_RATE_PERIOD_S
+#define SENSOR_NODE_RATE_PERIOD_S       10U
+#endif
+
 
 
 
@@ -41,7 +72,24 @@
 *                               DATA TYPES
 *******************************************************************************/
 
+/** @brief How a node's samples arrive -- updated under the node's lock */
 typedef struct {
+    uint32_t        num_samples;            /**< @brief Samples offered to the node */
+    uint32_t        num_duplicates;         /**< @brief Already in the queue */
+    uint32_t        num_gaps;               /**< @brief Jumps forward in seq32 */
+    uint32_t        num_gap_samples;        /**< @brief seq32s skipped by the jumps */
+    uint32_t        max_gap;                /**< @brief The longest jump */
+    uint32_t        newest_seq32;           /**< @brief The highest seq32 offered */
+    bool            has_newest;             /**< @brief newest_seq32 is set */
+    uint32_t        reorder_hist[SENSOR_NODE_REORDER_NUM_BUCKETS];  /**< @brief How far behind the newest each sample was */
+    uint32_t        max_reorder_depth;
+    uint32_t        rate_start_s;           /**< @brief Start of the period being counted */
+    uint32_t        rate_count;             /**< @brief Samples in the period being counted */
+    uint32_t        samples_per_s_x100;     /**< @brief Over the last full period */
+} SensorNodeIngestStats;
+
+
+typedef struct SensorNode {
     bool            is_used;                /* is this element in use (used by sensor_node_list) */
     struct {
         uint8_t is_stale : 1;
@@ -66,9 +114,38 @@ typedef struct {
     struct {
         uint32_t    num_samples_waiting;    /* Number of samples waiting to be sent */
     } shadow;
+    uint32_t        num_dropped;            /**< @brief Samples SensorNode_add_data() failed to add */
+    uint32_t        info_seq;               /**< @brief Odd while the metadata is being written */
+    struct SensorNode *p_ready_next;        /**< @brief The next node in the ready list */
+    bool            is_ready;               /**< @brief The node is in the ready list */
+    SensorNodeIngestStats ingest;
 } SensorNode;
 
 
+/** @brief What SensorNode_add_data_batch() did with a batch */
+typedef struct {
+    uint32_t        num_inserted;
+    uint32_t        num_duplicates;         /**< @brief Already in the queue */
+    uint32_t        num_out_of_window;      /**< @brief Behind the front of the queue (already sent) */
+} SensorNodeBatchResult;
+
+
+/** @brief A consistent copy of a node's metadata -- see SensorNode_read_info() */
+typedef struct {
+    uint8_t         fw_version[3];
+    uint8_t         stratum;
+    double          lat;
+    double          lon;
+    uint32_t        num_samples_waiting;
+    uint16_t        bulb_current_ma_rms;
+    uint16_t        id16;
+    uint32_t        num_rx_packets;
+    clock_time_t    last_msg_rx_time;
+    char const     *p_status;               /**< @brief As SensorNode_get_status_string() */
+    bool            is_dirty;
+} SensorNodeInfo;
+
+
 
 
 /*******************************************************************************
@@ -93,7 +170,14 @@ extern "C" {
 #endif
 
 
-/** @brief Initialise the object */
+/** @brief Create the node locks. Must succeed before any node is initialised
+ *         (SNL_init() calls it first) -- a node without its lock asserts.
+ */
+bool SensorNode_init_locks(void);
+
+/** @brief Initialise the object. The node must not be in the ready list --
+ *         SensorNode_destroy() takes it out.
+ */
 void SensorNode_init(SensorNode *p_self);
 bool SensorNode_destroy(SensorNode *p_self);
 
@@ -102,12 +186,85 @@ bool SensorNode_reset_data_stream(SensorNode *p_self, uint16_t id16, uint32_t se
 bool SensorNode_add_data(SensorNode *p_self, struct SensorData *p_sensor_data);
 struct SensorData* SensorNode_remove_data(SensorNode *p_self);
 
+/** @brief Add a batch of samples, in ascending order (e.g. built with
+ *         SensorDataList_insert()), with one lock and one pass over the queue.
+ *         The samples that weren't added are left in p_batch, for the caller
+ *         to return to the pool. Returns false if the lock timed out (nothing
+ *         was added).
+ */
+bool SensorNode_add_data_batch(SensorNode *p_self, SensorDataList *p_batch, SensorNodeBatchResult *p_result);
+
 uint32_t SensorNode_get_data_size(SensorNode *p_self);
 uint32_t SensorNode_max_pop_len(SensorNode const *p_self, uint32_t limit);
 uint32_t SensorNode_received_to_seq32(SensorNode const *p_self);
 
+/** @brief The first run of seq32s missing from the queue, from front_seq32 up
+ *         to the newest sample queued. Returns false if nothing is missing.
+ */
+bool SensorNode_get_first_missing(SensorNode const *p_self, uint32_t *p_first_seq32, uint32_t *p_count);
+
+/** @brief Give up on a missing run -- if it is at the front of the queue,
+ *         front_seq32 moves past it so the samples behind it are contiguous.
+ *         Returns false if the run is not at the front (yet).
+ */
+bool SensorNode_skip_missing(SensorNode *p_self, uint32_t first_seq32, uint32_t count);
+
 char const* SensorNode_get_status_string(SensorNode const *p_self);
 
+/** @brief Bracket every change to the metadata in SensorNodeInfo, so
+ *         SensorNode_read_info() can tell a copy was made while it changed.
+ *         No lock is taken -- a writer only waits for another writer of the
+ *         same node to finish its stores. The setters below do this for the
+ *         fields written by the pole data-link root.
+ */
+void SensorNode_begin_info_update(SensorNode *p_self);
+void SensorNode_end_info_update(SensorNode *p_self);
+
+void SensorNode_set_fw_version(SensorNode *p_self, uint8_t const *p_fw_version);
+void SensorNode_set_stratum(SensorNode *p_self, uint8_t stratum);
+void SensorNode_set_position(SensorNode *p_self, double lat, double lon);
+void SensorNode_set_bulb_current(SensorNode *p_self, uint16_t bulb_current_ma_rms);
+void SensorNode_set_num_samples_waiting(SensorNode *p_self, uint32_t num_samples_waiting);
+void SensorNode_count_rx_packet(SensorNode *p_self);
+
+/** @brief Copy the node's metadata without taking a lock. Returns false if a
+ *         writer kept changing it -- the copy is made anyway, but may mix old
+ *         and new values.
+ */
+bool SensorNode_read_info(SensorNode const *p_self, SensorNodeInfo *p_info);
+
+/** @brief Samples the node has dropped -- its lock timed out, or the sample
+ *         was a duplicate or (in a batch) already sent.
+ */
+uint32_t SensorNode_get_num_dropped(SensorNode const *p_self);
+
+/** @brief Copy the node's ingest statistics. Returns false if the lock timed
+ *         out.
+ */
+bool SensorNode_get_ingest_stats(SensorNode const *p_self, SensorNodeIngestStats *p_stats);
+
+/** @brief How far behind the newest sample percent of the samples arrived --
+ *         the top of the histogram bucket it falls in, capped at the deepest.
+ */
+uint32_t SensorNode_reorder_depth_percentile(SensorNodeIngestStats const *p_stats, uint32_t percent);
+
+/** @brief Operations on any node that failed because the lock timed out */
+uint32_t SensorNode_get_num_lock_timeouts(void);
+
+/** @brief The lock a node uses (for the host benchmarks' lock statistics) */
+osMutexId SensorNode_get_lock(SensorNode const *p_self);
+
+/** @brief The ready list holds the nodes that may have work for the uploader --
+ *         a node joins it when SensorNode_add_data() makes its queue
+ *         non-empty, or when it is marked as dirty. A node taken from the list
+ *         with SensorNode_pop_ready() that still has data must be put back
+ *         with SensorNode_mark_as_ready().
+ */
+void        SensorNode_clear_ready_list(void);
+void        SensorNode_mark_as_ready(SensorNode *p_self);
+SensorNode* SensorNode_pop_ready(void);
+uint32_t    SensorNode_get_num_ready(void);
+
 void     SensorNode_mark_as_dirty(SensorNode *p_self);
 void     SensorNode_clear_is_dirty(SensorNode *p_self);
 bool     SensorNode_is_dirty(SensorNode const *p_self);
@@ -131,6 +288,14 @@ void SensorNode_mark_for_deletion(SensorNode *p_self);
 *                               CONFIGURATION ERRORS
 *******************************************************************************/
 
+#if ( SENSOR_NODE_REORDER_NUM_BUCKETS < 2U ) || ( SENSOR_NODE_REORDER_NUM_BUCKETS > 32U )
+#error "SENSOR_NODE_REORDER_NUM_BUCKETS must be 2 to 32"
+#endif
+
+#if ( SENSOR_NODE_RATE_PERIOD_S < 1U )
+#error "SENSOR_NODE_RATE_PERIOD_S must be at least 1"
+#endif
+
 
 
 
@@ -72,9 +72,12 @@ uint32_t SNL_get_max_size(void);
 
 SensorNode* SNL_find(uip_ipaddr_t const *p_ipaddr, bool create_if_none, bool *p_was_created);
 
-void SNL_for_each_node(bool (*fn)(uint32_t index, SensorNode const *p_node));
+void SNL_for_each_node(bool (*fn)(uint32_t index, SensorNode *p_node));
 
 
+/* The node's place in the list (as passed to SNL_for_each_node()), if it is in use */
+bool SNL_get_index(SensorNode const* p_sensor_node, uint32_t *p_index);
+
 bool SNL_is_in_list(SensorNode const* p_sensor_node);
 SensorNode* SNL_find_first_active_node(void);
 SensorNode* SNL_find_next_active_node(SensorNode const *p_sensor_node, bool wrap_search);
@@ -0,0 +1,239 @@
+/**
+ * @file  deferred_log.h
+ * @brief Deferred logging -- log messages are formatted by a low priority task
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * AlcLogger_log_printf() formats the message in the calling task, which is a
+ * full vsnprintf() and a write to the debug UART on the hot paths. Instead, a
+ * deferred log message is recorded as the ID of its format string (see
+ * DeferredLogId) and up to DEFERRED_LOG_MAX_ARGS integer arguments, in a ring
+ * that is lock-free -- it can be written from any task or interrupt. On the
+ * gateway the deferred_log_process (16174prog03.c) formats the messages and
+ * passes them on to the AlcLogger, so they get their timestamp when they are
+ * emitted. Elsewhere (e.g. the host benchmarks) DeferredLog_task() does.
+ *
+ * When the ring is full the message is dropped and counted, and the number
+ * dropped is logged the next time the ring is emptied.
+ *
+ * Only integer arguments are recorded (a pointer to a string would not be
+ * valid by the time it is formatted). Messages with strings in them, and the
+ * critical messages that come before a reboot, are logged with the AlcLogger
+ * directly.
+ *
+ * DeferredLog_pop() and DeferredLog_format() let a host tool decode the raw
+ * messages, with the table of format strings in deferred_log.c.
+ */
+
+#ifndef SOURCE_INC_DEFERRED_LOG_H_
+#define SOURCE_INC_DEFERRED_LOG_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "alc_logger.h"
+
+
+
+
+/*******************************************************************************
+*                               DEFAULT CONFIGURATION
+*******************************************************************************/
+
+/** @def   DEFERRED_LOG_ENABLE
+ *  @brief Defer the messages, [1=yes, 0=no -- log them with the AlcLogger
+ *         from the calling task]
+ */
+#ifndef DEFERRED_LOG_ENABLE
+#define DEFERRED_LOG_ENABLE             1
+#endif
+
+
+/** @def   DEFERRED_LOG_RING_SIZE
+ *  @brief Number of messages that can wait to be formatted (a power of 2)
+ */
+#ifndef DEFERRED_LOG_RING_SIZE
+#define DEFERRED_LOG_RING_SIZE          64U
+#endif
+
+
+/** @def   DEFERRED_LOG_FLUSH_PERIOD_MS
+ *  @brief How often the ring is emptied
+ */
+#ifndef DEFERRED_LOG_FLUSH_PERIOD_MS
+#define DEFERRED_LOG_FLUSH_PERIOD_MS    100U
+#endif
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+/** @brief The most integer arguments a message can have */
+#define DEFERRED_LOG_MAX_ARGS           4U
+
+/** @brief The longest formatted message, including the terminator */
+#define DEFERRED_LOG_MAX_STR_LEN        100U
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+/** @brief The format strings -- the strings are in deferred_log.c.
+ *
+ * Add new IDs to the end, so a binary dump from older firmware still decodes.
+ */
+typedef enum {
+    LOG_ID_POOL_EMPTY=0,
+    LOG_ID_DUC_RETRANSMITTING,
+    LOG_ID_DUC_LINK_CLOSED,
+    LOG_ID_DUC_FORCING_CLOSED,
+    LOG_ID_DUC_NODES_DELETED,
+    LOG_ID_DUC_SEND_FAILED,
+    LOG_ID_DUC_BYTES_NOT_ACKED,
+    LOG_ID_DUC_DATAGRAM_SEND_FAILED,
+    LOG_ID_DUC_DATAGRAMS_GIVEN_UP,
+    LOG_ID_MODEM_RESTART_REQUESTED,
+    LOG_ID_MODEM_RECOVERY_REQUESTED,
+    LOG_ID_MODEM_CONF_CHANGED,
+    LOG_ID_MODEM_RESETTING,
+    LOG_ID_MODEM_REGISTERED,
+    LOG_ID_MODEM_NOT_REGISTERED,
+    LOG_ID_MODEM_CONNECTED,
+    LOG_ID_MODEM_NO_RESTART_AFTER_SOFT_RESET,
+    LOG_ID_MODEM_RESTARTING,
+    LOG_ID_MODEM_RESTARTING_FOR_CONF,
+    LOG_ID_MODEM_RECOVERY_PDP,
+    LOG_ID_MODEM_RECOVERY_SOFT_RESET,
+    LOG_ID_MODEM_RECOVERY_HARD_RESET,
+    NUM_DEFERRED_LOG_IDS
+} DeferredLogId;
+
+
+/** @brief A message waiting in the ring */
+typedef struct {
+    uint32_t seq;                           /**< Position in the ring + 1 -- written last */
+    uint16_t id;                            /**< DeferredLogId */
+    uint8_t  level;                         /**< AlcLoggerLevel */
+    uint8_t  num_args;
+    uint32_t args[DEFERRED_LOG_MAX_ARGS];
+} DeferredLogEntry;
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+#if DEFERRED_LOG_ENABLE
+#define DEFERRED_LOG(level, id)                     DeferredLog_put((level), (id), 0U, 0U, 0U, 0U, 0U)
+#define DEFERRED_LOG1(level, id, a0)                DeferredLog_put((level), (id), 1U, (uint32_t) (a0), 0U, 0U, 0U)
+#define DEFERRED_LOG2(level, id, a0, a1)            DeferredLog_put((level), (id), 2U, (uint32_t) (a0), (uint32_t) (a1), 0U, 0U)
+#define DEFERRED_LOG3(level, id, a0, a1, a2)        DeferredLog_put((level), (id), 3U, (uint32_t) (a0), (uint32_t) (a1), (uint32_t) (a2), 0U)
+#define DEFERRED_LOG4(level, id, a0, a1, a2, a3)    DeferredLog_put((level), (id), 4U, (uint32_t) (a0), (uint32_t) (a1), (uint32_t) (a2), (uint32_t) (a3))
+#else
+#define DEFERRED_LOG(level, id)                     DeferredLog_log_now((level), (id), 0U, 0U, 0U, 0U, 0U)
+#define DEFERRED_LOG1(level, id, a0)                DeferredLog_log_now((level), (id), 1U, (uint32_t) (a0), 0U, 0U, 0U)
+#define DEFERRED_LOG2(level, id, a0, a1)            DeferredLog_log_now((level), (id), 2U, (uint32_t) (a0), (uint32_t) (a1), 0U, 0U)
+#define DEFERRED_LOG3(level, id, a0, a1, a2)        DeferredLog_log_now((level), (id), 3U, (uint32_t) (a0), (uint32_t) (a1), (uint32_t) (a2), 0U)
+#define DEFERRED_LOG4(level, id, a0, a1, a2, a3)    DeferredLog_log_now((level), (id), 4U, (uint32_t) (a0), (uint32_t) (a1), (uint32_t) (a2), (uint32_t) (a3))
+#endif
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief Empty the ring, and clear the number dropped (for the unit-tests) */
+void DeferredLog_init(void);
+
+/** @brief Record a message in the ring (use the DEFERRED_LOG() macros).
+ *
+ * Safe to call from any task or interrupt -- a full ring drops the message.
+ */
+void DeferredLog_put(AlcLoggerLevel level, DeferredLogId id, uint32_t num_args,
+                     uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/** @brief Format a message and log it straight away (DEFERRED_LOG_ENABLE=0) */
+void DeferredLog_log_now(AlcLoggerLevel level, DeferredLogId id, uint32_t num_args,
+                         uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/** @brief Take the oldest message from the ring.
+ *
+ * There must only be one reader -- the task, or a tool dumping the ring.
+ *
+ * @return false if the ring is empty
+ */
+bool DeferredLog_pop(DeferredLogEntry *p_entry);
+
+/** @brief Format a message into p_buff (always terminated).
+ *
+ * @return The length of the formatted message
+ */
+uint32_t DeferredLog_format(DeferredLogEntry const *p_entry, char *p_buff, uint32_t len);
+
+/** @brief The format string for an ID -- "?" for an unknown ID */
+char const* DeferredLog_get_format(DeferredLogId id);
+
+/** @brief Format and emit up to max_entries messages from the ring, then log
+ *         the number dropped since the last flush.
+ *
+ * @return The number of messages emitted
+ */
+uint32_t DeferredLog_flush(uint32_t max_entries);
+
+/** @brief Number of messages dropped because the ring was full */
+uint32_t DeferredLog_get_num_dropped(void);
+
+
+/** @brief The RTOS task that emits the messages -- it should have a low
+ *         priority (osPriorityLow).
+ */
+void DeferredLog_task(void const * argument);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+/*******************************************************************************
+*                               CONFIGURATION ERRORS
+*******************************************************************************/
+
+#if ( DEFERRED_LOG_RING_SIZE & ( DEFERRED_LOG_RING_SIZE - 1U ) ) != 0U
+#error "DEFERRED_LOG_RING_SIZE must be a power of 2"
+#endif
+
+
+
+
+#endif /* SOURCE_INC_DEFERRED_LOG_H_ */
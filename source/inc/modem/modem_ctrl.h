@@ -50,6 +50,19 @@
 *                               DATA TYPES
 *******************************************************************************/
 
+/** @brief The tiers of recovery, cheapest first.
+ *
+ * Re-opening the socket is left to the user of the link -- it asks for the
+ * next tier with ModemCtrl_request_recovery() once that keeps failing.
+ */
+typedef enum {
+    MODEM_RECOVER_NONE=0,
+    MODEM_RECOVER_PDP,              /**< Re-attach the PDP context (and re-join the network if needed) */
+    MODEM_RECOVER_SOFT_RESET,       /**< Restart the modem with AT+CFUN=1,1 */
+    MODEM_RECOVER_HARD_RESET,       /**< Shut down, and hard reset the modem */
+    NUM_MODEM_RECOVERY_TIERS
+} ModemRecovery;
+
 
 
 
@@ -82,12 +95,37 @@ uint32_t ModemCtrl_get_state(void);
  * @return true/false the modem can execute commands
  */
 bool ModemCtrl_modem_is_ready(void);
+
+/** @brief Wait for the modem to be ready for commands (see
+ *         ModemCtrl_modem_is_ready()), so the caller can start using it the
+ *         moment it is, rather than polling on a period of its own.
+ *
+ * @return false if the modem was not ready within timeout_ms
+ */
+bool ModemCtrl_wait_for_ready(uint32_t timeout_ms);
 bool ModemCtrl_gps_is_ready(void);
 bool ModemCtrl_get_gps_info(GpsSentence *p_inf, uint32_t *p_timestamp);
 
 
 void ModemCtrl_restart_modem(void);
 
+/** @brief Ask for the link to be recovered, with the cheapest tier that
+ *         has not already been tried since the link last worked.
+ *
+ * A modem that does not answer "AT" goes straight to a hard reset. The PDP
+ * tier skips the network join and the GPRS attach when the modem still
+ * reports them.
+ */
+void ModemCtrl_request_recovery(void);
+
+/** @brief Tell the controller the link is working -- the next recovery
+ *         starts from the cheapest tier again.
+ */
+void ModemCtrl_link_opened(void);
+
+/** @brief Number of recoveries at the tier since start-up */
+uint32_t ModemCtrl_get_num_recoveries(ModemRecovery tier);
+
 
 void ModemCtrl_conf_has_been_changed(void);
 bool ModemCtrl_check_conf_has_changed(void);
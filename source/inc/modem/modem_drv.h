@@ -16,8 +16,11 @@
 *                               INCLUDE FILES
 *******************************************************************************/
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "cmsis_os.h"
+
 
 
 
@@ -40,6 +43,17 @@
 #define MODEM_NW_REG_JOINED_ROAMING     5U
 
 
+/** @brief Readiness signals seen from the modem, from its URC's and from the
+ *         replies to the status queries (see Modem_get_ready_flags()).
+ */
+#define MODEM_READY_DRIVER              ( 1u << 0 )     /**< @brief The driver task is running */
+#define MODEM_READY_RDY                 ( 1u << 1 )     /**< @brief "RDY" -- the modem has started */
+#define MODEM_READY_CALL                ( 1u << 2 )     /**< @brief "Call Ready" */
+#define MODEM_READY_SMS                 ( 1u << 3 )     /**< @brief "SMS Ready" */
+#define MODEM_READY_REGISTERED          ( 1u << 4 )     /**< @brief "+CREG:" -- registered to the home network */
+#define MODEM_READY_ATTACHED            ( 1u << 5 )     /**< @brief "+CGATT: 1" -- attached to GPRS */
+
+
 
 
 /*******************************************************************************
@@ -52,6 +66,106 @@
 #define SEARCH_BUSY_P   ( 1u << 4 )
 #define SEARCH_SHUT_OK  ( 1u << 5 )
 #define SEARCH_CLOSE_OK ( 1u << 6 )
+#define SEARCH_CONNECT  ( 1u << 7 )
+
+
+/** @brief Flags for ModemCommand */
+#define MODEM_CMD_FLAG_RAW_DATA     ( 1u << 0 )     /**< @brief Write p_tx_buff in transparent data mode (no AT command) */
+#define MODEM_CMD_FLAG_NO_CRLF      ( 1u << 1 )     /**< @brief Don't terminate command_str with CR/LF (e.g. "+++") */
+
+
+/** @brief Priority of a command submitted to the modem driver's queue.
+ *
+ * When the driver is free to start a new command, it picks the queued command
+ * with the highest priority. Commands of equal priority are run in the order
+ * they were submitted.
+ */
+typedef enum {
+    MODEM_CMD_PRIORITY_BULK=0,      /**< Bulk data transfers (AT+CIPSEND) */
+    MODEM_CMD_PRIORITY_NORMAL,      /**< General commands */
+    MODEM_CMD_PRIORITY_URGENT       /**< Short control and status queries */
+} ModemCmdPriority;
+
+
+/** @brief One fragment of the data for a scatter-gather write */
+typedef struct {
+    void const       *p_base;           /**< @brief Start of the fragment */
+    uint32_t          len;              /**< @brief Number of bytes in the fragment */
+} ModemIoVec;
+
+
+typedef struct ModemCommand ModemCommand;
+
+/** @brief A command descriptor for the modem driver's command queue.
+ *
+ * The descriptor belongs to the driver from the time it is submitted until
+ * it has completed, so it must not be modified or go out of scope before then.
+ */
+struct ModemCommand {
+    char const       *command_str;      /**< @brief The AT command (without CR/LF) */
+    uint32_t          search_mask;      /**< @brief SEARCH_xxx result codes that complete the command */
+    bool            (*fn)(char const *str); /**< @brief Response line parser (may be NULL) */
+    uint8_t const    *p_tx_buff;        /**< @brief Data to send after the '>' prompt (may be NULL) */
+    uint32_t          tx_bufflen;       /**< @brief Number of bytes in p_tx_buff (or in total in p_iov) */
+    ModemIoVec const *p_iov;            /**< @brief Data fragments, sent instead of p_tx_buff (may be NULL) */
+    uint32_t          iovcnt;           /**< @brief Number of entries in p_iov */
+    uint32_t          timeout_ms;       /**< @brief Timeout once started, 0 = no timeout */
+    ModemCmdPriority  priority;         /**< @brief Queue priority */
+    uint32_t          flags;            /**< @brief MODEM_CMD_FLAG_xxx */
+    uint8_t           channel;          /**< @brief Channel the data is sent on (for the sent count) */
+
+    /** @brief Completion callback (may be NULL).
+     *  @note Called from the ModemDrv_task context, so it must not block.
+     */
+    void            (*on_complete)(ModemCommand *p_cmd, bool result);
+    void             *p_context;        /**< @brief For use by the submitter */
+
+    volatile bool     is_done;          /**< @brief Set by the driver when the command has completed */
+    volatile bool     result;           /**< @brief Set by the driver when the command has completed */
+    uint32_t          order;            /**< @brief Used by the driver to keep FIFO order */
+    osThreadId        waiter;           /**< @brief Used by the driver to signal the submitter */
+};
+
+
+/** @brief The operations that differ from one modem module to the next.
+ *
+ * The AT command queue, the receive state machine, the readiness signals
+ * and the 3GPP commands common to all the modules are in modem_drv.c. The
+ * bearer and the socket commands of each module are in its own driver, which
+ * fills in one of these tables. The Modem_xxx functions of the same name call
+ * through the table of the selected driver (see Modem_select_driver()).
+ */
+typedef struct {
+    char const *name;
+
+    uint8_t     num_channels;           /**< @brief Sockets the module can have open */
+    char const *send_fmt;               /**< @brief The send command, from the channel and the length (e.g. "AT+CIPSEND=%u,%u") */
+
+    /** @brief Bytes that may be sent to a channel but not yet acknowledged
+     *         by the server, in quick send mode (see Modem_set_quick_send()).
+     */
+    uint32_t    send_window;
+
+    bool        has_transparent_mode;   /**< @brief Modem_set_transparent_mode() can be used */
+    bool        buffers_sends;          /**< @brief A send completes once the data is in the modem's buffer */
+
+    bool      (*soft_reset)(void);
+    bool      (*enable_network_registration)(void);
+    bool      (*get_network_registration)(uint32_t *p_status);
+    bool      (*enable_gprs)(bool on_off);
+    bool      (*get_ip_addr)(char *dest, size_t destlen);
+    bool      (*tcp_open)(uint8_t channel, char const *server, uint16_t port, uint32_t timeout_ms);
+
+    /** @brief Open a UDP link -- NULL if the driver can't (see Modem_udp_open()) */
+    bool      (*udp_open)(uint8_t channel, char const *server, uint16_t port, uint32_t timeout_ms);
+    bool      (*tcp_close)(uint8_t channel, uint32_t timeout_ms);
+    bool      (*tcp_get_send_size)(uint8_t channel, uint32_t *p_size, uint32_t timeout_ms);
+
+    /** @brief Ask the modem how much data the server has acknowledged on the
+     *         channel since it was opened.
+     */
+    bool      (*tcp_get_acked)(uint8_t channel, uint32_t *p_acked, uint32_t timeout_ms);
+} ModemDriverOps;
 
 
 
@@ -60,6 +174,9 @@
 *                               GLOBAL VARIABLES
 *******************************************************************************/
 
+extern ModemDriverOps const g_modem_drv_sim808;     /**< @brief SIMCom SIM808 (GSM/GPRS) */
+extern ModemDriverOps const g_modem_drv_ec2x;       /**< @brief Quectel EC21/EC25 (LTE Cat-1) */
+
 
 
 
@@ -78,6 +195,17 @@ extern "C" {
 #endif
 
 
+/** @brief Select the driver for the modem module that is fitted.
+ *
+ * The default is MODEM_DRV_DEFAULT_OPS (see modem_drv_conf.h).
+ *
+ * @note Must be called before ModemDrv_task() is started.
+ * @return false if the table is incomplete
+ */
+bool Modem_select_driver(ModemDriverOps const *p_ops);
+ModemDriverOps const* Modem_get_driver(void);
+
+
 bool Modem_run_command(char const *command_str,
                        uint32_t search_mask,
                        uint32_t timeout_ms);
@@ -95,6 +223,10 @@ bool Modem_run_command_ex(char const *command_str,
                           uint32_t tx_bufflen,
                           uint32_t timeout_ms);
 
+bool Modem_submit_command(ModemCommand *p_cmd);
+bool Modem_wait_command(ModemCommand *p_cmd);
+uint32_t Modem_get_queue_length(void);
+
 bool Modem_run_command_parse_reply_u32(
         char const *command_str,
         char const *p_search_str,
@@ -109,6 +241,29 @@ bool Modem_run_command_parse_reply_u32(
 void Modem_hard_reset(void);
 bool Modem_soft_reset(void);
 
+
+/** @brief The MODEM_READY_xxx signals seen since the last hard reset.
+ *
+ * "+CREG:" and "+CGATT:" clear their flag again when the modem reports it is
+ * no longer registered or attached.
+ */
+uint32_t Modem_get_ready_flags(void);
+
+/** @brief Wait for the modem to become ready, rather than for a fixed time.
+ *
+ * Returns as soon as all the flags are set, or poll_fn returns true. poll_fn
+ * (may be NULL) is called straight away, then again with a backoff that
+ * starts at MODEM_READY_POLL_MIN_MS and doubles up to max_poll_ms. The status
+ * queries update the flags from their replies, so poll_fn can just send one.
+ *
+ * @param flags        MODEM_READY_xxx flags to wait for (0 to rely on poll_fn)
+ * @param poll_fn      Polls the modem, and returns true if it is ready
+ * @param max_poll_ms  Longest interval between polls
+ * @param timeout_ms   Upper bound on the wait
+ * @return false if the modem was not ready within timeout_ms
+ */
+bool Modem_wait_for_ready(uint32_t flags, bool (*poll_fn)(void), uint32_t max_poll_ms, uint32_t timeout_ms);
+
 bool Modem_send_at(void);
 bool Modem_status(void);
 
@@ -130,16 +285,81 @@ double Modem_get_signal_strength(void);
 
 bool Modem_get_ip_addr(char *dest, size_t destlen);
 bool Modem_enable_mux(bool enable);
+bool Modem_set_echo(bool on_off);
+
+
+/** @brief Select transparent TCP mode (AT+CIPMODE=1) for the upload channel.
+ *
+ * Takes effect the next time GPRS is enabled. In transparent mode there is
+ * only one connection (on MODEM_CHANNEL_DATA_UPLOAD_CLIENT) and command echo
+ * is turned off. The driver leaves data mode with "+++" when an AT command is
+ * queued, and returns to it with "ATO" when more data is queued.
+ *
+ * Ignored unless the driver has_transparent_mode.
+ */
+void Modem_set_transparent_mode(bool enable);
+bool Modem_transparent_mode_is_enabled(void);
+
+
+/** @brief Select quick send mode (AT+CIPQSEND=1) for the multi-channel path.
+ *
+ * Takes effect the next time GPRS is enabled. In quick send mode the modem
+ * replies "DATA ACCEPT" as soon as the data is in its buffer, rather than
+ * "SEND OK" once the server has acknowledged it. So Modem_tcp_write_buff()
+ * returns without waiting for the network round trip, and several sends may
+ * be in flight. It blocks only when more than the driver's send_window bytes
+ * (MODEM_TCP_SEND_WINDOW for the SIM808) are unacknowledged.
+ *
+ * A driver that buffers_sends (the EC2x) has no "SEND OK" to wait for, so
+ * without quick send Modem_tcp_write_buff() waits until the server has
+ * acknowledged everything sent to the channel.
+ */
+void Modem_set_quick_send(bool enable);
+bool Modem_quick_send_is_enabled(void);
 
 
 /* TCP functions */
 bool Modem_tcp_write_buff(uint8_t channel, char const *p_buff, uint32_t bufflen, uint32_t timeout_ms);
 bool Modem_tcp_write_str(uint8_t channel, char const *p_str, uint32_t timeout_ms);
+
+/** @brief Send several fragments of data as one AT+CIPSEND.
+ *
+ * The total length is worked out from the fragments, and each fragment is
+ * written straight to the UART, so the caller does not need to copy them into
+ * one buffer first. The fragments must stay valid until the function returns.
+ */
+bool Modem_tcp_write_iov(uint8_t channel, ModemIoVec const *p_iov, uint32_t iovcnt, uint32_t timeout_ms);
 bool Modem_tcp_open(uint8_t channel, char const *server, uint16_t port, uint32_t timeout_ms);
 bool Modem_tcp_close(uint8_t channel, uint32_t timeout_ms);
+
+/** @brief Open a UDP link to the server on the channel.
+ *
+ * The Modem_tcp_xxx functions work on the link as they do on a TCP link
+ * (Modem_tcp_close() closes it) -- each write is sent as one datagram, and
+ * the datagrams from the server come to the channel's task as data does.
+ * Nothing is acknowledged, so a write completes once the modem has the data
+ * (the send window of quick send mode is not used).
+ *
+ * @note Not in transparent mode.
+ */
+bool Modem_udp_open(uint8_t channel, char const *server, uint16_t port, uint32_t timeout_ms);
 bool Modem_tcp_get_send_size(uint8_t channel, uint32_t *p_size, uint32_t timeout_ms);
 
 
+/** @brief Ask the modem how much data the server has acknowledged (AT+CIPACK)
+ *         and update the watermark returned by Modem_tcp_get_acked().
+ */
+bool Modem_tcp_update_ack(uint8_t channel, uint32_t timeout_ms);
+
+/** @brief Number of bytes accepted by the modem since the channel was opened */
+uint32_t Modem_tcp_get_sent(uint8_t channel);
+
+/** @brief Number of bytes acknowledged by the server since the channel was
+ *         opened (as of the last Modem_tcp_update_ack()).
+ */
+uint32_t Modem_tcp_get_acked(uint8_t channel);
+
+
 bool Modem_get_rtc(uint32_t *p_timestamp);
 
 
@@ -0,0 +1,137 @@
+/**
+ * @file  modem_drv_at.h
+ * @brief The AT command engine shared by the modem drivers
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Only for use by the drivers of the modem modules (modem_drv_sim808.c,
+ * modem_drv_ec2x.c), which are built on the command queue and the receive
+ * state machine in modem_drv.c. The rest of the firmware uses modem_drv.h.
+ *
+ * The reply parsers passed to ModemDrvAt_run_command() are called from the
+ * driver task. A parser that keeps its results in static data must hold the
+ * engine's mutex (ModemDrvAt_acquire()) around the command.
+ */
+
+#ifndef SOURCE_INC_MODEM_MODEM_DRV_AT_H_
+#define SOURCE_INC_MODEM_MODEM_DRV_AT_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "modem_drv.h"
+
+
+
+
+/*******************************************************************************
+*                               DEFAULT CONFIGURATION
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+/** @brief The most channels a driver may have (see ModemDriverOps) */
+#define MODEM_DRV_AT_MAX_CHANNELS       12U
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+bool ModemDrvAt_acquire(uint32_t timeout_ms);
+void ModemDrvAt_release(void);
+
+
+/** @brief Queue a command (with no data) and wait for it to complete */
+bool ModemDrvAt_run_command(char const *command_str,
+                            uint32_t search_mask,
+                            bool (*fn)(char const *str),
+                            uint32_t timeout_ms,
+                            ModemCmdPriority priority);
+
+/** @brief Complete the running command now.
+ * @note Only from a reply parser -- e.g. for a reply with no final result code.
+ */
+void ModemDrvAt_complete_command(bool result);
+
+
+void ModemDrvAt_set_ready_flag(uint32_t flag, bool is_set);
+
+/** @brief Poll for Modem_wait_for_ready() -- asks "AT+CGATT?" */
+bool ModemDrvAt_poll_attached(void);
+
+/** @brief Restart the modem with "AT+CFUN=1,1" -- it says "RDY" again */
+bool ModemDrvAt_cfun_reset(void);
+
+/** @brief The APN, username and password for AT+CSTT (and the like), as
+ *         "apn","username","password" -- from the settings in RAM.
+ */
+bool ModemDrvAt_build_apn_args(char *p_buff, uint32_t len);
+
+
+bool ModemDrvAt_link_is_open(void);
+
+/** @brief The channel was last opened with Modem_udp_open() */
+bool ModemDrvAt_link_is_udp(uint32_t channel);
+
+/** @brief The driver has seen a channel open (or close) with no URC the
+ *         engine knows about.
+ */
+void ModemDrvAt_link_opened(uint32_t channel);
+void ModemDrvAt_link_closed(uint32_t channel);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+/*******************************************************************************
+*                               CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+#endif /* SOURCE_INC_MODEM_MODEM_DRV_AT_H_ */
@@ -26,6 +26,157 @@
 #define MODEM_CHANNEL_DATA_UPLOAD_CLIENT        5U
 
 
+/** @def   MODEM_DRV_DEFAULT_OPS
+ *  @brief The driver of the modem module that is fitted (see ModemDriverOps),
+ *         unless another is chosen with Modem_select_driver() at boot.
+ */
+#ifndef MODEM_DRV_DEFAULT_OPS
+#define MODEM_DRV_DEFAULT_OPS                   g_modem_drv_sim808
+#endif
+
+
+/** @def   MODEM_CMD_QUEUE_SIZE
+ *  @brief Maximum number of commands waiting in the modem driver's queue
+ */
+#ifndef MODEM_CMD_QUEUE_SIZE
+#define MODEM_CMD_QUEUE_SIZE                    8U
+#endif
+
+
+/** @def   MODEM_CMD_WAIT_MARGIN_MS
+ *  @brief How much longer than a command's own timeout Modem_wait_command()
+ *         waits for it (it may have to wait in the queue behind others)
+ *         before giving up on it.
+ */
+#ifndef MODEM_CMD_WAIT_MARGIN_MS
+#define MODEM_CMD_WAIT_MARGIN_MS                30000U
+#endif
+
+
+/** @def   MODEM_CMD_DONE_SIGNAL
+ *  @brief Signal set on the submitting thread when its command completes
+ */
+#ifndef MODEM_CMD_DONE_SIGNAL
+#define MODEM_CMD_DONE_SIGNAL                   0x0100
+#endif
+
+
+/** @def   MODEM_DRV_WAKE_SIGNAL
+ *  @brief Signal set on the driver task when a command is submitted to it.
+ *
+ * The driver waits for characters in UART6_read(), so the UART6 driver must
+ * end a read early when the reading thread is signalled.
+ */
+#ifndef MODEM_DRV_WAKE_SIGNAL
+#define MODEM_DRV_WAKE_SIGNAL                   0x0200
+#endif
+
+
+/** @def   MODEM_DRV_RX_WAIT_MS
+ *  @brief Longest the driver task waits for a character when it has no
+ *         command deadline to keep.
+ */
+#ifndef MODEM_DRV_RX_WAIT_MS
+#define MODEM_DRV_RX_WAIT_MS                    1000U
+#endif
+
+
+/** @def   MODEM_UPLOAD_TRANSPARENT_MODE
+ *  @brief Set to 1 to use transparent TCP mode for the upload channel (see
+ *         Modem_set_transparent_mode()). Set to 0 to use the multi-channel
+ *         AT+CIPSEND path.
+ */
+#ifndef MODEM_UPLOAD_TRANSPARENT_MODE
+#define MODEM_UPLOAD_TRANSPARENT_MODE           0
+#endif
+
+
+/** @def   MODEM_TCP_QUICK_SEND
+ *  @brief Set to 1 to use quick send mode (AT+CIPQSEND=1) on the
+ *         multi-channel path (see Modem_set_quick_send()).
+ */
+#ifndef MODEM_TCP_QUICK_SEND
+#define MODEM_TCP_QUICK_SEND                    0
+#endif
+
+
+/** @def   MODEM_TCP_SEND_WINDOW
+ *  @brief In quick send mode, the maximum number of bytes that may be sent to
+ *         a channel but not yet acknowledged by the server.
+ */
+#ifndef MODEM_TCP_SEND_WINDOW
+#define MODEM_TCP_SEND_WINDOW                   4380U
+#endif
+
+
+/** @def   MODEM_TCP_ACK_POLL_MS
+ *  @brief How often AT+CIPACK is sent while waiting for the send window to open
+ */
+#ifndef MODEM_TCP_ACK_POLL_MS
+#define MODEM_TCP_ACK_POLL_MS                   250U
+#endif
+
+
+/** @def   MODEM_TRANSPARENT_GUARD_MS
+ *  @brief Silent time needed either side of the "+++" escape sequence
+ */
+#ifndef MODEM_TRANSPARENT_GUARD_MS
+#define MODEM_TRANSPARENT_GUARD_MS              1000U
+#endif
+
+
+/** @def   MODEM_READY_POLL_MIN_MS
+ *  @brief First interval between the polls made by Modem_wait_for_ready() --
+ *         it doubles after each poll, up to the maximum given by the caller.
+ */
+#ifndef MODEM_READY_POLL_MIN_MS
+#define MODEM_READY_POLL_MIN_MS                 100U
+#endif
+
+
+/** @def   MODEM_READY_CHECK_MS
+ *  @brief How often Modem_wait_for_ready() checks the readiness flags between
+ *         polls, so a URC ends the wait straight away.
+ */
+#ifndef MODEM_READY_CHECK_MS
+#define MODEM_READY_CHECK_MS                    20U
+#endif
+
+
+/** @def   MODEM_GPRS_ATTACH_TIMEOUT_MS
+ *  @brief Longest wait for the GPRS attach after setting the APN, before the
+ *         wireless connection is brought up.
+ */
+#ifndef MODEM_GPRS_ATTACH_TIMEOUT_MS
+#define MODEM_GPRS_ATTACH_TIMEOUT_MS            10000U
+#endif
+
+
+/** @def   MODEM_TRANSPARENT_SEND_SIZE
+ *  @brief Send size reported by Modem_tcp_get_send_size() in transparent mode
+ */
+#ifndef MODEM_TRANSPARENT_SEND_SIZE
+#define MODEM_TRANSPARENT_SEND_SIZE             1460U
+#endif
+
+
+/** @def   MODEM_EC2X_TCP_SEND_WINDOW
+ *  @brief MODEM_TCP_SEND_WINDOW for the EC2x driver -- the module buffers far
+ *         more unacknowledged data than the SIM808.
+ */
+#ifndef MODEM_EC2X_TCP_SEND_WINDOW
+#define MODEM_EC2X_TCP_SEND_WINDOW              ( 8U * 1460U )
+#endif
+
+
+/** @def   MODEM_EC2X_ACTIVATE_TIMEOUT_MS
+ *  @brief Longest wait for the EC2x to activate the PDP context (AT+QIACT=1)
+ */
+#ifndef MODEM_EC2X_ACTIVATE_TIMEOUT_MS
+#define MODEM_EC2X_ACTIVATE_TIMEOUT_MS          30000U
+#endif
+
+
 
 
 /*******************************************************************************
@@ -0,0 +1,178 @@
+/**
+ * @file  modem_urc_matcher.h
+ * @brief Table driven matcher for modem result codes and URC's.
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * All the final result codes and unsolicited result codes (URC's) that the
+ * modem driver is interested in are held in one table. At start-up the table
+ * is compiled into a trie, and each received character is then tested with a
+ * single step through the trie, rather than being tested against a number of
+ * separate matchers and a chain of strcmp() calls.
+ *
+ * A pattern may contain '%d' which matches a run of one or more digits. The
+ * value of each '%d' is captured (e.g. the channel number in "5, SEND OK").
+ */
+
+#ifndef SOURCE_INC_MODEM_MODEM_URC_MATCHER_H_
+#define SOURCE_INC_MODEM_MODEM_URC_MATCHER_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+
+/*******************************************************************************
+*                               DEFAULT CONFIGURATION
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+/** @brief Maximum number of '%d' values captured from one line */
+#define MODEM_URC_MATCHER_MAX_CAPTURES      2U
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+typedef enum {
+    MODEM_TOKEN_NONE=0,
+    MODEM_TOKEN_OK,                 /**< "OK" */
+    MODEM_TOKEN_FAIL,               /**< "FAIL" */
+    MODEM_TOKEN_ERROR,              /**< "ERROR" */
+    MODEM_TOKEN_BUSY_P,             /**< "busy p..." */
+    MODEM_TOKEN_SHUT_OK,            /**< "SHUT OK" */
+    MODEM_TOKEN_CONNECT,            /**< "CONNECT" (transparent mode data link is up) */
+    MODEM_TOKEN_CONNECT_OK,         /**< "<ch>, CONNECT OK" or "+QIOPEN: <ch>,0" */
+    MODEM_TOKEN_CONNECT_FAIL,       /**< "<ch>, CONNECT FAIL", "CONNECT FAIL" or "+QIOPEN: <ch>,<err>" */
+    MODEM_TOKEN_CLOSE_OK,           /**< "<ch>, CLOSE OK" or "CLOSE OK" */
+    MODEM_TOKEN_CLOSED,             /**< "<ch>, CLOSED", "CLOSED" or "+QIURC: "closed",<ch>" */
+    MODEM_TOKEN_SEND_OK,            /**< "<ch>, SEND OK" or "SEND OK" */
+    MODEM_TOKEN_SEND_FAIL,          /**< "<ch>, SEND FAIL" or "SEND FAIL" */
+    MODEM_TOKEN_DATA_ACCEPT,        /**< "DATA ACCEPT:<ch>,<len>" (quick send mode) */
+    MODEM_TOKEN_RECEIVE,            /**< "+RECEIVE,<ch>,<len>:" (fires on the ':') */
+    MODEM_TOKEN_RECEIVE_LINE,       /**< "+QIURC: "recv",<ch>,<len>" (the data follows the line) */
+    MODEM_TOKEN_RDY,                /**< "RDY" (the modem has started) */
+    MODEM_TOKEN_CALL_READY,         /**< "Call Ready" */
+    MODEM_TOKEN_SMS_READY,          /**< "SMS Ready" or "+QIND: SMS DONE" */
+    MODEM_TOKEN_CREG,               /**< "+CREG: <stat>", "+CREG: <n>,<stat>" or the "+CEREG: " forms */
+    MODEM_TOKEN_CGATT,              /**< "+CGATT: <state>" */
+    NUM_MODEM_TOKENS
+} ModemToken;
+
+
+/** @brief The state of the matcher for the line being received */
+typedef struct {
+    uint8_t  node;                  /**< @brief Current position in the trie */
+    bool     failed;                /**< @brief The line can't match any pattern */
+    uint8_t  num_captures;          /**< @brief Number of '%d' values captured */
+    uint32_t captures[MODEM_URC_MATCHER_MAX_CAPTURES];
+} ModemUrcMatcher;
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief Compile the table of patterns into the trie.
+ *
+ * @note Must be called before other functions are used.
+ * @return false if the table of patterns does not fit in the trie (see
+ *         MODEM_URC_MATCHER_MAX_NODES) or has a duplicate pattern.
+ */
+bool ModemUrcMatcher_init(void);
+
+
+/** @brief Start matching a new line */
+void ModemUrcMatcher_reset(ModemUrcMatcher *p_self);
+
+
+/** @brief Test the next character of the line.
+ *
+ * @param p_self  The matcher
+ * @param ch      The character (CR and LF should not be passed in)
+ * @return The token if a prefix pattern (e.g. "+RECEIVE,%d,%d:") has just
+ *         been matched, otherwise MODEM_TOKEN_NONE.
+ */
+ModemToken ModemUrcMatcher_feed(ModemUrcMatcher *p_self, uint8_t ch);
+
+
+/** @brief Signal the end of the line.
+ *
+ * @return The token if the whole line matched a pattern, otherwise
+ *         MODEM_TOKEN_NONE. The matcher is reset ready for the next line.
+ */
+ModemToken ModemUrcMatcher_end_of_line(ModemUrcMatcher *p_self);
+
+
+/** @brief Get a value captured by a '%d' in the last matched pattern
+ *
+ * @param p_self  The matcher
+ * @param index   0 for the first '%d' (the channel number in most patterns)
+ */
+uint32_t ModemUrcMatcher_get_capture(ModemUrcMatcher const *p_self, uint32_t index);
+
+
+/** @brief Get the number of '%d' values captured by the last matched pattern
+ *
+ * @note This is 0 for the single connection forms of the URC's (e.g. "CLOSED"
+ *       rather than "5, CLOSED").
+ */
+uint32_t ModemUrcMatcher_get_num_captures(ModemUrcMatcher const *p_self);
+
+
+/** @brief Get the printable name of a token (for debug output) */
+char const* ModemUrcMatcher_token_name(ModemToken token);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+/*******************************************************************************
+*                               CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+#endif /* SOURCE_INC_MODEM_MODEM_URC_MATCHER_H_ */
@@ -15,6 +15,7 @@
 /*******************************************************************************
 *                               INCLUDE FILES
 *******************************************************************************/
+#include <stdbool.h>
 
 
 
@@ -70,6 +71,19 @@ extern "C" {
 void DataUploadClient_task(void const * argument);
 
 
+/** @brief Upload over UDP rather than TCP, from when the link is next opened.
+ *
+ * Each upload is sent as one datagram, that starts with the security string
+ * and a sequence number. The server acknowledges the datagram with
+ * "ack,<seq>", and it is sent again until it is (see upload_window.h). The
+ * sequence numbers start again when the gateway does -- the samples carry
+ * their own timestamps, for the server to drop any it already has.
+ *
+ * @note Only if DUC_ENABLE_UDP is set -- it is ignored otherwise.
+ */
+void DataUploadClient_set_udp(bool enable);
+
+
 #ifdef __cplusplus
 }
 #endif
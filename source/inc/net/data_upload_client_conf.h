@@ -45,18 +45,18 @@
 
 #define DUC_GATEWAY_MSG_INTERVAL_S      ( 10U * 60U )           /**< Every 10 minutes */
 #define DUC_NODE_LONG_MSG_INTERVAL_S    ( 10U * 60U )           /**< Every 10 minutes */
-#define DUC_RUN_CHECKS_INTERVAL_S       ( 30U )                 /**< Every 30 seconds */
 #define DUC_LOST_CONN_INTERVAL_S        ( 4U * 60U )            /**< Every 4 minutes */
 #define DUC_LOOSING_CONN_INTERVAL_S     ( 2U * 60U )            /**< Every 2 minutes */
+#define DUC_METRICS_MSG_INTERVAL_S      ( 60U )                 /**< Every minute */
 
 #else
 /* values used for production */
 
 #define DUC_GATEWAY_MSG_INTERVAL_S      ( 60U )                 /**< Every minute */
 #define DUC_NODE_LONG_MSG_INTERVAL_S    ( 10U * 60U )           /**< Every 10 minutes */
-#define DUC_RUN_CHECKS_INTERVAL_S       ( 60U * 60U )           /**< Hourly */
 #define DUC_LOST_CONN_INTERVAL_S        ( 20U * 60U * 60U )     /**< 20 hours */
 #define DUC_LOOSING_CONN_INTERVAL_S     ( 5U * 60U * 60U )      /**< 5 hours */
+#define DUC_METRICS_MSG_INTERVAL_S      ( 15U * 60U )           /**< Every 15 minutes */
 
 #endif
 
@@ -64,7 +64,20 @@
 
 
 #define DUC_RETRY_OPEN_PERIOD_MS        ( 30000U )              /**< Retry open TCP every 30 seconds */
-#define DUC_RETRY_OPEN_LIMIT            ( 20U )                 /**< Max attempts before reset modem */
+#define DUC_RETRY_OPEN_LIMIT            ( 20U )                 /**< Max attempts (modem not ready) before reset modem */
+#define DUC_RECOVER_OPEN_LIMIT          ( 3U )                  /**< Max failed opens (modem ready) before next tier of modem recovery */
+#define DUC_MAX_DATA_MSGS_PER_UPLOAD    ( 21U )                 /**< Max Data messages sent with a Node message */
+
+
+/** @def   DUC_ENABLE_UDP
+ *  @brief Build in the UDP transport (see DataUploadClient_set_udp()) -- it
+ *         is then used unless transparent mode is.
+ */
+#ifndef DUC_ENABLE_UDP
+#define DUC_ENABLE_UDP                  ( 0 )
+#endif
+
+#define DUC_UDP_HEADER_MAX_LEN          ( 64U )                 /**< Security string and sequence number at the start of each datagram */
 
 
 
@@ -17,6 +17,7 @@
 *******************************************************************************/
 #include "sensor_data.h"
 #include "sensor_node.h"
+#include "upload_metrics.h"
 
 
 
@@ -32,6 +33,9 @@
 *                               DEFINES
 *******************************************************************************/
 
+/** @brief Size of buffer that always holds a Data message (with terminator) */
+#define DATA_UPLOAD_MSG_DATA_MAX_LEN    128U
+
 
 
 
@@ -68,7 +72,16 @@ void prepare_security_string_msg(char *dest, uint32_t len);
 void prepare_gateway_msg(char *dest, uint32_t len);
 void prepare_node_long_msg(char *dest, uint32_t len, SensorNode const *p_sensor_node);
 void prepare_node_msg(char *dest, uint32_t len, SensorNode const *p_sensor_node);
-void prepare_data_msg(char *dest, uint32_t len, struct SensorData *p_sensor_data);
+
+/** @brief Format a Data message.
+ * @return The length of the message (not including the terminator).
+ */
+uint32_t prepare_data_msg(char *dest, uint32_t len, struct SensorData *p_sensor_data);
+
+/** @brief Format an Upload Metrics message from a copy taken by
+ *         UploadMetrics_get().
+ */
+void prepare_upload_metrics_msg(char *dest, uint32_t len, UploadMetrics const *p_metrics);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,140 @@
+/**
+ * @file  timer_wheel.h
+ * @brief A hashed timer wheel -- deadlines in seconds, fired only when due.
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Each entry is kept in the slot (deadline % TIMER_WHEEL_NUM_SLOTS), so
+ * advancing the wheel by one second only looks at the entries in one slot.
+ * An entry more than one turn of the wheel away stays in its slot until its
+ * deadline comes round.
+ *
+ * The entries are owned by the caller (they are not allocated), and the
+ * wheel is not thread safe -- it is meant to be used by one task.
+ */
+
+#ifndef SOURCE_INC_NET_TIMER_WHEEL_H_
+#define SOURCE_INC_NET_TIMER_WHEEL_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+
+/*******************************************************************************
+*                               DEFAULT CONFIGURATION
+*******************************************************************************/
+
+/** @def   TIMER_WHEEL_NUM_SLOTS
+ *  @brief The number of slots (one per second) in the wheel
+ */
+#ifndef TIMER_WHEEL_NUM_SLOTS
+#define TIMER_WHEEL_NUM_SLOTS           256U
+#endif
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+typedef struct TimerWheelEntry TimerWheelEntry;
+
+/** @brief Called when an entry's deadline is reached. The entry is disarmed
+ *         before the call, so it may be re-armed from here.
+ */
+typedef void (*TimerWheelFn)(TimerWheelEntry *p_entry);
+
+struct TimerWheelEntry {
+    TimerWheelEntry *p_prev;        /* The previous entry in the slot. */
+    TimerWheelEntry *p_next;        /* The next entry in the slot. */
+    uint32_t         deadline_s;    /* When to fire (seconds). */
+    uint32_t         slot;          /* The slot the entry is in. */
+    bool             is_armed;      /* The entry is in the wheel. */
+    TimerWheelFn     fn;            /* Called when the entry fires. */
+    void            *p_context;     /* For the owner of the entry. */
+};
+
+typedef struct {
+    TimerWheelEntry *p_slots[TIMER_WHEEL_NUM_SLOTS];
+    uint32_t         now_s;         /* The last second the wheel was advanced to. */
+    uint32_t         num_armed;     /* The number of entries in the wheel. */
+} TimerWheel;
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+void TimerWheel_init(TimerWheel *p_self, uint32_t now_s);
+
+void TimerWheelEntry_init(TimerWheelEntry *p_entry, TimerWheelFn fn, void *p_context);
+bool TimerWheelEntry_is_armed(TimerWheelEntry const *p_entry);
+
+/* Arms (or re-arms) the entry. A deadline that has already passed fires the
+ * next time the wheel is advanced to a later second.
+ */
+void TimerWheel_arm(TimerWheel *p_self, TimerWheelEntry *p_entry, uint32_t deadline_s);
+void TimerWheel_disarm(TimerWheel *p_self, TimerWheelEntry *p_entry);
+
+/* Fires every entry due by now_s. Returns the number fired. */
+uint32_t TimerWheel_advance(TimerWheel *p_self, uint32_t now_s);
+
+uint32_t TimerWheel_get_num_armed(TimerWheel const *p_self);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+/*******************************************************************************
+*                               CONFIGURATION ERRORS
+*******************************************************************************/
+
+#if ( TIMER_WHEEL_NUM_SLOTS < 1U )
+#error "TIMER_WHEEL_NUM_SLOTS must be at least 1"
+#endif
+
+
+
+
+#endif /* SOURCE_INC_NET_TIMER_WHEEL_H_ */
@@ -0,0 +1,167 @@
+/**
+ * @file  upload_backlog.h
+ * @brief The uploads sent to the cloud over TCP that the server has not
+ *        acknowledged yet
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Used by the data upload client when the modem is in quick send mode. Then a
+ * successful write only means the modem has the data -- it may take up to its
+ * send window ahead of the server's acks, over several uploads. A copy of each
+ * upload of node data is kept here, with where it ends in the channel's byte
+ * count, until the server's acks (AT+CIPACK) cover it. When the link is lost,
+ * every upload left is sent again on the next link.
+ *
+ * The uploads are kept oldest first, packed into one buffer. When there is no
+ * room the caller leaves its data where it is until the acks free some.
+ *
+ * The backlog is owned by the caller (it is not allocated), and is not thread
+ * safe -- it is meant to be used by one task.
+ */
+
+#ifndef SOURCE_INC_NET_UPLOAD_BACKLOG_H_
+#define SOURCE_INC_NET_UPLOAD_BACKLOG_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+
+/*******************************************************************************
+*                               DEFAULT CONFIGURATION
+*******************************************************************************/
+
+/** @def   UPLOAD_BACKLOG_LEN
+ *  @brief Bytes kept -- at least the modem's send window (MODEM_TCP_SEND_WINDOW)
+ *         and one upload, so the window is not held back by the backlog.
+ */
+#ifndef UPLOAD_BACKLOG_LEN
+#define UPLOAD_BACKLOG_LEN              8192U
+#endif
+
+
+/** @def   UPLOAD_BACKLOG_MAX_UPLOADS
+ *  @brief The most uploads kept
+ */
+#ifndef UPLOAD_BACKLOG_MAX_UPLOADS
+#define UPLOAD_BACKLOG_MAX_UPLOADS      16U
+#endif
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+typedef struct {
+    uint32_t    len;            /* Bytes in the upload. */
+    uint32_t    end;            /* The channel's byte count after it was sent. */
+    bool        is_sent;        /* Sent on the current link (so end is valid). */
+} UploadBacklogEntry;
+
+
+typedef struct {
+    char        buff[UPLOAD_BACKLOG_LEN];
+    UploadBacklogEntry entries[UPLOAD_BACKLOG_MAX_UPLOADS];
+    uint32_t    num_entries;    /* Uploads kept, oldest first. */
+    uint32_t    used;           /* Bytes in buff used by the uploads kept. */
+    uint32_t    num_open;       /* Bytes appended after them, not pushed yet. */
+} UploadBacklog;
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+void UploadBacklog_init(UploadBacklog *p_self);
+
+/* The most a new upload can hold -- 0 if no more uploads can be kept. */
+uint32_t UploadBacklog_room(UploadBacklog const *p_self);
+
+/* Appends to the new upload. False (and nothing is appended) if there isn't
+ * room for all of it.
+ */
+bool UploadBacklog_append(UploadBacklog *p_self, char const *p_buff, uint32_t len);
+
+/* Keeps the new upload -- it has been sent, and ends at 'end' in the channel's
+ * byte count.
+ */
+void UploadBacklog_push(UploadBacklog *p_self, uint32_t end);
+
+/* Drops the new upload without keeping it. */
+void UploadBacklog_cancel(UploadBacklog *p_self);
+
+/* The server has acknowledged the channel's bytes up to 'acked' -- frees the
+ * uploads sent on this link that end at or before it. Returns the number
+ * freed.
+ */
+uint32_t UploadBacklog_ack(UploadBacklog *p_self, uint32_t acked);
+
+/* The link has been lost -- every upload kept has to be sent again. */
+void UploadBacklog_link_lost(UploadBacklog *p_self);
+
+/* An upload kept, oldest first. NULL if index is out of range. */
+char const* UploadBacklog_get(UploadBacklog const *p_self, uint32_t index, uint32_t *p_len);
+
+/* Records a send of an upload kept, on the current link. */
+void UploadBacklog_sent(UploadBacklog *p_self, uint32_t index, uint32_t end);
+
+uint32_t UploadBacklog_get_num_uploads(UploadBacklog const *p_self);
+bool UploadBacklog_is_empty(UploadBacklog const *p_self);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+/*******************************************************************************
+*                               CONFIGURATION ERRORS
+*******************************************************************************/
+
+#if ( UPLOAD_BACKLOG_MAX_UPLOADS < 1U )
+#error "UPLOAD_BACKLOG_MAX_UPLOADS must be at least 1"
+#endif
+
+
+
+
+#endif /* SOURCE_INC_NET_UPLOAD_BACKLOG_H_ */
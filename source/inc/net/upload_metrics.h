@@ -0,0 +1,172 @@
+/**
+ * @file  upload_metrics.h
+ * @brief Counters, rates and upload-lag histograms for the data upload client
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * The data upload client reports each write to the modem, each
+ * retransmission and each sample it uploads. The rates are kept over the
+ * last UPLOAD_METRICS_RATE_WINDOW_S seconds, and the lag (upload time less
+ * the sample's timestamp) is kept as a log2 histogram -- gateway-wide and for
+ * each place in the node list.
+ *
+ * Only the data upload client task updates the metrics. Other tasks (the
+ * shell) may read them without a lock -- a copy may be one update behind.
+ */
+
+#ifndef SOURCE_INC_NET_UPLOAD_METRICS_H_
+#define SOURCE_INC_NET_UPLOAD_METRICS_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sensor_node_list.h"
+
+
+
+
+/*******************************************************************************
+*                               DEFAULT CONFIGURATION
+*******************************************************************************/
+
+/** @def   UPLOAD_METRICS_RATE_WINDOW_S
+ *  @brief The number of seconds the rates are taken over
+ */
+#ifndef UPLOAD_METRICS_RATE_WINDOW_S
+#define UPLOAD_METRICS_RATE_WINDOW_S    60U
+#endif
+
+
+/** @def   UPLOAD_METRICS_NUM_LAG_BUCKETS
+ *  @brief The number of buckets in a lag histogram. Bucket 0 holds a lag of
+ *         0 s, bucket k holds [2^(k-1), 2^k) s, and the last bucket holds
+ *         everything longer.
+ */
+#ifndef UPLOAD_METRICS_NUM_LAG_BUCKETS
+#define UPLOAD_METRICS_NUM_LAG_BUCKETS  16U
+#endif
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+typedef struct {
+    uint32_t num_samples;       /**< @brief Samples uploaded with a valid lag */
+    uint32_t lag_max_s;         /**< @brief The longest lag seen */
+    uint64_t lag_total_s;       /**< @brief For the mean lag */
+    uint32_t lag_hist[UPLOAD_METRICS_NUM_LAG_BUCKETS];
+} UploadLagStats;
+
+
+typedef struct {
+    uint64_t       bytes_sent;          /**< @brief Bytes accepted by the modem */
+    uint32_t       num_uploads;         /**< @brief Writes to the modem */
+    uint32_t       num_upload_failures; /**< @brief Writes to the modem that failed */
+    uint32_t       num_retransmissions; /**< @brief Uploads sent again after a lost link */
+    uint32_t       num_samples;         /**< @brief Samples uploaded */
+    uint32_t       num_samples_no_time; /**< @brief Samples uploaded before the gateway had the time */
+    uint32_t       write_ms_max;        /**< @brief The longest write to the modem */
+    uint64_t       write_ms_total;      /**< @brief For the mean write time */
+    uint32_t       unacked_bytes;       /**< @brief Sent but not acknowledged by the server, when the link was last checked */
+    uint32_t       window_s;            /**< @brief The seconds the window values cover */
+    uint32_t       window_bytes;        /**< @brief Bytes sent in the window */
+    uint32_t       window_samples;      /**< @brief Samples uploaded in the window */
+    UploadLagStats lag;                 /**< @brief Gateway-wide */
+} UploadMetrics;
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+void UploadMetrics_init(uint32_t now_s);
+
+/** @brief Clear the lag kept for a place in the node list -- when a new node
+ *         takes it.
+ */
+void UploadMetrics_reset_node(uint32_t index);
+
+
+/** @brief Report a write of num_bytes to the modem that took write_ms */
+void UploadMetrics_upload_done(uint32_t now_s, uint32_t num_bytes, uint32_t write_ms, bool success);
+void UploadMetrics_retransmission(void);
+void UploadMetrics_set_unacked(uint32_t num_bytes);
+
+/** @brief Report a sample uploaded for the node at index in the node list.
+ *         now_utc_s is 0 if the gateway does not have the time -- the sample
+ *         is counted, but its lag is not.
+ */
+void UploadMetrics_sample_uploaded(uint32_t now_s, uint32_t index, uint32_t ts_seconds, uint32_t now_utc_s);
+
+
+/** @brief Copy the gateway-wide metrics, with the window values as of now_s */
+void UploadMetrics_get(uint32_t now_s, UploadMetrics *p_metrics);
+bool UploadMetrics_get_node_lag(uint32_t index, UploadLagStats *p_lag);
+
+/** @brief The lag that percent of the samples were uploaded within -- the
+ *         top of the histogram bucket it falls in, capped at the longest lag.
+ */
+uint32_t UploadMetrics_lag_percentile_s(UploadLagStats const *p_lag, uint32_t percent);
+uint32_t UploadMetrics_lag_mean_s(UploadLagStats const *p_lag);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+/*******************************************************************************
+*                               CONFIGURATION ERRORS
+*******************************************************************************/
+
+#if ( UPLOAD_METRICS_RATE_WINDOW_S < 1U )
+#error "UPLOAD_METRICS_RATE_WINDOW_S must be at least 1"
+#endif
+
+#if ( UPLOAD_METRICS_NUM_LAG_BUCKETS < 2U ) || ( UPLOAD_METRICS_NUM_LAG_BUCKETS > 32U )
+#error "UPLOAD_METRICS_NUM_LAG_BUCKETS must be 2 to 32"
+#endif
+
+
+
+
+#endif /* SOURCE_INC_NET_UPLOAD_METRICS_H_ */
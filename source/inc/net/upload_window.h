@@ -0,0 +1,210 @@
+/**
+ * @file  upload_window.h
+ * @brief The datagrams sent to the cloud that are waiting to be acknowledged
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * Used by the data upload client when it uploads over UDP. Each datagram is
+ * formatted into a slot of the window, with the next sequence number, and
+ * stays there until the server acknowledges that sequence number. A datagram
+ * that is not acknowledged in time is sent again, with the timeout doubled
+ * each time, and is given up after UPLOAD_WINDOW_MAX_SENDS sends.
+ *
+ * The retransmission timeout follows the round trip of the datagrams that
+ * were acknowledged after being sent once (a retransmitted datagram's round
+ * trip can't be measured -- the ack may be for either send).
+ *
+ * When every slot is waiting for an ack the window is full, and the caller
+ * leaves its data where it is until a slot is free.
+ *
+ * The window is owned by the caller (it is not allocated), and is not thread
+ * safe -- it is meant to be used by one task.
+ */
+
+#ifndef SOURCE_INC_NET_UPLOAD_WINDOW_H_
+#define SOURCE_INC_NET_UPLOAD_WINDOW_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+
+/*******************************************************************************
+*                               DEFAULT CONFIGURATION
+*******************************************************************************/
+
+/** @def   UPLOAD_WINDOW_NUM_SLOTS
+ *  @brief The most datagrams that can wait for an ack
+ */
+#ifndef UPLOAD_WINDOW_NUM_SLOTS
+#define UPLOAD_WINDOW_NUM_SLOTS         8U
+#endif
+
+
+/** @def   UPLOAD_WINDOW_SLOT_LEN
+ *  @brief The longest datagram -- less than the modules' 1460 byte limit
+ */
+#ifndef UPLOAD_WINDOW_SLOT_LEN
+#define UPLOAD_WINDOW_SLOT_LEN          1400U
+#endif
+
+
+/** @def   UPLOAD_WINDOW_INITIAL_RTO_MS
+ *  @brief The retransmission timeout before any round trip has been measured
+ */
+#ifndef UPLOAD_WINDOW_INITIAL_RTO_MS
+#define UPLOAD_WINDOW_INITIAL_RTO_MS    3000U
+#endif
+
+
+/** @def   UPLOAD_WINDOW_MIN_RTO_MS
+ *  @brief The shortest retransmission timeout
+ */
+#ifndef UPLOAD_WINDOW_MIN_RTO_MS
+#define UPLOAD_WINDOW_MIN_RTO_MS        500U
+#endif
+
+
+/** @def   UPLOAD_WINDOW_MAX_RTO_MS
+ *  @brief The longest retransmission timeout (after backing off)
+ */
+#ifndef UPLOAD_WINDOW_MAX_RTO_MS
+#define UPLOAD_WINDOW_MAX_RTO_MS        30000U
+#endif
+
+
+/** @def   UPLOAD_WINDOW_MAX_SENDS
+ *  @brief Sends of a datagram before it is given up
+ */
+#ifndef UPLOAD_WINDOW_MAX_SENDS
+#define UPLOAD_WINDOW_MAX_SENDS         8U
+#endif
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+typedef struct {
+    char        buff[UPLOAD_WINDOW_SLOT_LEN];
+    uint32_t    len;            /* Bytes used in buff. */
+    uint32_t    seq;            /* The datagram's sequence number. */
+    uint32_t    sent_ms;        /* When it was last sent. */
+    uint32_t    num_sends;      /* Times it has been sent (0 = not yet). */
+    bool        is_used;        /* Holds a datagram. */
+} UploadWindowSlot;
+
+typedef struct {
+    UploadWindowSlot slots[UPLOAD_WINDOW_NUM_SLOTS];
+    uint32_t    next_seq;       /* Given to the next slot taken. */
+    uint32_t    num_used;       /* Slots holding a datagram. */
+    uint32_t    srtt_ms;        /* Smoothed round trip (0 = not measured yet). */
+    uint32_t    rto_ms;         /* Retransmission timeout for a first resend. */
+    uint32_t    num_acked;      /* Datagrams acknowledged. */
+    uint32_t    num_resent;     /* Datagrams sent again. */
+    uint32_t    num_expired;    /* Datagrams given up. */
+} UploadWindow;
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+void UploadWindow_init(UploadWindow *p_self, uint32_t first_seq);
+
+/* Takes a free slot, with the next sequence number. NULL if the window is
+ * full. The slot is empty (len is 0) -- fill it with UploadWindow_append().
+ */
+UploadWindowSlot* UploadWindow_take(UploadWindow *p_self);
+
+/* Appends to the datagram. False (and nothing is appended) if there isn't
+ * room for all of it.
+ */
+bool UploadWindow_append(UploadWindowSlot *p_slot, char const *p_buff, uint32_t len);
+uint32_t UploadWindow_room(UploadWindowSlot const *p_slot);
+
+/* Gives the slot back without sending it (the sequence number is not used). */
+void UploadWindow_cancel(UploadWindow *p_self, UploadWindowSlot *p_slot);
+
+/* Records a send of the datagram (the first, or a retransmission). */
+void UploadWindow_sent(UploadWindow *p_self, UploadWindowSlot *p_slot, uint32_t now_ms);
+
+/* The server has the datagram -- frees its slot. False if no slot holds the
+ * sequence number (a duplicate ack, or one for a datagram given up).
+ */
+bool UploadWindow_ack(UploadWindow *p_self, uint32_t seq, uint32_t now_ms);
+
+/* The oldest datagram due to be sent again, NULL if none is. Datagrams sent
+ * UPLOAD_WINDOW_MAX_SENDS times are given up (and freed) instead.
+ */
+UploadWindowSlot* UploadWindow_next_due(UploadWindow *p_self, uint32_t now_ms);
+
+/* Marks every datagram sent to be sent again straight away (e.g. when the
+ * link has been re-opened), without counting it as a send.
+ */
+void UploadWindow_resend_all(UploadWindow *p_self, uint32_t now_ms);
+
+uint32_t UploadWindow_get_num_used(UploadWindow const *p_self);
+bool UploadWindow_is_full(UploadWindow const *p_self);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+/*******************************************************************************
+*                               CONFIGURATION ERRORS
+*******************************************************************************/
+
+#if ( UPLOAD_WINDOW_NUM_SLOTS < 1U )
+#error "UPLOAD_WINDOW_NUM_SLOTS must be at least 1"
+#endif
+
+#if ( UPLOAD_WINDOW_MIN_RTO_MS > UPLOAD_WINDOW_MAX_RTO_MS )
+#error "UPLOAD_WINDOW_MIN_RTO_MS is more than UPLOAD_WINDOW_MAX_RTO_MS"
+#endif
+
+
+
+
+#endif /* SOURCE_INC_NET_UPLOAD_WINDOW_H_ */
@@ -4,6 +4,17 @@
  *
  * @note
  * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * The settings are kept in RAM -- reading one doesn't touch the EEPROM. A
+ * write changes the setting in RAM straight away (and tells the modem
+ * control if it is part of the modem's configuration), and it is written to
+ * the EEPROM by the next Store_write_back().
+ *
+ * To change several settings together, write them between Store_begin() and
+ * Store_commit(): they are changed together by the commit, with one
+ * notification (so the modem is restarted once), and written to the EEPROM
+ * together. Reads see the staged changes straight away; the rest of the
+ * firmware (e.g. the modem control) sees them at the commit.
  */
 
 #ifndef SOURCE_INC_STORAGE_NV_SETTINGS_H_
@@ -25,6 +36,15 @@
 *                               DEFAULT CONFIGURATION
 *******************************************************************************/
 
+/** @def   STORE_TRANSACTION_IDLE_MS
+ *  @brief A transaction nothing has been written to for this long is committed
+ *         by Store_commit_if_idle() -- the Bluetooth settings are written one
+ *         at a time, with nothing to say the last has been written.
+ */
+#ifndef STORE_TRANSACTION_IDLE_MS
+#define STORE_TRANSACTION_IDLE_MS           2000U
+#endif
+
 
 
 
@@ -32,6 +52,9 @@
 *                               DEFINES
 *******************************************************************************/
 
+/* The longest modem APN, username and password (not counting the length) */
+#define STORE_MODEM_STRING_MAXLEN           31U
+
 
 
 
@@ -64,6 +87,23 @@ extern "C" {
 #endif
 
 
+/* Reads the settings from the EEPROM (done on the first access otherwise). */
+void Store_init(void);
+
+/* Writes from here on are staged, to be made by Store_commit(). If a
+ * transaction is already open, they are added to it.
+ */
+void Store_begin(void);
+bool Store_commit(void);
+bool Store_commit_if_idle(uint32_t idle_ms);
+void Store_abort(void);
+
+/* Writes the changed settings to the EEPROM, from the calling task. False if
+ * any failed (they are tried again next time).
+ */
+bool Store_write_back(void);
+bool Store_has_unwritten_changes(void);
+
 bool Store_read_cloud_ipv4(uint8_t *p_buff4);
 bool Store_write_cloud_ipv4(uint8_t const *p_buff4);
 
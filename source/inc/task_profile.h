@@ -0,0 +1,202 @@
+/**
+ * @file  task_profile.h
+ * @brief Run-time profile of the RTOS tasks and the Contiki processes
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * The tasks are sampled with uxTaskGetSystemState() -- the CPU share of a task
+ * is the growth of its run-time counter between two samples, over the growth
+ * of the total. This needs configUSE_TRACE_FACILITY, and for the CPU share,
+ * configGENERATE_RUN_TIME_STATS with a run-time counter. The cycle counter
+ * here can be used for that, in FreeRTOSConfig.h:
+ *
+ *     #define configGENERATE_RUN_TIME_STATS               1
+ *     #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    TaskProfile_start_counter()
+ *     #define portGET_RUN_TIME_COUNTER_VALUE()            TaskProfile_get_counter()
+ *
+ * The counters are 32 bits, so the time between two samples must be less than
+ * a wrap of the counter (about 19 s of cycles at 216 MHz).
+ *
+ * The Contiki processes all run in one task, so while they are being profiled
+ * each process's thread is wrapped (see TaskProfile_hook_processes()) to count
+ * its events and the cycles spent handling them. The threads are put back
+ * afterwards, so profiling costs nothing when it is not running.
+ */
+
+#ifndef SOURCE_INC_TASK_PROFILE_H_
+#define SOURCE_INC_TASK_PROFILE_H_
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "contiki.h"
+
+
+
+
+/*******************************************************************************
+*                               DEFAULT CONFIGURATION
+*******************************************************************************/
+
+/** @def   TASK_PROFILE_MAX_TASKS
+ *  @brief The most RTOS tasks that can be sampled
+ */
+#ifndef TASK_PROFILE_MAX_TASKS
+#define TASK_PROFILE_MAX_TASKS          16U
+#endif
+
+
+/** @def   TASK_PROFILE_MAX_PROCESSES
+ *  @brief The most Contiki processes that can be profiled
+ */
+#ifndef TASK_PROFILE_MAX_PROCESSES
+#define TASK_PROFILE_MAX_PROCESSES      32U
+#endif
+
+
+
+
+/*******************************************************************************
+*                               DEFINES
+*******************************************************************************/
+
+/** @brief Longest task name kept, including the terminator */
+#define TASK_PROFILE_NAME_LEN           16U
+
+
+
+
+/*******************************************************************************
+*                               DATA TYPES
+*******************************************************************************/
+
+/** @brief One RTOS task in a sample */
+typedef struct {
+    char     name[TASK_PROFILE_NAME_LEN];
+    uint32_t number;                /**< Task number -- unique to the task */
+    uint32_t priority;
+    uint32_t run_time;              /**< Run-time counter (0 without run-time stats) */
+    uint32_t stack_free_bytes;      /**< Least stack left since the task started */
+} TaskProfileTask;
+
+
+/** @brief The RTOS tasks at one time */
+typedef struct {
+    TaskProfileTask tasks[TASK_PROFILE_MAX_TASKS];
+    uint32_t        num_tasks;
+    uint32_t        total_run_time;
+    uint32_t        counter;        /**< TaskProfile_get_counter() when sampled */
+} TaskProfileSample;
+
+
+/** @brief The counts for one Contiki process */
+typedef struct {
+    struct process *p_process;
+    uint32_t        num_events;
+    uint32_t        cycles;         /**< Cycles spent handling the events (wraps) */
+    uint32_t        max_cycles;     /**< Longest time handling one event */
+} TaskProfileProcess;
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               MACRO's
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               FUNCTION PROTOTYPES
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief Start the cycle counter (DWT), if it is not running already */
+void TaskProfile_start_counter(void);
+
+/** @brief The cycle counter */
+uint32_t TaskProfile_get_counter(void);
+
+/** @brief Convert a number of cycles to micro-seconds */
+uint32_t TaskProfile_cycles_to_us(uint32_t cycles);
+
+
+/** @brief Sample the RTOS tasks.
+ *
+ * @return false if the tasks can not be sampled (no trace facility, or more
+ *         than TASK_PROFILE_MAX_TASKS tasks)
+ */
+bool TaskProfile_sample(TaskProfileSample *p_sample);
+
+/** @brief The CPU share, in 1/1000ths, of a task between two samples.
+ *
+ * A task missing from the first sample is taken from when it started.
+ */
+uint32_t TaskProfile_cpu_permille(TaskProfileSample const *p_first,
+                                  TaskProfileSample const *p_second,
+                                  uint32_t index);
+
+
+/** @brief Start profiling the Contiki processes -- wrap the thread of each
+ *         process that is running, and count its events from zero.
+ *
+ * Must be called from the Contiki task, and followed by
+ * TaskProfile_unhook_processes(). Processes started in between are not
+ * profiled, nor are any beyond TASK_PROFILE_MAX_PROCESSES (see
+ * TaskProfile_get_num_unprofiled()). Does nothing if already profiling.
+ */
+void TaskProfile_hook_processes(void);
+
+/** @brief Stop profiling -- put back the threads of the processes wrapped.
+ *         Their counts are kept until the next TaskProfile_hook_processes().
+ */
+void TaskProfile_unhook_processes(void);
+
+/** @brief Number of Contiki processes wrapped */
+uint32_t TaskProfile_get_num_processes(void);
+
+/** @brief Number of Contiki processes running but not wrapped, because there
+ *         were more than TASK_PROFILE_MAX_PROCESSES
+ */
+uint32_t TaskProfile_get_num_unprofiled(void);
+
+/** @brief The counts for a Contiki process, in the order they were wrapped
+ *
+ * @return false if index is out of range
+ */
+bool TaskProfile_get_process(uint32_t index, TaskProfileProcess *p_process);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+
+/*******************************************************************************
+*                               CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+#endif /* SOURCE_INC_TASK_PROFILE_H_ */
@@ -10,6 +10,8 @@
 
 #include "16174prog03_shell_factory.h"
 #include "16174prog03_shell_nodes.h"
+#include "16174prog03_shell_tasks.h"
+#include "16174prog03_shell_upload.h"
 #include "alc_blink_app.h"
 #if ALC_USING_STM32_BLUENRG_BLE
 #include "alc_bluetooth_server.h"
@@ -23,6 +25,9 @@
 #include "alc_shell_rtimer.h"
 #include "alc_shell_status.h"
 #include "alc_shell_time.h"
+#include "deferred_log.h"
+#include "nv_settings.h"
+#include "resend_request.h"
 #include "serial-shell.h"
 #include "shell.h"
 
@@ -33,6 +38,9 @@ PROCESS_NAME(border_router_process);
 
 
 PROCESS(start_shell, "start shell");
+PROCESS(nv_settings_process, "nv settings");
+PROCESS(resend_request_process, "resend request");
+PROCESS(deferred_log_process, "deferred log");
 
 
 /******************************************************************************/
@@ -40,6 +48,7 @@ PROCESS(start_shell, "start shell");
  * List of processes that will be auto-started in the main() function.
  */
 AUTOSTART_PROCESSES(
+        &nv_settings_process,
         &alc_blink_app_process,
 #if ALC_USING_STM32_BLUENRG_BLE
         &alc_bluetooth_server_process,
@@ -47,6 +56,8 @@ AUTOSTART_PROCESSES(
         &alc_pole_cluster_ctrl_server_process,
         &alc_pole_data_link_root_process,
         &border_router_process,
+        &resend_request_process,
+        &deferred_log_process,
         &start_shell
 );
 /******************************************************************************/
@@ -68,8 +79,86 @@ PROCESS_THREAD(start_shell, ev, data)
     alc_shell_time_init();
     C16174prog03_shell_factory_init();
     C16174prog03_shell_nodes_init();
+    C16174prog03_shell_tasks_init();
+    C16174prog03_shell_upload_init();
     shell_reboot_init();
 
     PROCESS_END();
 }
 /******************************************************************************/
+/* This process reads the settings from EEPROM, then commits the transactions
+ * left open (by the Bluetooth interface), and writes the changes made to the
+ * settings back to EEPROM
+ */
+PROCESS_THREAD(nv_settings_process, ev, data)
+{
+    static struct etimer et;
+
+    PROCESS_BEGIN();
+
+    Store_init();
+
+    etimer_set(&et, CLOCK_SECOND);
+
+    while(1)
+    {
+        PROCESS_WAIT_EVENT_UNTIL( etimer_expired(&et) );
+        etimer_reset(&et);
+
+        Store_commit_if_idle(STORE_TRANSACTION_IDLE_MS);
+
+        if( Store_has_unwritten_changes() )
+        {
+            Store_write_back();
+        }
+    }
+
+    PROCESS_END();
+}
+/******************************************************************************/
+/* This process asks the nodes to resend the samples missing from their queues
+ */
+PROCESS_THREAD(resend_request_process, ev, data)
+{
+    static struct etimer et;
+
+    PROCESS_BEGIN();
+
+    ResendRequest_init();
+
+    etimer_set(&et, CLOCK_SECOND);
+
+    while(1)
+    {
+        PROCESS_WAIT_EVENT_UNTIL( etimer_expired(&et) );
+        etimer_reset(&et);
+
+        ResendRequest_poll(clock_time());
+    }
+
+    PROCESS_END();
+}
+/******************************************************************************/
+/* This process passes the deferred log messages on to the AlcLogger, so they
+ * are formatted here rather than in the tasks that log them
+ */
+PROCESS_THREAD(deferred_log_process, ev, data)
+{
+    static struct etimer et;
+
+    PROCESS_BEGIN();
+
+    /* (Not DeferredLog_init() -- the tasks may have logged already) */
+    etimer_set(&et, ( ( DEFERRED_LOG_FLUSH_PERIOD_MS * CLOCK_SECOND ) / 1000U ));
+
+    while(1)
+    {
+        PROCESS_WAIT_EVENT_UNTIL( etimer_expired(&et) );
+        etimer_reset(&et);
+
+        DeferredLog_flush(DEFERRED_LOG_RING_SIZE);
+    }
+
+    PROCESS_END();
+}
+/******************************************************************************/
@@ -218,9 +218,14 @@ void GetGatewayIP(uint8_t* GatewayIP)
     Store_read_cloud_ipv4(GatewayIP);
 }
 /******************************************************************************/
+/* The gateway settings are written one at a time -- they are staged in one
+ * transaction, committed when they stop coming (see nv_settings.h), so the
+ * modem is restarted once.
+ */
 // (4 bytes)
 void setGatewayIP(uint8_t const* GatewayIP)
 {
+    Store_begin();
     Store_write_cloud_ipv4(GatewayIP);
 }
 /******************************************************************************/
@@ -231,6 +236,7 @@ void GetGatewayPort(uint16_t* GateawayPort)
 /******************************************************************************/
 void setGatewayPort(uint16_t const* GateawayPort)
 {
+    Store_begin();
     Store_write_cloud_portnum(GateawayPort);
 }
 /******************************************************************************/
@@ -243,6 +249,7 @@ void GetGatewayAPN(uint8_t* GatewayAPN)
 // (20 bytes  1st is length)
 void setGatewayAPN(uint8_t const* GatewayAPN)
 {
+    Store_begin();
     Store_write_modem_apn(GatewayAPN);
 }
 /******************************************************************************/
@@ -255,6 +262,7 @@ void GetGatewayUsername(uint8_t* GatewayUsername)
 // (20 bytes  1st is length)
 void setGatewayUsername(uint8_t const* GatewayUsername)
 {
+    Store_begin();
     Store_write_modem_username(GatewayUsername);
 }
 /******************************************************************************/
@@ -267,6 +275,7 @@ void GetGatewayPassword(uint8_t* GatewayPassword)
 // (20 bytes  1st is length)
 void setGatewayPassword(uint8_t const* GatewayPassword)
 {
+    Store_begin();
     Store_write_modem_password(GatewayPassword);
 }
 /******************************************************************************/
@@ -0,0 +1,259 @@
+/**
+ * @file  resend_request.c
+ * @brief Requests to the nodes to resend the samples missing from their queues
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <string.h>
+
+#include "resend_request.h"
+
+#include "sensor_node_list.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+/** @brief The run being requested from the node in the same place in the
+ *         node list.
+ */
+typedef struct {
+    uip_ipaddr_t      ipaddr;       /**< @brief The node the run is missing from */
+    bool              is_pending;   /**< @brief A run is missing */
+    bool              is_given_up;  /**< @brief Requested RESEND_REQUEST_MAX_TX_COUNT times */
+    uint32_t          first_seq32;
+    uint32_t          count;
+    uint32_t          tx_count;     /**< @brief Times the run has been requested */
+    clock_time_t      due_at;       /**< @brief When to request it (again) */
+} ResendState;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+static ResendState         s_state[SENSOR_NODE_LIST_SIZE];
+static ResendRequestSendFn s_send_fn=NULL;
+static ResendRequestStats  s_stats;
+
+/** @brief The time of the poll in progress -- SNL_for_each_node() has no
+ *         context for the callback.
+ */
+static clock_time_t s_now;
+static clock_time_t s_next_send_at;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static bool poll_node__(uint32_t index, SensorNode *p_sensor_node);
+static void send__(ResendState *p_state, SensorNode const *p_sensor_node);
+static bool is_due__(clock_time_t due_at, clock_time_t now);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+void ResendRequest_init(void)
+{
+    memset(s_state, 0, sizeof(s_state));
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    s_now          = 0U;
+    s_next_send_at = 0U;
+}
+/******************************************************************************/
+void ResendRequest_set_send_fn(ResendRequestSendFn fn)
+{
+    s_send_fn = fn;
+}
+/******************************************************************************/
+void ResendRequest_poll(clock_time_t now)
+{
+    s_now = now;
+
+    SNL_for_each_node(&poll_node__);
+}
+/******************************************************************************/
+void ResendRequest_get_stats(ResendRequestStats *p_stats)
+{
+    if(p_stats)
+    {
+        *p_stats = s_stats;
+    }
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static bool poll_node__(uint32_t index, SensorNode *p_sensor_node)
+{
+    ResendState *p_state = &s_state[index];
+    uint32_t     first_seq32;
+    uint32_t     count;
+
+    if( !uip_ipaddr_cmp(&p_state->ipaddr, &p_sensor_node->ipaddr) )
+    {
+        /* A new node in this place in the list */
+        memset(p_state, 0, sizeof(ResendState));
+        uip_ipaddr_copy(&p_state->ipaddr, &p_sensor_node->ipaddr);
+    }
+
+    if( !SensorNode_get_first_missing(p_sensor_node, &first_seq32, &count) )
+    {
+        if( p_state->is_pending )
+        {
+            s_stats.num_resolved++;
+            p_state->is_pending = false;
+        }
+    }
+    else
+    {
+        if( count > RESEND_REQUEST_MAX_COUNT )
+        {
+            count = RESEND_REQUEST_MAX_COUNT;
+        }
+
+        if(
+                ( !p_state->is_pending ) ||
+                ( ( first_seq32 - p_state->first_seq32 ) >= p_state->count )
+        )
+        {
+            /* A new run -- give a late sample the chance to fill it first */
+            if( p_state->is_pending )
+            {
+                s_stats.num_resolved++;
+            }
+
+            p_state->is_pending  = true;
+            p_state->is_given_up = false;
+            p_state->first_seq32 = first_seq32;
+            p_state->count       = count;
+            p_state->tx_count    = 0U;
+            p_state->due_at      = s_now + RESEND_REQUEST_1ST_DELAY;
+        }
+        else if( is_due__(p_state->due_at, s_now) )
+        {
+            /* The same run -- a request already made may have filled the
+             * front of it.
+             */
+            p_state->first_seq32 = first_seq32;
+            p_state->count       = count;
+
+            if( p_state->tx_count < RESEND_REQUEST_MAX_TX_COUNT )
+            {
+                send__(p_state, p_sensor_node);
+            }
+            else
+            {
+                if( !p_state->is_given_up )
+                {
+                    s_stats.num_given_up++;
+                    p_state->is_given_up = true;
+                }
+
+                /* Until it reaches the front of the queue the run is only
+                 * behind data still being uploaded.
+                 */
+                if( SensorNode_skip_missing(p_sensor_node, first_seq32, count) )
+                {
+                    s_stats.num_skipped++;
+                    p_state->is_pending = false;
+                }
+            }
+        }
+        else
+        {
+            /* Requested, and waiting for the node */
+        }
+    }
+
+    return true;
+}
+/******************************************************************************/
+static void send__(ResendState *p_state, SensorNode const *p_sensor_node)
+{
+    if( s_send_fn == NULL )
+    {
+        /* Nothing to send it -- not counted as a try, so the run is kept
+         * until there is.
+         */
+        s_stats.num_unsent++;
+    }
+    else if( !is_due__(s_next_send_at, s_now) )
+    {
+        s_stats.num_rate_limited++;
+    }
+    else if( s_send_fn(&p_sensor_node->ipaddr, p_sensor_node->id16, p_state->first_seq32, p_state->count) )
+    {
+        s_stats.num_sent++;
+        p_state->tx_count++;
+        p_state->due_at = s_now + RESEND_REQUEST_REPEAT_DELAY;
+        s_next_send_at  = s_now + RESEND_REQUEST_MIN_INTERVAL;
+    }
+    else
+    {
+        /* Tried again on the next poll */
+    }
+}
+/******************************************************************************/
+/* Allows for clock_time() wrapping */
+static bool is_due__(clock_time_t due_at, clock_time_t now)
+{
+    return ( (int32_t) ( due_at - now ) <= 0 );
+}
+/******************************************************************************/
@@ -60,6 +60,9 @@
 *                               LOCAL FUNCTION PROTOTYPES
 *******************************************************************************/
 
+static struct SensorData* find_from_back__(SensorDataList const *p_self, struct SensorData const *p_data);
+static void link_before__(SensorDataList *p_self, struct SensorData *p_next, struct SensorData *p_data);
+
 
 
 
@@ -323,6 +326,62 @@ bool SensorDataList_insert(SensorDataList *p_self, struct SensorData *p_data)
     return inserted;
 }
 /******************************************************************************/
+/* The batch is walked once, and the place in the list only moves forwards
+ * while the batch is ascending -- so a sorted batch is merged in O(n + m),
+ * and one that follows on from the list in O(m).
+ */
+uint32_t SensorDataList_merge(SensorDataList *p_self, SensorDataList *p_batch)
+{
+    uint32_t num_inserted=0U;
+
+    if( (p_self) && (p_batch) )
+    {
+        SensorDataList     duplicates;
+        struct SensorData *p_cursor=NULL;       /* The first in the list not less than the last one merged */
+        struct SensorData *p_last_merged=NULL;
+
+        SensorDataList_init(&duplicates);
+
+        while( !SensorDataList_is_empty(p_batch) )
+        {
+            struct SensorData *p_data = SensorDataList_pop_front(p_batch);
+
+            if(
+                    ( p_last_merged == NULL ) ||
+                    ( !is_greater__(p_data, p_last_merged) )
+            )
+            {
+                /* The first one, or the batch went backwards */
+                p_cursor = find_from_back__(p_self, p_data);
+            }
+            else
+            {
+                while( ( p_cursor ) && ( is_greater__(p_data, p_cursor) ) )
+                {
+                    p_cursor = p_cursor->p_next;
+                }
+            }
+
+            if( ( p_cursor ) && ( is_equal__(p_cursor, p_data) ) )
+            {
+                SensorDataList_push_back(&duplicates, p_data);
+            }
+            else
+            {
+                link_before__(p_self, p_cursor, p_data);
+
+                p_last_merged = p_data;
+                num_inserted++;
+            }
+        }
+
+        /* Give the duplicates back to the caller */
+        *p_batch = duplicates;
+    }
+
+    return num_inserted;
+}
+/******************************************************************************/
 void SensorDataList_push_back(SensorDataList *p_self, struct SensorData *p_data)
 {
     if( (p_self) && (p_data) )
@@ -438,5 +497,45 @@ void SensorDataList_check_links(SensorDataList const *p_self)
 *                               LOCAL FUNCTIONS
 *******************************************************************************/
 
+/******************************************************************************/
+/* The first object that isn't less than p_data (NULL if there's none) */
+static struct SensorData* find_from_back__(SensorDataList const *p_self, struct SensorData const *p_data)
+{
+    struct SensorData *p_found=NULL;
+
+    for(struct SensorData *iter = p_self->p_last;
+        ( iter != NULL ) && ( !is_greater__(p_data, iter) );
+        iter = iter->p_prev)
+    {
+        p_found = iter;
+    }
+
+    return p_found;
+}
+/******************************************************************************/
+/* Link p_data in before p_next, or at the end if p_next is NULL */
+static void link_before__(SensorDataList *p_self, struct SensorData *p_next, struct SensorData *p_data)
+{
+    if( p_next == NULL )
+    {
+        SensorDataList_push_back(p_self, p_data);
+    }
+    else
+    {
+        p_data->p_next = p_next;
+        p_data->p_prev = p_next->p_prev;
 
+        if( p_next->p_prev )
+        {
+            p_next->p_prev->p_next = p_data;
+        }
+        else
+        {
+            p_self->p_first = p_data;
+        }
 
+        p_next->p_prev = p_data;
+        p_self->size++;
+    }
+}
+/******************************************************************************/
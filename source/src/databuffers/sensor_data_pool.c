@@ -22,6 +22,7 @@
 #include "alc_assert.h"
 #include "alc_logger.h"
 #include "cmsis_os.h"
+#include "deferred_log.h"
 
 
 
@@ -186,7 +187,7 @@ struct SensorData* SensorDataPool_get(void)
             if( s_pointers.size == 0U )
             {
                 /* pool is now empty */
-                AlcLogger_log_warning("SensorDataPool is empty.");
+                DEFERRED_LOG(ALC_LOGGER_WARNING, LOG_ID_POOL_EMPTY);
             }
         }
 
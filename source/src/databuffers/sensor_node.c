@@ -12,6 +12,8 @@
 /*******************************************************************************
 *                               INCLUDE FILES
 *******************************************************************************/
+#include <string.h>
+
 #include "sensor_node.h"
 
 #include "alc_assert.h"
@@ -54,10 +56,26 @@
 *                               LOCAL GLOBAL VARIABLES
 *******************************************************************************/
 
-/* This module uses this mutex to control access to the objects from multiple
- * threads.
+/* The nodes share out these mutexes, so that different nodes can be used from
+ * different threads at the same time. Created by SensorNode_init_locks(),
+ * before any node is initialised.
+ */
+static osMutexId s_locks[SENSOR_NODE_NUM_LOCKS];
+
+/* Updated atomically -- the thread that counts it doesn't have the lock */
+static uint32_t s_num_lock_timeouts;
+
+
+/* The nodes with work for the uploader, oldest first. Only changed with
+ * s_ready_lock taken, and never while a node's lock is held.
  */
-extern osMutexId g_sensor_node_mutexHandle;
+static struct {
+    SensorNode *p_first;
+    SensorNode *p_last;
+    uint32_t    size;
+} s_ready;
+
+static osMutexId s_ready_lock;
 
 
 
@@ -66,7 +84,16 @@ extern osMutexId g_sensor_node_mutexHandle;
 *                               LOCAL FUNCTION PROTOTYPES
 *******************************************************************************/
 
+static osMutexId lock_for__(SensorNode const *p_self);
+static bool lock__(SensorNode const *p_self);
+static void unlock__(SensorNode const *p_self);
+static bool ready_lock__(void);
+static void ready_unlock__(void);
+static void remove_from_ready__(SensorNode *p_self);
 static uint32_t calc_max_pop_len__(SensorNode const *p_self, uint32_t limit);
+static void note_ingest__(SensorNode *p_self, uint32_t seq32);
+static void count_ingest__(SensorNode *p_self, uint32_t num_samples, uint32_t now_s);
+static uint32_t reorder_bucket__(uint32_t depth);
 static void flush_data_stream__(SensorNode const *p_self);
 
 
@@ -83,29 +110,75 @@ static void flush_data_stream__(SensorNode const *p_self);
 *                               GLOBAL FUNCTIONS
 *******************************************************************************/
 
+/******************************************************************************/
+bool SensorNode_init_locks(void)
+{
+    osMutexDef(sensor_node_lock);
+    osMutexDef(sensor_node_ready_lock);
+
+    bool success=true;
+
+    if( s_ready_lock == NULL )
+    {
+        s_ready_lock = osMutexCreate(osMutex(sensor_node_ready_lock));
+
+        if( s_ready_lock == NULL )
+        {
+            success = false;
+        }
+    }
+
+    for(uint32_t ii=0U; ii<SENSOR_NODE_NUM_LOCKS; ii++)
+    {
+        if( s_locks[ii] == NULL )
+        {
+            s_locks[ii] = osMutexCreate(osMutex(sensor_node_lock));
+
+            if( s_locks[ii] == NULL )
+            {
+                success = false;
+            }
+        }
+    }
+
+    return success;
+}
 /******************************************************************************/
 void SensorNode_init(SensorNode *p_self)
 {
     if(p_self)
     {
-        /*
-         * Using mutex to protect sensor-node objects from access by multiple threads
-         */
-        if( osMutexWait(g_sensor_node_mutexHandle, 1000) == osOK )
+        ALC_ASSERT( lock_for__(p_self) != NULL );
+
+        if( lock__(p_self) )
         {
+            /* A reader may be part way through a copy -- keep the count, and
+             * make it odd. Not with SensorNode_begin_info_update(), as the
+             * node may never have been initialised (so the count may be odd
+             * already), and nothing else writes to a node being initialised.
+             */
+            uint32_t info_seq = __atomic_or_fetch(&p_self->info_seq, 1U, __ATOMIC_RELAXED);
+
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+
             memset(p_self, 0, sizeof(SensorNode));
 
+            p_self->info_seq = info_seq;
+
             SensorDataList_init(&p_self->data_list);
 
-            SensorNode_update_last_msg_rx_time(p_self);
+            p_self->last_msg_rx_time = clock_seconds();
+
+            p_self->ingest.rate_start_s = p_self->last_msg_rx_time;
 
             p_self->lat = 0.0f;
             p_self->lon = 0.0f;
 
             p_self->flags.is_dirty = true;
 
-            /* release mutex */
-            osMutexRelease(g_sensor_node_mutexHandle);
+            SensorNode_end_info_update(p_self);
+
+            unlock__(p_self);
         }
     }
 }
@@ -116,16 +189,14 @@ bool SensorNode_destroy(SensorNode *p_self)
 
     if(p_self)
     {
-        /*
-         * Using mutex to protect sensor-node objects from access by multiple threads
-         */
-        if( osMutexWait(g_sensor_node_mutexHandle, 1000) == osOK )
+        if( lock__(p_self) )
         {
             /* delete all data and return it to the store */
             flush_data_stream__(p_self);
 
-            /* release mutex */
-            osMutexRelease(g_sensor_node_mutexHandle);
+            unlock__(p_self);
+
+            remove_from_ready__(p_self);
 
             success = true;
         }
@@ -140,19 +211,23 @@ bool SensorNode_reset_data_stream(SensorNode *p_self, uint16_t id16, uint32_t se
 
     if(p_self)
     {
-        /*
-         * Using mutex to protect sensor-node objects from access by multiple threads
-         */
-        if( osMutexWait(g_sensor_node_mutexHandle, 1000) == osOK )
+        if( lock__(p_self) )
         {
             flush_data_stream__(p_self);
 
+            SensorNode_begin_info_update(p_self);
             p_self->id16             = id16;
+            SensorNode_end_info_update(p_self);
+
             p_self->wrong_id16_count = 0U;
             p_self->front_seq32      = seq32;
 
-            /* release mutex */
-            osMutexRelease(g_sensor_node_mutexHandle);
+            /* The new stream's sequence numbers aren't gaps or reordering */
+            p_self->ingest.has_newest = false;
+
+            unlock__(p_self);
+
+            success = true;
         }
     }
     return success;
@@ -161,34 +236,127 @@ bool SensorNode_reset_data_stream(SensorNode *p_self, uint16_t id16, uint32_t se
 bool SensorNode_add_data(SensorNode *p_self, struct SensorData *p_sensor_data)
 {
     bool success=false;
+    bool was_empty=false;
 
     if( (p_self) && (p_sensor_data) )
     {
-        /*
-         * Using mutex to protect sensor-node objects from access by multiple threads
-         */
-        if( osMutexWait(g_sensor_node_mutexHandle, 1000) == osOK )
+        if( lock__(p_self) )
         {
+            was_empty = SensorDataList_is_empty(&p_self->data_list);
+
+            note_ingest__(p_self, p_sensor_data->seq32);
+            count_ingest__(p_self, 1U, clock_seconds());
+
             /* Use insert as the data needs to be sorted */
             success = SensorDataList_insert(&p_self->data_list, p_sensor_data);
 
-            /* release mutex */
-            osMutexRelease(g_sensor_node_mutexHandle);
+            if( !success )
+            {
+                p_self->ingest.num_duplicates++;
+            }
+
+            unlock__(p_self);
+        }
+
+        if( ( success ) && ( was_empty ) )
+        {
+            SensorNode_mark_as_ready(p_self);
+        }
+
+        if( !success )
+        {
+            /* The caller returns the sample to the pool -- count it here, so
+             * the drop isn't silent.
+             */
+            __atomic_add_fetch(&p_self->num_dropped, 1U, __ATOMIC_RELAXED);
         }
     }
     return success;
 }
 /******************************************************************************/
+bool SensorNode_add_data_batch(SensorNode *p_self, SensorDataList *p_batch, SensorNodeBatchResult *p_result)
+{
+    SensorNodeBatchResult result = { 0U, 0U, 0U };
+    bool                  success=false;
+    bool                  was_empty=false;
+
+    if( (p_self) && (p_batch) )
+    {
+        if( lock__(p_self) )
+        {
+            SensorDataList in_window;
+            SensorDataList out_of_window;
+
+            SensorDataList_init(&in_window);
+            SensorDataList_init(&out_of_window);
+
+            count_ingest__(p_self, SensorDataList_get_size(p_batch), clock_seconds());
+
+            while( !SensorDataList_is_empty(p_batch) )
+            {
+                struct SensorData *p_data = SensorDataList_pop_front(p_batch);
+
+                note_ingest__(p_self, p_data->seq32);
+
+                if( (int32_t) ( p_data->seq32 - p_self->front_seq32 ) < 0 )
+                {
+                    SensorDataList_push_back(&out_of_window, p_data);
+                }
+                else
+                {
+                    SensorDataList_push_back(&in_window, p_data);
+                }
+            }
+
+            /* Leaves the duplicates in in_window */
+            was_empty           = SensorDataList_is_empty(&p_self->data_list);
+            result.num_inserted = SensorDataList_merge(&p_self->data_list, &in_window);
+
+            result.num_duplicates = SensorDataList_get_size(&in_window);
+
+            p_self->ingest.num_duplicates += result.num_duplicates;
+
+            unlock__(p_self);
+
+            result.num_out_of_window = SensorDataList_get_size(&out_of_window);
+
+            /* Hand back everything that wasn't added */
+            *p_batch = in_window;
+
+            while( !SensorDataList_is_empty(&out_of_window) )
+            {
+                SensorDataList_push_back(p_batch, SensorDataList_pop_front(&out_of_window));
+            }
+
+            success = true;
+        }
+
+        if( ( result.num_inserted > 0U ) && ( was_empty ) )
+        {
+            SensorNode_mark_as_ready(p_self);
+        }
+
+        if( !SensorDataList_is_empty(p_batch) )
+        {
+            __atomic_add_fetch(&p_self->num_dropped, SensorDataList_get_size(p_batch), __ATOMIC_RELAXED);
+        }
+    }
+
+    if(p_result)
+    {
+        *p_result = result;
+    }
+
+    return success;
+}
+/******************************************************************************/
 struct SensorData* SensorNode_remove_data(SensorNode *p_self)
 {
     struct SensorData *p_sensor_data=NULL;
 
     if(p_self)
     {
-        /*
-         * Using mutex to protect sensor-node objects from access by multiple threads
-         */
-        if( osMutexWait(g_sensor_node_mutexHandle, 1000) == osOK )
+        if( lock__(p_self) )
         {
             // todo
             p_sensor_data = SensorDataList_pop_front(&p_self->data_list);
@@ -198,8 +366,7 @@ struct SensorData* SensorNode_remove_data(SensorNode *p_self)
                 p_self->front_seq32 = ( p_sensor_data->seq32 + 1 );
             }
 
-            /* release mutex */
-            osMutexRelease(g_sensor_node_mutexHandle);
+            unlock__(p_self);
         }
     }
 
@@ -212,15 +379,11 @@ uint32_t SensorNode_get_data_size(SensorNode *p_self)
 
     if(p_self)
     {
-        /*
-         * Using mutex to protect sensor-node objects from access by multiple threads
-         */
-        if( osMutexWait(g_sensor_node_mutexHandle, 1000) == osOK )
+        if( lock__(p_self) )
         {
             count = SensorDataList_get_size(&p_self->data_list);
 
-            /* release mutex */
-            osMutexRelease(g_sensor_node_mutexHandle);
+            unlock__(p_self);
         }
     }
 
@@ -233,16 +396,12 @@ uint32_t SensorNode_max_pop_len(SensorNode const *p_self, uint32_t limit)
 
     if(p_self)
     {
-        /*
-         * Using mutex to protect sensor-node objects from access by multiple threads
-         */
-        if( osMutexWait(g_sensor_node_mutexHandle, 1000) == osOK )
+        if( lock__(p_self) )
         {
             count = calc_max_pop_len__(p_self, limit);
 
 
-            /* release mutex */
-            osMutexRelease(g_sensor_node_mutexHandle);
+            unlock__(p_self);
         }
     }
 
@@ -255,23 +414,76 @@ uint32_t SensorNode_received_to_seq32(SensorNode const *p_self)
 
     if(p_self)
     {
-        /*
-         * Using mutex to protect sensor-node objects from access by multiple threads
-         */
-        if( osMutexWait(g_sensor_node_mutexHandle, 1000) == osOK )
+        if( lock__(p_self) )
         {
             seq32 =  p_self->front_seq32;
             seq32 += calc_max_pop_len__(p_self, UINT32_MAX);
             seq32 -= 1U;
 
-            /* release mutex */
-            osMutexRelease(g_sensor_node_mutexHandle);
+            unlock__(p_self);
         }
     }
 
     return seq32;
 }
 /******************************************************************************/
+bool SensorNode_get_first_missing(SensorNode const *p_self, uint32_t *p_first_seq32, uint32_t *p_count)
+{
+    bool found=false;
+
+    if( (p_self) && (p_first_seq32) && (p_count) )
+    {
+        if( lock__(p_self) )
+        {
+            uint32_t expected = p_self->front_seq32;
+
+            for(struct SensorData const* iter=p_self->data_list.p_first; iter!=NULL; iter=iter->p_next)
+            {
+                int32_t diff = (int32_t) ( iter->seq32 - expected );
+
+                if( diff > 0 )
+                {
+                    *p_first_seq32 = expected;
+                    *p_count       = (uint32_t) diff;
+                    found          = true;
+                    break;
+                }
+
+                if( diff == 0 )
+                {
+                    expected++;
+                }
+            }
+
+            unlock__(p_self);
+        }
+    }
+
+    return found;
+}
+/******************************************************************************/
+bool SensorNode_skip_missing(SensorNode *p_self, uint32_t first_seq32, uint32_t count)
+{
+    bool skipped=false;
+
+    if(p_self)
+    {
+        if( lock__(p_self) )
+        {
+            /* front_seq32 is somewhere in the run */
+            if( ( p_self->front_seq32 - first_seq32 ) < count )
+            {
+                p_self->front_seq32 = first_seq32 + count;
+                skipped             = true;
+            }
+
+            unlock__(p_self);
+        }
+    }
+
+    return skipped;
+}
+/******************************************************************************/
 char const* SensorNode_get_status_string(SensorNode const *p_self)
 {
     if(p_self)
@@ -292,11 +504,310 @@ char const* SensorNode_get_status_string(SensorNode const *p_self)
     return "?";
 }
 /******************************************************************************/
+/* A sequence lock: the count is odd while the metadata is being written, and
+ * a reader whose copy started and ended on the same even count has a
+ * consistent copy. A writer makes the count odd with a compare-and-swap from
+ * an even count, so only one writer at a time is part way through -- no lock
+ * is taken.
+ */
+void SensorNode_begin_info_update(SensorNode *p_self)
+{
+    if(p_self)
+    {
+        uint32_t seq = __atomic_load_n(&p_self->info_seq, __ATOMIC_RELAXED);
+
+        while(
+                ( ( seq & 1U ) != 0U ) ||
+                ( !__atomic_compare_exchange_n(&p_self->info_seq, &seq, ( seq + 1U ), false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) )
+        )
+        {
+            if( ( seq & 1U ) != 0U )
+            {
+                /* Another writer is part way through a few stores -- let it
+                 * finish, even if it has a lower priority.
+                 */
+                osDelay(1U);
+                seq = __atomic_load_n(&p_self->info_seq, __ATOMIC_RELAXED);
+            }
+        }
+
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+}
+/******************************************************************************/
+void SensorNode_end_info_update(SensorNode *p_self)
+{
+    if(p_self)
+    {
+        __atomic_add_fetch(&p_self->info_seq, 1U, __ATOMIC_RELEASE);
+    }
+}
+/******************************************************************************/
+void SensorNode_set_fw_version(SensorNode *p_self, uint8_t const *p_fw_version)
+{
+    if( ( p_self ) && ( p_fw_version ) )
+    {
+        SensorNode_begin_info_update(p_self);
+        memcpy(p_self->fw_version, p_fw_version, sizeof(p_self->fw_version));
+        SensorNode_end_info_update(p_self);
+    }
+}
+/******************************************************************************/
+void SensorNode_set_stratum(SensorNode *p_self, uint8_t stratum)
+{
+    if(p_self)
+    {
+        SensorNode_begin_info_update(p_self);
+        p_self->stratum = stratum;
+        SensorNode_end_info_update(p_self);
+    }
+}
+/******************************************************************************/
+void SensorNode_set_position(SensorNode *p_self, double lat, double lon)
+{
+    if(p_self)
+    {
+        SensorNode_begin_info_update(p_self);
+        p_self->lat = lat;
+        p_self->lon = lon;
+        SensorNode_end_info_update(p_self);
+    }
+}
+/******************************************************************************/
+void SensorNode_set_bulb_current(SensorNode *p_self, uint16_t bulb_current_ma_rms)
+{
+    if(p_self)
+    {
+        SensorNode_begin_info_update(p_self);
+        p_self->bulb_current_ma_rms = bulb_current_ma_rms;
+        SensorNode_end_info_update(p_self);
+    }
+}
+/******************************************************************************/
+void SensorNode_set_num_samples_waiting(SensorNode *p_self, uint32_t num_samples_waiting)
+{
+    if(p_self)
+    {
+        SensorNode_begin_info_update(p_self);
+        p_self->num_samples_waiting = num_samples_waiting;
+        SensorNode_end_info_update(p_self);
+    }
+}
+/******************************************************************************/
+void SensorNode_count_rx_packet(SensorNode *p_self)
+{
+    if(p_self)
+    {
+        SensorNode_begin_info_update(p_self);
+        p_self->num_rx_packets++;
+        SensorNode_end_info_update(p_self);
+    }
+}
+/******************************************************************************/
+bool SensorNode_read_info(SensorNode const *p_self, SensorNodeInfo *p_info)
+{
+    bool success=false;
+
+    if( (p_self) && (p_info) )
+    {
+        for(uint32_t ii=0U; ( ii < SENSOR_NODE_INFO_READ_ATTEMPTS ) && ( !success ); ii++)
+        {
+            uint32_t seq = __atomic_load_n(&p_self->info_seq, __ATOMIC_ACQUIRE);
+
+            memcpy(p_info->fw_version, p_self->fw_version, sizeof(p_info->fw_version));
+            p_info->stratum             = p_self->stratum;
+            p_info->lat                 = p_self->lat;
+            p_info->lon                 = p_self->lon;
+            p_info->num_samples_waiting = p_self->num_samples_waiting;
+            p_info->bulb_current_ma_rms = p_self->bulb_current_ma_rms;
+            p_info->id16                = p_self->id16;
+            p_info->num_rx_packets      = p_self->num_rx_packets;
+            p_info->last_msg_rx_time    = p_self->last_msg_rx_time;
+            p_info->p_status            = SensorNode_get_status_string(p_self);
+            p_info->is_dirty            = ( p_self->flags.is_dirty ) ? true : false;
+
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+            success = ( ( seq & 1U ) == 0U ) &&
+                      ( __atomic_load_n(&p_self->info_seq, __ATOMIC_RELAXED) == seq );
+        }
+    }
+
+    return success;
+}
+/******************************************************************************/
+uint32_t SensorNode_get_num_dropped(SensorNode const *p_self)
+{
+    if(p_self)
+    {
+        return __atomic_load_n(&p_self->num_dropped, __ATOMIC_RELAXED);
+    }
+
+    return 0U;
+}
+/******************************************************************************/
+bool SensorNode_get_ingest_stats(SensorNode const *p_self, SensorNodeIngestStats *p_stats)
+{
+    bool success=false;
+
+    if( (p_self) && (p_stats) )
+    {
+        if( lock__(p_self) )
+        {
+            *p_stats = p_self->ingest;
+
+            unlock__(p_self);
+
+            /* Nothing has arrived for a whole period since the rate was
+             * last worked out.
+             */
+            if( ( clock_seconds() - p_stats->rate_start_s ) >= ( 2U * SENSOR_NODE_RATE_PERIOD_S ) )
+            {
+                p_stats->samples_per_s_x100 = 0U;
+            }
+
+            success = true;
+        }
+    }
+
+    return success;
+}
+/******************************************************************************/
+uint32_t SensorNode_reorder_depth_percentile(SensorNodeIngestStats const *p_stats, uint32_t percent)
+{
+    uint32_t depth=0U;
+
+    if( ( p_stats ) && ( p_stats->num_samples > 0U ) )
+    {
+        /* The rank of the sample wanted, rounded up */
+        uint64_t rank  = ( ( (uint64_t) p_stats->num_samples * percent ) + 99U ) / 100U;
+        uint64_t count = 0U;
+        uint32_t kk;
+
+        if( rank == 0U )
+        {
+            rank = 1U;
+        }
+
+        for(kk=0U; kk<( SENSOR_NODE_REORDER_NUM_BUCKETS - 1U ); kk++)
+        {
+            count += p_stats->reorder_hist[kk];
+
+            if( count >= rank )
+            {
+                break;
+            }
+        }
+
+        /* The top of bucket kk -- the last bucket has no top */
+        depth = p_stats->max_reorder_depth;
+
+        if( ( kk < ( SENSOR_NODE_REORDER_NUM_BUCKETS - 1U ) ) && ( ( ( 1UL << kk ) - 1U ) < depth ) )
+        {
+            depth = (uint32_t) ( ( 1UL << kk ) - 1U );
+        }
+    }
+
+    return depth;
+}
+/******************************************************************************/
+uint32_t SensorNode_get_num_lock_timeouts(void)
+{
+    return __atomic_load_n(&s_num_lock_timeouts, __ATOMIC_RELAXED);
+}
+/******************************************************************************/
+osMutexId SensorNode_get_lock(SensorNode const *p_self)
+{
+    return lock_for__(p_self);
+}
+/******************************************************************************/
+/* Forgets the nodes in the list without touching them -- for SNL_init(),
+ * which then initialises every node.
+ */
+void SensorNode_clear_ready_list(void)
+{
+    if( ready_lock__() )
+    {
+        s_ready.p_first = NULL;
+        s_ready.p_last  = NULL;
+        s_ready.size    = 0U;
+
+        ready_unlock__();
+    }
+}
+/******************************************************************************/
+void SensorNode_mark_as_ready(SensorNode *p_self)
+{
+    if(p_self)
+    {
+        if( ready_lock__() )
+        {
+            if( !p_self->is_ready )
+            {
+                p_self->is_ready     = true;
+                p_self->p_ready_next = NULL;
+
+                if(s_ready.p_last)
+                {
+                    s_ready.p_last->p_ready_next = p_self;
+                }
+                else
+                {
+                    s_ready.p_first = p_self;
+                }
+
+                s_ready.p_last = p_self;
+                s_ready.size++;
+            }
+
+            ready_unlock__();
+        }
+    }
+}
+/******************************************************************************/
+SensorNode* SensorNode_pop_ready(void)
+{
+    SensorNode *p_node=NULL;
+
+    if( ready_lock__() )
+    {
+        p_node = s_ready.p_first;
+
+        if(p_node)
+        {
+            s_ready.p_first = p_node->p_ready_next;
+
+            if( s_ready.p_first == NULL )
+            {
+                s_ready.p_last = NULL;
+            }
+
+            s_ready.size--;
+
+            p_node->p_ready_next = NULL;
+            p_node->is_ready     = false;
+        }
+
+        ready_unlock__();
+    }
+
+    return p_node;
+}
+/******************************************************************************/
+uint32_t SensorNode_get_num_ready(void)
+{
+    return __atomic_load_n(&s_ready.size, __ATOMIC_RELAXED);
+}
+/******************************************************************************/
 void SensorNode_mark_as_dirty(SensorNode *p_self)
 {
     if(p_self)
     {
+        SensorNode_begin_info_update(p_self);
         p_self->flags.is_dirty = true;
+        SensorNode_end_info_update(p_self);
+
+        SensorNode_mark_as_ready(p_self);
     }
 }
 /******************************************************************************/
@@ -304,7 +815,9 @@ void SensorNode_clear_is_dirty(SensorNode *p_self)
 {
     if(p_self)
     {
+        SensorNode_begin_info_update(p_self);
         p_self->flags.is_dirty = false;
+        SensorNode_end_info_update(p_self);
     }
 }
 /******************************************************************************/
@@ -322,7 +835,9 @@ void SensorNode_mark_as_stale(SensorNode *p_self)
 {
     if(p_self)
     {
+        SensorNode_begin_info_update(p_self);
         p_self->flags.is_stale = true;
+        SensorNode_end_info_update(p_self);
     }
 }
 /******************************************************************************/
@@ -330,8 +845,10 @@ void SensorNode_update_last_msg_rx_time(SensorNode *p_self)
 {
     if(p_self)
     {
+        SensorNode_begin_info_update(p_self);
         p_self->flags.is_stale   = false;
         p_self->last_msg_rx_time = clock_seconds();
+        SensorNode_end_info_update(p_self);
     }
 }
 /******************************************************************************/
@@ -351,7 +868,9 @@ void SensorNode_mark_for_deletion(SensorNode *p_self)
 {
     if(p_self)
     {
+        SensorNode_begin_info_update(p_self);
         p_self->flags.for_deleting = true;
+        SensorNode_end_info_update(p_self);
     }
 }
 /******************************************************************************/
@@ -363,6 +882,90 @@ void SensorNode_mark_for_deletion(SensorNode *p_self)
 *                               LOCAL FUNCTIONS
 *******************************************************************************/
 
+/******************************************************************************/
+static osMutexId lock_for__(SensorNode const *p_self)
+{
+    /* The nodes are in an array, so neighbours get different locks */
+    return s_locks[ ( (uintptr_t) p_self / sizeof(SensorNode) ) % SENSOR_NODE_NUM_LOCKS ];
+}
+/******************************************************************************/
+static bool lock__(SensorNode const *p_self)
+{
+    if( osMutexWait(lock_for__(p_self), SENSOR_NODE_LOCK_TIMEOUT_MS) == osOK )
+    {
+        return true;
+    }
+
+    __atomic_add_fetch(&s_num_lock_timeouts, 1U, __ATOMIC_RELAXED);
+
+    return false;
+}
+/******************************************************************************/
+static void unlock__(SensorNode const *p_self)
+{
+    osMutexRelease(lock_for__(p_self));
+}
+/******************************************************************************/
+static bool ready_lock__(void)
+{
+    ALC_ASSERT( s_ready_lock != NULL );
+
+    if( osMutexWait(s_ready_lock, SENSOR_NODE_LOCK_TIMEOUT_MS) == osOK )
+    {
+        return true;
+    }
+
+    __atomic_add_fetch(&s_num_lock_timeouts, 1U, __ATOMIC_RELAXED);
+
+    return false;
+}
+/******************************************************************************/
+static void ready_unlock__(void)
+{
+    osMutexRelease(s_ready_lock);
+}
+/******************************************************************************/
+/* Only when a node is destroyed, so a walk along the list is fine */
+static void remove_from_ready__(SensorNode *p_self)
+{
+    if( ready_lock__() )
+    {
+        if(p_self->is_ready)
+        {
+            SensorNode *p_prev=NULL;
+
+            for(SensorNode *p_node = s_ready.p_first; p_node; p_node = p_node->p_ready_next)
+            {
+                if( p_node == p_self )
+                {
+                    if(p_prev)
+                    {
+                        p_prev->p_ready_next = p_self->p_ready_next;
+                    }
+                    else
+                    {
+                        s_ready.p_first = p_self->p_ready_next;
+                    }
+
+                    if( s_ready.p_last == p_self )
+                    {
+                        s_ready.p_last = p_prev;
+                    }
+
+                    s_ready.size--;
+                    break;
+                }
+
+                p_prev = p_node;
+            }
+
+            p_self->p_ready_next = NULL;
+            p_self->is_ready     = false;
+        }
+
+        ready_unlock__();
+    }
+}
 /******************************************************************************/
 static uint32_t calc_max_pop_len__(SensorNode const *p_self, uint32_t limit)
 {
@@ -380,6 +983,78 @@ static uint32_t calc_max_pop_len__(SensorNode const *p_self, uint32_t limit)
     return count;
 }
 /******************************************************************************/
+/* Called with the node locked, for each sample offered to the node */
+static void note_ingest__(SensorNode *p_self, uint32_t seq32)
+{
+    SensorNodeIngestStats *p_ingest = &p_self->ingest;
+    uint32_t               depth=0U;
+
+    if( !p_ingest->has_newest )
+    {
+        p_ingest->newest_seq32 = seq32;
+        p_ingest->has_newest   = true;
+    }
+    else if( (int32_t) ( seq32 - p_ingest->newest_seq32 ) > 0 )
+    {
+        /* Ahead of everything so far -- anything skipped is a gap (it may
+         * still turn up, late).
+         */
+        uint32_t gap = seq32 - p_ingest->newest_seq32 - 1U;
+
+        if( gap > 0U )
+        {
+            p_ingest->num_gaps++;
+            p_ingest->num_gap_samples += gap;
+
+            if( gap > p_ingest->max_gap )
+            {
+                p_ingest->max_gap = gap;
+            }
+        }
+
+        p_ingest->newest_seq32 = seq32;
+    }
+    else
+    {
+        depth = p_ingest->newest_seq32 - seq32;
+    }
+
+    p_ingest->reorder_hist[reorder_bucket__(depth)]++;
+
+    if( depth > p_ingest->max_reorder_depth )
+    {
+        p_ingest->max_reorder_depth = depth;
+    }
+}
+/******************************************************************************/
+/* Called with the node locked */
+static void count_ingest__(SensorNode *p_self, uint32_t num_samples, uint32_t now_s)
+{
+    SensorNodeIngestStats *p_ingest = &p_self->ingest;
+    uint32_t               elapsed_s = now_s - p_ingest->rate_start_s;
+
+    if( elapsed_s >= SENSOR_NODE_RATE_PERIOD_S )
+    {
+        /* Over the time since the period started -- which is longer than
+         * the period if the node went quiet.
+         */
+        p_ingest->samples_per_s_x100 = (uint32_t) ( ( (uint64_t) p_ingest->rate_count * 100U ) / elapsed_s );
+        p_ingest->rate_start_s       = now_s;
+        p_ingest->rate_count         = 0U;
+    }
+
+    p_ingest->num_samples += num_samples;
+    p_ingest->rate_count  += num_samples;
+}
+/******************************************************************************/
+/* 0 for in order, otherwise the number of bits needed to hold the depth */
+static uint32_t reorder_bucket__(uint32_t depth)
+{
+    uint32_t bucket = ( depth == 0U ) ? 0U : ( 32U - (uint32_t) __builtin_clz(depth) );
+
+    return ( bucket < SENSOR_NODE_REORDER_NUM_BUCKETS ) ? bucket : ( SENSOR_NODE_REORDER_NUM_BUCKETS - 1U );
+}
+/******************************************************************************/
 static void flush_data_stream__(SensorNode const *p_self)
 {
     uint32_t count=0U;
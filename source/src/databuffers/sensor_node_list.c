@@ -18,6 +18,7 @@
 #include "sensor_node_list.h"
 
 #include "alc_assert.h"
+#include "cmsis_os.h"
 #include "contiki.h"
 #include "net/ipv6/uip-ds6.h"
 
@@ -68,8 +69,15 @@
 *                               LOCAL GLOBAL VARIABLES
 *******************************************************************************/
 
+/* The nodes never move, so the list is walked without a lock -- a walk sees
+ * each node either in use or not (is_used is set once the node is ready, and
+ * cleared once it is destroyed). Adding and removing nodes take s_list_lock,
+ * so they take turns.
+ */
 static SensorNode s_node_list[SENSOR_NODE_LIST_SIZE];
 
+static osMutexId s_list_lock;
+
 
 
 
@@ -78,6 +86,8 @@ static SensorNode s_node_list[SENSOR_NODE_LIST_SIZE];
 *******************************************************************************/
 
 static bool find_nodes_index__(SensorNode const* p_sensor_node, uint32_t *p_index);
+static bool is_used__(uint32_t index);
+static SensorNode* search__(uip_ipaddr_t const *p_ipaddr, int *p_unused_idx);
 
 
 
@@ -96,8 +106,26 @@ static bool find_nodes_index__(SensorNode const* p_sensor_node, uint32_t *p_inde
 /******************************************************************************/
 void SNL_init(void)
 {
+    osMutexDef(sensor_node_list_lock);
+
     PRINTF("SNL_init() -- todo!!\r\n");
 
+    if( s_list_lock == NULL )
+    {
+        s_list_lock = osMutexCreate(osMutex(sensor_node_list_lock));
+        ALC_ASSERT( s_list_lock != NULL );
+    }
+
+    /* Before any node is initialised -- a node can't be used without its lock */
+    if( !SensorNode_init_locks() )
+    {
+        PRINTF("SNL_init() -- failed to create the node locks\r\n");
+        ALC_ASSERT( false );
+    }
+
+    /* The nodes are about to be initialised, so can't stay in the list */
+    SensorNode_clear_ready_list();
+
     for(uint32_t ii=0; ii<SENSOR_NODE_LIST_SIZE; ii++)
     {
         SensorNode_init(&s_node_list[ii]);
@@ -110,7 +138,7 @@ uint32_t SNL_get_size(void)
 
     for(uint32_t ii=0; ii<SENSOR_NODE_LIST_SIZE; ii++)
     {
-        if( s_node_list[ii].is_used )
+        if( is_used__(ii) )
         {
             size++;
         }
@@ -137,68 +165,63 @@ SensorNode* SNL_find(uip_ipaddr_t const *p_ipaddr, bool create_if_none, bool *p_
     {
         int unused_idx=-1;
 
-        /* Search through the list
-         */
-        for(uint32_t ii=0; ii<SENSOR_NODE_LIST_SIZE; ii++)
+        p_sensor_node = search__(p_ipaddr, NULL);
+
+        if( ( p_sensor_node == NULL ) && (create_if_none) )
         {
-            if( s_node_list[ii].is_used )
+            if( osMutexWait(s_list_lock, SENSOR_NODE_LOCK_TIMEOUT_MS) != osOK )
             {
-                /* The element is in use -- test if the IP address matches
-                 */
-                if( uip_ipaddr_cmp(&s_node_list[ii].ipaddr, p_ipaddr)  )
-                {
-                    /* Found it -- set return pointer and exit for() loop */
-                    //PRINTF("Found element at index %d\r\n", ii);
-                    p_sensor_node = &s_node_list[ii];
-                    break;
-                }
+                PRINTF("SNL_find() -- list lock timed out\r\n");
+                return NULL;
             }
-            else if(unused_idx == -1)
+
+            /* Another thread may have added it since the search */
+            p_sensor_node = search__(p_ipaddr, &unused_idx);
+
+            if( p_sensor_node == NULL )
             {
-                /* Found an unused element -- remember the index in case we need
-                 * to create a new entry later.
+                /* The IP address is not in the list, and we have been asked
+                 * to create a new entry if none is found
                  */
-                unused_idx = ii;
-            }
-        }
+                if( ( unused_idx >= 0 ) && ( unused_idx < SENSOR_NODE_LIST_SIZE ) )
+                {
+                    /* Create new entry here */
+                    p_sensor_node = &s_node_list[unused_idx];
 
-        if( ( p_sensor_node == NULL ) && (create_if_none) )
-        {
-            /* The IP address is not in the list, and we have been asked to
-             * create a new entry if none is found
-             */
-            if( ( unused_idx >= 0 ) && ( unused_idx < SENSOR_NODE_LIST_SIZE ) )
-            {
-                /* Create new entry here */
-                p_sensor_node = &s_node_list[unused_idx];
+                    PRINTF("Creating entry at index %d for ", unused_idx);
+                    PRINT6ADDR(p_ipaddr);
+                    PRINTF("\r\n");
 
-                PRINTF("Creating entry at index %d for ", unused_idx);
-                PRINT6ADDR(p_ipaddr);
-                PRINTF("\r\n");
+                    SensorNode_init(p_sensor_node);
 
-                SensorNode_init(p_sensor_node);
+                    uip_ipaddr_copy(&p_sensor_node->ipaddr, p_ipaddr);
 
-                uip_ipaddr_copy(&p_sensor_node->ipaddr, p_ipaddr);
+                    /* Only now can the walks see it */
+                    __atomic_store_n(&p_sensor_node->is_used, true, __ATOMIC_RELEASE);
 
-                p_sensor_node->is_used = true;
+                    /* A new node is dirty -- its long message is due */
+                    SensorNode_mark_as_ready(p_sensor_node);
 
-                if(p_was_created)
+                    if(p_was_created)
+                    {
+                        *p_was_created = true;
+                    }
+                }
+                else
                 {
-                    *p_was_created = true;
+                    /* List is full -- don't do anything */
+                    PRINTF("List is full -- can't add new item\r\n");
                 }
             }
-            else
-            {
-                /* List is full -- don't do anything */
-                PRINTF("List is full -- can't add new item\r\n");
-            }
+
+            osMutexRelease(s_list_lock);
         }
     }
 
     return p_sensor_node;
 }
 /******************************************************************************/
-void SNL_for_each_node(bool (*fn)(uint32_t index, SensorNode const *p_node))
+void SNL_for_each_node(bool (*fn)(uint32_t index, SensorNode *p_node))
 {
     if(fn)
     {
@@ -206,7 +229,7 @@ void SNL_for_each_node(bool (*fn)(uint32_t index, SensorNode const *p_node))
          */
         for(uint32_t ii=0; ii<SENSOR_NODE_LIST_SIZE; ii++)
         {
-            if( s_node_list[ii].is_used )
+            if( is_used__(ii) )
             {
                 if(!fn(ii, &s_node_list[ii]))
                 {
@@ -217,6 +240,26 @@ void SNL_for_each_node(bool (*fn)(uint32_t index, SensorNode const *p_node))
     }
 }
 /******************************************************************************/
+bool SNL_get_index(SensorNode const* p_sensor_node, uint32_t *p_index)
+{
+    /* The nodes are in an array, so no need to search it */
+    if(
+            ( p_sensor_node >= &s_node_list[0] ) &&
+            ( p_sensor_node < &s_node_list[SENSOR_NODE_LIST_SIZE] ) &&
+            ( __atomic_load_n(&p_sensor_node->is_used, __ATOMIC_ACQUIRE) )
+    )
+    {
+        if(p_index)
+        {
+            *p_index = (uint32_t) ( p_sensor_node - &s_node_list[0] );
+        }
+
+        return true;
+    }
+
+    return false;
+}
+/******************************************************************************/
 bool SNL_is_in_list(SensorNode const* p_sensor_node)
 {
     return find_nodes_index__(p_sensor_node, NULL);
@@ -228,7 +271,7 @@ SensorNode* SNL_find_first_active_node(void)
 
     for(uint32_t ii=0U; ii<SENSOR_NODE_LIST_SIZE; ii++)
     {
-        if(s_node_list[ii].is_used)
+        if( is_used__(ii) )
         {
             /* Found the first used node */
             p_first_node = &s_node_list[ii];
@@ -276,7 +319,7 @@ SensorNode* SNL_find_next_active_node(SensorNode const *p_sensor_node, bool wrap
          */
         for(uint32_t ii=start_index; ii<SENSOR_NODE_LIST_SIZE; ii++)
         {
-            if(s_node_list[ii].is_used)
+            if( is_used__(ii) )
             {
                 /* Found the right index */
                 p_next_active_node = &s_node_list[ii];
@@ -290,7 +333,7 @@ SensorNode* SNL_find_next_active_node(SensorNode const *p_sensor_node, bool wrap
         {
             for(uint32_t ii=0U; ii<start_index; ii++)
             {
-                if(s_node_list[ii].is_used)
+                if( is_used__(ii) )
                 {
                     /* Found the right index */
                     p_next_active_node = &s_node_list[ii];
@@ -309,12 +352,18 @@ uint32_t SNL_remove_deleted_nodes(void)
 {
     uint32_t count_deleted=0U;
 
+    if( osMutexWait(s_list_lock, SENSOR_NODE_LOCK_TIMEOUT_MS) != osOK )
+    {
+        /* Tried again the next time */
+        return 0U;
+    }
+
     /* Search through the list
      */
     for(uint32_t ii=0; ii<SENSOR_NODE_LIST_SIZE; ii++)
     {
         if(
-                ( s_node_list[ii].is_used ) &&
+                ( is_used__(ii) ) &&
                 ( s_node_list[ii].flags.for_deleting )
         )
         {
@@ -325,13 +374,15 @@ uint32_t SNL_remove_deleted_nodes(void)
                 PRINT6ADDR(p_ipaddr);
                 PRINTF("\r\n");
 
-                s_node_list[ii].is_used = false;
+                __atomic_store_n(&s_node_list[ii].is_used, false, __ATOMIC_RELEASE);
 
                 count_deleted++;
             }
         }
     }
 
+    osMutexRelease(s_list_lock);
+
     return count_deleted;
 }
 /******************************************************************************/
@@ -372,3 +423,36 @@ static bool find_nodes_index__(SensorNode const* p_sensor_node, uint32_t *p_inde
     return  is_in_list;
 }
 /******************************************************************************/
+static bool is_used__(uint32_t index)
+{
+    return __atomic_load_n(&s_node_list[index].is_used, __ATOMIC_ACQUIRE);
+}
+/******************************************************************************/
+/* The node with the IP address, if it is in the list -- and the first unused
+ * place, if p_unused_idx is given (left at -1 if the list is full).
+ */
+static SensorNode* search__(uip_ipaddr_t const *p_ipaddr, int *p_unused_idx)
+{
+    for(uint32_t ii=0; ii<SENSOR_NODE_LIST_SIZE; ii++)
+    {
+        if( is_used__(ii) )
+        {
+            /* The element is in use -- test if the IP address matches
+             */
+            if( uip_ipaddr_cmp(&s_node_list[ii].ipaddr, p_ipaddr) )
+            {
+                return &s_node_list[ii];
+            }
+        }
+        else if( ( p_unused_idx ) && ( *p_unused_idx == -1 ) )
+        {
+            /* Found an unused element -- remember the index in case we need
+             * to create a new entry later.
+             */
+            *p_unused_idx = (int) ii;
+        }
+    }
+
+    return NULL;
+}
+/******************************************************************************/
@@ -0,0 +1,324 @@
+/**
+ * @file  deferred_log.c
+ * @brief Deferred logging -- log messages are formatted by a low priority task
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "deferred_log.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cmsis_os.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+#define RING_MASK       ( DEFERRED_LOG_RING_SIZE - 1U )
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+/* The arguments are formatted as unsigned int -- %u, %d or %x */
+static char const * const s_formats[NUM_DEFERRED_LOG_IDS] = {
+    [LOG_ID_POOL_EMPTY]                         = "SensorDataPool is empty.",
+    [LOG_ID_DUC_RETRANSMITTING]                 = "Retransmitting data to server",
+    [LOG_ID_DUC_LINK_CLOSED]                    = "Data Upload Client detected TCP link to server has been closed",
+    [LOG_ID_DUC_FORCING_CLOSED]                 = "Data Upload Client forcing TCP closed",
+    [LOG_ID_DUC_NODES_DELETED]                  = "Deleted %u nodes",
+    [LOG_ID_DUC_SEND_FAILED]                    = "Data Upload Client failed to send data to cloud",
+    [LOG_ID_DUC_BYTES_NOT_ACKED]                = "Data Upload Client link closed with %u bytes not acknowledged by server",
+    [LOG_ID_DUC_DATAGRAM_SEND_FAILED]           = "Data Upload Client failed to send datagram to cloud",
+    [LOG_ID_DUC_DATAGRAMS_GIVEN_UP]             = "Data Upload Client gave up %u datagrams not acknowledged by server",
+    [LOG_ID_MODEM_RESTART_REQUESTED]            = "Requesting restart Modem",
+    [LOG_ID_MODEM_RECOVERY_REQUESTED]           = "Requesting Modem recovery",
+    [LOG_ID_MODEM_CONF_CHANGED]                 = "ModemCtrl_conf_has_been_changed()",
+    [LOG_ID_MODEM_RESETTING]                    = "Resetting the modem",
+    [LOG_ID_MODEM_REGISTERED]                   = "Modem is registered to network",
+    [LOG_ID_MODEM_NOT_REGISTERED]               = "Modem could not register to network",
+    [LOG_ID_MODEM_CONNECTED]                    = "Modem running and connected to GPRS.",
+    [LOG_ID_MODEM_NO_RESTART_AFTER_SOFT_RESET]  = "Modem did not restart after soft reset",
+    [LOG_ID_MODEM_RESTARTING]                   = "Modem restart requested -- restarting modem",
+    [LOG_ID_MODEM_RESTARTING_FOR_CONF]          = "Modem configuration has changed -- restarting modem",
+    [LOG_ID_MODEM_RECOVERY_PDP]                 = "Modem recovery -- re-attaching PDP context",
+    [LOG_ID_MODEM_RECOVERY_SOFT_RESET]          = "Modem recovery -- soft reset",
+    [LOG_ID_MODEM_RECOVERY_HARD_RESET]          = "Modem recovery -- hard reset"
+};
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+/* A bounded multi-producer, single-consumer ring. A writer reserves a
+ * position by moving the head on, fills in the entry, then sets its seq to
+ * the position + 1 -- the reader only takes the entry at the tail once its
+ * seq says it has been written.
+ */
+static struct {
+    DeferredLogEntry entries[DEFERRED_LOG_RING_SIZE];
+    uint32_t head;                  /* Next position to reserve */
+    uint32_t tail;                  /* Next position to read */
+    uint32_t num_dropped;
+    uint32_t num_dropped_logged;
+    uint32_t is_flushing;
+} s_ring;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static void emit__(AlcLoggerLevel level, char const *p_str);
+static void log_num_dropped__(void);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+void DeferredLog_init(void)
+{
+    memset(&s_ring, 0, sizeof(s_ring));
+}
+/******************************************************************************/
+void DeferredLog_put(AlcLoggerLevel level, DeferredLogId id, uint32_t num_args,
+                     uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    uint32_t head = __atomic_load_n(&s_ring.head, __ATOMIC_RELAXED);
+    DeferredLogEntry *p_entry;
+
+    do
+    {
+        if( ( head - __atomic_load_n(&s_ring.tail, __ATOMIC_ACQUIRE) ) >= DEFERRED_LOG_RING_SIZE )
+        {
+            /* Full */
+            __atomic_fetch_add(&s_ring.num_dropped, 1U, __ATOMIC_RELAXED);
+            return;
+        }
+    } while( !__atomic_compare_exchange_n(&s_ring.head, &head, ( head + 1U ), true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) );
+
+    p_entry = &s_ring.entries[head & RING_MASK];
+
+    p_entry->id       = (uint16_t) id;
+    p_entry->level    = (uint8_t) level;
+    p_entry->num_args = (uint8_t) num_args;
+    p_entry->args[0]  = a0;
+    p_entry->args[1]  = a1;
+    p_entry->args[2]  = a2;
+    p_entry->args[3]  = a3;
+
+    __atomic_store_n(&p_entry->seq, ( head + 1U ), __ATOMIC_RELEASE);
+}
+/******************************************************************************/
+void DeferredLog_log_now(AlcLoggerLevel level, DeferredLogId id, uint32_t num_args,
+                         uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    DeferredLogEntry entry = {
+        .seq      = 0U,
+        .id       = (uint16_t) id,
+        .level    = (uint8_t) level,
+        .num_args = (uint8_t) num_args,
+        .args     = { a0, a1, a2, a3 }
+    };
+    char str[DEFERRED_LOG_MAX_STR_LEN];
+
+    DeferredLog_format(&entry, str, sizeof(str));
+    emit__(level, str);
+}
+/******************************************************************************/
+bool DeferredLog_pop(DeferredLogEntry *p_entry)
+{
+    uint32_t tail = __atomic_load_n(&s_ring.tail, __ATOMIC_RELAXED);
+    DeferredLogEntry *p_slot = &s_ring.entries[tail & RING_MASK];
+
+    if(
+            ( p_entry == NULL ) ||
+            ( __atomic_load_n(&p_slot->seq, __ATOMIC_ACQUIRE) != ( tail + 1U ) )
+    )
+    {
+        /* Empty, or the writer has not finished with it yet */
+        return false;
+    }
+
+    *p_entry = *p_slot;
+
+    /* The slot can now be reused */
+    __atomic_store_n(&s_ring.tail, ( tail + 1U ), __ATOMIC_RELEASE);
+
+    return true;
+}
+/******************************************************************************/
+uint32_t DeferredLog_format(DeferredLogEntry const *p_entry, char *p_buff, uint32_t len)
+{
+    int ret;
+
+    if( ( p_entry == NULL ) || ( p_buff == NULL ) || ( len == 0U ) )
+    {
+        return 0U;
+    }
+
+    ret = snprintf(p_buff, len, DeferredLog_get_format((DeferredLogId) p_entry->id),
+                   (unsigned int) p_entry->args[0],
+                   (unsigned int) p_entry->args[1],
+                   (unsigned int) p_entry->args[2],
+                   (unsigned int) p_entry->args[3]);
+
+    if( ret < 0 )
+    {
+        p_buff[0] = '\0';
+        return 0U;
+    }
+
+    return ( (uint32_t) ret < len ) ? (uint32_t) ret : ( len - 1U );
+}
+/******************************************************************************/
+char const* DeferredLog_get_format(DeferredLogId id)
+{
+    if(
+            ( (uint32_t) id < NUM_DEFERRED_LOG_IDS ) &&
+            ( s_formats[id] )
+    )
+    {
+        return s_formats[id];
+    }
+
+    return "?";
+}
+/******************************************************************************/
+uint32_t DeferredLog_flush(uint32_t max_entries)
+{
+    DeferredLogEntry entry;
+    char str[DEFERRED_LOG_MAX_STR_LEN];
+    uint32_t count=0U;
+
+    /* Only one reader at a time */
+    if( __atomic_exchange_n(&s_ring.is_flushing, 1U, __ATOMIC_ACQUIRE) != 0U )
+    {
+        return 0U;
+    }
+
+    while( ( count < max_entries ) && ( DeferredLog_pop(&entry) ) )
+    {
+        DeferredLog_format(&entry, str, sizeof(str));
+        emit__((AlcLoggerLevel) entry.level, str);
+        count++;
+    }
+
+    log_num_dropped__();
+
+    __atomic_store_n(&s_ring.is_flushing, 0U, __ATOMIC_RELEASE);
+
+    return count;
+}
+/******************************************************************************/
+uint32_t DeferredLog_get_num_dropped(void)
+{
+    return __atomic_load_n(&s_ring.num_dropped, __ATOMIC_RELAXED);
+}
+/******************************************************************************/
+void DeferredLog_task(void const * argument)
+{
+    (void) argument;
+
+    for(;;)
+    {
+        DeferredLog_flush(DEFERRED_LOG_RING_SIZE);
+        osDelay(DEFERRED_LOG_FLUSH_PERIOD_MS);
+    }
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static void emit__(AlcLoggerLevel level, char const *p_str)
+{
+    switch(level)
+    {
+    case ALC_LOGGER_WARNING:
+        AlcLogger_log_warning(p_str);
+        break;
+
+    case ALC_LOGGER_ERROR:
+        AlcLogger_log_error(p_str);
+        break;
+
+    case ALC_LOGGER_CRITICAL:
+        AlcLogger_log_critical(p_str);
+        break;
+
+    case ALC_LOGGER_INFO:
+    case NUM_ALC_LOGGER_LEVELS:
+    default:
+        AlcLogger_log_info(p_str);
+        break;
+    }
+}
+/******************************************************************************/
+/* Log the number dropped since it was last logged */
+static void log_num_dropped__(void)
+{
+    uint32_t num_dropped = DeferredLog_get_num_dropped();
+    char str[DEFERRED_LOG_MAX_STR_LEN];
+
+    if( num_dropped != s_ring.num_dropped_logged )
+    {
+        snprintf(str, sizeof(str), "Deferred log dropped %u messages",
+                 (unsigned int) ( num_dropped - s_ring.num_dropped_logged ));
+        AlcLogger_log_warning(str);
+
+        s_ring.num_dropped_logged = num_dropped;
+    }
+}
+/******************************************************************************/
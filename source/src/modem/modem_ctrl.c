@@ -18,6 +18,7 @@
 #include "alc_nmea_utils.h"
 #include "alc_string.h"
 #include "cmsis_os.h"
+#include "deferred_log.h"
 #include "FreeRTOS.h"
 #include "modem_drv.h"
 #include "stm32xxxx_hal.h"
@@ -40,6 +41,21 @@
 /* how long to delay configuration-changed event */
 #define DELAY_CONF_CHANGED_EV_MS        ( 120LU * 1000LU )
 
+/* Upper bounds on the waits during bring-up -- each wait ends as soon as the
+ * modem is ready.
+ */
+#define DRIVER_START_TIMEOUT_MS         5000U   /**< The driver task to start */
+#define BOOT_TIMEOUT_MS                 12000U  /**< "RDY" or "OK" after a hard reset */
+#define GPS_START_TIMEOUT_MS            5000U   /**< The GPS to power up */
+#define REGISTER_SLICE_MS               5000U   /**< One attempt to register to the network */
+#define REGISTER_POLL_MAX_MS            2000U   /**< Longest interval between "AT+CREG?" */
+
+/* The modem still answers "AT" for a moment after AT+CFUN=1,1 */
+#define SOFT_RESET_SETTLE_MS            1000U
+
+/* How often ModemCtrl_wait_for_ready() checks the state */
+#define READY_CHECK_MS                  20U
+
 
 
 
@@ -62,6 +78,7 @@ typedef enum {
     ST_JOINING_NETWORK,
     ST_CONFIGURE_LINK,
     ST_RUNNING,
+    ST_SOFT_RESET,
     ST_SHUTDOWN
 } ModemState;
 
@@ -86,6 +103,15 @@ static struct {
     volatile bool     has_changed;
 } s_conf_changed = {0U};
 static volatile bool s_restart_modem=false;
+static volatile bool s_recovery_requested=false;
+static volatile bool s_link_opened=false;
+
+/** @brief The last tier of recovery tried since the link last worked */
+static ModemRecovery s_last_recovery=MODEM_RECOVER_NONE;
+static uint32_t s_num_recoveries[NUM_MODEM_RECOVERY_TIERS];
+
+/** @brief configure_link() only needs to re-attach the PDP context */
+static bool s_keep_gprs_attached=false;
 
 
 
@@ -97,9 +123,14 @@ static volatile bool s_restart_modem=false;
 static bool begin(void);
 static void enable_gps(void);
 static bool registered_to_network(void);
+#if MODEM_HAS_GPS
+static bool gps_is_powered__(void);
+#endif
 static bool configure_link(void);
 static bool decode_cgnsinf_sentence(char const *str);
 static void check_conf__(void);
+static void start_recovery__(void);
+static void wait_while_running__(uint32_t timeout_ms);
 static bool is_connected__(void);
 
 
@@ -124,7 +155,27 @@ uint32_t ModemCtrl_get_state(void)
 /******************************************************************************/
 bool ModemCtrl_modem_is_ready(void)
 {
-    return ( s_state == ST_RUNNING );
+    /* Not once a recovery or a restart has been asked for, even before the
+     * task has seen it.
+     */
+    return ( s_state == ST_RUNNING ) && ( !s_recovery_requested ) && ( !s_restart_modem );
+}
+/******************************************************************************/
+bool ModemCtrl_wait_for_ready(uint32_t timeout_ms)
+{
+    uint32_t start = HAL_GetTick();
+
+    while( !ModemCtrl_modem_is_ready() )
+    {
+        if( ( HAL_GetTick() - start ) >= timeout_ms )
+        {
+            return false;
+        }
+
+        osDelay(READY_CHECK_MS);
+    }
+
+    return true;
 }
 /******************************************************************************/
 bool ModemCtrl_gps_is_ready(void)
@@ -200,14 +251,31 @@ bool ModemCtrl_get_gps_info(GpsSentence *p_inf, uint32_t *p_timestamp)
 /******************************************************************************/
 void ModemCtrl_restart_modem(void)
 {
-    AlcLogger_log_info("Requesting restart Modem");
+    DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_RESTART_REQUESTED);
 
     s_restart_modem = true;
 }
 /******************************************************************************/
+void ModemCtrl_request_recovery(void)
+{
+    DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_RECOVERY_REQUESTED);
+
+    s_recovery_requested = true;
+}
+/******************************************************************************/
+void ModemCtrl_link_opened(void)
+{
+    s_link_opened = true;
+}
+/******************************************************************************/
+uint32_t ModemCtrl_get_num_recoveries(ModemRecovery tier)
+{
+    return ( tier < NUM_MODEM_RECOVERY_TIERS ) ? s_num_recoveries[tier] : 0U;
+}
+/******************************************************************************/
 void ModemCtrl_conf_has_been_changed(void)
 {
-    AlcLogger_log_info("ModemCtrl_conf_has_been_changed()");
+    DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_CONF_CHANGED);
 
     s_conf_changed.has_changed = false;
     s_conf_changed.changed_at  = HAL_GetTick();
@@ -236,10 +304,13 @@ void ModemCtrl_start_task(void const * argument)
     s_gps_ready = false;
 
     s_restart_modem = false;
+    s_recovery_requested = false;
+    s_link_opened = false;
+    s_last_recovery = MODEM_RECOVER_NONE;
     s_conf_changed.has_changed = false;
 
 
-    osDelay(5000);
+    (void) Modem_wait_for_ready(MODEM_READY_DRIVER, NULL, 0U, DRIVER_START_TIMEOUT_MS);
 
     PRINTF("MODEM TASK -- starting\r\n");
 
@@ -250,8 +321,10 @@ void ModemCtrl_start_task(void const * argument)
         {
         case ST_INITIALISING:
             PRINTF("ModemCtrl -- initialising\r\n");
-            AlcLogger_log_info("Resetting the modem");
+            DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_RESETTING);
             s_restart_modem = false;
+            s_recovery_requested = false;
+            s_keep_gprs_attached = false;
             s_conf_changed.has_changed = false;
             num_attempts = 0U;
             while( s_state == ST_INITIALISING )
@@ -288,7 +361,7 @@ void ModemCtrl_start_task(void const * argument)
 
             PRINTF("ModemCtrl -- enabling GPS\r\n");
             enable_gps();
-            osDelay(5000);
+            (void) Modem_wait_for_ready(0U, &gps_is_powered__, 1000U, GPS_START_TIMEOUT_MS);
             s_state = ST_JOINING_NETWORK;
             break;
 #endif
@@ -297,32 +370,28 @@ void ModemCtrl_start_task(void const * argument)
         case ST_JOINING_NETWORK:
             PRINTF("ModemCtrl -- Joining network\r\n");
             num_attempts = 0U;
+
+            /* Report changes in registration with "+CREG:" URC's */
+            Modem_enable_network_registration();
+
             while( s_state == ST_JOINING_NETWORK )
             {
                 check_conf__();
 
-                if( registered_to_network() )
+                if( Modem_wait_for_ready(MODEM_READY_REGISTERED, &registered_to_network, REGISTER_POLL_MAX_MS, REGISTER_SLICE_MS) )
                 {
                     PRINTF("ModemCtrl -- SUCCESS -- registered to network\r\n");
-                    AlcLogger_log_info("Modem is registered to network");
+                    DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_REGISTERED);
                     s_state = ST_CONFIGURE_LINK;
                 }
                 else if( num_attempts++ < 200U )
                 {
                     PRINTF("ModemCtrl -- ERROR -- Failed to register to network\r\n");
-#if 1
-                    osDelay(5000u);
-#else
-                    for(int ii=0; ii<=num_attempts; ii++)
-                    {
-                        osDelay(5000u);
-                    }
-#endif
                 }
                 else
                 {
                     /* too many attempts -- try resetting the modem and starting again. */
-                    AlcLogger_log_error("Modem could not register to network");
+                    DEFERRED_LOG(ALC_LOGGER_ERROR, LOG_ID_MODEM_NOT_REGISTERED);
                     s_state = ST_INITIALISING;
                 }
             }
@@ -343,12 +412,15 @@ void ModemCtrl_start_task(void const * argument)
                 if( configure_link() )
                 {
                     PRINTF("ModemCtrl -- modem link configured\r\n");
-                    AlcLogger_log_info("Modem running and connected to GPRS.");
+                    DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_CONNECTED);
                     s_state = ST_RUNNING;
                 }
                 else if( num_attempts++ < 25U )
                 {
                     PRINTF("ModemCtrl -- failed to configure modem link!\r\n");
+
+                    /* Start again from the GPRS attach next time */
+                    s_keep_gprs_attached = false;
                     osDelay(2000u);
                 }
                 else
@@ -372,7 +444,7 @@ void ModemCtrl_start_task(void const * argument)
                 {
                     /* Modem connection is OK */
                     num_attempts = 0U;
-                    osDelay(30000u);
+                    wait_while_running__(30000u);
                 }
                 else
                 {
@@ -385,13 +457,40 @@ void ModemCtrl_start_task(void const * argument)
                     else
                     {
                         AlcLogger_log_critical("Modem CTRL detected modem is no longer connected");
-                        s_state = ST_SHUTDOWN;
+                        start_recovery__();
                     }
                 }
             }
             break;
 
 
+        case ST_SOFT_RESET:
+            PRINTF("ModemCtrl -- soft reset\r\n");
+            s_gps_ready = false;
+
+            if( Modem_soft_reset() )
+            {
+                osDelay(SOFT_RESET_SETTLE_MS);
+            }
+
+            if( Modem_wait_for_ready(MODEM_READY_RDY, &Modem_send_at, 500U, BOOT_TIMEOUT_MS) )
+            {
+#if MODEM_HAS_GPS
+                s_state = ST_ENABLE_GPS;
+#else
+                s_state = ST_JOINING_NETWORK;
+#endif
+            }
+            else
+            {
+                DEFERRED_LOG(ALC_LOGGER_ERROR, LOG_ID_MODEM_NO_RESTART_AFTER_SOFT_RESET);
+                s_last_recovery = MODEM_RECOVER_HARD_RESET;
+                s_num_recoveries[MODEM_RECOVER_HARD_RESET]++;
+                s_state = ST_SHUTDOWN;
+            }
+            break;
+
+
         case ST_SHUTDOWN:
             /*
              * Perform a controlled shutdown of the modem and then restart it
@@ -436,27 +535,13 @@ static bool begin(void)
 
     PRINTF("Modem -- hard reset\r\n");
     Modem_hard_reset();
-    osDelay(2000);
-
-    uint8_t ch;
 
     PRINTF("Attempting to autobaud with modem using AT commands\r\n");
 
-    // give 10 seconds to reboot
-    int16_t timeout = 10000;
-
-    while( timeout > 0 )
-    {
-        if( Modem_send_at() )
-        {
-            break;
-        }
-
-        osDelay(500);
-        timeout -= 500;
-    }
-
-    if( timeout <= 0 )
+    /* The modem says "RDY" once it has started at a fixed baud rate, or
+     * answers "AT" once it has autobauded.
+     */
+    if( !Modem_wait_for_ready(MODEM_READY_RDY, &Modem_send_at, 500U, BOOT_TIMEOUT_MS) )
     {
         PRINTF("Timeout: No response to AT... last ditch attempt.\r\n");
         Modem_send_at();
@@ -467,8 +552,6 @@ static bool begin(void)
         osDelay(100);
     }
 
-    osDelay(1000);
-
     return true;
 }
 /******************************************************************************/
@@ -490,8 +573,6 @@ static bool registered_to_network(void)
 #if MODEM_IS_CELLULAR
     uint32_t status;
 
-    Modem_enable_network_registration();
-
     if( Modem_get_network_registration(&status) )
     {
         if( status == MODEM_NW_REG_JOINED_HOME )
@@ -507,9 +588,32 @@ static bool registered_to_network(void)
     return success;
 }
 /******************************************************************************/
+#if MODEM_HAS_GPS
+static bool gps_is_powered__(void)
+{
+    int32_t power;
+
+    return ( Modem_run_command_parse_reply_u32("AT+CGNSPWR?", "+CGNSPWR: ", &power, 0, SEARCH_OK|SEARCH_ERROR, 1000) ) &&
+           ( power == 1 );
+}
+#endif
+/******************************************************************************/
 static bool configure_link(void)
 {
-    Modem_enable_gprs(false);
+    if(s_keep_gprs_attached)
+    {
+        uint32_t status;
+
+        /* Just re-attach the PDP context -- the reply refreshes the cached
+         * attach state, so Modem_enable_gprs() skips AT+CGATT=1 if it can.
+         */
+        s_keep_gprs_attached = false;
+        (void) Modem_gprs_service_status(&status);
+    }
+    else
+    {
+        Modem_enable_gprs(false);
+    }
 
     if( !Modem_enable_gprs(true) )
     {
@@ -540,20 +644,93 @@ static bool configure_link(void)
 /******************************************************************************/
 static void check_conf__(void)
 {
+    if(s_link_opened)
+    {
+        s_link_opened   = false;
+        s_last_recovery = MODEM_RECOVER_NONE;
+    }
+
+
+    if(s_recovery_requested)
+    {
+        s_recovery_requested = false;
+        start_recovery__();
+    }
+
+
     if(s_restart_modem)
     {
-        AlcLogger_log_info("Modem restart requested -- restarting modem");
+        DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_RESTARTING);
         s_state = ST_SHUTDOWN;
     }
 
 
     if( ModemCtrl_check_conf_has_changed() )
     {
-        AlcLogger_log_info("Modem configuration has changed -- restarting modem");
+        DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_RESTARTING_FOR_CONF);
         s_state = ST_SHUTDOWN;
     }
 }
 /******************************************************************************/
+static void start_recovery__(void)
+{
+    ModemRecovery tier = (ModemRecovery) ( s_last_recovery + 1 );
+
+    if( tier >= NUM_MODEM_RECOVERY_TIERS )
+    {
+        tier = MODEM_RECOVER_HARD_RESET;
+    }
+
+    if(
+            ( tier < MODEM_RECOVER_HARD_RESET ) &&
+            ( !Modem_send_at() )
+    )
+    {
+        /* The modem is not answering -- only a hard reset will do */
+        tier = MODEM_RECOVER_HARD_RESET;
+    }
+
+    s_last_recovery = tier;
+    s_num_recoveries[tier]++;
+
+    switch(tier)
+    {
+    case MODEM_RECOVER_PDP:
+        DEFERRED_LOG(ALC_LOGGER_WARNING, LOG_ID_MODEM_RECOVERY_PDP);
+        s_keep_gprs_attached = true;
+
+        /* The "+CREG:" URC's keep the registration state up to date */
+        s_state = ( Modem_get_ready_flags() & MODEM_READY_REGISTERED ) ? ST_CONFIGURE_LINK : ST_JOINING_NETWORK;
+        break;
+
+    case MODEM_RECOVER_SOFT_RESET:
+        DEFERRED_LOG(ALC_LOGGER_WARNING, LOG_ID_MODEM_RECOVERY_SOFT_RESET);
+        s_state = ST_SOFT_RESET;
+        break;
+
+    default:
+        DEFERRED_LOG(ALC_LOGGER_WARNING, LOG_ID_MODEM_RECOVERY_HARD_RESET);
+        s_state = ST_SHUTDOWN;
+        break;
+    }
+}
+/******************************************************************************/
+/* Like osDelay(), but returns early when the modem has to be recovered or restarted */
+static void wait_while_running__(uint32_t timeout_ms)
+{
+    uint32_t start = HAL_GetTick();
+
+    while(
+            ( s_state == ST_RUNNING ) &&
+            ( !s_recovery_requested ) &&
+            ( !s_restart_modem ) &&
+            ( ( HAL_GetTick() - start ) < timeout_ms )
+    )
+    {
+        osDelay(READY_CHECK_MS);
+    }
+}
+/******************************************************************************/
 static bool is_connected__(void)
 {
     /**
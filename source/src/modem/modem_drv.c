@@ -0,0 +1,2304 @@
+/**
+ * @file  modem_drv.c
+ * @brief Modem driver -- the AT command engine shared by the modem modules
+ *
+ * @note
+ * Copyright (C) 2016, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * The command queue, the receive state machine, the readiness signals and
+ * the commands common to all the modules are here. The bearer and socket
+ * commands are in the driver of each module, and are called through the
+ * ModemDriverOps table of the driver that has been selected.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "modem_drv.h"
+#include "modem_drv_at.h"
+#include "modem_drv_conf.h"
+#include "modem_urc_matcher.h"
+#include "nv_settings.h"
+
+#include "alc_eat_string_tokens.h"
+#include "alc_test_char_seq.h"
+#include "cmsis_os.h"
+#include "FreeRTOS.h"
+#include "gpio.h"
+#include "http_server.h"
+#include "task.h"
+#include "uart6.h"
+
+
+#define DEBUG DEBUG_NONE
+#include "net-debug.h"
+
+
+#if DEBUG
+#include "uart3.h"
+#else
+#define UART3_write(...)                do { } while(0)
+#endif
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+static const uint8_t ASCII_LF = 0x0A;   /* LINE FEED           */
+static const uint8_t ASCII_CR = 0x0D;   /* CARRAGE RETURN      */
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+typedef enum
+{
+    RXST_IDLE = 0,
+    RXST_COMMAND,
+    RXST_GT,
+    RXST_TX_DATA,
+    RXST_TX_DATA_COMPLETE,
+    RXST_DATA_MODE
+} RxState;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+/** @brief How each final result code completes a command.
+ *
+ * A token only completes the running command when its search_mask bit is set
+ * in the command's search mask.
+ */
+static const struct {
+    uint32_t search_mask;
+    bool     result;
+    bool     data_channel_only;     /**< @brief Only for MODEM_CHANNEL_DATA_UPLOAD_CLIENT */
+} s_token_results[NUM_MODEM_TOKENS] = {
+    [MODEM_TOKEN_OK]        = { SEARCH_OK,       true,  false },
+    [MODEM_TOKEN_FAIL]      = { SEARCH_FAIL,     false, false },
+    [MODEM_TOKEN_ERROR]     = { SEARCH_ERROR,    false, false },
+    [MODEM_TOKEN_BUSY_P]    = { SEARCH_BUSY_P,   false, false },
+    [MODEM_TOKEN_SHUT_OK]   = { SEARCH_SHUT_OK,  true,  false },
+    [MODEM_TOKEN_CLOSE_OK]  = { SEARCH_CLOSE_OK, true,  true  },
+    [MODEM_TOKEN_CONNECT]   = { SEARCH_CONNECT,  true,  false },
+    [MODEM_TOKEN_CONNECT_OK] = { SEARCH_CONNECT, true,  true  },
+    [MODEM_TOKEN_CONNECT_FAIL] = { SEARCH_CONNECT, false, false },
+};
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+/** @brief The driver of the modem module that is fitted */
+static ModemDriverOps const *s_p_ops=&MODEM_DRV_DEFAULT_OPS;
+
+
+static struct {
+    RxState   rx_state;
+
+    struct {
+        char const *command_str;
+        uint32_t    search_mask;
+        bool (*fn)(char const *str);
+        bool        result;
+        bool        active;
+        bool        escaping;       /**< @brief Command is the "+++" escape from data mode */
+        uint8_t     channel;        /**< @brief Channel of the data sent by the command */
+
+
+        struct {
+            uint32_t tx_bufflen;
+            uint32_t tx_count;
+            bool ready_to_send;
+        } tx_data;
+    } current_command;
+
+
+    volatile uint32_t num_errors;
+
+    volatile bool tcp_link_is_open;
+
+    volatile bool echo_enabled;         /**< @brief Modem echoes commands (ATE1) */
+    volatile bool transparent_mode;     /**< @brief Use AT+CIPMODE=1 when GPRS is next enabled */
+    volatile bool data_mode;            /**< @brief Modem is in transparent data mode */
+    bool          skip_data_lf;         /**< @brief Next LF ends the "CONNECT" line -- it is not data */
+    volatile bool quick_send;           /**< @brief Use AT+CIPQSEND=1 when GPRS is next enabled */
+    uint32_t      last_data_tx_time;    /**< @brief When data was last written in data mode */
+    uint32_t      last_data_rx_time;    /**< @brief When data was last received in data mode */
+    uint32_t      num_held;             /**< @brief Received bytes held back as the start of a "CLOSED" line */
+    bool          is_held_after_gap;    /**< @brief The held bytes came after the guard time of silence */
+    bool          is_link_suspect;      /**< @brief Data mode had a "CLOSED" line that may have been the modem's */
+    bool          is_checking_link;     /**< @brief Left data mode to find out if the link is still open */
+    volatile uint32_t ready_flags;      /**< @brief MODEM_READY_xxx signals seen since the last hard reset */
+} s_task_data;
+
+
+static AlcTestCharSeq s_current_command;
+
+/** @brief Matcher for the result codes and URC's in the line being received */
+static ModemUrcMatcher s_urc;
+
+
+/** @brief What the modem sends in data mode when the link is closed */
+static char const s_closed_line[] = "\r\nCLOSED\r\n";
+
+
+/** @brief The queue of commands waiting to be run by the driver task.
+ *
+ * Commands are added by any task with Modem_submit_command(), and are only
+ * started, monitored and completed by ModemDrv_task(). The driver holds a
+ * command only while is_servicing is set, so a submitter that gives up
+ * waiting can take its command back (see abandon_command__()) between
+ * services.
+ */
+static struct {
+    ModemCommand *p_entries[MODEM_CMD_QUEUE_SIZE];
+    uint32_t      count;            /**< @brief Number of commands waiting */
+    uint32_t      next_order;       /**< @brief Order stamp for next command */
+    ModemCommand *p_running;        /**< @brief The command being run (NULL if none) */
+    uint32_t      start_time;       /**< @brief When the running command was started */
+    ModemCommand *p_deferred;       /**< @brief Command waiting for data mode to be left or resumed */
+    bool          is_servicing;     /**< @brief Set while the driver task is servicing the queue */
+    bool          is_running_abandoned; /**< @brief The submitter gave up on the running command */
+    osThreadId    driver;           /**< @brief The driver task, woken when a command is submitted */
+} s_cmd_queue;
+
+
+/** @brief Commands used by the driver to leave and resume transparent data mode */
+static ModemCommand s_escape_cmd;
+static ModemCommand s_resume_cmd;
+
+
+/** @brief The handle for the TCP receive queue belonging to the data-upload-client */
+extern osMessageQId g_data_upload_client_rx_queueHandle;
+
+
+/* @brief The mutex object
+ * @note This object is created in freertos.c
+ *
+ * Commands are sequenced by the command queue, so the mutex does not guard
+ * the modem itself (Modem_run_command_ex() does not take it). It is the lock
+ * handed out by ModemDrvAt_acquire() / ModemDrvAt_release(), which guards:
+ *  - the static reply-parser state of the query functions below
+ *    (Modem_run_command_parse_reply_u32(), Modem_get_rtc()), and
+ *  - the static reply-parser state of the module drivers, and their command
+ *    sequences that must not be interleaved (e.g. opening a link).
+ */
+extern osMutexId g_modem_drv_mutexHandle;
+
+
+
+
+/** @brief Data counts for each channel (reset when the channel is opened)
+ */
+static volatile struct {
+    uint32_t sent;      /**< @brief Bytes accepted by the modem */
+    uint32_t acked;     /**< @brief Bytes acknowledged by the server (from the driver's tcp_get_acked) */
+    bool     is_udp;    /**< @brief Opened by Modem_udp_open() */
+} s_tcp_channel[MODEM_DRV_AT_MAX_CHANNELS];
+
+
+/** @brief Var used by Modem_get_rtc() function
+ */
+static volatile struct {
+    uint32_t year;
+    uint32_t month;
+    uint32_t day;
+    uint32_t hours;
+    uint32_t minutes;
+    uint32_t seconds;
+    bool     success;
+} s_get_rtc_data;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static bool check_get_rtc_reply__(char const *str);
+static bool wait_for_send_window__(uint8_t channel, uint32_t bufflen, uint32_t window, uint32_t timeout_ms);
+static void add_sent_count__(uint32_t channel, uint32_t count);
+static bool run_command_ex__(char const *command_str, uint32_t search_mask, bool (*fn)(char const *str), uint8_t const* p_tx_buff, uint32_t tx_bufflen, uint32_t timeout_ms, ModemCmdPriority priority);
+static ModemCommand* dequeue_command__(void);
+static void complete_command__(ModemCommand *p_cmd, bool result);
+static bool abandon_command__(ModemCommand *p_cmd);
+static void service_command_queue__(void);
+static uint32_t rx_wait_ms__(void);
+static void wake_driver__(void);
+static void write_tx_data__(ModemCommand const *p_cmd);
+static ModemCommand* check_data_mode__(ModemCommand *p_cmd);
+static void escape_complete__(ModemCommand *p_cmd, bool result);
+static void resume_complete__(ModemCommand *p_cmd, bool result);
+static bool start_command(char const *command_str, uint32_t search_mask, bool (*fn)(char const *str), uint32_t tx_bufflen, uint32_t flags);
+static void process_rx_char__(uint8_t ch);
+static void process_urc__(ModemToken token);
+static bool ops_are_valid__(ModemDriverOps const *p_ops);
+static void modem_restarted__(void);
+static void complete_on_token__(ModemToken token);
+static void receive_data__(uint32_t channel, uint32_t numbytes, uint32_t num_skip);
+static void forward_rx_data__(uint32_t channel, uint8_t ch);
+static void receive_data_mode_char__(uint8_t ch);
+static void check_held_data__(void);
+static inline bool closed_line_is_held__(void);
+static void release_held_data__(void);
+static void data_mode_link_closed__(void);
+static uint32_t urc_channel__(void);
+static inline RxState idle_rx_state__(void);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+
+
+
+static uint8_t  replybuffer[255];
+static uint16_t replybuffer_inp=0U;
+
+/******************************************************************************/
+static inline void ReplyBuffer_reset(void)
+{
+    replybuffer[0]  = '\0';
+    replybuffer_inp = 0U;
+}
+/******************************************************************************/
+static inline void ReplyBuffer_push_back(uint8_t ch)
+{
+    if( replybuffer_inp < ( sizeof(replybuffer) - 2 ) )
+    {
+        replybuffer[replybuffer_inp] = ch;
+        replybuffer_inp++;
+        replybuffer[replybuffer_inp] = '\0';
+    }
+}
+/******************************************************************************/
+
+
+
+
+/******************************************************************************/
+bool Modem_select_driver(ModemDriverOps const *p_ops)
+{
+    if( ops_are_valid__(p_ops) )
+    {
+        s_p_ops = p_ops;
+        return true;
+    }
+
+    return false;
+}
+/******************************************************************************/
+ModemDriverOps const* Modem_get_driver(void)
+{
+    return s_p_ops;
+}
+/******************************************************************************/
+
+
+
+
+/******************************************************************************/
+bool Modem_run_command(char const *command_str, uint32_t search_mask, uint32_t timeout_ms)
+{
+    return Modem_run_command_ex(command_str, search_mask, NULL, NULL, 0U, timeout_ms);
+}
+/******************************************************************************/
+bool Modem_run_command_tx_data(char const *command_str, uint32_t search_mask, uint8_t const* p_tx_buff, uint32_t tx_bufflen, uint32_t timeout_ms)
+{
+    return Modem_run_command_ex(command_str, search_mask, NULL, p_tx_buff, tx_bufflen, timeout_ms);
+}
+/******************************************************************************/
+
+
+
+
+/******************************************************************************/
+bool Modem_submit_command(ModemCommand *p_cmd)
+{
+    bool success=false;
+
+    if(
+            ( p_cmd ) &&
+            (
+                    ( p_cmd->command_str ) ||
+                    ( p_cmd->flags & MODEM_CMD_FLAG_RAW_DATA )
+            )
+    )
+    {
+        p_cmd->is_done = false;
+        p_cmd->result  = false;
+        p_cmd->waiter  = osThreadGetId();
+
+        if( ( p_cmd->p_tx_buff == NULL ) && ( p_cmd->p_iov == NULL ) )
+        {
+            p_cmd->tx_bufflen = 0U;
+        }
+
+        taskENTER_CRITICAL();
+
+        if( s_cmd_queue.count < MODEM_CMD_QUEUE_SIZE )
+        {
+            p_cmd->order = s_cmd_queue.next_order++;
+            s_cmd_queue.p_entries[s_cmd_queue.count] = p_cmd;
+            s_cmd_queue.count++;
+            success = true;
+        }
+
+        taskEXIT_CRITICAL();
+
+        if(success)
+        {
+            wake_driver__();
+        }
+        else
+        {
+            PRINTF("ModemDrv - command queue is full\r\n");
+            s_task_data.num_errors++;
+        }
+    }
+
+    return success;
+}
+/******************************************************************************/
+bool Modem_wait_command(ModemCommand *p_cmd)
+{
+    /* The driver completes a command once it has run (worst case when it
+     * times out), but it may have to wait behind others first -- or the
+     * driver task may be stuck -- so the wait is bounded too.
+     */
+    if(p_cmd)
+    {
+        uint32_t start   = osKernelSysTick();
+        uint32_t wait_ms = p_cmd->timeout_ms + MODEM_CMD_WAIT_MARGIN_MS;
+
+        while( !__atomic_load_n(&p_cmd->is_done, __ATOMIC_ACQUIRE) )
+        {
+            uint32_t elapsed = osKernelSysTick() - start;
+
+            if( elapsed < wait_ms )
+            {
+                osSignalWait(MODEM_CMD_DONE_SIGNAL, ( wait_ms - elapsed ));
+            }
+            else if( abandon_command__(p_cmd) )
+            {
+                PRINTF("ModemDrv - gave up waiting for command\r\n");
+                s_task_data.num_errors++;
+                return false;
+            }
+            else
+            {
+                /* The driver is using it -- it will be done with it shortly */
+                osSignalWait(MODEM_CMD_DONE_SIGNAL, 1U);
+            }
+        }
+
+        return p_cmd->result;
+    }
+
+    return false;
+}
+/******************************************************************************/
+uint32_t Modem_get_queue_length(void)
+{
+    return s_cmd_queue.count;
+}
+/******************************************************************************/
+
+
+
+
+static struct {
+    char const *p_search_str;
+    uint32_t    search_str_len;
+    int32_t     num;
+    uint32_t    index;
+    bool        success;
+} volatile s_run_command_parse_reply={0U};
+
+
+static bool check_run_command_parse_reply(char const *str)
+{
+    if(
+            ( s_run_command_parse_reply.p_search_str ) &&
+            ( s_run_command_parse_reply.search_str_len > 0U ) &&
+            ( strncmp(str, s_run_command_parse_reply.p_search_str, s_run_command_parse_reply.search_str_len) == 0 )
+    )
+    {
+        str=&str[s_run_command_parse_reply.search_str_len];
+
+        PRINTF("STR = %s\r\n", str);
+
+        s_run_command_parse_reply.num     = 0;
+        s_run_command_parse_reply.success = false;
+
+        uint32_t temp_u32;
+
+        for(uint32_t ii=0U; ii<=s_run_command_parse_reply.index; ii++)
+        {
+            if( !eat_u32(&str, &temp_u32) )
+            {
+                break;
+            }
+            else if(ii == s_run_command_parse_reply.index )
+            {
+                // success -- got it
+                s_run_command_parse_reply.num     = temp_u32;
+                s_run_command_parse_reply.success = true;
+                break;
+            }
+            else if( !eat_char(&str, ',') )
+            {
+                // failed
+            }
+            else
+            {
+                // carry on with next number
+            }
+        }
+    }
+
+    return true;
+}
+
+
+
+
+bool Modem_run_command_parse_reply_u32(
+        char const *command_str,
+        char const *p_search_str,
+        int32_t    *p_num,
+        uint32_t    index,
+        uint32_t search_mask,
+        uint32_t timeout_ms)
+{
+    bool success=false;
+
+    if(
+            (command_str) &&
+            (p_search_str)
+    )
+    {
+        if( ModemDrvAt_acquire(timeout_ms) )
+        {
+            s_run_command_parse_reply.p_search_str = p_search_str;
+            s_run_command_parse_reply.search_str_len = strlen(p_search_str);
+            s_run_command_parse_reply.index = index;
+            s_run_command_parse_reply.num = 0;
+
+            if( run_command_ex__(command_str, search_mask, &check_run_command_parse_reply, NULL, 0U, timeout_ms, MODEM_CMD_PRIORITY_URGENT) )
+            {
+                success = s_run_command_parse_reply.success;
+            }
+
+            if(p_num)
+            {
+                *p_num = s_run_command_parse_reply.num;
+            }
+
+            ModemDrvAt_release();
+        }
+    }
+
+    return success;
+}
+/******************************************************************************/
+bool Modem_run_command_ex(char const *command_str, uint32_t search_mask, bool (*fn)(char const *str), uint8_t const* p_tx_buff, uint32_t tx_bufflen, uint32_t timeout_ms)
+{
+    /* Commands are sequenced by the driver's queue -- no need for the mutex */
+    return run_command_ex__(command_str, search_mask, fn, p_tx_buff, tx_bufflen, timeout_ms, MODEM_CMD_PRIORITY_NORMAL);
+}
+/******************************************************************************/
+void Modem_hard_reset(void)
+{
+    HAL_GPIO_WritePin(MODEM_RST_GPIO_Port, MODEM_RST_Pin, GPIO_PIN_RESET);
+    osDelay(500);
+    HAL_GPIO_WritePin(MODEM_RST_GPIO_Port, MODEM_RST_Pin, GPIO_PIN_SET);
+
+    /* The modem starts up in command mode with echo on */
+    modem_restarted__();
+}
+/******************************************************************************/
+uint32_t Modem_get_ready_flags(void)
+{
+    return s_task_data.ready_flags;
+}
+/******************************************************************************/
+bool Modem_wait_for_ready(uint32_t flags, bool (*poll_fn)(void), uint32_t max_poll_ms, uint32_t timeout_ms)
+{
+    uint32_t start   = osKernelSysTick();
+    uint32_t poll_ms = MODEM_READY_POLL_MIN_MS;
+    uint32_t poll_at = start;
+
+    for(;;)
+    {
+        if(
+                ( flags != 0U ) &&
+                ( ( s_task_data.ready_flags & flags ) == flags )
+        )
+        {
+            return true;
+        }
+
+        if(
+                ( poll_fn ) &&
+                ( (int32_t) ( osKernelSysTick() - poll_at ) >= 0 )
+        )
+        {
+            if( poll_fn() )
+            {
+                return true;
+            }
+
+            poll_at = osKernelSysTick() + poll_ms;
+            poll_ms = ( ( 2U * poll_ms ) < max_poll_ms ) ? ( 2U * poll_ms ) : max_poll_ms;
+        }
+
+        if( ( osKernelSysTick() - start ) >= timeout_ms )
+        {
+            return false;
+        }
+
+        osDelay(MODEM_READY_CHECK_MS);
+    }
+}
+/******************************************************************************/
+bool Modem_soft_reset(void)
+{
+    return s_p_ops->soft_reset();
+}
+/******************************************************************************/
+bool Modem_send_at(void)
+{
+    return Modem_run_command("AT", SEARCH_OK, 100);
+}
+/******************************************************************************/
+bool Modem_enable_network_registration(void)
+{
+    return s_p_ops->enable_network_registration();
+}
+/******************************************************************************/
+bool Modem_get_network_registration(uint32_t *p_status)
+{
+    if(p_status)
+    {
+        *p_status=0U;
+    }
+
+    return s_p_ops->get_network_registration(p_status);
+}
+/******************************************************************************/
+bool Modem_gprs_service_status(uint32_t *p_status)
+{
+    if(p_status)
+    {
+        *p_status=0U;
+    }
+
+    return Modem_run_command_parse_reply_u32(
+            "AT+CGATT?",
+            "+CGATT: ",
+            p_status,
+            0,
+            SEARCH_OK|SEARCH_ERROR,
+            1000);
+}
+/******************************************************************************/
+bool Modem_get_sim_ccid(void)
+{
+    return Modem_run_command("AT+CCID", SEARCH_OK|SEARCH_ERROR, 10000);
+}
+/******************************************************************************/
+bool Modem_is_password_required(void)
+{
+    return Modem_run_command("AT+CPIN?", SEARCH_OK|SEARCH_ERROR, 10000);
+}
+/******************************************************************************/
+bool Modem_unlock_sim(char const *p_pin)
+{
+    bool success=false;
+
+    if( (p_pin) && ( strlen(p_pin) == 4 ) )
+    {
+        char send_buff[14];
+
+        snprintf(send_buff, sizeof(send_buff), "AT+CPIN=%s", p_pin);
+
+        success = Modem_run_command(send_buff, SEARCH_OK|SEARCH_ERROR, 10000);
+    }
+
+    return success;
+}
+/******************************************************************************/
+bool Modem_enable_gprs(bool on_off)
+{
+    return s_p_ops->enable_gprs(on_off);
+}
+/******************************************************************************/
+double Modem_get_signal_strength(void)
+{
+    uint32_t rssi;
+
+    if( Modem_run_command_parse_reply_u32(
+            "AT+CSQ",
+            "+CSQ: ",
+            &rssi,
+            0,
+            SEARCH_OK|SEARCH_ERROR,
+            1000) )
+    {
+        double sig_strength = (double) rssi;
+
+        sig_strength *= 2.0f;
+        sig_strength -= 115.0f;
+
+        return sig_strength;
+    }
+
+    return 0.0f;
+}
+/******************************************************************************/
+bool Modem_get_ip_addr(char *dest, size_t destlen)
+{
+    return s_p_ops->get_ip_addr(dest, destlen);
+}
+/******************************************************************************/
+bool Modem_set_echo(bool on_off)
+{
+    bool success = Modem_run_command( ( on_off ? "ATE1" : "ATE0" ), SEARCH_OK | SEARCH_ERROR, 1000);
+
+    if(success)
+    {
+        s_task_data.echo_enabled = on_off;
+    }
+
+    return success;
+}
+/******************************************************************************/
+void Modem_set_transparent_mode(bool enable)
+{
+    s_task_data.transparent_mode = ( enable ) && ( s_p_ops->has_transparent_mode );
+}
+/******************************************************************************/
+bool Modem_transparent_mode_is_enabled(void)
+{
+    return s_task_data.transparent_mode;
+}
+/******************************************************************************/
+void Modem_set_quick_send(bool enable)
+{
+    s_task_data.quick_send = enable;
+}
+/******************************************************************************/
+bool Modem_quick_send_is_enabled(void)
+{
+    return s_task_data.quick_send;
+}
+/******************************************************************************/
+bool Modem_tcp_write_buff(uint8_t channel, char const *p_buff, uint32_t bufflen, uint32_t timeout_ms)
+{
+    ModemIoVec iov;
+
+    iov.p_base = p_buff;
+    iov.len    = bufflen;
+
+    if( p_buff )
+    {
+        return Modem_tcp_write_iov(channel, &iov, 1U, timeout_ms);
+    }
+
+    return false;
+}
+/******************************************************************************/
+bool Modem_tcp_write_iov(uint8_t channel, ModemIoVec const *p_iov, uint32_t iovcnt, uint32_t timeout_ms)
+{
+    bool     success=false;
+    uint32_t bufflen=0U;
+
+    if( p_iov )
+    {
+        for(uint32_t ii=0U; ii<iovcnt; ii++)
+        {
+            if( ( p_iov[ii].p_base == NULL ) && ( p_iov[ii].len > 0U ) )
+            {
+                return false;
+            }
+
+            bufflen += p_iov[ii].len;
+        }
+    }
+
+    if( ( channel < s_p_ops->num_channels ) && (p_iov) && (bufflen>0U) )
+    {
+        char         str[25];
+        ModemCommand cmd;
+
+        PRINTF("Modem_tcp_write_iov(%u, %u, %u) \r\n", channel, iovcnt, bufflen);
+
+        memset(&cmd, 0, sizeof(cmd));
+
+        cmd.p_iov      = p_iov;
+        cmd.iovcnt     = iovcnt;
+        cmd.tx_bufflen = bufflen;
+        cmd.timeout_ms = timeout_ms;
+        cmd.priority   = MODEM_CMD_PRIORITY_BULK;
+        cmd.channel    = channel;
+
+        if( s_task_data.transparent_mode )
+        {
+            /* No AT command needed -- the data is written straight to the
+             * modem while it is in data mode.
+             */
+            cmd.flags = MODEM_CMD_FLAG_RAW_DATA;
+
+            if( ( channel == MODEM_CHANNEL_DATA_UPLOAD_CLIENT ) && ( Modem_submit_command(&cmd) ) )
+            {
+                success = Modem_wait_command(&cmd);
+            }
+
+            return success;
+        }
+
+        if(
+                ( s_task_data.quick_send ) &&
+                ( !s_tcp_channel[channel].is_udp ) &&
+                ( !wait_for_send_window__(channel, bufflen, s_p_ops->send_window, timeout_ms) )
+        )
+        {
+            /* Too much data is still waiting to be acknowledged */
+            PRINTF("Modem_tcp_write_iov -- send window did not open\r\n");
+            return false;
+        }
+
+        snprintf(str, sizeof(str), s_p_ops->send_fmt, channel, bufflen );
+
+        /* Bulk data is queued at the lowest priority, so control commands
+         * from other tasks can run between sends.
+         */
+        cmd.command_str = str;
+        cmd.search_mask = SEARCH_BUSY_P;
+
+        if( Modem_submit_command(&cmd) )
+        {
+            success = Modem_wait_command(&cmd);
+        }
+
+        if(
+                ( success ) &&
+                ( s_p_ops->buffers_sends ) &&
+                ( !s_task_data.quick_send ) &&
+                ( !s_tcp_channel[channel].is_udp )
+        )
+        {
+            /* The module only has the data -- wait (with a window of 0)
+             * until the server has acknowledged it.
+             */
+            success = wait_for_send_window__(channel, 0U, 0U, timeout_ms);
+        }
+    }
+
+    return success;
+}
+/******************************************************************************/
+bool Modem_tcp_write_str(uint8_t channel, char const *p_str, uint32_t timeout_ms)
+{
+    if( p_str )
+    {
+        return Modem_tcp_write_buff(channel, p_str, strlen(p_str), timeout_ms);
+    }
+
+    return false;
+}
+/******************************************************************************/
+bool Modem_tcp_open(uint8_t channel, char const *server, uint16_t port, uint32_t timeout_ms)
+{
+    if( ( server ) && ( channel < s_p_ops->num_channels ) )
+    {
+        PRINTF("Modem_tcp_open(%u, %s, %u) \r\n", channel, server, port);
+
+        s_tcp_channel[channel].is_udp = false;
+
+        return s_p_ops->tcp_open(channel, server, port, timeout_ms);
+    }
+
+    return false;
+}
+/******************************************************************************/
+bool Modem_udp_open(uint8_t channel, char const *server, uint16_t port, uint32_t timeout_ms)
+{
+    if(
+            ( server ) &&
+            ( channel < s_p_ops->num_channels ) &&
+            ( s_p_ops->udp_open ) &&
+            ( !s_task_data.transparent_mode )
+    )
+    {
+        PRINTF("Modem_udp_open(%u, %s, %u) \r\n", channel, server, port);
+
+        s_tcp_channel[channel].is_udp = true;
+
+        return s_p_ops->udp_open(channel, server, port, timeout_ms);
+    }
+
+    return false;
+}
+/******************************************************************************/
+bool Modem_tcp_close(uint8_t channel, uint32_t timeout_ms)
+{
+    if( channel < s_p_ops->num_channels )
+    {
+        PRINTF("Modem_tcp_close(%u) \r\n", channel);
+
+        return s_p_ops->tcp_close(channel, timeout_ms);
+    }
+
+    return false;
+}
+/******************************************************************************/
+bool Modem_tcp_get_send_size(uint8_t channel, uint32_t *p_size, uint32_t timeout_ms)
+{
+    if( ( p_size ) && ( s_task_data.transparent_mode ) )
+    {
+        /* The size can't be asked for in transparent mode (and would force
+         * the modem out of data mode) -- so just report the state of the link.
+         */
+        bool success = ( s_task_data.tcp_link_is_open ) && ( channel == MODEM_CHANNEL_DATA_UPLOAD_CLIENT );
+
+        *p_size = (success) ? MODEM_TRANSPARENT_SEND_SIZE : 0U;
+
+        return success;
+    }
+    else if( ( p_size ) && ( channel < s_p_ops->num_channels ) )
+    {
+        *p_size = 0U;
+
+        return s_p_ops->tcp_get_send_size(channel, p_size, timeout_ms);
+    }
+
+    return false;
+}
+/******************************************************************************/
+bool Modem_tcp_update_ack(uint8_t channel, uint32_t timeout_ms)
+{
+    uint32_t acked;
+
+    if(
+            ( channel < s_p_ops->num_channels ) &&
+            ( !s_task_data.transparent_mode ) &&
+            ( s_p_ops->tcp_get_acked(channel, &acked, timeout_ms) )
+    )
+    {
+        s_tcp_channel[channel].acked = acked;
+        return true;
+    }
+
+    return false;
+}
+/******************************************************************************/
+uint32_t Modem_tcp_get_sent(uint8_t channel)
+{
+    return ( channel < s_p_ops->num_channels ) ? s_tcp_channel[channel].sent : 0U;
+}
+/******************************************************************************/
+uint32_t Modem_tcp_get_acked(uint8_t channel)
+{
+    return ( channel < s_p_ops->num_channels ) ? s_tcp_channel[channel].acked : 0U;
+}
+/******************************************************************************/
+static bool check_get_rtc_reply__(char const *str)
+{
+    /** Expect the line to be '+CCLK: "yy/mm/dd,hh:mm:ss+oo"'
+     */
+    if(
+            ( strncmp(str, "+CCLK: ", 7) == 0 )
+    )
+    {
+        str=&str[7];
+
+        PRINTF("STR = %s\r\n", str);
+
+        s_get_rtc_data.success = false;
+
+
+        bool success=true;
+
+        success &= eat_char(&str, '\"');
+        success &= eat_u32(&str, &s_get_rtc_data.year);
+        success &= eat_char(&str, '/');
+        success &= eat_u32(&str, &s_get_rtc_data.month);
+        success &= eat_char(&str, '/');
+        success &= eat_u32(&str, &s_get_rtc_data.day);
+        success &= eat_comma(&str);
+        success &= eat_u32(&str, &s_get_rtc_data.hours);
+        success &= eat_char(&str, ':');
+        success &= eat_u32(&str, &s_get_rtc_data.minutes);
+        success &= eat_char(&str, ':');
+        success &= eat_u32(&str, &s_get_rtc_data.seconds);
+
+        s_get_rtc_data.success = success;
+    }
+
+    return true;
+}
+/******************************************************************************/
+bool Modem_get_rtc(uint32_t *p_timestamp)
+{
+    bool success=false;
+
+    if(p_timestamp)
+    {
+        if( ModemDrvAt_acquire(1000U) )
+        {
+            s_get_rtc_data.success = false;
+
+            if( run_command_ex__("AT+CCLK?", SEARCH_OK|SEARCH_ERROR, &check_get_rtc_reply__, NULL, 0U, 1000U, MODEM_CMD_PRIORITY_URGENT) )
+            {
+                if(s_get_rtc_data.success)
+                {
+                    success = true;
+                }
+
+            }
+
+            ModemDrvAt_release();
+
+
+            struct tm tm;
+
+            memset(&tm, 0, sizeof(tm));
+
+            tm.tm_year = s_get_rtc_data.year + 100;     /* tm_year is years since 1900  */
+            tm.tm_mon  = s_get_rtc_data.month - 1;      /* tm_mon range is 0 to 11 */
+            tm.tm_mday = s_get_rtc_data.day;
+            tm.tm_hour = s_get_rtc_data.hours;
+            tm.tm_min  = s_get_rtc_data.minutes;
+            tm.tm_sec  = s_get_rtc_data.seconds;
+
+            *p_timestamp = timegm(&tm);             /* See README.md if your system lacks timegm(). */
+        }
+
+        PRINTF("Get RTC = %u.%u.%u.%u.%u.%u (%u) (%lu)\r\n",
+                s_get_rtc_data.year,
+                s_get_rtc_data.month,
+                s_get_rtc_data.day,
+                s_get_rtc_data.hours,
+                s_get_rtc_data.minutes,
+                s_get_rtc_data.seconds,
+                s_get_rtc_data.success,
+                *p_timestamp);
+    }
+
+    return success;
+}
+/******************************************************************************/
+void ModemDrv_task(void const * argument)
+{
+    uint8_t ch;
+
+    memset(&s_task_data, 0, sizeof(s_task_data));
+    memset(&s_cmd_queue, 0, sizeof(s_cmd_queue));
+    s_cmd_queue.driver = osThreadGetId();
+
+    s_task_data.echo_enabled     = true;
+    s_task_data.transparent_mode = ( MODEM_UPLOAD_TRANSPARENT_MODE != 0 ) && ( s_p_ops->has_transparent_mode );
+    s_task_data.quick_send       = ( MODEM_TCP_QUICK_SEND != 0 );
+
+
+    /* "+++" -- needs the guard time either side, and no CR/LF */
+    memset(&s_escape_cmd, 0, sizeof(s_escape_cmd));
+    s_escape_cmd.command_str = "+++";
+    s_escape_cmd.search_mask = SEARCH_OK|SEARCH_ERROR;
+    s_escape_cmd.timeout_ms  = ( 2U * MODEM_TRANSPARENT_GUARD_MS ) + 500U;
+    s_escape_cmd.priority    = MODEM_CMD_PRIORITY_URGENT;
+    s_escape_cmd.flags       = MODEM_CMD_FLAG_NO_CRLF;
+    s_escape_cmd.on_complete = &escape_complete__;
+
+    memset(&s_resume_cmd, 0, sizeof(s_resume_cmd));
+    s_resume_cmd.command_str = "ATO";
+    s_resume_cmd.search_mask = SEARCH_CONNECT|SEARCH_ERROR;
+    s_resume_cmd.timeout_ms  = 5000U;
+    s_resume_cmd.priority    = MODEM_CMD_PRIORITY_URGENT;
+    s_resume_cmd.on_complete = &resume_complete__;
+
+
+    AlcTestCharSeq_clear(&s_current_command);
+
+    if( !ModemUrcMatcher_init() )
+    {
+        PRINTF("ModemDrv - URC matcher table is too big\r\n");
+        s_task_data.num_errors++;
+    }
+    ModemUrcMatcher_reset(&s_urc);
+
+    PRINTF("ModemDrv - %s driver\r\n", s_p_ops->name);
+
+    /* The Modem module is attached to UART6 */
+    UART6_start();
+
+    s_task_data.ready_flags = MODEM_READY_DRIVER;
+
+    for(;;)
+    {
+        /* Sleep until a character comes in, the next deadline is due or a
+         * command is submitted.
+         */
+        if( UART6_read( &ch, 1, rx_wait_ms__()) > 0 )
+        {
+            process_rx_char__(ch);
+        }
+
+        check_held_data__();
+
+        service_command_queue__();
+    }
+}
+/******************************************************************************/
+
+
+
+
+/******************************************************************************/
+bool ModemDrvAt_acquire(uint32_t timeout_ms)
+{
+    return ( osMutexWait(g_modem_drv_mutexHandle, timeout_ms) == osOK );
+}
+/******************************************************************************/
+void ModemDrvAt_release(void)
+{
+    osMutexRelease(g_modem_drv_mutexHandle);
+}
+/******************************************************************************/
+bool ModemDrvAt_run_command(char const *command_str, uint32_t search_mask, bool (*fn)(char const *str), uint32_t timeout_ms, ModemCmdPriority priority)
+{
+    return run_command_ex__(command_str, search_mask, fn, NULL, 0U, timeout_ms, priority);
+}
+/******************************************************************************/
+void ModemDrvAt_complete_command(bool result)
+{
+    s_task_data.current_command.result = result;
+    s_task_data.current_command.active = false;
+    s_task_data.rx_state = idle_rx_state__();
+}
+/******************************************************************************/
+void ModemDrvAt_set_ready_flag(uint32_t flag, bool is_set)
+{
+    /* Called from the driver task -- the other writers are the resets and
+     * Modem_enable_gprs(), between commands.
+     */
+    if(is_set)
+    {
+        s_task_data.ready_flags |= flag;
+    }
+    else
+    {
+        s_task_data.ready_flags &= ~flag;
+    }
+}
+/******************************************************************************/
+bool ModemDrvAt_poll_attached(void)
+{
+    uint32_t status;
+
+    return ( Modem_gprs_service_status(&status) ) && ( status != 0U );
+}
+/******************************************************************************/
+bool ModemDrvAt_cfun_reset(void)
+{
+    /* Full functionality, with a restart -- the modem says "RDY" again */
+    s_task_data.ready_flags &= MODEM_READY_DRIVER;
+
+    if( !Modem_run_command("AT+CFUN=1,1", SEARCH_OK|SEARCH_ERROR, 10000U) )
+    {
+        return false;
+    }
+
+    modem_restarted__();
+
+    return true;
+}
+/******************************************************************************/
+bool ModemDrvAt_build_apn_args(char *p_buff, uint32_t len)
+{
+    uint8_t apn[STORE_MODEM_STRING_MAXLEN + 1U];
+    uint8_t username[STORE_MODEM_STRING_MAXLEN + 1U];
+    uint8_t password[STORE_MODEM_STRING_MAXLEN + 1U];
+    int n;
+
+    if( ( p_buff == NULL ) || ( len == 0U ) )
+    {
+        return false;
+    }
+
+    /* A setting that has never been stored is left empty */
+    (void) Store_read_modem_apn_str(apn, sizeof(apn));
+    (void) Store_read_modem_username_str(username, sizeof(username));
+    (void) Store_read_modem_password_str(password, sizeof(password));
+
+    n = snprintf(p_buff, len, "\"%s\",\"%s\",\"%s\"", (char const*) apn, (char const*) username, (char const*) password);
+
+    return ( n > 0 ) && ( (uint32_t) n < len );
+}
+/******************************************************************************/
+bool ModemDrvAt_link_is_open(void)
+{
+    return s_task_data.tcp_link_is_open;
+}
+/******************************************************************************/
+bool ModemDrvAt_link_is_udp(uint32_t channel)
+{
+    return ( channel < MODEM_DRV_AT_MAX_CHANNELS ) && ( s_tcp_channel[channel].is_udp );
+}
+/******************************************************************************/
+void ModemDrvAt_link_opened(uint32_t channel)
+{
+    UART3_write("<<<<PORT OPEN>>>>", 17, 100);
+    s_task_data.tcp_link_is_open = true;
+
+    if( channel < MODEM_DRV_AT_MAX_CHANNELS )
+    {
+        s_tcp_channel[channel].sent  = 0U;
+        s_tcp_channel[channel].acked = 0U;
+    }
+
+    if( channel == MODEM_CHANNEL_DATA_UPLOAD_CLIENT )
+    {
+        /* The message is for the data-upload-client's channel
+         */
+        xQueueReset(g_data_upload_client_rx_queueHandle);
+        HttpServer_connection_opened();
+    }
+}
+/******************************************************************************/
+void ModemDrvAt_link_closed(uint32_t channel)
+{
+    UART3_write("<<<<PORT CLOSED>>>>", 19, 100);
+    s_task_data.tcp_link_is_open = false;
+    s_task_data.data_mode        = false;
+
+    if( channel == MODEM_CHANNEL_DATA_UPLOAD_CLIENT )
+    {
+        /* The message is for the data-upload-client's channel
+         */
+        HttpServer_connection_closed();
+    }
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static bool run_command_ex__(char const *command_str, uint32_t search_mask, bool (*fn)(char const *str), uint8_t const* p_tx_buff, uint32_t tx_bufflen, uint32_t timeout_ms, ModemCmdPriority priority)
+{
+    ModemCommand cmd;
+
+    memset(&cmd, 0, sizeof(cmd));
+
+    cmd.command_str = command_str;
+    cmd.search_mask = search_mask;
+    cmd.fn          = fn;
+    cmd.p_tx_buff   = p_tx_buff;
+    cmd.tx_bufflen  = tx_bufflen;
+    cmd.timeout_ms  = timeout_ms;
+    cmd.priority    = priority;
+
+    if( Modem_submit_command(&cmd) )
+    {
+        return Modem_wait_command(&cmd);
+    }
+
+    return false;
+}
+/******************************************************************************/
+static ModemCommand* dequeue_command__(void)
+{
+    ModemCommand *p_cmd=NULL;
+
+    taskENTER_CRITICAL();
+
+    if( s_cmd_queue.count > 0U )
+    {
+        uint32_t best=0U;
+
+        /* Find the highest priority command, and the oldest of those */
+        for(uint32_t ii=1U; ii<s_cmd_queue.count; ii++)
+        {
+            ModemCommand const *p_iter = s_cmd_queue.p_entries[ii];
+            ModemCommand const *p_best = s_cmd_queue.p_entries[best];
+
+            if(
+                    ( p_iter->priority > p_best->priority ) ||
+                    (
+                            ( p_iter->priority == p_best->priority ) &&
+                            ( ( (int32_t) ( p_iter->order - p_best->order ) ) < 0 )
+                    )
+            )
+            {
+                best = ii;
+            }
+        }
+
+        p_cmd = s_cmd_queue.p_entries[best];
+
+        /* remove it -- order is kept by the 'order' stamp, not the position */
+        s_cmd_queue.count--;
+        s_cmd_queue.p_entries[best] = s_cmd_queue.p_entries[s_cmd_queue.count];
+        s_cmd_queue.p_entries[s_cmd_queue.count] = NULL;
+    }
+
+    taskEXIT_CRITICAL();
+
+    return p_cmd;
+}
+/******************************************************************************/
+static void complete_command__(ModemCommand *p_cmd, bool result)
+{
+    /* Take a copy of the waiter -- once is_done is set the submitter may
+     * reuse (or discard) the descriptor, so the callback runs before it is set.
+     */
+    osThreadId waiter = p_cmd->waiter;
+
+    p_cmd->result = result;
+
+    if(p_cmd->on_complete)
+    {
+        p_cmd->on_complete(p_cmd, result);
+    }
+
+    __atomic_store_n(&p_cmd->is_done, true, __ATOMIC_RELEASE);
+
+    if(waiter)
+    {
+        osSignalSet(waiter, MODEM_CMD_DONE_SIGNAL);
+    }
+}
+/******************************************************************************/
+/* Take a command back from the driver, if it is not using it right now.
+ * Called by the submitter, when it gives up waiting for the command.
+ */
+static bool abandon_command__(ModemCommand *p_cmd)
+{
+    bool is_abandoned=false;
+
+    taskENTER_CRITICAL();
+
+    if( !s_cmd_queue.is_servicing )
+    {
+        is_abandoned = true;
+
+        if( s_cmd_queue.p_running == p_cmd )
+        {
+            /* The driver task drops what is left of it on its next service */
+            s_cmd_queue.p_running = NULL;
+            s_cmd_queue.is_running_abandoned = true;
+        }
+        else if( s_cmd_queue.p_deferred == p_cmd )
+        {
+            s_cmd_queue.p_deferred = NULL;
+        }
+        else
+        {
+            for(uint32_t ii=0U; ii<s_cmd_queue.count; ii++)
+            {
+                if( s_cmd_queue.p_entries[ii] == p_cmd )
+                {
+                    s_cmd_queue.count--;
+                    s_cmd_queue.p_entries[ii] = s_cmd_queue.p_entries[s_cmd_queue.count];
+                    s_cmd_queue.p_entries[s_cmd_queue.count] = NULL;
+                    break;
+                }
+            }
+        }
+    }
+
+    taskEXIT_CRITICAL();
+
+    if(is_abandoned)
+    {
+        wake_driver__();
+    }
+
+    return is_abandoned;
+}
+/******************************************************************************/
+static void service_command_queue__(void)
+{
+    ModemCommand *p_cmd;
+
+    taskENTER_CRITICAL();
+    s_cmd_queue.is_servicing = true;
+    p_cmd = s_cmd_queue.p_running;
+    taskEXIT_CRITICAL();
+
+    if( s_cmd_queue.is_running_abandoned )
+    {
+        /* The submitter gave up waiting -- drop what is left of the command */
+        s_cmd_queue.is_running_abandoned = false;
+        s_task_data.rx_state = idle_rx_state__();
+        s_task_data.current_command.tx_data.ready_to_send = false;
+        s_task_data.current_command.result = false;
+        s_task_data.current_command.active = false;
+    }
+
+    if( p_cmd )
+    {
+        /****************************************************************
+         * A command is running
+         ***************************************************************/
+        if( s_task_data.current_command.tx_data.ready_to_send )
+        {
+            PRINTF("ModemDrv - sending data\r\n");
+            s_task_data.current_command.tx_data.ready_to_send = false;
+            write_tx_data__(p_cmd);
+        }
+
+        if(
+                ( s_task_data.current_command.active ) &&
+                ( p_cmd->timeout_ms > 0U ) &&
+                ( ( osKernelSysTick() - s_cmd_queue.start_time ) >= p_cmd->timeout_ms )
+        )
+        {
+            PRINTF("ModemDrv - Timeout waiting for command to complete\r\n");
+            s_task_data.num_errors++;
+            s_task_data.rx_state = idle_rx_state__();
+            s_task_data.current_command.result = false;
+            s_task_data.current_command.active = false;
+        }
+
+        if( !s_task_data.current_command.active )
+        {
+            s_cmd_queue.p_running = NULL;
+            complete_command__(p_cmd, s_task_data.current_command.result);
+        }
+    }
+
+
+    if( s_cmd_queue.p_running == NULL )
+    {
+        /****************************************************************
+         * Driver is free -- start the next command
+         ***************************************************************/
+        p_cmd = s_cmd_queue.p_deferred;
+        s_cmd_queue.p_deferred = NULL;
+
+        if( p_cmd == NULL )
+        {
+            p_cmd = dequeue_command__();
+        }
+
+        if(p_cmd)
+        {
+            p_cmd = check_data_mode__(p_cmd);
+        }
+
+        if(p_cmd)
+        {
+            if( start_command(p_cmd->command_str, p_cmd->search_mask, p_cmd->fn, p_cmd->tx_bufflen, p_cmd->flags) )
+            {
+                s_task_data.current_command.channel = p_cmd->channel;
+                s_cmd_queue.start_time = osKernelSysTick();
+                s_cmd_queue.p_running  = p_cmd;
+            }
+            else
+            {
+                complete_command__(p_cmd, false);
+            }
+        }
+    }
+
+    taskENTER_CRITICAL();
+    s_cmd_queue.is_servicing = false;
+    taskEXIT_CRITICAL();
+}
+/******************************************************************************/
+/* How long the driver task can wait for a character before it has something
+ * else to do: until the running command times out, the guard time before
+ * leaving data mode is up, or the bytes held back in data mode are due. With
+ * nothing to time it waits for a character or for a command to be submitted.
+ */
+static uint32_t rx_wait_ms__(void)
+{
+    uint32_t      wait_ms = MODEM_DRV_RX_WAIT_MS;
+    uint32_t      now     = osKernelSysTick();
+    ModemCommand *p_running;
+    bool          is_waiting;
+
+    if( osSignalWait(MODEM_DRV_WAKE_SIGNAL, 0U).status == osEventSignal )
+    {
+        /* A command was submitted (or given up on) since the last service */
+        return 0U;
+    }
+
+    taskENTER_CRITICAL();
+    p_running  = s_cmd_queue.p_running;
+    is_waiting = ( s_cmd_queue.p_deferred != NULL ) || ( s_cmd_queue.count > 0U ) || ( s_cmd_queue.is_running_abandoned );
+    taskEXIT_CRITICAL();
+
+    if( p_running )
+    {
+        if( s_task_data.current_command.tx_data.ready_to_send )
+        {
+            wait_ms = 0U;
+        }
+        else if(
+                ( s_task_data.current_command.active ) &&
+                ( p_running->timeout_ms > 0U )
+        )
+        {
+            uint32_t elapsed = now - s_cmd_queue.start_time;
+            uint32_t left    = ( elapsed < p_running->timeout_ms ) ? ( p_running->timeout_ms - elapsed ) : 0U;
+
+            wait_ms = ( left < wait_ms ) ? left : wait_ms;
+        }
+        else if( !s_task_data.current_command.active )
+        {
+            wait_ms = 0U;
+        }
+    }
+    else if(is_waiting)
+    {
+        uint32_t elapsed = now - s_task_data.last_data_tx_time;
+
+        if(
+                ( s_task_data.data_mode ) &&
+                ( !s_cmd_queue.is_running_abandoned ) &&
+                ( closed_line_is_held__() )
+        )
+        {
+            /* Waiting to find out if the link is closed (see below) */
+        }
+        else if(
+                ( s_task_data.data_mode ) &&
+                ( !s_cmd_queue.is_running_abandoned ) &&
+                ( elapsed < MODEM_TRANSPARENT_GUARD_MS )
+        )
+        {
+            /* Waiting out the guard time before "+++" */
+            wait_ms = MODEM_TRANSPARENT_GUARD_MS - elapsed;
+        }
+        else
+        {
+            wait_ms = 0U;
+        }
+    }
+
+    if( s_task_data.num_held > 0U )
+    {
+        /* Until the held bytes are known to be data or the "CLOSED" line */
+        uint32_t elapsed = now - s_task_data.last_data_rx_time;
+        uint32_t left    = ( elapsed < MODEM_TRANSPARENT_GUARD_MS ) ? ( MODEM_TRANSPARENT_GUARD_MS - elapsed ) : 0U;
+
+        wait_ms = ( left < wait_ms ) ? left : wait_ms;
+    }
+
+    return wait_ms;
+}
+/******************************************************************************/
+static void wake_driver__(void)
+{
+    osThreadId driver = s_cmd_queue.driver;
+
+    if(driver)
+    {
+        osSignalSet(driver, MODEM_DRV_WAKE_SIGNAL);
+    }
+}
+/******************************************************************************/
+static void write_tx_data__(ModemCommand const *p_cmd)
+{
+    if( p_cmd->p_iov )
+    {
+        /* Each fragment goes straight from the caller's buffer to the UART */
+        for(uint32_t ii=0U; ii<p_cmd->iovcnt; ii++)
+        {
+            if( p_cmd->p_iov[ii].len > 0U )
+            {
+                UART6_write(p_cmd->p_iov[ii].p_base, p_cmd->p_iov[ii].len, p_cmd->timeout_ms);
+            }
+        }
+    }
+    else
+    {
+        UART6_write(p_cmd->p_tx_buff, p_cmd->tx_bufflen, p_cmd->timeout_ms);
+    }
+}
+/******************************************************************************/
+static ModemCommand* check_data_mode__(ModemCommand *p_cmd)
+{
+    if(
+            ( s_task_data.data_mode ) &&
+            ( closed_line_is_held__() )
+    )
+    {
+        /****************************************************************
+         * The modem may have closed the link and left data mode -- wait
+         * until that is known
+         ***************************************************************/
+        s_cmd_queue.p_deferred = p_cmd;
+        p_cmd = NULL;
+    }
+    else if(
+            ( p_cmd->flags & MODEM_CMD_FLAG_RAW_DATA ) &&
+            (
+                    ( !s_task_data.data_mode ) ||
+                    ( !s_task_data.is_link_suspect )
+            )
+    )
+    {
+        /****************************************************************
+         * Data for transparent mode
+         ***************************************************************/
+        if( s_task_data.data_mode )
+        {
+            write_tx_data__(p_cmd);
+            s_task_data.last_data_tx_time = osKernelSysTick();
+            add_sent_count__(p_cmd->channel, p_cmd->tx_bufflen);
+            complete_command__(p_cmd, true);
+            p_cmd = NULL;
+        }
+        else if(
+                ( s_task_data.transparent_mode ) &&
+                ( s_task_data.tcp_link_is_open )
+        )
+        {
+            /* Link is open but the modem is in command mode -- resume data
+             * mode first.
+             */
+            s_cmd_queue.p_deferred = p_cmd;
+            p_cmd = &s_resume_cmd;
+        }
+        else
+        {
+            /* The link is closed */
+            complete_command__(p_cmd, false);
+            p_cmd = NULL;
+        }
+    }
+    else if( s_task_data.data_mode )
+    {
+        /****************************************************************
+         * An AT command, so leave data mode first -- or data when the
+         * link may have been closed, to find out if it is still open
+         ***************************************************************/
+        s_cmd_queue.p_deferred = p_cmd;
+
+        if( ( osKernelSysTick() - s_task_data.last_data_tx_time ) < MODEM_TRANSPARENT_GUARD_MS )
+        {
+            /* Wait for the guard time before sending "+++" */
+            p_cmd = NULL;
+        }
+        else
+        {
+            s_task_data.is_checking_link = s_task_data.is_link_suspect;
+            s_task_data.is_link_suspect  = false;
+            p_cmd = &s_escape_cmd;
+        }
+    }
+    else
+    {
+        /* Command mode -- just run the command */
+    }
+
+    return p_cmd;
+}
+/******************************************************************************/
+static void escape_complete__(ModemCommand *p_cmd, bool result)
+{
+    (void) p_cmd;
+
+    if(
+            ( !result ) &&
+            ( s_task_data.is_checking_link )
+    )
+    {
+        /* The modem only ignores "+++" when it is not in data mode, so the
+         * "CLOSED" line was its own.
+         */
+        ModemDrvAt_link_closed(MODEM_CHANNEL_DATA_UPLOAD_CLIENT);
+    }
+
+    s_task_data.is_checking_link = false;
+
+    if( ( !result ) && ( s_cmd_queue.p_deferred ) )
+    {
+        /* Still in data mode (or the link is closed) -- can't run the command */
+        ModemCommand *p_deferred = s_cmd_queue.p_deferred;
+
+        s_cmd_queue.p_deferred = NULL;
+        complete_command__(p_deferred, false);
+    }
+}
+/******************************************************************************/
+static void resume_complete__(ModemCommand *p_cmd, bool result)
+{
+    (void) p_cmd;
+
+    if(!result)
+    {
+        /* Failed to get back to data mode -- assume the link is down, so the
+         * deferred data will fail.
+         */
+        s_task_data.tcp_link_is_open = false;
+    }
+}
+/******************************************************************************/
+static bool start_command(char const *command_str, uint32_t search_mask, bool (*fn)(char const *str), uint32_t tx_bufflen, uint32_t flags)
+{
+    bool succes=false;
+
+    if(command_str)
+    {
+        if( !s_task_data.current_command.active )
+        {
+            PRINTF("ModemDrv - command '%s'\r\n", command_str);
+
+            s_task_data.current_command.result = false;
+
+            s_task_data.current_command.tx_data.ready_to_send = false;
+            s_task_data.current_command.tx_data.tx_bufflen    = tx_bufflen;
+            s_task_data.current_command.tx_data.tx_count      = 0U;
+
+            AlcTestCharSeq_set(&s_current_command, command_str);
+            s_task_data.current_command.search_mask = search_mask;
+            s_task_data.current_command.fn          = fn;
+            s_task_data.current_command.result      = false;
+            s_task_data.current_command.escaping    = s_task_data.data_mode;
+            release_held_data__();
+            s_task_data.rx_state                    = RXST_IDLE;
+            s_task_data.current_command.active      = true;
+
+            ModemUrcMatcher_reset(&s_urc);
+
+            if(
+                    ( !s_task_data.echo_enabled ) ||
+                    ( flags & MODEM_CMD_FLAG_NO_CRLF )
+            )
+            {
+                /* There is no echo to wait for */
+                ReplyBuffer_reset();
+                s_task_data.rx_state = ( tx_bufflen == 0U ) ? RXST_COMMAND : RXST_GT;
+            }
+
+            UART6_write(command_str, strlen(command_str), 100);
+
+            if( ( flags & MODEM_CMD_FLAG_NO_CRLF ) == 0U )
+            {
+                UART6_write("\r\n", 2, 100);
+            }
+
+            succes = true;
+        }
+    }
+
+    return succes;
+}
+/******************************************************************************/
+static void process_rx_char__(uint8_t ch)
+{
+    ModemToken token;
+
+    switch( s_task_data.rx_state )
+    {
+    case RXST_IDLE:
+        /****************************************************************
+         * Idle mode
+         ***************************************************************/
+        if( ch == ASCII_CR )
+        {
+            if( AlcTestCharSeq_is_found(&s_current_command) )
+            {
+                //
+                UART3_write("<<<< FOUND CMD <<<<\r\n", 21, 100);
+                AlcTestCharSeq_restart(&s_current_command);
+                ReplyBuffer_reset();
+
+                if( s_task_data.current_command.tx_data.tx_bufflen == 0U )
+                {
+                    /* No data to be transmitted -- so goto process command lines */
+                    s_task_data.rx_state = RXST_COMMAND;
+                }
+                else
+                {
+                    /* There is data to be transmitted -- so now wait for modem
+                     * to send '>' character before starting transmission.
+                     */
+                    s_task_data.rx_state = RXST_GT;
+                }
+            }
+            else
+            {
+                UART3_write("\r\n", 2, 100);
+            }
+
+            token = ModemUrcMatcher_end_of_line(&s_urc);
+            process_urc__(token);
+        }
+        else if( ch == ASCII_LF )
+        {
+            // Ignore linefeed chars
+        }
+        else
+        {
+            UART3_write(&ch, 1, 100);
+
+            AlcTestCharSeq_test_char(&s_current_command, ch);
+
+            token = ModemUrcMatcher_feed(&s_urc, ch);
+            if( token == MODEM_TOKEN_RECEIVE )
+            {
+                receive_data__(ModemUrcMatcher_get_capture(&s_urc, 0U), ModemUrcMatcher_get_capture(&s_urc, 1U), 2U);
+            }
+        }
+        break;
+
+    case RXST_COMMAND:
+        /****************************************************************
+         * A command is running
+         ***************************************************************/
+        if( ch == ASCII_CR )
+        {
+            UART3_write("  GOTLINE >>>>", 14, 100);
+            UART3_write(replybuffer, strlen(replybuffer), 100);
+            UART3_write("<<<<\r\n", 6, 100);
+
+            if( s_task_data.current_command.fn )
+            {
+                s_task_data.current_command.fn(replybuffer);
+            }
+
+            token = ModemUrcMatcher_end_of_line(&s_urc);
+            process_urc__(token);
+
+            if( s_task_data.current_command.active )
+            {
+                /* The line parser may have already completed the command */
+                complete_on_token__(token);
+            }
+
+            ReplyBuffer_reset();
+        }
+        else if( ch == ASCII_LF )
+        {
+            // Ignore linefeed chars
+        }
+        else
+        {
+            // Add character to current line
+            ReplyBuffer_push_back(ch);
+
+            token = ModemUrcMatcher_feed(&s_urc, ch);
+            if( token == MODEM_TOKEN_RECEIVE )
+            {
+                /* Data arrived while the command was running -- it is not part of the reply */
+                receive_data__(ModemUrcMatcher_get_capture(&s_urc, 0U), ModemUrcMatcher_get_capture(&s_urc, 1U), 2U);
+                ReplyBuffer_reset();
+            }
+        }
+        break;
+
+
+    case RXST_GT:
+        /****************************************************************
+         * Wait for Modem to send a '>' (greater-than) character
+         ***************************************************************/
+        UART3_write(&ch, 1, 100);
+        if( ch == '>' )
+        {
+            s_task_data.current_command.tx_data.ready_to_send = true;
+            s_task_data.current_command.tx_data.tx_count = 0U;
+
+            if( s_task_data.echo_enabled )
+            {
+                s_task_data.rx_state = RXST_TX_DATA;
+            }
+            else
+            {
+                /* The data won't be echoed -- just wait for "x, SEND OK" */
+                s_task_data.rx_state = RXST_TX_DATA_COMPLETE;
+                ModemUrcMatcher_reset(&s_urc);
+            }
+        }
+        else if( ch == ASCII_CR )
+        {
+            /* The modem replies "ERROR" instead of '>' if the link is not
+             * open -- fail now rather than wait for the timeout.
+             */
+            token = ModemUrcMatcher_end_of_line(&s_urc);
+
+            if( token == MODEM_TOKEN_ERROR )
+            {
+                UART3_write("<<<< SEND REFUSED >>>>\r\n", 24, 100);
+                s_task_data.current_command.result = false;
+                s_task_data.current_command.active = false;
+                s_task_data.rx_state = RXST_IDLE;
+            }
+            else
+            {
+                process_urc__(token);
+            }
+        }
+        else if( ch != ASCII_LF )
+        {
+            (void) ModemUrcMatcher_feed(&s_urc, ch);
+        }
+        break;
+
+    case RXST_TX_DATA:
+        /****************************************************************
+         * Transmitting data to Modem -- it will be echoed back here
+         ***************************************************************/
+        UART3_write(&ch, 1, 100);
+        s_task_data.current_command.tx_data.tx_count++;
+
+        if( s_task_data.current_command.tx_data.tx_count >= s_task_data.current_command.tx_data.tx_bufflen )
+        {
+            s_task_data.rx_state = RXST_TX_DATA_COMPLETE;
+            ModemUrcMatcher_reset(&s_urc);
+        }
+        break;
+
+    case RXST_TX_DATA_COMPLETE:
+        /****************************************************************
+         * Data sent to Modem -- waiting for Modem to send "x, SEND OK"
+         * string, where x is the channel number.
+         ***************************************************************/
+        UART3_write(&ch, 1, 100);
+        if( ch == ASCII_CR )
+        {
+            token = ModemUrcMatcher_end_of_line(&s_urc);
+
+            if( token == MODEM_TOKEN_DATA_ACCEPT )
+            {
+                /* Quick send mode -- the data is in the modem's buffer */
+                UART3_write("<<<< DATA ACCEPTED >>>>\r\n", 25, 100);
+                add_sent_count__(ModemUrcMatcher_get_capture(&s_urc, 0U), ModemUrcMatcher_get_capture(&s_urc, 1U));
+                s_task_data.current_command.result = true;
+                s_task_data.current_command.active = false;
+                s_task_data.rx_state = RXST_IDLE;
+            }
+            else if( token == MODEM_TOKEN_SEND_OK )
+            {
+                //
+                UART3_write("<<<< SEND COMPLETE >>>>\r\n", 25, 100);
+                add_sent_count__(s_task_data.current_command.channel, s_task_data.current_command.tx_data.tx_bufflen);
+                s_task_data.current_command.result = true;
+                s_task_data.current_command.active = false;
+                s_task_data.rx_state = RXST_IDLE;
+            }
+            else if( token == MODEM_TOKEN_SEND_FAIL )
+            {
+                UART3_write("<<<< SEND FAILED >>>>\r\n", 23, 100);
+                s_task_data.current_command.result = false;
+                s_task_data.current_command.active = false;
+                s_task_data.rx_state = RXST_IDLE;
+            }
+            else
+            {
+                process_urc__(token);
+            }
+        }
+        else if( ch == ASCII_LF )
+        {
+            // Ignore linefeed chars
+        }
+        else
+        {
+            token = ModemUrcMatcher_feed(&s_urc, ch);
+            if( token == MODEM_TOKEN_RECEIVE )
+            {
+                receive_data__(ModemUrcMatcher_get_capture(&s_urc, 0U), ModemUrcMatcher_get_capture(&s_urc, 1U), 2U);
+            }
+        }
+        break;
+
+
+    case RXST_DATA_MODE:
+        /****************************************************************
+         * Transparent data mode -- everything is data from the server,
+         * apart from a "CLOSED" line when the link is closed.
+         ***************************************************************/
+        if( s_task_data.skip_data_lf )
+        {
+            s_task_data.skip_data_lf = false;
+
+            if( ch == ASCII_LF )
+            {
+                break;
+            }
+        }
+
+        receive_data_mode_char__(ch);
+        break;
+
+
+    default:
+        /*
+         * Should never get here
+         */
+        s_task_data.rx_state = RXST_IDLE;
+        break;
+
+    } /* switch() */
+}
+/******************************************************************************/
+static void process_urc__(ModemToken token)
+{
+    uint32_t channel = urc_channel__();
+
+    switch(token)
+    {
+    case MODEM_TOKEN_CONNECT:
+        /* Transparent mode -- the modem is now in data mode. This is also
+         * sent when data mode is resumed with "ATO".
+         */
+        s_task_data.data_mode = true;
+        s_task_data.skip_data_lf = true;
+        s_task_data.last_data_tx_time = osKernelSysTick();
+        s_task_data.last_data_rx_time = ( osKernelSysTick() - MODEM_TRANSPARENT_GUARD_MS );
+        s_task_data.num_held = 0U;
+        s_task_data.is_link_suspect = false;
+
+        if( !s_task_data.tcp_link_is_open )
+        {
+            ModemDrvAt_link_opened(MODEM_CHANNEL_DATA_UPLOAD_CLIENT);
+        }
+        break;
+
+    case MODEM_TOKEN_CONNECT_OK:
+        ModemDrvAt_link_opened(channel);
+        break;
+
+    case MODEM_TOKEN_RECEIVE_LINE:
+        /* The CR of the line has gone -- just the LF before the data */
+        receive_data__(channel, ModemUrcMatcher_get_capture(&s_urc, 1U), 1U);
+        break;
+
+    case MODEM_TOKEN_RDY:
+        ModemDrvAt_set_ready_flag(MODEM_READY_RDY, true);
+        break;
+
+    case MODEM_TOKEN_CALL_READY:
+        ModemDrvAt_set_ready_flag(MODEM_READY_CALL, true);
+        break;
+
+    case MODEM_TOKEN_SMS_READY:
+        ModemDrvAt_set_ready_flag(MODEM_READY_SMS, true);
+        break;
+
+    case MODEM_TOKEN_CREG:
+        /* "+CREG: <stat>" as a URC, "+CREG: <n>,<stat>" as the reply to
+         * "AT+CREG?" -- the status is always the last value.
+         */
+        ModemDrvAt_set_ready_flag(
+                MODEM_READY_REGISTERED,
+                ( ModemUrcMatcher_get_capture(&s_urc, ( ModemUrcMatcher_get_num_captures(&s_urc) - 1U )) == MODEM_NW_REG_JOINED_HOME ));
+        break;
+
+    case MODEM_TOKEN_CGATT:
+        ModemDrvAt_set_ready_flag(MODEM_READY_ATTACHED, ( ModemUrcMatcher_get_capture(&s_urc, 0U) != 0U ));
+        break;
+
+    case MODEM_TOKEN_CLOSE_OK:
+    case MODEM_TOKEN_CLOSED:
+        ModemDrvAt_link_closed(channel);
+        break;
+
+    default:
+        /* Not an unsolicited result code */
+        break;
+    }
+}
+/******************************************************************************/
+static void complete_on_token__(ModemToken token)
+{
+    if(
+            ( token < NUM_MODEM_TOKENS ) &&
+            ( s_token_results[token].search_mask & s_task_data.current_command.search_mask )
+    )
+    {
+        if(
+                ( !s_token_results[token].data_channel_only ) ||
+                ( urc_channel__() == MODEM_CHANNEL_DATA_UPLOAD_CLIENT )
+        )
+        {
+            if(
+                    ( s_task_data.current_command.escaping ) &&
+                    ( s_token_results[token].result )
+            )
+            {
+                /* "+++" worked -- the modem is back in command mode */
+                s_task_data.data_mode = false;
+            }
+
+            s_task_data.current_command.result = s_token_results[token].result;
+            s_task_data.current_command.active = false;
+            s_task_data.rx_state = idle_rx_state__();
+        }
+    }
+}
+/******************************************************************************/
+static void receive_data__(uint32_t channel, uint32_t numbytes, uint32_t num_skip)
+{
+    uint8_t ch;
+
+    /* Skip the end of the line before the data */
+    for(; num_skip>0U; num_skip--)
+    {
+        UART6_read( &ch, 1, 1000);
+    }
+
+    while( numbytes > 0U )
+    {
+        if( UART6_read( &ch, 1, 1000) > 0 )
+        {
+            numbytes--;
+            forward_rx_data__(channel, ch);
+        }
+    }
+}
+/******************************************************************************/
+/* The modem sends "CLOSED" in data mode when the link goes, but the server's
+ * data could hold the same line. So, like the "+++" escape the other way, it
+ * is only taken as the modem's with the guard time of silence before or
+ * after it -- after it, the modem is in command mode and sends no more data.
+ * The bytes that might be the line are held back until they turn out to be
+ * data, and the line itself is not data.
+ */
+static void receive_data_mode_char__(uint8_t ch)
+{
+    uint32_t now = osKernelSysTick();
+
+    if(
+            ( s_task_data.num_held > 0U ) &&
+            ( s_closed_line[s_task_data.num_held] != '\0' ) &&
+            ( ch == (uint8_t) s_closed_line[s_task_data.num_held] )
+    )
+    {
+        s_task_data.num_held++;
+    }
+    else
+    {
+        /* Anything held is data after all -- unless a whole "CLOSED" line
+         * was held, which the modem could have sent just before the bytes it
+         * echoes in command mode. That is checked before more data is sent.
+         */
+        if( closed_line_is_held__() )
+        {
+            s_task_data.is_link_suspect = true;
+        }
+
+        release_held_data__();
+
+        if( ch == (uint8_t) s_closed_line[0] )
+        {
+            s_task_data.num_held = 1U;
+            s_task_data.is_held_after_gap = ( ( now - s_task_data.last_data_rx_time ) >= MODEM_TRANSPARENT_GUARD_MS );
+        }
+        else
+        {
+            forward_rx_data__(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, ch);
+        }
+    }
+
+    s_task_data.last_data_rx_time = now;
+
+    if(
+            ( closed_line_is_held__() ) &&
+            ( s_task_data.is_held_after_gap )
+    )
+    {
+        data_mode_link_closed__();
+    }
+}
+/******************************************************************************/
+/* Called by the driver task between characters. Once the line has gone quiet
+ * for the guard time, a whole "CLOSED" line is the modem's, and the start of
+ * one is data.
+ */
+static void check_held_data__(void)
+{
+    if(
+            ( s_task_data.num_held > 0U ) &&
+            ( ( osKernelSysTick() - s_task_data.last_data_rx_time ) >= MODEM_TRANSPARENT_GUARD_MS )
+    )
+    {
+        if( closed_line_is_held__() )
+        {
+            data_mode_link_closed__();
+        }
+        else
+        {
+            release_held_data__();
+        }
+    }
+}
+/******************************************************************************/
+static inline bool closed_line_is_held__(void)
+{
+    return ( s_closed_line[s_task_data.num_held] == '\0' );
+}
+/******************************************************************************/
+static void release_held_data__(void)
+{
+    for(uint32_t ii=0U; ii<s_task_data.num_held; ii++)
+    {
+        forward_rx_data__(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, (uint8_t) s_closed_line[ii]);
+    }
+
+    s_task_data.num_held = 0U;
+}
+/******************************************************************************/
+static void data_mode_link_closed__(void)
+{
+    s_task_data.num_held = 0U;
+    ModemDrvAt_link_closed(MODEM_CHANNEL_DATA_UPLOAD_CLIENT);
+    s_task_data.rx_state = RXST_IDLE;
+}
+/******************************************************************************/
+static void forward_rx_data__(uint32_t channel, uint8_t ch)
+{
+    if( channel == MODEM_CHANNEL_DATA_UPLOAD_CLIENT )
+    {
+        /* The data is for the data-upload-client's channel
+         */
+        if( xQueueSendToBack(g_data_upload_client_rx_queueHandle, &ch, 1000) != pdPASS )
+        {
+            // Failed to post the message, even after 10 ticks.
+            //printf("ModemDrv - Failed to post the message\r\n");
+        }
+    }
+}
+/******************************************************************************/
+static bool wait_for_send_window__(uint8_t channel, uint32_t bufflen, uint32_t window, uint32_t timeout_ms)
+{
+    uint32_t start_time = osKernelSysTick();
+
+    for(;;)
+    {
+        uint32_t outstanding = s_tcp_channel[channel].sent - s_tcp_channel[channel].acked;
+
+        if(
+                ( outstanding == 0U ) ||
+                ( ( outstanding + bufflen ) <= window )
+        )
+        {
+            /* Window is open (a buffer bigger than the window can still be
+             * sent once everything before it has been acknowledged).
+             */
+            return true;
+        }
+
+        if( ( osKernelSysTick() - start_time ) >= timeout_ms )
+        {
+            return false;
+        }
+
+        if( !Modem_tcp_update_ack(channel, 1000U) )
+        {
+            /* The link has probably gone */
+            return false;
+        }
+
+        if( ( s_tcp_channel[channel].sent - s_tcp_channel[channel].acked ) == outstanding )
+        {
+            /* No progress -- wait before asking again */
+            osDelay(MODEM_TCP_ACK_POLL_MS);
+        }
+    }
+}
+/******************************************************************************/
+static void add_sent_count__(uint32_t channel, uint32_t count)
+{
+    if( channel < MODEM_DRV_AT_MAX_CHANNELS )
+    {
+        s_tcp_channel[channel].sent += count;
+    }
+}
+/******************************************************************************/
+static uint32_t urc_channel__(void)
+{
+    /* The single connection forms of the URC's (transparent mode) have no
+     * channel number -- they can only be for the upload channel.
+     */
+    if( ModemUrcMatcher_get_num_captures(&s_urc) == 0U )
+    {
+        return MODEM_CHANNEL_DATA_UPLOAD_CLIENT;
+    }
+
+    return ModemUrcMatcher_get_capture(&s_urc, 0U);
+}
+/******************************************************************************/
+static inline RxState idle_rx_state__(void)
+{
+    return (s_task_data.data_mode) ? RXST_DATA_MODE : RXST_IDLE;
+}
+/******************************************************************************/
+static bool ops_are_valid__(ModemDriverOps const *p_ops)
+{
+    return ( p_ops ) &&
+           ( p_ops->num_channels > MODEM_CHANNEL_DATA_UPLOAD_CLIENT ) &&
+           ( p_ops->num_channels <= MODEM_DRV_AT_MAX_CHANNELS ) &&
+           ( p_ops->send_fmt ) &&
+           ( p_ops->soft_reset ) &&
+           ( p_ops->enable_network_registration ) &&
+           ( p_ops->get_network_registration ) &&
+           ( p_ops->enable_gprs ) &&
+           ( p_ops->get_ip_addr ) &&
+           ( p_ops->tcp_open ) &&
+           ( p_ops->tcp_close ) &&
+           ( p_ops->tcp_get_send_size ) &&
+           ( p_ops->tcp_get_acked );
+}
+/******************************************************************************/
+static void modem_restarted__(void)
+{
+    s_task_data.echo_enabled     = true;
+    s_task_data.data_mode        = false;
+    s_task_data.num_held         = 0U;
+    s_task_data.is_link_suspect  = false;
+    s_task_data.tcp_link_is_open = false;
+    s_task_data.ready_flags     &= MODEM_READY_DRIVER;
+}
+/******************************************************************************/
@@ -0,0 +1,499 @@
+/**
+ * @file  modem_drv_ec2x.c
+ * @brief Modem driver (for Quectel EC21/EC25 LTE Cat-1 modem modules)
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * The PDP context (AT+QICSGP, AT+QIACT) and the TCP commands (AT+QIOPEN,
+ * AT+QISEND) of the EC2x, on the AT command engine in modem_drv.c.
+ *
+ * The sockets are opened in direct push mode, so received data arrives as
+ * '+QIURC: "recv",<ch>,<len>' followed by the data. A send completes as soon
+ * as the data is in the module's buffer ("SEND OK"), and "AT+QISEND=<ch>,0"
+ * says how much of it the server has acknowledged. In quick send mode up to
+ * MODEM_EC2X_TCP_SEND_WINDOW bytes may wait for the server's ack; without it
+ * (the default) each send waits for the ack, as "SEND OK" does on the SIM808.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "modem_drv.h"
+#include "modem_drv_at.h"
+#include "modem_drv_conf.h"
+#include "nv_settings.h"
+
+#include "alc_eat_string_tokens.h"
+#include "alc_string.h"
+#include "cmsis_os.h"
+
+
+#define DEBUG DEBUG_NONE
+#include "net-debug.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+#define EC2X_NUM_CHANNELS           12U
+#define EC2X_MAX_SEND_SIZE          1460U
+
+/** @brief The PDP context used for the sockets */
+#define EC2X_CONTEXT_ID             1U
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+/** @brief Var used by get_ip_addr__()
+ */
+static struct {
+    volatile char ip_address[25];
+} s_get_ip_addr_data;
+
+
+/** @brief Var used by open_link__()
+ */
+static volatile struct {
+    uint32_t channel;
+} s_tcp_open_cmd;
+
+
+/** @brief Var used by tcp_get_send_size__() and tcp_get_acked__()
+ */
+static volatile struct {
+    uint32_t acked;
+    bool     success;
+} s_tcp_send_state;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static bool enable_network_registration__(void);
+static bool get_network_registration__(uint32_t *p_status);
+static bool enable_gprs__(bool on_off);
+static bool get_ip_addr__(char *dest, size_t destlen);
+static bool tcp_open__(uint8_t channel, char const *server, uint16_t port, uint32_t timeout_ms);
+static bool udp_open__(uint8_t channel, char const *server, uint16_t port, uint32_t timeout_ms);
+static bool open_link__(uint8_t channel, char const *protocol, char const *server, uint16_t port, uint32_t timeout_ms);
+static bool tcp_close__(uint8_t channel, uint32_t timeout_ms);
+static bool tcp_get_send_size__(uint8_t channel, uint32_t *p_size, uint32_t timeout_ms);
+static bool tcp_get_acked__(uint8_t channel, uint32_t *p_acked, uint32_t timeout_ms);
+static bool get_send_state__(uint8_t channel, uint32_t timeout_ms);
+static bool check_ip_address__(char const *str);
+static bool check_tcp_open_reply__(char const *str);
+static bool check_send_state_reply__(char const *str);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+#if ( EC2X_NUM_CHANNELS > MODEM_DRV_AT_MAX_CHANNELS )
+#error "EC2X_NUM_CHANNELS is more than MODEM_DRV_AT_MAX_CHANNELS"
+#endif
+
+#if ( MODEM_CHANNEL_DATA_UPLOAD_CLIENT >= EC2X_NUM_CHANNELS )
+#error "MODEM_CHANNEL_DATA_UPLOAD_CLIENT is not an EC2x channel"
+#endif
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL VARIABLES
+*******************************************************************************/
+
+ModemDriverOps const g_modem_drv_ec2x = {
+    .name                           = "EC2x",
+    .num_channels                   = EC2X_NUM_CHANNELS,
+    .send_fmt                       = "AT+QISEND=%u,%u",
+    .send_window                    = MODEM_EC2X_TCP_SEND_WINDOW,
+    .has_transparent_mode           = false,
+    .buffers_sends                  = true,
+    .soft_reset                     = &ModemDrvAt_cfun_reset,
+    .enable_network_registration    = &enable_network_registration__,
+    .get_network_registration       = &get_network_registration__,
+    .enable_gprs                    = &enable_gprs__,
+    .get_ip_addr                    = &get_ip_addr__,
+    .tcp_open                       = &tcp_open__,
+    .udp_open                       = &udp_open__,
+    .tcp_close                      = &tcp_close__,
+    .tcp_get_send_size              = &tcp_get_send_size__,
+    .tcp_get_acked                  = &tcp_get_acked__,
+};
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static bool enable_network_registration__(void)
+{
+    /* EPS (LTE) registration -- the "+CEREG: " URC's set the same readiness
+     * flag as "+CREG: " on the SIM808.
+     */
+    return Modem_run_command("AT+CEREG=1", SEARCH_OK|SEARCH_ERROR, 10000);
+}
+/******************************************************************************/
+static bool get_network_registration__(uint32_t *p_status)
+{
+    return Modem_run_command_parse_reply_u32(
+            "AT+CEREG?",
+            "+CEREG: ",
+            p_status,
+            1,
+            SEARCH_OK|SEARCH_ERROR,
+            1000);
+}
+/******************************************************************************/
+static bool enable_gprs__(bool on_off)
+{
+    if(on_off)
+    {
+        char args[( 3U * ( STORE_MODEM_STRING_MAXLEN + 3U ) ) + 1U];
+        char cmd[sizeof(args) + 16U];
+
+        /* close all sockets */
+        PRINTF("deactivate PDP context\r\n");
+        Modem_run_command("AT+QIDEACT=1", SEARCH_OK|SEARCH_ERROR, 40000U);
+
+
+        /* The module attaches by itself on LTE -- usually already done */
+        if( ( Modem_get_ready_flags() & MODEM_READY_ATTACHED ) == 0U )
+        {
+            PRINTF("send AT+CGATT=1\r\n");
+            if( !Modem_run_command("AT+CGATT=1", SEARCH_OK|SEARCH_ERROR, 10000U) )
+            {
+                PRINTF("Failed to set GATT=1\r\n");
+                return false;
+            }
+
+            ModemDrvAt_set_ready_flag(MODEM_READY_ATTACHED, true);
+        }
+
+
+        /* Set APN name, user, password -- the same arguments as AT+CSTT */
+        PRINTF("Set APN name, user, password\r\n");
+        if( !ModemDrvAt_build_apn_args(args, sizeof(args)) )
+        {
+            return false;
+        }
+
+        snprintf(cmd, sizeof(cmd), "AT+QICSGP=%u,1,%s", EC2X_CONTEXT_ID, args);
+        if( !Modem_run_command(cmd, SEARCH_OK|SEARCH_ERROR, 10000U) )
+        {
+            return false;
+        }
+
+        if( !Modem_wait_for_ready(MODEM_READY_ATTACHED, &ModemDrvAt_poll_attached, 1000U, MODEM_GPRS_ATTACH_TIMEOUT_MS) )
+        {
+            PRINTF("Not attached yet -- trying anyway\r\n");
+        }
+
+        /* activate PDP context */
+        PRINTF("activate PDP context\r\n");
+        if( !Modem_run_command("AT+QIACT=1", SEARCH_OK|SEARCH_ERROR, MODEM_EC2X_ACTIVATE_TIMEOUT_MS) )
+        {
+            return false;
+        }
+    }
+    else
+    {
+        /* close all sockets */
+        if( !Modem_run_command("AT+QIDEACT=1", SEARCH_OK|SEARCH_ERROR, 40000U) )
+        {
+            return false;
+        }
+
+        if( !Modem_run_command("AT+CGATT=0", SEARCH_OK|SEARCH_ERROR, 10000U) )
+        {
+            return false;
+        }
+
+        ModemDrvAt_set_ready_flag(MODEM_READY_ATTACHED, false);
+    }
+
+    return true;
+}
+/******************************************************************************/
+static bool get_ip_addr__(char *dest, size_t destlen)
+{
+    bool success=false;
+
+    if( ModemDrvAt_acquire(1000) )
+    {
+        s_get_ip_addr_data.ip_address[0] = '\0';
+
+        if(
+                ( ModemDrvAt_run_command("AT+QIACT?", SEARCH_OK|SEARCH_ERROR, &check_ip_address__, 1000U, MODEM_CMD_PRIORITY_NORMAL) ) &&
+                ( s_get_ip_addr_data.ip_address[0] != '\0' )
+        )
+        {
+            PRINTF("ip_address >>>>%s<<<<\r\n", s_get_ip_addr_data.ip_address);
+
+            strncpy_safe(dest, s_get_ip_addr_data.ip_address, destlen);
+
+            success = true;
+        }
+
+        ModemDrvAt_release();
+    }
+
+    return success;
+}
+/******************************************************************************/
+static bool tcp_open__(uint8_t channel, char const *server, uint16_t port, uint32_t timeout_ms)
+{
+    return open_link__(channel, "TCP", server, port, timeout_ms);
+}
+/******************************************************************************/
+static bool udp_open__(uint8_t channel, char const *server, uint16_t port, uint32_t timeout_ms)
+{
+    return open_link__(channel, "UDP", server, port, timeout_ms);
+}
+/******************************************************************************/
+static bool open_link__(uint8_t channel, char const *protocol, char const *server, uint16_t port, uint32_t timeout_ms)
+{
+    bool success=false;
+
+    if( ModemDrvAt_acquire(timeout_ms) )
+    {
+        char command[100];
+
+        /* Direct push mode (access mode 1) */
+        snprintf(command, sizeof(command), "AT+QIOPEN=%u,%u,\"%s\",\"%s\",%u,0,1", EC2X_CONTEXT_ID, channel, protocol, server, port);
+
+        s_tcp_open_cmd.channel = channel;
+
+        /* "OK" only means the command was accepted -- check_tcp_open_reply__()
+         * completes the command when "+QIOPEN: <ch>,<err>" arrives.
+         */
+        success = ModemDrvAt_run_command(command, SEARCH_ERROR, &check_tcp_open_reply__, timeout_ms, MODEM_CMD_PRIORITY_NORMAL);
+
+        ModemDrvAt_release();
+    }
+
+    return success;
+}
+/******************************************************************************/
+static bool tcp_close__(uint8_t channel, uint32_t timeout_ms)
+{
+    bool success=false;
+
+    if( ModemDrvAt_acquire(timeout_ms) )
+    {
+        char command[20];
+
+        /* "OK" once the socket is closed -- there is no URC for it */
+        snprintf(command, sizeof(command), "AT+QICLOSE=%u", channel);
+
+        success = ModemDrvAt_run_command(command, SEARCH_OK|SEARCH_ERROR, NULL, timeout_ms, MODEM_CMD_PRIORITY_NORMAL);
+
+        if(success)
+        {
+            ModemDrvAt_link_closed(channel);
+        }
+
+        ModemDrvAt_release();
+    }
+
+    return success;
+}
+/******************************************************************************/
+static bool tcp_get_send_size__(uint8_t channel, uint32_t *p_size, uint32_t timeout_ms)
+{
+    /* There is no query for the free space -- the module replies "ERROR" if
+     * the socket is not open, and the send window limits the rest. The query
+     * is only for TCP, so a UDP link is open until the module says it closed.
+     */
+    if( ModemDrvAt_link_is_udp(channel) )
+    {
+        *p_size = ( ModemDrvAt_link_is_open() ) ? EC2X_MAX_SEND_SIZE : 0U;
+        return true;
+    }
+
+    if( get_send_state__(channel, timeout_ms) )
+    {
+        *p_size = EC2X_MAX_SEND_SIZE;
+        return true;
+    }
+
+    return false;
+}
+/******************************************************************************/
+static bool tcp_get_acked__(uint8_t channel, uint32_t *p_acked, uint32_t timeout_ms)
+{
+    if( get_send_state__(channel, timeout_ms) )
+    {
+        *p_acked = s_tcp_send_state.acked;
+        return true;
+    }
+
+    return false;
+}
+/******************************************************************************/
+static bool get_send_state__(uint8_t channel, uint32_t timeout_ms)
+{
+    bool success=false;
+
+    if( ModemDrvAt_acquire(timeout_ms) )
+    {
+        char command[20];
+
+        snprintf(command, sizeof(command), "AT+QISEND=%u,0", channel);
+
+        s_tcp_send_state.acked   = 0U;
+        s_tcp_send_state.success = false;
+
+        if( ModemDrvAt_run_command(command, SEARCH_OK|SEARCH_ERROR, &check_send_state_reply__, timeout_ms, MODEM_CMD_PRIORITY_URGENT) )
+        {
+            success = s_tcp_send_state.success;
+        }
+
+        ModemDrvAt_release();
+    }
+
+    return success;
+}
+/******************************************************************************/
+static bool check_ip_address__(char const *str)
+{
+    /** Expect the line to be '+QIACT: <ctx>,<state>,<type>,"<ip>"'
+     */
+    if(
+            ( strncmp(str, "+QIACT: ", 8) == 0 )
+    )
+    {
+        char const *p_start = strchr(str, '"');
+
+        if(p_start)
+        {
+            char const *p_end = strchr(&p_start[1], '"');
+
+            if(
+                    ( p_end ) &&
+                    ( (size_t) ( p_end - p_start ) <= sizeof(s_get_ip_addr_data.ip_address) )
+            )
+            {
+                memcpy((char*) s_get_ip_addr_data.ip_address, &p_start[1], (size_t) ( p_end - p_start - 1 ));
+                s_get_ip_addr_data.ip_address[p_end - p_start - 1] = '\0';
+            }
+        }
+    }
+
+    return true;
+}
+/******************************************************************************/
+static bool check_tcp_open_reply__(char const *str)
+{
+    /** Expect the line to be '+QIOPEN: <ch>,<err>'
+     */
+    if(
+            ( strncmp(str, "+QIOPEN: ", 9) == 0 )
+    )
+    {
+        uint32_t channel;
+        uint32_t err;
+        bool success;
+
+        str = &str[9];
+
+        success =  eat_u32(&str, &channel);
+        success &= eat_comma(&str);
+        success &= eat_u32(&str, &err);
+
+        if(
+                ( success ) &&
+                ( channel == s_tcp_open_cmd.channel )
+        )
+        {
+            /* The link itself is opened by the "+QIOPEN: <ch>,0" URC */
+            ModemDrvAt_complete_command( err == 0U );
+        }
+    }
+
+    return true;
+}
+/******************************************************************************/
+static bool check_send_state_reply__(char const *str)
+{
+    /** Expect the line to be '+QISEND: <total>,<acked>,<unacked>'
+     */
+    if(
+            ( strncmp(str, "+QISEND: ", 9) == 0 )
+    )
+    {
+        uint32_t total;
+        uint32_t acked;
+        uint32_t unacked;
+        bool success;
+
+        str = &str[9];
+
+        success =  eat_u32(&str, &total);
+        success &= eat_comma(&str);
+        success &= eat_u32(&str, &acked);
+        success &= eat_comma(&str);
+        success &= eat_u32(&str, &unacked);
+
+        if(success)
+        {
+            s_tcp_send_state.acked   = acked;
+            s_tcp_send_state.success = true;
+        }
+    }
+
+    return true;
+}
+/******************************************************************************/
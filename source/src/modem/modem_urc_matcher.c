@@ -0,0 +1,436 @@
+/**
+ * @file  modem_urc_matcher.c
+ * @brief Table driven matcher for modem result codes and URC's.
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "modem_urc_matcher.h"
+
+#include <stddef.h>
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+/** @brief Maximum number of nodes in the trie (node 0 is the root) */
+#ifndef MODEM_URC_MATCHER_MAX_NODES
+#define MODEM_URC_MATCHER_MAX_NODES     255U
+#endif
+
+/** @brief Value used in the trie for a '%d' in the pattern */
+#define MATCH_DIGITS                    0x01U
+
+/** @brief Index used in the trie for 'no node' (the root is never a child) */
+#define NO_NODE                         0U
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+typedef enum {
+    MATCH_LINE=0,       /**< The whole line must match the pattern */
+    MATCH_PREFIX        /**< Fires as soon as the pattern is matched */
+} MatchKind;
+
+
+typedef struct {
+    uint8_t ch;                 /**< Character, or MATCH_DIGITS */
+    uint8_t token;              /**< Token if a pattern ends here */
+    uint8_t first_child;
+    uint8_t next_sibling;
+} TrieNode;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+/** @brief The patterns.
+ *
+ * A token may have more than one pattern (e.g. with and without the channel
+ * number), but each must be of the same kind.
+ */
+static const struct {
+    char const *pattern;
+    ModemToken  token;
+    MatchKind   kind;
+} s_patterns[] = {
+    { "OK",                 MODEM_TOKEN_OK,             MATCH_LINE   },
+    { "FAIL",               MODEM_TOKEN_FAIL,           MATCH_LINE   },
+    { "ERROR",              MODEM_TOKEN_ERROR,          MATCH_LINE   },
+    { "busy p...",          MODEM_TOKEN_BUSY_P,         MATCH_LINE   },
+    { "SHUT OK",            MODEM_TOKEN_SHUT_OK,        MATCH_LINE   },
+    { "CONNECT",            MODEM_TOKEN_CONNECT,        MATCH_LINE   },
+    { "CONNECT FAIL",       MODEM_TOKEN_CONNECT_FAIL,   MATCH_LINE   },
+    { "CLOSE OK",           MODEM_TOKEN_CLOSE_OK,       MATCH_LINE   },
+    { "CLOSED",             MODEM_TOKEN_CLOSED,         MATCH_LINE   },
+    { "%d, CONNECT OK",     MODEM_TOKEN_CONNECT_OK,     MATCH_LINE   },
+    { "%d, CONNECT FAIL",   MODEM_TOKEN_CONNECT_FAIL,   MATCH_LINE   },
+    { "%d, CLOSE OK",       MODEM_TOKEN_CLOSE_OK,       MATCH_LINE   },
+    { "%d, CLOSED",         MODEM_TOKEN_CLOSED,         MATCH_LINE   },
+    { "%d, SEND OK",        MODEM_TOKEN_SEND_OK,        MATCH_LINE   },
+    { "%d, SEND FAIL",      MODEM_TOKEN_SEND_FAIL,      MATCH_LINE   },
+    { "DATA ACCEPT:%d,%d",  MODEM_TOKEN_DATA_ACCEPT,    MATCH_LINE   },
+    { "+RECEIVE,%d,%d:",    MODEM_TOKEN_RECEIVE,        MATCH_PREFIX },
+    { "RDY",                MODEM_TOKEN_RDY,            MATCH_LINE   },
+    { "Call Ready",         MODEM_TOKEN_CALL_READY,     MATCH_LINE   },
+    { "SMS Ready",          MODEM_TOKEN_SMS_READY,      MATCH_LINE   },
+    { "+CREG: %d",          MODEM_TOKEN_CREG,           MATCH_LINE   },
+    { "+CREG: %d,%d",       MODEM_TOKEN_CREG,           MATCH_LINE   },
+    { "+CGATT: %d",         MODEM_TOKEN_CGATT,          MATCH_LINE   },
+
+    /* Quectel EC2x (QI socket commands) */
+    { "SEND OK",            MODEM_TOKEN_SEND_OK,        MATCH_LINE   },
+    { "SEND FAIL",          MODEM_TOKEN_SEND_FAIL,      MATCH_LINE   },
+    { "+QIOPEN: %d,0",      MODEM_TOKEN_CONNECT_OK,     MATCH_LINE   },
+    { "+QIOPEN: %d,%d",     MODEM_TOKEN_CONNECT_FAIL,   MATCH_LINE   },
+    { "+QIURC: \"closed\",%d", MODEM_TOKEN_CLOSED,     MATCH_LINE   },
+    { "+QIURC: \"recv\",%d,%d", MODEM_TOKEN_RECEIVE_LINE, MATCH_LINE },
+    { "+QIND: SMS DONE",    MODEM_TOKEN_SMS_READY,      MATCH_LINE   },
+    { "+CEREG: %d",         MODEM_TOKEN_CREG,           MATCH_LINE   },
+    { "+CEREG: %d,%d",      MODEM_TOKEN_CREG,           MATCH_LINE   },
+};
+
+
+static char const * const s_token_names[NUM_MODEM_TOKENS] = {
+    [MODEM_TOKEN_NONE]          = "NONE",
+    [MODEM_TOKEN_OK]            = "OK",
+    [MODEM_TOKEN_FAIL]          = "FAIL",
+    [MODEM_TOKEN_ERROR]         = "ERROR",
+    [MODEM_TOKEN_BUSY_P]        = "BUSY_P",
+    [MODEM_TOKEN_SHUT_OK]       = "SHUT_OK",
+    [MODEM_TOKEN_CONNECT]       = "CONNECT",
+    [MODEM_TOKEN_CONNECT_OK]    = "CONNECT_OK",
+    [MODEM_TOKEN_CONNECT_FAIL]  = "CONNECT_FAIL",
+    [MODEM_TOKEN_CLOSE_OK]      = "CLOSE_OK",
+    [MODEM_TOKEN_CLOSED]        = "CLOSED",
+    [MODEM_TOKEN_SEND_OK]       = "SEND_OK",
+    [MODEM_TOKEN_SEND_FAIL]     = "SEND_FAIL",
+    [MODEM_TOKEN_DATA_ACCEPT]   = "DATA_ACCEPT",
+    [MODEM_TOKEN_RECEIVE]       = "RECEIVE",
+    [MODEM_TOKEN_RECEIVE_LINE]  = "RECEIVE_LINE",
+    [MODEM_TOKEN_RDY]           = "RDY",
+    [MODEM_TOKEN_CALL_READY]    = "CALL_READY",
+    [MODEM_TOKEN_SMS_READY]     = "SMS_READY",
+    [MODEM_TOKEN_CREG]          = "CREG",
+    [MODEM_TOKEN_CGATT]         = "CGATT",
+};
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+static TrieNode s_trie[MODEM_URC_MATCHER_MAX_NODES];
+static uint32_t s_trie_size=0U;
+
+/** @brief Match kind for each token (looked up when a token is reached) */
+static uint8_t s_token_kind[NUM_MODEM_TOKENS];
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static uint8_t find_child__(uint8_t parent, uint8_t ch);
+static uint8_t add_child__(uint8_t parent, uint8_t ch);
+static bool add_pattern__(char const *pattern, ModemToken token);
+static inline bool is_digit__(uint8_t ch);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+#if ( MODEM_URC_MATCHER_MAX_NODES > 255U )
+#error "MODEM_URC_MATCHER_MAX_NODES must fit in a uint8_t"
+#endif
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+bool ModemUrcMatcher_init(void)
+{
+    bool success=true;
+
+    /* Start with just the root node */
+    s_trie_size = 1U;
+    s_trie[0].ch           = 0U;
+    s_trie[0].token        = MODEM_TOKEN_NONE;
+    s_trie[0].first_child  = NO_NODE;
+    s_trie[0].next_sibling = NO_NODE;
+
+    for(uint32_t ii=0U; ii<( sizeof(s_patterns) / sizeof(s_patterns[0]) ); ii++)
+    {
+        s_token_kind[s_patterns[ii].token] = (uint8_t) s_patterns[ii].kind;
+        success &= add_pattern__(s_patterns[ii].pattern, s_patterns[ii].token);
+    }
+
+    return success;
+}
+/******************************************************************************/
+void ModemUrcMatcher_reset(ModemUrcMatcher *p_self)
+{
+    if(p_self)
+    {
+        p_self->node         = 0U;
+        p_self->failed       = false;
+        p_self->num_captures = 0U;
+    }
+}
+/******************************************************************************/
+ModemToken ModemUrcMatcher_feed(ModemUrcMatcher *p_self, uint8_t ch)
+{
+    ModemToken token=MODEM_TOKEN_NONE;
+
+    if( (p_self) && (!p_self->failed) )
+    {
+        uint8_t node = p_self->node;
+
+        if( node == 0U )
+        {
+            /* First character of a new line -- forget the last line's values */
+            p_self->num_captures = 0U;
+        }
+
+        if(
+                ( s_trie[node].ch == MATCH_DIGITS ) &&
+                ( node != 0U ) &&
+                ( is_digit__(ch) )
+        )
+        {
+            /* Still in a run of digits -- accumulate the captured value */
+            uint32_t idx = p_self->num_captures - 1U;
+            p_self->captures[idx] = ( p_self->captures[idx] * 10U ) + (uint32_t) ( ch - '0' );
+        }
+        else
+        {
+            uint8_t next = find_child__(node, ch);
+
+            if( ( next == NO_NODE ) && ( is_digit__(ch) ) )
+            {
+                /* Not a literal digit -- try the start of a '%d' */
+                next = find_child__(node, MATCH_DIGITS);
+
+                if( next != NO_NODE )
+                {
+                    if( p_self->num_captures < MODEM_URC_MATCHER_MAX_CAPTURES )
+                    {
+                        p_self->captures[p_self->num_captures] = (uint32_t) ( ch - '0' );
+                        p_self->num_captures++;
+                    }
+                    else
+                    {
+                        /* pattern has too many '%d' */
+                        next = NO_NODE;
+                    }
+                }
+            }
+
+            if( next == NO_NODE )
+            {
+                /* The line does not match any pattern */
+                p_self->failed = true;
+            }
+            else
+            {
+                p_self->node = next;
+
+                if(
+                        ( s_trie[next].token != MODEM_TOKEN_NONE ) &&
+                        ( s_token_kind[s_trie[next].token] == MATCH_PREFIX )
+                )
+                {
+                    /* Prefix pattern matched -- ignore the rest of the line */
+                    token = (ModemToken) s_trie[next].token;
+                    p_self->failed = true;
+                }
+            }
+        }
+    }
+
+    return token;
+}
+/******************************************************************************/
+ModemToken ModemUrcMatcher_end_of_line(ModemUrcMatcher *p_self)
+{
+    ModemToken token=MODEM_TOKEN_NONE;
+
+    if(p_self)
+    {
+        if(
+                ( !p_self->failed ) &&
+                ( s_trie[p_self->node].token != MODEM_TOKEN_NONE ) &&
+                ( s_token_kind[s_trie[p_self->node].token] == MATCH_LINE )
+        )
+        {
+            token = (ModemToken) s_trie[p_self->node].token;
+        }
+
+        /* Ready for next line -- but keep the captured values until the
+         * first character of the next line arrives.
+         */
+        p_self->node   = 0U;
+        p_self->failed = false;
+
+        if( token == MODEM_TOKEN_NONE )
+        {
+            p_self->num_captures = 0U;
+        }
+    }
+
+    return token;
+}
+/******************************************************************************/
+uint32_t ModemUrcMatcher_get_capture(ModemUrcMatcher const *p_self, uint32_t index)
+{
+    if(
+            ( p_self ) &&
+            ( index < p_self->num_captures )
+    )
+    {
+        return p_self->captures[index];
+    }
+
+    return 0U;
+}
+/******************************************************************************/
+uint32_t ModemUrcMatcher_get_num_captures(ModemUrcMatcher const *p_self)
+{
+    return (p_self) ? p_self->num_captures : 0U;
+}
+/******************************************************************************/
+char const* ModemUrcMatcher_token_name(ModemToken token)
+{
+    if( ( token < NUM_MODEM_TOKENS ) && ( s_token_names[token] ) )
+    {
+        return s_token_names[token];
+    }
+
+    return "?";
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static uint8_t find_child__(uint8_t parent, uint8_t ch)
+{
+    for(uint8_t iter=s_trie[parent].first_child; iter!=NO_NODE; iter=s_trie[iter].next_sibling)
+    {
+        if( s_trie[iter].ch == ch )
+        {
+            return iter;
+        }
+    }
+
+    return NO_NODE;
+}
+/******************************************************************************/
+static uint8_t add_child__(uint8_t parent, uint8_t ch)
+{
+    uint8_t child = find_child__(parent, ch);
+
+    if( child == NO_NODE )
+    {
+        /* The trie is full if the table of patterns is too big */
+        if( s_trie_size < MODEM_URC_MATCHER_MAX_NODES )
+        {
+            child = (uint8_t) s_trie_size;
+            s_trie_size++;
+
+            s_trie[child].ch           = ch;
+            s_trie[child].token        = MODEM_TOKEN_NONE;
+            s_trie[child].first_child  = NO_NODE;
+            s_trie[child].next_sibling = s_trie[parent].first_child;
+
+            s_trie[parent].first_child = child;
+        }
+    }
+
+    return child;
+}
+/******************************************************************************/
+static bool add_pattern__(char const *pattern, ModemToken token)
+{
+    uint8_t node=0U;
+
+    while( *pattern != '\0' )
+    {
+        uint8_t ch = (uint8_t) *pattern;
+
+        if( ( pattern[0] == '%' ) && ( pattern[1] == 'd' ) )
+        {
+            ch = MATCH_DIGITS;
+            pattern++;
+        }
+
+        pattern++;
+
+        node = add_child__(node, ch);
+
+        if( node == NO_NODE )
+        {
+            /* ran out of space */
+            return false;
+        }
+    }
+
+    if(
+            ( node == 0U ) ||
+            ( s_trie[node].token != MODEM_TOKEN_NONE )
+    )
+    {
+        /* Empty pattern, or the same pattern is in the table twice */
+        return false;
+    }
+
+    s_trie[node].token = (uint8_t) token;
+
+    return true;
+}
+/******************************************************************************/
+static inline bool is_digit__(uint8_t ch)
+{
+    return ( ( ch >= '0' ) && ( ch <= '9' ) );
+}
+/******************************************************************************/
@@ -18,9 +18,11 @@
 #include "alc_eat_string_tokens.h"
 #include "alc_ipaddr_snprintf.h"
 #include "alc_logger.h"
+#include "alc_rtcc.h"
 #include "alc_string.h"
 #include "cmsis_os.h"
 #include "data_upload_msg.h"
+#include "deferred_log.h"
 #include "FreeRTOS.h"
 #include "gps_time_ctrl.h"
 #include "modem_ctrl.h"
@@ -31,6 +33,10 @@
 #include "sensor_node_list.h"
 #include "stm32xxxx_hal_cortex.h"
 #include "sys/clock.h"
+#include "timer_wheel.h"
+#include "upload_backlog.h"
+#include "upload_metrics.h"
+#include "upload_window.h"
 
 
 #define DEBUG_DONT_SEND_DATA_TO_CLOUD 0
@@ -68,11 +74,19 @@
 #endif
 
 
-/** @def   DUC_RUN_CHECKS_INTERVAL_S
- *  @brief How often (in seconds) to send do housekeeping checks on nodes
+/** @def   DUC_GATEWAY_MSG_INTERVAL_S
+ *  @brief How often (in seconds) to send the Gateway message to the cloud
  */
-#ifndef DUC_RUN_CHECKS_INTERVAL_S
-#error "DUC_RUN_CHECKS_INTERVAL_S has not been defined in data_upload_client_conf.h"
+#ifndef DUC_GATEWAY_MSG_INTERVAL_S
+#error "DUC_GATEWAY_MSG_INTERVAL_S has not been defined in data_upload_client_conf.h"
+#endif
+
+
+/** @def   DUC_METRICS_MSG_INTERVAL_S
+ *  @brief How often (in seconds) to send the Upload Metrics message to the cloud
+ */
+#ifndef DUC_METRICS_MSG_INTERVAL_S
+#error "DUC_METRICS_MSG_INTERVAL_S has not been defined in data_upload_client_conf.h"
 #endif
 
 
@@ -92,6 +106,11 @@
 #endif
 
 
+#ifndef SENSOR_NODE_LIST_SIZE
+#error "SENSOR_NODE_LIST_SIZE has not been defined in contiki-conf.h"
+#endif
+
+
 
 
 /*******************************************************************************
@@ -111,6 +130,23 @@ typedef struct {
 } IPConnection;
 
 
+/** @brief The deadlines kept for the node in the same place in the node list */
+typedef struct {
+    SensorNode      *p_sensor_node;
+    TimerWheelEntry  long_msg;          /**< @brief Time to send the long Node message */
+    TimerWheelEntry  comms;             /**< @brief Time the node goes stale, or is lost */
+    bool             is_due_long_msg;   /**< @brief The long_msg entry has fired */
+} NodeTimers;
+
+
+/** @brief The samples in an upload, for the metrics once it has got there */
+typedef struct {
+    uint32_t         index;             /**< @brief The node's place in the list */
+    uint32_t         num_samples;
+    uint32_t         ts_seconds[DUC_MAX_DATA_MSGS_PER_UPLOAD];
+} UploadSamples;
+
+
 
 
 /*******************************************************************************
@@ -129,9 +165,64 @@ extern osMessageQId g_data_upload_client_rx_queueHandle;
 static char s_request_str[1500];
 static bool s_need_retransmit_data=false;
 
+static bool s_use_udp = ( DUC_ENABLE_UDP != 0 );    /**< @brief Open a UDP link next time */
+static bool s_link_is_udp=false;                    /**< @brief The link was opened with Modem_udp_open() */
+
 
-static uint32_t s_last_gateway_tx_s=0U;
-static uint32_t s_hourly_s=0U;
+#if DUC_ENABLE_UDP
+/** @brief The datagrams sent on the UDP link that the server has not
+ *         acknowledged yet (they are kept when the link is closed).
+ */
+static struct {
+    UploadWindow window;
+    uint32_t     num_expired;   /**< @brief window.num_expired when last logged */
+} s_udp;
+#endif
+
+
+/** @brief A Node message and the Data messages that follow it.
+ *
+ * Each message is formatted into its own buffer, and the buffers are passed
+ * to the modem as one scatter-gather write -- so they are not copied into
+ * one string first. The last upload is kept here until it has been sent, so
+ * it can be retransmitted if the write fails.
+ */
+static struct {
+    char       node_msg[256];
+    char       data_msg[DUC_MAX_DATA_MSGS_PER_UPLOAD][DATA_UPLOAD_MSG_DATA_MAX_LEN];
+    ModemIoVec iov[1U + DUC_MAX_DATA_MSGS_PER_UPLOAD];
+    uint32_t   iovcnt;      /**< @brief Number of entries used in iov[] */
+    uint32_t   len;         /**< @brief Total number of bytes in iov[] */
+    UploadSamples samples;  /**< @brief The samples in the Data messages */
+} s_node_upload;
+
+
+/** @brief Where the last buffer sent to the modem sits in the channel's byte
+ *         count -- used to check that it was acknowledged by the server.
+ */
+static struct {
+    uint32_t start;         /**< @brief Modem_tcp_get_sent() before the buffer */
+    uint32_t end;           /**< @brief Modem_tcp_get_sent() after the buffer */
+} s_last_upload;
+
+
+/** @brief In quick send mode, copies of the uploads of node data that the
+ *         server has not acknowledged yet. The modem takes up to its send
+ *         window ahead of the acks, so there may be several -- they are all
+ *         sent again when the link is next opened.
+ */
+static UploadBacklog s_backlog;
+static UploadSamples s_backlog_samples[UPLOAD_BACKLOG_MAX_UPLOADS];    /**< @brief In each upload kept */
+
+
+/** @brief The periodic work -- only the entries that are due are looked at,
+ *         rather than every node on every pass.
+ */
+static TimerWheel      s_timer_wheel;
+static TimerWheelEntry s_gateway_msg_timer;
+static TimerWheelEntry s_metrics_msg_timer;
+static NodeTimers      s_node_timers[SENSOR_NODE_LIST_SIZE];
+static bool            s_have_nodes_for_deleting=false;
 
 
 /** @brief A buffer to hold text lines received from the Cloud Server */
@@ -149,17 +240,39 @@ static struct {
 
 static bool modem_is_ready__(void);
 static bool connect_to_server__(IPConnection const *p_connection);
-static bool node_is_due_long_msg(SensorNode const *p_sensor_node);
+static void init_timers__(void);
+static void start_node_timers__(uint32_t index, SensorNode *p_sensor_node);
+static void gateway_msg_timer_fired__(TimerWheelEntry *p_entry);
+static void metrics_msg_timer_fired__(TimerWheelEntry *p_entry);
+static void long_msg_timer_fired__(TimerWheelEntry *p_entry);
+static void comms_timer_fired__(TimerWheelEntry *p_entry);
+static bool node_is_due_long_msg(uint32_t index);
 static void mark_all_nodes_as_dirty__(void);
 static bool mark_node_as_dirty__(uint32_t index, SensorNode *p_sensor_node);
 static void poll_nodes__(void);
 static bool process_node__(uint32_t index, SensorNode *p_sensor_node);
-static void do_hourly_checks__(void);
-static bool check_node_lost_comms__(uint32_t index, SensorNode *p_sensor_node);
+static void remove_deleted_nodes__(void);
+static void check_node_lost_comms__(NodeTimers *p_timers);
 static bool upload_buffer_to_cloud__(bool write_log);
+static bool upload_iov_to_cloud__(ModemIoVec const *p_iov, uint32_t iovcnt, bool write_log);
+#if DUC_ENABLE_UDP
+static bool send_datagram__(ModemIoVec const *p_iov, uint32_t iovcnt, bool write_log);
+static bool write_datagram__(UploadWindowSlot *p_slot);
+#endif
+static void resend_due_datagrams__(void);
+static bool backlog_is_used__(void);
+static uint32_t backlog_room__(void);
+static void keep_upload__(ModemIoVec const *p_iov, uint32_t iovcnt, UploadSamples const *p_samples);
+static void ack_backlog__(uint32_t acked);
+static void record_samples__(UploadSamples const *p_samples);
+static void resend_backlog__(void);
+static void check_uploads_were_acked__(void);
 static bool send_security_string_msg__(void);
 static bool send_gateway_msg__(void);
+static bool send_upload_metrics_msg__(void);
+static uint32_t utc_now__(void);
 static uint32_t tcp_link_send_size__(void);
+static uint32_t upload_send_size__(void);
 static bool tcp_link_is_open__(void);
 static bool print_ip_status_line__(char const *str);
 static void dump_ip_status__(void);
@@ -167,6 +280,7 @@ static void command_line_reset__(void);
 static void command_line_push_back__(uint8_t ch);
 static void process_char_from_server__(char ch);
 static void check_tim_reply__(char const *str);
+static void check_ack_reply__(char const *str);
 
 
 
@@ -198,14 +312,23 @@ void HttpServer_connection_closed(void)
 void DataUploadClient_task(void const * argument)
 {
     uint32_t count_open_failures=0U;
+    uint32_t count_not_ready=0U;
+    bool modem_was_ready;
     IPConnection cloud_connection;
 
     osDelay(1000u);
 
-    s_hourly_s = clock_seconds();
+    init_timers__();
+    UploadMetrics_init(clock_seconds());
     command_line_reset__();
 
     s_need_retransmit_data = false;
+    UploadBacklog_init(&s_backlog);
+
+#if DUC_ENABLE_UDP
+    UploadWindow_init(&s_udp.window, 0U);
+    s_udp.num_expired = 0U;
+#endif
 
 
 #if DEBUG_DONT_SEND_DATA_TO_CLOUD
@@ -235,20 +358,32 @@ void DataUploadClient_task(void const * argument)
         /* run the data upload client */
 
         /* Test if Modem needs to be reset */
-        if( count_open_failures >= DUC_RETRY_OPEN_LIMIT )
+        if( count_not_ready >= DUC_RETRY_OPEN_LIMIT )
         {
             /* Have exceeded the limit...
              * reset the modem to try to clear the fault
              */
-            count_open_failures=0U;
+            count_not_ready=0U;
             ModemCtrl_restart_modem();
         }
 
 
-        if( !modem_is_ready__() )
+        /* Re-opening the socket hasn't worked -- the modem controller tries
+         * the next tier of recovery (re-attach PDP, soft reset, hard reset).
+         */
+        if( count_open_failures >= DUC_RECOVER_OPEN_LIMIT )
+        {
+            count_open_failures=0U;
+            ModemCtrl_request_recovery();
+        }
+
+
+        modem_was_ready = modem_is_ready__();
+
+        if( !modem_was_ready )
         {
             /* The modem is not ready yet */
-            count_open_failures++;
+            count_not_ready++;
         }
         else
         {
@@ -278,36 +413,60 @@ void DataUploadClient_task(void const * argument)
                 /* We are now connected to the Cloud server
                  */
                 count_open_failures=0U;
+                count_not_ready=0U;
+                ModemCtrl_link_opened();
 
                 PRINTF("DataUploadClient -- opened TCP link success\r\n");
                 AlcLogger_log_info("Data Upload Client successfully opened TCP link to server");
 
 
+                /**** resend what the server didn't acknowledge ****/
+                resend_backlog__();
+
+
                 /**** resend string to the cloud server ****/
                 if( s_need_retransmit_data )
                 {
-                    uint32_t len = strlen(s_request_str);
-
-                    if( ( len > 0U ) && ( len < sizeof(s_request_str) ) )
+                    if( s_node_upload.len > 0U )
                     {
                         /* Send buffer contents to cloud */
-                        PRINTF("Sending %u bytes to cloud\r\n", len);
-                        AlcLogger_log_info("Retransmitting data to server");
-                        upload_buffer_to_cloud__(true);
-                        s_need_retransmit_data = false;
+                        PRINTF("Sending %u bytes to cloud\r\n", s_node_upload.len);
+                        DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_DUC_RETRANSMITTING);
+                        UploadMetrics_retransmission();
+
+                        if( upload_iov_to_cloud__(s_node_upload.iov, s_node_upload.iovcnt, true) )
+                        {
+                            keep_upload__(s_node_upload.iov, s_node_upload.iovcnt, &s_node_upload.samples);
+                        }
                     }
+
+                    s_need_retransmit_data = false;
                 }
 
 
-                /**** send security string to the cloud server ****/
-                PRINTF("DataUploadClient -- sending security string\r\n");
-                if( send_security_string_msg__() )
+#if DUC_ENABLE_UDP
+                /**** send again what the server didn't acknowledge ****/
+                if( s_link_is_udp )
                 {
-                    PRINTF("DataUploadClient -- success, sent security string ok\r\n");
+                    UploadWindow_resend_all(&s_udp.window, osKernelSysTick());
+                    resend_due_datagrams__();
                 }
-                else
+#endif
+
+
+                /**** send security string to the cloud server ****/
+                /* (on a UDP link every datagram starts with it) */
+                if( !s_link_is_udp )
                 {
-                    PRINTF("DataUploadClient -- error, failed to send security string!\r\n");
+                    PRINTF("DataUploadClient -- sending security string\r\n");
+                    if( send_security_string_msg__() )
+                    {
+                        PRINTF("DataUploadClient -- success, sent security string ok\r\n");
+                    }
+                    else
+                    {
+                        PRINTF("DataUploadClient -- error, failed to send security string!\r\n");
+                    }
                 }
 
 
@@ -326,7 +485,8 @@ void DataUploadClient_task(void const * argument)
                 mark_all_nodes_as_dirty__();
 
 
-                s_last_gateway_tx_s = clock_seconds();
+                TimerWheel_arm(&s_timer_wheel, &s_gateway_msg_timer, ( clock_seconds() + DUC_GATEWAY_MSG_INTERVAL_S ));
+                TimerWheel_arm(&s_timer_wheel, &s_metrics_msg_timer, ( clock_seconds() + DUC_METRICS_MSG_INTERVAL_S ));
 
 
                 command_line_reset__();
@@ -344,10 +504,14 @@ void DataUploadClient_task(void const * argument)
                         process_char_from_server__(ch);
                     }
 
+                    resend_due_datagrams__();
                     poll_nodes__();
                 }
 
 
+                check_uploads_were_acked__();
+
+
                 /* Make sure the TCP link is closed */
                 PRINTF("DataUploadClient -- closing TCP link...\r\n");
                 if( Modem_tcp_close(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, 10000) )
@@ -359,7 +523,7 @@ void DataUploadClient_task(void const * argument)
                     PRINTF("DataUploadClient -- closed TCP link failed!\r\n");
                 }
 
-                AlcLogger_log_warning("Data Upload Client detected TCP link to server has been closed");
+                DEFERRED_LOG(ALC_LOGGER_WARNING, LOG_ID_DUC_LINK_CLOSED);
             }
             else
             {
@@ -370,8 +534,19 @@ void DataUploadClient_task(void const * argument)
             }
         }
 
-        PRINTF("DataUploadClient -- will try to open the TCP link in 30 seconds\r\n");
-        osDelay(DUC_RETRY_OPEN_PERIOD_MS);
+        if( modem_was_ready )
+        {
+            PRINTF("DataUploadClient -- will try to open the TCP link in 30 seconds\r\n");
+            osDelay(DUC_RETRY_OPEN_PERIOD_MS);
+        }
+        else
+        {
+            /* Try again the moment the modem is ready, rather than waiting
+             * for the rest of the retry period.
+             */
+            PRINTF("DataUploadClient -- waiting for the modem\r\n");
+            (void) ModemCtrl_wait_for_ready(DUC_RETRY_OPEN_PERIOD_MS);
+        }
 #endif
     } /* for() */
 
@@ -384,6 +559,11 @@ void DataUploadClient_task(void const * argument)
     HAL_NVIC_SystemReset();
 }
 /******************************************************************************/
+void DataUploadClient_set_udp(bool enable)
+{
+    s_use_udp = ( enable ) && ( DUC_ENABLE_UDP != 0 );
+}
+/******************************************************************************/
 
 
 
@@ -445,7 +625,7 @@ static bool connect_to_server__(IPConnection const *p_connection)
          * Just close it here
          * Assume our state has got out of sync with the modem's state
          */
-        AlcLogger_log_warning("Data Upload Client forcing TCP closed");
+        DEFERRED_LOG(ALC_LOGGER_WARNING, LOG_ID_DUC_FORCING_CLOSED);
         if( Modem_tcp_close(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, 10000) )
         {
             PRINTF("Data Upload Client -- closed TCP link ok\r\n");
@@ -460,6 +640,10 @@ static bool connect_to_server__(IPConnection const *p_connection)
     {
         uint8_t server[18];
 
+        /* There are no datagrams in transparent mode -- just a byte stream */
+        s_link_is_udp = ( s_use_udp ) && ( !Modem_transparent_mode_is_enabled() );
+        char const *p_protocol = ( s_link_is_udp ) ? "UDP" : "TCP";
+
         /* get IP address as a string */
         snprintf(server, sizeof(server),
                 "%u.%u.%u.%u",
@@ -468,36 +652,119 @@ static bool connect_to_server__(IPConnection const *p_connection)
                 p_connection->ipv4_address[2],
                 p_connection->ipv4_address[3]);
 
-        PRINTF("Data Upload Client opening TCP link to '%s:%u'", server, p_connection->portnum);
-        success = Modem_tcp_open(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, server, p_connection->portnum, 10000);
+        PRINTF("Data Upload Client opening %s link to '%s:%u'", p_protocol, server, p_connection->portnum);
+
+        if(s_link_is_udp)
+        {
+            success = Modem_udp_open(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, server, p_connection->portnum, 10000);
+        }
+        else
+        {
+            success = Modem_tcp_open(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, server, p_connection->portnum, 10000);
+        }
 
         if(success)
         {
-            AlcLogger_log_printf(ALC_LOGGER_INFO, "Data Upload Client successfully opened TCP link to '%s:%u'", server, p_connection->portnum);
+            AlcLogger_log_printf(ALC_LOGGER_INFO, "Data Upload Client successfully opened %s link to '%s:%u'", p_protocol, server, p_connection->portnum);
         }
         else
         {
-            AlcLogger_log_printf(ALC_LOGGER_ERROR, "Data Upload Client failed to open TCP link to '%s:%u'", server, p_connection->portnum);
+            AlcLogger_log_printf(ALC_LOGGER_ERROR, "Data Upload Client failed to open %s link to '%s:%u'", p_protocol, server, p_connection->portnum);
         }
     }
 
     return success;
 }
 /******************************************************************************/
-static bool node_is_due_long_msg(SensorNode const *p_sensor_node)
+static void init_timers__(void)
 {
-    if(p_sensor_node)
+    TimerWheel_init(&s_timer_wheel, clock_seconds());
+    TimerWheelEntry_init(&s_gateway_msg_timer, &gateway_msg_timer_fired__, NULL);
+    TimerWheelEntry_init(&s_metrics_msg_timer, &metrics_msg_timer_fired__, NULL);
+
+    for(uint32_t ii=0U; ii<SENSOR_NODE_LIST_SIZE; ii++)
     {
-        if(
-                ( p_sensor_node->last_long_msg_s == 0U ) ||
-                ( ( clock_seconds() - p_sensor_node->last_long_msg_s ) >= DUC_NODE_LONG_MSG_INTERVAL_S )
-        )
+        NodeTimers *p_timers = &s_node_timers[ii];
+
+        p_timers->p_sensor_node   = NULL;
+        p_timers->is_due_long_msg = false;
+        TimerWheelEntry_init(&p_timers->long_msg, &long_msg_timer_fired__, p_timers);
+        TimerWheelEntry_init(&p_timers->comms, &comms_timer_fired__, p_timers);
+    }
+
+    s_have_nodes_for_deleting = false;
+}
+/******************************************************************************/
+/* Called each time a node is processed -- only does anything the first time a
+ * node is seen in this place in the node list, or after its comms deadline
+ * has been dropped.
+ */
+static void start_node_timers__(uint32_t index, SensorNode *p_sensor_node)
+{
+    NodeTimers *p_timers = &s_node_timers[index];
+
+    if(
+            ( p_timers->p_sensor_node != p_sensor_node ) ||
+            ( !TimerWheelEntry_is_armed(&p_timers->comms) )
+    )
+    {
+        uint32_t seconds_since_last_msg_rx = SensorNode_seconds_since_last_msg_rx(p_sensor_node);
+        uint32_t now_s                     = clock_seconds();
+
+        if( p_timers->p_sensor_node != p_sensor_node )
         {
-            return true;
+            /* The lag kept for this place was for another node */
+            UploadMetrics_reset_node(index);
         }
+
+        p_timers->p_sensor_node = p_sensor_node;
+
+        /* check_node_lost_comms__() moves the deadline on as the node goes
+         * stale and then lost.
+         */
+        TimerWheel_arm(&s_timer_wheel, &p_timers->comms, ( now_s - seconds_since_last_msg_rx + DUC_LOOSING_CONN_INTERVAL_S ));
+    }
+}
+/******************************************************************************/
+static void gateway_msg_timer_fired__(TimerWheelEntry *p_entry)
+{
+    send_gateway_msg__();
+
+    TimerWheel_arm(&s_timer_wheel, p_entry, ( clock_seconds() + DUC_GATEWAY_MSG_INTERVAL_S ));
+}
+/******************************************************************************/
+static void metrics_msg_timer_fired__(TimerWheelEntry *p_entry)
+{
+    send_upload_metrics_msg__();
+
+    TimerWheel_arm(&s_timer_wheel, p_entry, ( clock_seconds() + DUC_METRICS_MSG_INTERVAL_S ));
+}
+/******************************************************************************/
+/* Re-armed when the long message is sent */
+static void long_msg_timer_fired__(TimerWheelEntry *p_entry)
+{
+    NodeTimers *p_timers = (NodeTimers*) p_entry->p_context;
+
+    p_timers->is_due_long_msg = true;
+
+    if( SNL_get_index(p_timers->p_sensor_node, NULL) )
+    {
+        SensorNode_mark_as_ready(p_timers->p_sensor_node);
     }
+}
+/******************************************************************************/
+static void comms_timer_fired__(TimerWheelEntry *p_entry)
+{
+    check_node_lost_comms__((NodeTimers*) p_entry->p_context);
+}
+/******************************************************************************/
+static bool node_is_due_long_msg(uint32_t index)
+{
+    NodeTimers const *p_timers = &s_node_timers[index];
 
-    return false;
+    /* A node that has not had a long message yet has no deadline */
+    return ( p_timers->is_due_long_msg ) ||
+           ( !TimerWheelEntry_is_armed(&p_timers->long_msg) );
 }
 /******************************************************************************/
 static void mark_all_nodes_as_dirty__(void)
@@ -514,23 +781,47 @@ static bool mark_node_as_dirty__(uint32_t index, SensorNode *p_sensor_node)
 /******************************************************************************/
 static void poll_nodes__(void)
 {
-    /* Process each node */
-    SNL_for_each_node(&process_node__);
+    /* Process the nodes with work -- an idle node isn't looked at. A node
+     * that still has data goes to the back of the list, so each node in the
+     * list is processed at most once per pass.
+     */
+    for(uint32_t num_ready = SensorNode_get_num_ready(); num_ready > 0U; num_ready--)
+    {
+        SensorNode *p_sensor_node = SensorNode_pop_ready();
+        uint32_t    index;
 
+        if( p_sensor_node == NULL )
+        {
+            break;
+        }
 
-    /* Send gateway info every 10 minutes */
-    if( ( clock_seconds() - s_last_gateway_tx_s ) >= (DUC_GATEWAY_MSG_INTERVAL_S) )
-    {
-        send_gateway_msg__();
-        s_last_gateway_tx_s = clock_seconds();
+        if( !SNL_get_index(p_sensor_node, &index) )
+        {
+            /* The node has been deleted */
+            continue;
+        }
+
+        if( !process_node__(index, p_sensor_node) )
+        {
+            /* Try again when the link is next open */
+            SensorNode_mark_as_ready(p_sensor_node);
+            break;
+        }
+
+        if( SensorNode_get_data_size(p_sensor_node) > 0U )
+        {
+            SensorNode_mark_as_ready(p_sensor_node);
+        }
     }
 
 
-    /* Check every hour */
-    if( ( clock_seconds() - s_hourly_s ) >= (DUC_RUN_CHECKS_INTERVAL_S) )
+    /* Send the gateway info, and check on the nodes' comms, when it is due */
+    (void) TimerWheel_advance(&s_timer_wheel, clock_seconds());
+
+
+    if(s_have_nodes_for_deleting)
     {
-        do_hourly_checks__();
-        s_hourly_s = clock_seconds();
+        remove_deleted_nodes__();
     }
 }
 /******************************************************************************/
@@ -538,14 +829,17 @@ static bool process_node__(uint32_t index, SensorNode *p_sensor_node)
 {
     bool error_free=true;
 
-    if( p_sensor_node )
+    if( ( p_sensor_node ) && ( index < SENSOR_NODE_LIST_SIZE ) )
     {
-        uint32_t datalen = SensorNode_get_data_size(p_sensor_node);
+        uint32_t datalen   = SensorNode_get_data_size(p_sensor_node);
+        uint32_t send_size = upload_send_size__();
+
+        start_node_timers__(index, p_sensor_node);
 
-        if( tcp_link_send_size__() == 0U )
+        if( send_size == 0U )
         {
-            /* Detected TCP link is closed...
-             * can't send any data
+            /* Detected TCP link is closed (or every datagram, or the
+             * backlog, is waiting for an ack)... can't send any data
              */
             PRINTF("Detected TCP link is closed!\r\n");
             error_free = false;
@@ -557,17 +851,22 @@ static bool process_node__(uint32_t index, SensorNode *p_sensor_node)
             bool sending_node_message=false;
 
 
-            /* Initialise the buffer. We will write data to this buffer before
-             * sending the buffer contents to the Modem for transmission in one
-             * go.
+            /* Initialise the buffers. We will write each message to its own
+             * buffer before sending them all to the Modem for transmission in
+             * one go.
              */
-            s_request_str[0] = '\0';
+            s_node_upload.node_msg[0] = '\0';
+            s_node_upload.iovcnt      = 0U;
+            s_node_upload.len         = 0U;
+
+            s_node_upload.samples.index       = index;
+            s_node_upload.samples.num_samples = 0U;
 
 
             /* Test if we should send a Node message */
             if(
                     ( SensorNode_is_dirty(p_sensor_node) ) ||
-                    ( node_is_due_long_msg(p_sensor_node) )
+                    ( node_is_due_long_msg(index) )
             )
             {
                 /* Send long Node message...
@@ -575,8 +874,11 @@ static bool process_node__(uint32_t index, SensorNode *p_sensor_node)
                  */
                 SensorNode_clear_is_dirty(p_sensor_node);
                 sending_node_message = true;
-                prepare_node_long_msg(s_request_str, sizeof(s_request_str), p_sensor_node);
+                prepare_node_long_msg(s_node_upload.node_msg, sizeof(s_node_upload.node_msg), p_sensor_node);
                 p_sensor_node->last_long_msg_s = clock_seconds();
+
+                s_node_timers[index].is_due_long_msg = false;
+                TimerWheel_arm(&s_timer_wheel, &s_node_timers[index].long_msg, ( p_sensor_node->last_long_msg_s + DUC_NODE_LONG_MSG_INTERVAL_S ));
             }
             else if( datalen > 0U )
             {
@@ -584,7 +886,7 @@ static bool process_node__(uint32_t index, SensorNode *p_sensor_node)
                  * There will be data to follow this message
                  */
                 sending_node_message = true;
-                prepare_node_msg(s_request_str, sizeof(s_request_str), p_sensor_node);
+                prepare_node_msg(s_node_upload.node_msg, sizeof(s_node_upload.node_msg), p_sensor_node);
             }
             else
             {
@@ -594,6 +896,11 @@ static bool process_node__(uint32_t index, SensorNode *p_sensor_node)
 
             if(sending_node_message)
             {
+                s_node_upload.iov[0].p_base = s_node_upload.node_msg;
+                s_node_upload.iov[0].len    = strlen(s_node_upload.node_msg);
+                s_node_upload.iovcnt        = 1U;
+                s_node_upload.len           = s_node_upload.iov[0].len;
+
                 /* We are sending a Node message...
                  * If there is data for the Node, then send the data also...
                  */
@@ -604,38 +911,57 @@ static bool process_node__(uint32_t index, SensorNode *p_sensor_node)
                     PRINTF("uploading data to cloud\r\n");
 #endif
 
-                    // flush data
-                    uint32_t loopcount=0U;
-                    for(
-                            struct SensorData *p_sensor_data = SensorNode_remove_data(p_sensor_node);
-                            p_sensor_data != NULL;
-                            p_sensor_data = SensorNode_remove_data(p_sensor_node)
-                    )
+                    /* flush data...
+                     * A data object can't be put back once it's removed from
+                     * the Node, so stop while there is still room in the
+                     * modem's send buffer for the longest Data message.
+                     */
+                    for(uint32_t ii=0U; ii<DUC_MAX_DATA_MSGS_PER_UPLOAD; ii++)
                     {
+                        if( ( s_node_upload.len + DATA_UPLOAD_MSG_DATA_MAX_LEN ) > send_size )
+                        {
+                            break;
+                        }
+
+                        struct SensorData *p_sensor_data = SensorNode_remove_data(p_sensor_node);
+
+                        if( p_sensor_data == NULL )
+                        {
+                            break;
+                        }
+
 #if DEBUG_STREAM
                         PRINTF("  uploading data = %lu.%02u: %lu\r\n", p_sensor_data->ts_seconds, p_sensor_data->ts_hundreths, p_sensor_data->seq32);
 #endif
 
-                        uint32_t len = strlen(s_request_str);
+                        /* add Data message to its own buffer */
+                        ModemIoVec *p_iov = &s_node_upload.iov[s_node_upload.iovcnt];
+
+                        p_iov->p_base = s_node_upload.data_msg[ii];
+                        p_iov->len    = prepare_data_msg(s_node_upload.data_msg[ii], DATA_UPLOAD_MSG_DATA_MAX_LEN, p_sensor_data);
 
-                        /* add Data message to buffer */
-                        prepare_data_msg(&s_request_str[len], sizeof(s_request_str) - len, p_sensor_data);
+                        s_node_upload.iovcnt++;
+                        s_node_upload.len += p_iov->len;
+
+                        /* Counted in the metrics once it has got there */
+                        s_node_upload.samples.ts_seconds[s_node_upload.samples.num_samples] = p_sensor_data->ts_seconds;
+                        s_node_upload.samples.num_samples++;
 
                         /* return data object to the empty pool */
                         SensorDataPool_return(p_sensor_data);
-
-                        loopcount++;
-                        if( loopcount > 20U )
-                        {
-                            break;
-                        }
                     }
                 }
 
 
                 /* Send buffer contents to cloud */
-                PRINTF("Sending %u bytes to cloud\r\n", strlen(s_request_str));
-                error_free = upload_buffer_to_cloud__(true);
+                PRINTF("Sending %u bytes to cloud\r\n", s_node_upload.len);
+                error_free = upload_iov_to_cloud__(s_node_upload.iov, s_node_upload.iovcnt, true);
+
+                if( ( error_free ) && ( s_node_upload.iovcnt > 1U ) )
+                {
+                    /* Keep the data until the server has acknowledged it */
+                    keep_upload__(s_node_upload.iov, s_node_upload.iovcnt, &s_node_upload.samples);
+                }
 
                 if( (!error_free) && ( datalen > 0U ) )
                 {
@@ -652,23 +978,29 @@ static bool process_node__(uint32_t index, SensorNode *p_sensor_node)
     return error_free;
 }
 /******************************************************************************/
-static void do_hourly_checks__(void)
+static void remove_deleted_nodes__(void)
 {
-    PRINTF("Doing hourly checks\r\n");
+    uint32_t deleted_count = SNL_remove_deleted_nodes();
 
-    /* Process each node */
-    SNL_for_each_node(&check_node_lost_comms__);
+    s_have_nodes_for_deleting = false;
 
-    uint32_t deleted_count = SNL_remove_deleted_nodes();
     if( deleted_count > 0U )
     {
-        AlcLogger_log_printf(ALC_LOGGER_INFO, "Deleted %u nodes", deleted_count);
+        DEFERRED_LOG1(ALC_LOGGER_INFO, LOG_ID_DUC_NODES_DELETED, deleted_count);
     }
 }
 /******************************************************************************/
-static bool check_node_lost_comms__(uint32_t index, SensorNode *p_sensor_node)
+/* Called when the node's comms deadline is reached -- re-arms the deadline
+ * for the next step (stale, then lost) from when the node was last heard.
+ */
+static void check_node_lost_comms__(NodeTimers *p_timers)
 {
-    if( p_sensor_node )
+    SensorNode *p_sensor_node = p_timers->p_sensor_node;
+
+    /* The node has gone from this place in the list. The deadline is armed
+     * again when the next node here is processed.
+     */
+    if( ( p_sensor_node ) && ( p_sensor_node->is_used ) )
     {
         PRINTF("Checking ");
         PRINT6ADDR(&p_sensor_node->ipaddr);
@@ -688,6 +1020,10 @@ static bool check_node_lost_comms__(uint32_t index, SensorNode *p_sensor_node)
             AlcLogger_log_printf(ALC_LOGGER_INFO, "Node %s marked for deletion", ip_str);
 
             SensorNode_mark_for_deletion(p_sensor_node);
+            s_have_nodes_for_deleting = true;
+
+            TimerWheel_disarm(&s_timer_wheel, &p_timers->long_msg);
+            p_timers->is_due_long_msg = false;
 
             send_node_status_message = true;
         }
@@ -704,10 +1040,13 @@ static bool check_node_lost_comms__(uint32_t index, SensorNode *p_sensor_node)
             SensorNode_mark_as_stale(p_sensor_node);
 
             send_node_status_message = true;
+
+            TimerWheel_arm(&s_timer_wheel, &p_timers->comms, ( clock_seconds() - seconds_since_last_msg_rx + DUC_LOST_CONN_INTERVAL_S ));
         }
         else
         {
-            /* do nothing here */
+            /* Heard from the node since the deadline was set */
+            TimerWheel_arm(&s_timer_wheel, &p_timers->comms, ( clock_seconds() - seconds_since_last_msg_rx + DUC_LOOSING_CONN_INTERVAL_S ));
         }
 
 
@@ -722,14 +1061,49 @@ static bool check_node_lost_comms__(uint32_t index, SensorNode *p_sensor_node)
 }
 /******************************************************************************/
 static bool upload_buffer_to_cloud__(bool write_log)
+{
+    ModemIoVec iov;
+
+    iov.p_base = s_request_str;
+    iov.len    = strlen(s_request_str);
+
+    return upload_iov_to_cloud__(&iov, 1U, write_log);
+}
+/******************************************************************************/
+static bool upload_iov_to_cloud__(ModemIoVec const *p_iov, uint32_t iovcnt, bool write_log)
 {
 #if DEBUG_DONT_SEND_DATA_TO_CLOUD
     /* Just print data to the screen */
     bool success = true;
-    PRINTF(s_request_str);
+    uint32_t num_bytes = 0U;
+    for(uint32_t ii=0U; ii<iovcnt; ii++)
+    {
+        PRINTF("%.*s", (int) p_iov[ii].len, (char const*) p_iov[ii].p_base);
+        num_bytes += p_iov[ii].len;
+    }
+
+    UploadMetrics_upload_done(clock_seconds(), num_bytes, 0U, success);
 #else
+#if DUC_ENABLE_UDP
+    if(s_link_is_udp)
+    {
+        return send_datagram__(p_iov, iovcnt, write_log);
+    }
+#endif
+
     /* send data to the Modem */
-    bool success = Modem_tcp_write_str(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, s_request_str, 4000);
+    s_last_upload.start = Modem_tcp_get_sent(MODEM_CHANNEL_DATA_UPLOAD_CLIENT);
+
+    uint32_t start_ms = osKernelSysTick();
+
+    bool success = Modem_tcp_write_iov(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, p_iov, iovcnt, 4000);
+
+    s_last_upload.end = Modem_tcp_get_sent(MODEM_CHANNEL_DATA_UPLOAD_CLIENT);
+
+    UploadMetrics_upload_done(clock_seconds(),
+                              ( s_last_upload.end - s_last_upload.start ),
+                              ( osKernelSysTick() - start_ms ),
+                              success);
 #endif
 
     if(!success)
@@ -738,13 +1112,271 @@ static bool upload_buffer_to_cloud__(bool write_log)
 
         if(write_log)
         {
-            AlcLogger_log_error("Data Upload Client failed to send data to cloud");
+            DEFERRED_LOG(ALC_LOGGER_ERROR, LOG_ID_DUC_SEND_FAILED);
         }
     }
 
     return success;
 }
 /******************************************************************************/
+/* In quick send mode (on a TCP link) a successful write only means the modem
+ * has the data, so the uploads of node data are kept in the backlog until the
+ * server acknowledges them.
+ */
+static bool backlog_is_used__(void)
+{
+    return ( Modem_quick_send_is_enabled() ) && ( !s_link_is_udp );
+}
+/******************************************************************************/
+/* The room in the backlog, if it can take an upload with at least one Data
+ * message (0 if not). The server's acks are only fetched from the modem when
+ * the room is short.
+ */
+static uint32_t backlog_room__(void)
+{
+    uint32_t min_room = sizeof(s_node_upload.node_msg) + DATA_UPLOAD_MSG_DATA_MAX_LEN;
+
+    ack_backlog__(Modem_tcp_get_acked(MODEM_CHANNEL_DATA_UPLOAD_CLIENT));
+
+    if( UploadBacklog_room(&s_backlog) < min_room )
+    {
+        (void) Modem_tcp_update_ack(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, 1000U);
+        ack_backlog__(Modem_tcp_get_acked(MODEM_CHANNEL_DATA_UPLOAD_CLIENT));
+    }
+
+    return ( UploadBacklog_room(&s_backlog) < min_room ) ? 0U : UploadBacklog_room(&s_backlog);
+}
+/******************************************************************************/
+/* Copies the upload just sent into the backlog (upload_send_size__() has made
+ * sure there is room for it), with its samples -- they are counted in the
+ * metrics when the server acknowledges it. Without the backlog the write
+ * was all there is to it, so they are counted now.
+ */
+static void keep_upload__(ModemIoVec const *p_iov, uint32_t iovcnt, UploadSamples const *p_samples)
+{
+    bool success=true;
+
+    if( !backlog_is_used__() )
+    {
+        record_samples__(p_samples);
+        return;
+    }
+
+    for(uint32_t ii=0U; ( success ) && ( ii<iovcnt ); ii++)
+    {
+        success = UploadBacklog_append(&s_backlog, (char const*) p_iov[ii].p_base, p_iov[ii].len);
+    }
+
+    if(success)
+    {
+        s_backlog_samples[UploadBacklog_get_num_uploads(&s_backlog)] = *p_samples;
+        UploadBacklog_push(&s_backlog, s_last_upload.end);
+    }
+    else
+    {
+        /* It can't be sent again, so this write is all it gets */
+        UploadBacklog_cancel(&s_backlog);
+        record_samples__(p_samples);
+        PRINTF("Data Upload Client -- no room to keep the upload!\r\n");
+    }
+}
+/******************************************************************************/
+/* Frees the uploads the acks cover, oldest first, and counts their samples */
+static void ack_backlog__(uint32_t acked)
+{
+    uint32_t num_acked = UploadBacklog_ack(&s_backlog, acked);
+
+    if( num_acked > 0U )
+    {
+        for(uint32_t ii=0U; ii<num_acked; ii++)
+        {
+            record_samples__(&s_backlog_samples[ii]);
+        }
+
+        memmove(&s_backlog_samples[0], &s_backlog_samples[num_acked], ( UploadBacklog_get_num_uploads(&s_backlog) * sizeof(UploadSamples) ));
+    }
+}
+/******************************************************************************/
+static void record_samples__(UploadSamples const *p_samples)
+{
+    uint32_t now_s     = clock_seconds();
+    uint32_t now_utc_s = utc_now__();
+
+    for(uint32_t ii=0U; ii<p_samples->num_samples; ii++)
+    {
+        UploadMetrics_sample_uploaded(now_s, p_samples->index, p_samples->ts_seconds[ii], now_utc_s);
+    }
+}
+/******************************************************************************/
+/* Sends the uploads left in the backlog when the last link was lost, oldest
+ * first. Any not sent are left for the next link.
+ */
+static void resend_backlog__(void)
+{
+    uint32_t num_uploads = UploadBacklog_get_num_uploads(&s_backlog);
+
+    if( num_uploads > 0U )
+    {
+        DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_DUC_RETRANSMITTING);
+    }
+
+    for(uint32_t ii=0U; ii<num_uploads; ii++)
+    {
+        ModemIoVec iov;
+
+        iov.p_base = UploadBacklog_get(&s_backlog, ii, &iov.len);
+
+        PRINTF("Sending %u bytes to cloud\r\n", iov.len);
+        UploadMetrics_retransmission();
+
+        if( !upload_iov_to_cloud__(&iov, 1U, true) )
+        {
+            break;
+        }
+
+        /* Without quick send (or on a UDP link, which keeps its own
+         * window) the upload is done with once it has been written.
+         */
+        UploadBacklog_sent(&s_backlog, ii, ( ( backlog_is_used__() ) ? s_last_upload.end : 0U ));
+    }
+
+    if( !backlog_is_used__() )
+    {
+        ack_backlog__(0U);
+    }
+}
+/******************************************************************************/
+static void check_uploads_were_acked__(void)
+{
+    /* In quick send mode a successful write only means the modem has the
+     * data -- so check how much the server actually acknowledged before the
+     * link was lost. (A UDP link keeps its own count, in the window.)
+     */
+    if( backlog_is_used__() )
+    {
+        (void) Modem_tcp_update_ack(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, 1000U);
+
+        uint32_t acked = Modem_tcp_get_acked(MODEM_CHANNEL_DATA_UPLOAD_CLIENT);
+        uint32_t sent  = Modem_tcp_get_sent(MODEM_CHANNEL_DATA_UPLOAD_CLIENT);
+
+        UploadMetrics_set_unacked(sent - acked);
+
+        if( acked < sent )
+        {
+            DEFERRED_LOG1(ALC_LOGGER_ERROR, LOG_ID_DUC_BYTES_NOT_ACKED, ( sent - acked ));
+        }
+
+        /* The uploads of node data the acks don't cover stay in the backlog,
+         * and are sent again when the link is next opened.
+         */
+        ack_backlog__(acked);
+        UploadBacklog_link_lost(&s_backlog);
+    }
+}
+/******************************************************************************/
+#if DUC_ENABLE_UDP
+/* The datagram holds the security string, then "sq,<seq>", then the messages.
+ * Once it is in the window it is sent again until it is acknowledged -- so a
+ * failed write still counts as sent (the data is not lost).
+ */
+static bool send_datagram__(ModemIoVec const *p_iov, uint32_t iovcnt, bool write_log)
+{
+    UploadWindowSlot *p_slot = UploadWindow_take(&s_udp.window);
+    bool success = ( p_slot != NULL );
+
+    if(success)
+    {
+        char     header[DUC_UDP_HEADER_MAX_LEN];
+        uint32_t len;
+
+        prepare_security_string_msg(header, sizeof(header));
+        len = strlen(header);
+        snprintf(&header[len], ( sizeof(header) - len ), "sq,%u\r\n", p_slot->seq);
+
+        success = UploadWindow_append(p_slot, header, strlen(header));
+
+        for(uint32_t ii=0U; ( success ) && ( ii<iovcnt ); ii++)
+        {
+            success = UploadWindow_append(p_slot, (char const*) p_iov[ii].p_base, p_iov[ii].len);
+        }
+
+        if(success)
+        {
+            (void) write_datagram__(p_slot);
+        }
+        else
+        {
+            UploadWindow_cancel(&s_udp.window, p_slot);
+        }
+    }
+
+    if( !success )
+    {
+        PRINTF("Data Upload Client -- no room for the datagram!\r\n");
+
+        if(write_log)
+        {
+            DEFERRED_LOG(ALC_LOGGER_ERROR, LOG_ID_DUC_DATAGRAM_SEND_FAILED);
+        }
+    }
+
+    return success;
+}
+/******************************************************************************/
+static bool write_datagram__(UploadWindowSlot *p_slot)
+{
+    ModemIoVec iov;
+    uint32_t   start_ms = osKernelSysTick();
+
+    iov.p_base = p_slot->buff;
+    iov.len    = p_slot->len;
+
+    bool success = Modem_tcp_write_iov(MODEM_CHANNEL_DATA_UPLOAD_CLIENT, &iov, 1U, 4000);
+
+    if(success)
+    {
+        UploadWindow_sent(&s_udp.window, p_slot, osKernelSysTick());
+    }
+
+    UploadMetrics_upload_done(clock_seconds(),
+                              ( success ) ? p_slot->len : 0U,
+                              ( osKernelSysTick() - start_ms ),
+                              success);
+
+    return success;
+}
+#endif
+/******************************************************************************/
+/* Oldest first -- stops at a failed write, to try again on the next pass */
+static void resend_due_datagrams__(void)
+{
+#if DUC_ENABLE_UDP
+    if(s_link_is_udp)
+    {
+        UploadWindowSlot *p_slot;
+
+        while( ( p_slot = UploadWindow_next_due(&s_udp.window, osKernelSysTick()) ) != NULL )
+        {
+            if( p_slot->num_sends > 0U )
+            {
+                UploadMetrics_retransmission();
+            }
+
+            if( !write_datagram__(p_slot) )
+            {
+                break;
+            }
+        }
+
+        if( s_udp.window.num_expired != s_udp.num_expired )
+        {
+            DEFERRED_LOG1(ALC_LOGGER_ERROR, LOG_ID_DUC_DATAGRAMS_GIVEN_UP, ( s_udp.window.num_expired - s_udp.num_expired ));
+            s_udp.num_expired = s_udp.window.num_expired;
+        }
+    }
+#endif
+}
+/******************************************************************************/
 static bool send_security_string_msg__(void)
 {
     prepare_security_string_msg(s_request_str, sizeof(s_request_str));
@@ -759,6 +1391,32 @@ static bool send_gateway_msg__(void)
     return upload_buffer_to_cloud__(true);
 }
 /******************************************************************************/
+static bool send_upload_metrics_msg__(void)
+{
+    UploadMetrics metrics;
+
+    UploadMetrics_get(clock_seconds(), &metrics);
+    prepare_upload_metrics_msg(s_request_str, sizeof(s_request_str), &metrics);
+
+    return upload_buffer_to_cloud__(false);
+}
+/******************************************************************************/
+/* 0 until the gateway has the time */
+static uint32_t utc_now__(void)
+{
+    uint32_t now_utc_s=0U;
+
+    if( AlcRtcc_get_status() != ALC_RTCC_INVALID )
+    {
+        AlcRtccData t;
+
+        AlcRtcc_get(&t);
+        now_utc_s = t.seconds;
+    }
+
+    return now_utc_s;
+}
+/******************************************************************************/
 static uint32_t tcp_link_send_size__(void)
 {
     uint32_t send_size=0U;
@@ -768,6 +1426,39 @@ static uint32_t tcp_link_send_size__(void)
     return send_size;
 }
 /******************************************************************************/
+/* The most one upload can hold -- 0 if the link is closed, or if every
+ * datagram on a UDP link (or the backlog, in quick send mode) is waiting for
+ * an ack.
+ */
+static uint32_t upload_send_size__(void)
+{
+    uint32_t send_size = tcp_link_send_size__();
+
+    if( ( send_size > 0U ) && ( backlog_is_used__() ) )
+    {
+        uint32_t room = backlog_room__();
+
+        if( room < send_size )
+        {
+            send_size = room;
+        }
+    }
+
+#if DUC_ENABLE_UDP
+    if(s_link_is_udp)
+    {
+        uint32_t room = ( UploadWindow_is_full(&s_udp.window) ) ? 0U : ( UPLOAD_WINDOW_SLOT_LEN - DUC_UDP_HEADER_MAX_LEN );
+
+        if( room < send_size )
+        {
+            send_size = room;
+        }
+    }
+#endif
+
+    return send_size;
+}
+/******************************************************************************/
 static bool tcp_link_is_open__(void)
 {
     return ( tcp_link_send_size__() > 0U );
@@ -821,6 +1512,7 @@ static void process_char_from_server__(char ch)
         if( strlen(s_command_line.buff) > 0 )
         {
             check_tim_reply__(s_command_line.buff);
+            check_ack_reply__(s_command_line.buff);
         }
 
         command_line_reset__();
@@ -853,3 +1545,22 @@ static void check_tim_reply__(char const *str)
     }
 }
 /******************************************************************************/
+static void check_ack_reply__(char const *str)
+{
+    /** Expect the line to be 'ack,seq' -- the server has the datagram
+     */
+    if( strncmp(str, "ack,", 4) == 0 )
+    {
+        uint32_t seq;
+
+        str = &str[4];
+
+        if( eat_u32(&str, &seq) )
+        {
+#if DUC_ENABLE_UDP
+            (void) UploadWindow_ack(&s_udp.window, seq, osKernelSysTick());
+#endif
+        }
+    }
+}
+/******************************************************************************/
@@ -13,6 +13,7 @@
 *                               INCLUDE FILES
 *******************************************************************************/
 #include <stdio.h>
+#include <string.h>
 
 #include "data_upload_msg.h"
 
@@ -132,9 +133,22 @@ void prepare_node_long_msg(char *dest, uint32_t len, SensorNode const *p_sensor_
 {
     if( (dest) && ( len > 8U ) && (p_sensor_node) )
     {
-        /* Format: "nd,IP6ADDR,STATUS,MA.MI.REL,STRATUM,LAT,LON,WAITING,CURRENT"
+        /* Format: "nd,IP6ADDR,STATUS,MA.MI.REL,STRATUM,LAT,LON,WAITING,CURRENT,RATE,DUPS,GAPS,REORDER_P99"
          */
 
+        SensorNodeInfo        info;
+        SensorNodeIngestStats ingest;
+
+        /* The ingest side may be updating the node -- take a consistent copy
+         * without holding it up.
+         */
+        (void) SensorNode_read_info(p_sensor_node, &info);
+
+        if( !SensorNode_get_ingest_stats(p_sensor_node, &ingest) )
+        {
+            memset(&ingest, 0, sizeof(ingest));
+        }
+
         /* Initialise string */
         strncpy_safe(dest, "nd,", len);
 
@@ -144,16 +158,21 @@ void prepare_node_long_msg(char *dest, uint32_t len, SensorNode const *p_sensor_
         uint32_t idx = strlen(dest);
 
         /* Append remaining data */
-        sprintf(&dest[idx], ",%s,%u.%u.%u,%u,%0.6f,%0.6f,%u,%u\r\n",
-                SensorNode_get_status_string(p_sensor_node),
-                p_sensor_node->fw_version[0],
-                p_sensor_node->fw_version[1],
-                p_sensor_node->fw_version[2],
-                p_sensor_node->stratum,
-                p_sensor_node->lat,
-                p_sensor_node->lon,
-                p_sensor_node->num_samples_waiting,
-                p_sensor_node->bulb_current_ma_rms
+        sprintf(&dest[idx], ",%s,%u.%u.%u,%u,%0.6f,%0.6f,%u,%u,%u.%02u,%u,%u,%u\r\n",
+                info.p_status,
+                info.fw_version[0],
+                info.fw_version[1],
+                info.fw_version[2],
+                info.stratum,
+                info.lat,
+                info.lon,
+                info.num_samples_waiting,
+                info.bulb_current_ma_rms,
+                ( ingest.samples_per_s_x100 / 100U ),
+                ( ingest.samples_per_s_x100 % 100U ),
+                ingest.num_duplicates,
+                ingest.num_gaps,
+                SensorNode_reorder_depth_percentile(&ingest, 99U)
                 );
     }
 }
@@ -170,11 +189,13 @@ void prepare_node_msg(char *dest, uint32_t len, SensorNode const *p_sensor_node)
     }
 }
 /******************************************************************************/
-void prepare_data_msg(char *dest, uint32_t len, struct SensorData *p_sensor_data)
+uint32_t prepare_data_msg(char *dest, uint32_t len, struct SensorData *p_sensor_data)
 {
+    uint32_t msglen=0U;
+
     if( (dest) && ( len > 0U ) && (p_sensor_data) )
     {
-        snprintf(dest,
+        int ret = snprintf(dest,
                 len,
                 "da,%u.%02u,%d,%d,%d,%d,%d,%d,%d,%d,%d\r\n",
                 p_sensor_data->ts_seconds,
@@ -188,6 +209,41 @@ void prepare_data_msg(char *dest, uint32_t len, struct SensorData *p_sensor_data
                 p_sensor_data->mag_x,
                 p_sensor_data->mag_y,
                 p_sensor_data->mag_z);
+
+        if( ret > 0 )
+        {
+            /* snprintf() returns the length it would have written */
+            msglen = ( (uint32_t) ret < len ) ? (uint32_t) ret : ( len - 1U );
+        }
+    }
+
+    return msglen;
+}
+/******************************************************************************/
+void prepare_upload_metrics_msg(char *dest, uint32_t len, UploadMetrics const *p_metrics)
+{
+    if( (dest) && ( len > 0U ) && (p_metrics) )
+    {
+        /* Format: "um,BYTES/S,SAMPLES/S,UPLOADS,FAILED,RETX,UNACKED,LAG_P50,LAG_P99,LAG_MAX"
+         * The rates are to two decimal places, the lags in seconds.
+         */
+        uint32_t window_s           = ( p_metrics->window_s > 0U ) ? p_metrics->window_s : 1U;
+        uint32_t bytes_per_s_x100   = (uint32_t) ( ( (uint64_t) p_metrics->window_bytes * 100U ) / window_s );
+        uint32_t samples_per_s_x100 = (uint32_t) ( ( (uint64_t) p_metrics->window_samples * 100U ) / window_s );
+
+        snprintf(dest,
+                 len,
+                 "um,%u.%02u,%u.%02u,%u,%u,%u,%u,%u,%u,%u\r\n",
+                 ( bytes_per_s_x100 / 100U ), ( bytes_per_s_x100 % 100U ),
+                 ( samples_per_s_x100 / 100U ), ( samples_per_s_x100 % 100U ),
+                 p_metrics->num_uploads,
+                 p_metrics->num_upload_failures,
+                 p_metrics->num_retransmissions,
+                 p_metrics->unacked_bytes,
+                 UploadMetrics_lag_percentile_s(&p_metrics->lag, 50U),
+                 UploadMetrics_lag_percentile_s(&p_metrics->lag, 99U),
+                 p_metrics->lag.lag_max_s
+                 );
     }
 }
 /******************************************************************************/
@@ -0,0 +1,239 @@
+/**
+ * @file  timer_wheel.c
+ * @brief A hashed timer wheel -- deadlines in seconds, fired only when due.
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "timer_wheel.h"
+
+#include <stddef.h>
+#include <string.h>
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static bool is_due__(uint32_t deadline_s, uint32_t now_s);
+static TimerWheelEntry* find_due__(TimerWheelEntry *p_entry, uint32_t now_s);
+static void unlink__(TimerWheel *p_self, TimerWheelEntry *p_entry);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+void TimerWheel_init(TimerWheel *p_self, uint32_t now_s)
+{
+    if(p_self)
+    {
+        memset(p_self, 0, sizeof(TimerWheel));
+        p_self->now_s = now_s;
+    }
+}
+/******************************************************************************/
+void TimerWheelEntry_init(TimerWheelEntry *p_entry, TimerWheelFn fn, void *p_context)
+{
+    if(p_entry)
+    {
+        memset(p_entry, 0, sizeof(TimerWheelEntry));
+        p_entry->fn        = fn;
+        p_entry->p_context = p_context;
+    }
+}
+/******************************************************************************/
+bool TimerWheelEntry_is_armed(TimerWheelEntry const *p_entry)
+{
+    return ( p_entry ) && ( p_entry->is_armed );
+}
+/******************************************************************************/
+void TimerWheel_arm(TimerWheel *p_self, TimerWheelEntry *p_entry, uint32_t deadline_s)
+{
+    if( ( p_self ) && ( p_entry ) )
+    {
+        /* A deadline that has passed goes in the next slot to be visited */
+        uint32_t slot_s = ( is_due__(deadline_s, p_self->now_s) ) ? ( p_self->now_s + 1U ) : deadline_s;
+        TimerWheelEntry **pp_slot;
+
+        TimerWheel_disarm(p_self, p_entry);
+
+        pp_slot = &p_self->p_slots[slot_s % TIMER_WHEEL_NUM_SLOTS];
+
+        p_entry->deadline_s = deadline_s;
+        p_entry->slot       = slot_s % TIMER_WHEEL_NUM_SLOTS;
+        p_entry->is_armed   = true;
+        p_entry->p_prev     = NULL;
+        p_entry->p_next     = *pp_slot;
+
+        if(*pp_slot)
+        {
+            (*pp_slot)->p_prev = p_entry;
+        }
+
+        *pp_slot = p_entry;
+        p_self->num_armed++;
+    }
+}
+/******************************************************************************/
+void TimerWheel_disarm(TimerWheel *p_self, TimerWheelEntry *p_entry)
+{
+    if( ( p_self ) && ( TimerWheelEntry_is_armed(p_entry) ) )
+    {
+        unlink__(p_self, p_entry);
+    }
+}
+/******************************************************************************/
+uint32_t TimerWheel_advance(TimerWheel *p_self, uint32_t now_s)
+{
+    uint32_t num_fired=0U;
+
+    if( ( p_self ) && ( !is_due__(now_s, p_self->now_s) ) )
+    {
+        uint32_t num_ticks = now_s - p_self->now_s;
+
+        /* After a long gap every slot is visited once -- the deadline test
+         * below still fires each entry that is due.
+         */
+        if( num_ticks > TIMER_WHEEL_NUM_SLOTS )
+        {
+            p_self->now_s = now_s - TIMER_WHEEL_NUM_SLOTS;
+            num_ticks     = TIMER_WHEEL_NUM_SLOTS;
+        }
+
+        for(uint32_t ii=0U; ii<num_ticks; ii++)
+        {
+            TimerWheelEntry **pp_slot;
+            TimerWheelEntry  *p_entry;
+
+            /* Move on one second first, so an entry re-armed by its callback
+             * to a deadline that has passed goes into a later slot.
+             */
+            p_self->now_s++;
+            pp_slot = &p_self->p_slots[p_self->now_s % TIMER_WHEEL_NUM_SLOTS];
+
+            /* The callback may arm or disarm any entry, so search the slot
+             * again from its head after each one.
+             */
+            while( ( p_entry = find_due__(*pp_slot, now_s) ) != NULL )
+            {
+                unlink__(p_self, p_entry);
+                num_fired++;
+
+                if(p_entry->fn)
+                {
+                    p_entry->fn(p_entry);
+                }
+            }
+        }
+    }
+
+    return num_fired;
+}
+/******************************************************************************/
+uint32_t TimerWheel_get_num_armed(TimerWheel const *p_self)
+{
+    return ( p_self ) ? p_self->num_armed : 0U;
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+/* Allows for clock_seconds() wrapping */
+static bool is_due__(uint32_t deadline_s, uint32_t now_s)
+{
+    return ( (int32_t) ( deadline_s - now_s ) <= 0 );
+}
+/******************************************************************************/
+static TimerWheelEntry* find_due__(TimerWheelEntry *p_entry, uint32_t now_s)
+{
+    while( ( p_entry ) && ( !is_due__(p_entry->deadline_s, now_s) ) )
+    {
+        p_entry = p_entry->p_next;
+    }
+
+    return p_entry;
+}
+/******************************************************************************/
+static void unlink__(TimerWheel *p_self, TimerWheelEntry *p_entry)
+{
+    if(p_entry->p_prev)
+    {
+        p_entry->p_prev->p_next = p_entry->p_next;
+    }
+    else
+    {
+        p_self->p_slots[p_entry->slot] = p_entry->p_next;
+    }
+
+    if(p_entry->p_next)
+    {
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    }
+
+    p_entry->p_prev   = NULL;
+    p_entry->p_next   = NULL;
+    p_entry->is_armed = false;
+    p_self->num_armed--;
+}
+/******************************************************************************/
@@ -0,0 +1,244 @@
+/**
+ * @file  upload_backlog.c
+ * @brief The uploads sent to the cloud over TCP that the server has not
+ *        acknowledged yet
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "upload_backlog.h"
+
+#include <stddef.h>
+#include <string.h>
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static bool is_acked__(uint32_t end, uint32_t acked);
+static void free_oldest__(UploadBacklog *p_self);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+void UploadBacklog_init(UploadBacklog *p_self)
+{
+    if(p_self)
+    {
+        memset(p_self, 0, sizeof(UploadBacklog));
+    }
+}
+/******************************************************************************/
+uint32_t UploadBacklog_room(UploadBacklog const *p_self)
+{
+    if(
+            ( p_self ) &&
+            ( p_self->num_entries < UPLOAD_BACKLOG_MAX_UPLOADS )
+    )
+    {
+        return ( UPLOAD_BACKLOG_LEN - p_self->used - p_self->num_open );
+    }
+
+    return 0U;
+}
+/******************************************************************************/
+bool UploadBacklog_append(UploadBacklog *p_self, char const *p_buff, uint32_t len)
+{
+    if(
+            ( p_self ) &&
+            ( ( p_buff ) || ( len == 0U ) ) &&
+            ( len <= UploadBacklog_room(p_self) )
+    )
+    {
+        memcpy(&p_self->buff[p_self->used + p_self->num_open], p_buff, len);
+        p_self->num_open += len;
+
+        return true;
+    }
+
+    return false;
+}
+/******************************************************************************/
+void UploadBacklog_push(UploadBacklog *p_self, uint32_t end)
+{
+    if(
+            ( p_self ) &&
+            ( p_self->num_open > 0U ) &&
+            ( p_self->num_entries < UPLOAD_BACKLOG_MAX_UPLOADS )
+    )
+    {
+        UploadBacklogEntry *p_entry = &p_self->entries[p_self->num_entries];
+
+        p_entry->len     = p_self->num_open;
+        p_entry->end     = end;
+        p_entry->is_sent = true;
+
+        p_self->num_entries++;
+        p_self->used    += p_self->num_open;
+        p_self->num_open = 0U;
+    }
+}
+/******************************************************************************/
+void UploadBacklog_cancel(UploadBacklog *p_self)
+{
+    if(p_self)
+    {
+        p_self->num_open = 0U;
+    }
+}
+/******************************************************************************/
+uint32_t UploadBacklog_ack(UploadBacklog *p_self, uint32_t acked)
+{
+    uint32_t count=0U;
+
+    /* The uploads were sent in order, so the acks free them in order */
+    while(
+            ( p_self ) &&
+            ( p_self->num_entries > 0U ) &&
+            ( p_self->entries[0].is_sent ) &&
+            ( is_acked__(p_self->entries[0].end, acked) )
+    )
+    {
+        free_oldest__(p_self);
+        count++;
+    }
+
+    return count;
+}
+/******************************************************************************/
+void UploadBacklog_link_lost(UploadBacklog *p_self)
+{
+    if(p_self)
+    {
+        for(uint32_t ii=0U; ii<p_self->num_entries; ii++)
+        {
+            p_self->entries[ii].is_sent = false;
+        }
+    }
+}
+/******************************************************************************/
+char const* UploadBacklog_get(UploadBacklog const *p_self, uint32_t index, uint32_t *p_len)
+{
+    if( ( p_self ) && ( index < p_self->num_entries ) )
+    {
+        uint32_t offset=0U;
+
+        for(uint32_t ii=0U; ii<index; ii++)
+        {
+            offset += p_self->entries[ii].len;
+        }
+
+        if(p_len)
+        {
+            *p_len = p_self->entries[index].len;
+        }
+
+        return &p_self->buff[offset];
+    }
+
+    return NULL;
+}
+/******************************************************************************/
+void UploadBacklog_sent(UploadBacklog *p_self, uint32_t index, uint32_t end)
+{
+    if( ( p_self ) && ( index < p_self->num_entries ) )
+    {
+        p_self->entries[index].end     = end;
+        p_self->entries[index].is_sent = true;
+    }
+}
+/******************************************************************************/
+uint32_t UploadBacklog_get_num_uploads(UploadBacklog const *p_self)
+{
+    return ( p_self ) ? p_self->num_entries : 0U;
+}
+/******************************************************************************/
+bool UploadBacklog_is_empty(UploadBacklog const *p_self)
+{
+    return ( UploadBacklog_get_num_uploads(p_self) == 0U );
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+/* Allows for the byte count wrapping */
+static bool is_acked__(uint32_t end, uint32_t acked)
+{
+    return ( (int32_t) ( acked - end ) >= 0 );
+}
+/******************************************************************************/
+/* Moves the rest (and any new upload) down over the oldest */
+static void free_oldest__(UploadBacklog *p_self)
+{
+    uint32_t len = p_self->entries[0].len;
+
+    memmove(&p_self->buff[0], &p_self->buff[len], ( ( p_self->used - len ) + p_self->num_open ));
+    memmove(&p_self->entries[0], &p_self->entries[1], ( ( p_self->num_entries - 1U ) * sizeof(UploadBacklogEntry) ));
+
+    p_self->num_entries--;
+    p_self->used -= len;
+}
+/******************************************************************************/
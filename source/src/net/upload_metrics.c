@@ -0,0 +1,300 @@
+/**
+ * @file  upload_metrics.c
+ * @brief Counters, rates and upload-lag histograms for the data upload client
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "upload_metrics.h"
+
+#include <stddef.h>
+#include <string.h>
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+/** @brief What was uploaded in one second of the rate window */
+typedef struct {
+    uint32_t second;
+    uint32_t bytes;
+    uint32_t samples;
+} RateBucket;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+static UploadMetrics  s_metrics;
+static UploadLagStats s_node_lag[SENSOR_NODE_LIST_SIZE];
+
+/** @brief One bucket per second, used round-robin */
+static RateBucket s_rate[UPLOAD_METRICS_RATE_WINDOW_S];
+static uint32_t   s_start_s;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static RateBucket* rate_bucket__(uint32_t now_s);
+static void add_lag__(UploadLagStats *p_lag, uint32_t lag_s);
+static uint32_t lag_bucket__(uint32_t lag_s);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+void UploadMetrics_init(uint32_t now_s)
+{
+    memset(&s_metrics, 0, sizeof(s_metrics));
+    memset(s_node_lag, 0, sizeof(s_node_lag));
+    memset(s_rate, 0, sizeof(s_rate));
+
+    /* So that a bucket left at zero is never taken to be in the window */
+    for(uint32_t ii=0U; ii<UPLOAD_METRICS_RATE_WINDOW_S; ii++)
+    {
+        s_rate[ii].second = now_s - UPLOAD_METRICS_RATE_WINDOW_S;
+    }
+
+    s_start_s = now_s;
+}
+/******************************************************************************/
+void UploadMetrics_reset_node(uint32_t index)
+{
+    if( index < SENSOR_NODE_LIST_SIZE )
+    {
+        memset(&s_node_lag[index], 0, sizeof(UploadLagStats));
+    }
+}
+/******************************************************************************/
+void UploadMetrics_upload_done(uint32_t now_s, uint32_t num_bytes, uint32_t write_ms, bool success)
+{
+    s_metrics.num_uploads++;
+    s_metrics.write_ms_total += write_ms;
+
+    if( write_ms > s_metrics.write_ms_max )
+    {
+        s_metrics.write_ms_max = write_ms;
+    }
+
+    if(success)
+    {
+        s_metrics.bytes_sent += num_bytes;
+        rate_bucket__(now_s)->bytes += num_bytes;
+    }
+    else
+    {
+        s_metrics.num_upload_failures++;
+    }
+}
+/******************************************************************************/
+void UploadMetrics_retransmission(void)
+{
+    s_metrics.num_retransmissions++;
+}
+/******************************************************************************/
+void UploadMetrics_set_unacked(uint32_t num_bytes)
+{
+    s_metrics.unacked_bytes = num_bytes;
+}
+/******************************************************************************/
+void UploadMetrics_sample_uploaded(uint32_t now_s, uint32_t index, uint32_t ts_seconds, uint32_t now_utc_s)
+{
+    s_metrics.num_samples++;
+    rate_bucket__(now_s)->samples++;
+
+    if( ( now_utc_s == 0U ) || ( ts_seconds == 0U ) )
+    {
+        /* The gateway, or the node, does not have the time */
+        s_metrics.num_samples_no_time++;
+    }
+    else
+    {
+        /* A sample stamped ahead of the gateway's clock has no lag */
+        uint32_t lag_s = ( (int32_t) ( now_utc_s - ts_seconds ) > 0 ) ? ( now_utc_s - ts_seconds ) : 0U;
+
+        add_lag__(&s_metrics.lag, lag_s);
+
+        if( index < SENSOR_NODE_LIST_SIZE )
+        {
+            add_lag__(&s_node_lag[index], lag_s);
+        }
+    }
+}
+/******************************************************************************/
+void UploadMetrics_get(uint32_t now_s, UploadMetrics *p_metrics)
+{
+    if(p_metrics)
+    {
+        *p_metrics = s_metrics;
+
+        p_metrics->window_bytes   = 0U;
+        p_metrics->window_samples = 0U;
+
+        for(uint32_t ii=0U; ii<UPLOAD_METRICS_RATE_WINDOW_S; ii++)
+        {
+            if( ( now_s - s_rate[ii].second ) < UPLOAD_METRICS_RATE_WINDOW_S )
+            {
+                p_metrics->window_bytes   += s_rate[ii].bytes;
+                p_metrics->window_samples += s_rate[ii].samples;
+            }
+        }
+
+        /* Soon after start-up the window is only as long as the time since */
+        p_metrics->window_s = now_s - s_start_s + 1U;
+
+        if( p_metrics->window_s > UPLOAD_METRICS_RATE_WINDOW_S )
+        {
+            p_metrics->window_s = UPLOAD_METRICS_RATE_WINDOW_S;
+        }
+    }
+}
+/******************************************************************************/
+bool UploadMetrics_get_node_lag(uint32_t index, UploadLagStats *p_lag)
+{
+    bool success=false;
+
+    if( ( index < SENSOR_NODE_LIST_SIZE ) && ( p_lag ) )
+    {
+        *p_lag  = s_node_lag[index];
+        success = true;
+    }
+
+    return success;
+}
+/******************************************************************************/
+uint32_t UploadMetrics_lag_percentile_s(UploadLagStats const *p_lag, uint32_t percent)
+{
+    uint32_t lag_s=0U;
+
+    if( ( p_lag ) && ( p_lag->num_samples > 0U ) )
+    {
+        /* The rank of the sample wanted, rounded up */
+        uint64_t rank  = ( ( (uint64_t) p_lag->num_samples * percent ) + 99U ) / 100U;
+        uint64_t count = 0U;
+        uint32_t kk;
+
+        if( rank == 0U )
+        {
+            rank = 1U;
+        }
+
+        for(kk=0U; kk<( UPLOAD_METRICS_NUM_LAG_BUCKETS - 1U ); kk++)
+        {
+            count += p_lag->lag_hist[kk];
+
+            if( count >= rank )
+            {
+                break;
+            }
+        }
+
+        /* The top of bucket kk -- the last bucket has no top */
+        lag_s = p_lag->lag_max_s;
+
+        if( ( kk < ( UPLOAD_METRICS_NUM_LAG_BUCKETS - 1U ) ) && ( ( ( 1UL << kk ) - 1U ) < lag_s ) )
+        {
+            lag_s = (uint32_t) ( ( 1UL << kk ) - 1U );
+        }
+    }
+
+    return lag_s;
+}
+/******************************************************************************/
+uint32_t UploadMetrics_lag_mean_s(UploadLagStats const *p_lag)
+{
+    return ( ( p_lag ) && ( p_lag->num_samples > 0U ) ) ? (uint32_t) ( p_lag->lag_total_s / p_lag->num_samples ) : 0U;
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+/* The bucket for now_s -- emptied first if it last held an older second */
+static RateBucket* rate_bucket__(uint32_t now_s)
+{
+    RateBucket *p_bucket = &s_rate[now_s % UPLOAD_METRICS_RATE_WINDOW_S];
+
+    if( p_bucket->second != now_s )
+    {
+        p_bucket->second  = now_s;
+        p_bucket->bytes   = 0U;
+        p_bucket->samples = 0U;
+    }
+
+    return p_bucket;
+}
+/******************************************************************************/
+static void add_lag__(UploadLagStats *p_lag, uint32_t lag_s)
+{
+    p_lag->num_samples++;
+    p_lag->lag_total_s += lag_s;
+    p_lag->lag_hist[lag_bucket__(lag_s)]++;
+
+    if( lag_s > p_lag->lag_max_s )
+    {
+        p_lag->lag_max_s = lag_s;
+    }
+}
+/******************************************************************************/
+/* 0 for no lag, otherwise the number of bits needed to hold the lag */
+static uint32_t lag_bucket__(uint32_t lag_s)
+{
+    uint32_t bucket = ( lag_s == 0U ) ? 0U : ( 32U - (uint32_t) __builtin_clz(lag_s) );
+
+    return ( bucket < UPLOAD_METRICS_NUM_LAG_BUCKETS ) ? bucket : ( UPLOAD_METRICS_NUM_LAG_BUCKETS - 1U );
+}
+/******************************************************************************/
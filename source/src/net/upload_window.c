@@ -0,0 +1,349 @@
+/**
+ * @file  upload_window.c
+ * @brief The datagrams sent to the cloud that are waiting to be acknowledged
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "upload_window.h"
+
+#include <stddef.h>
+#include <string.h>
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static uint32_t timeout_ms__(UploadWindow const *p_self, UploadWindowSlot const *p_slot);
+static bool is_due__(UploadWindow const *p_self, UploadWindowSlot const *p_slot, uint32_t now_ms);
+static bool is_older__(uint32_t seq, uint32_t than_seq);
+static void update_rto__(UploadWindow *p_self, uint32_t rtt_ms);
+static void free_slot__(UploadWindow *p_self, UploadWindowSlot *p_slot);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+void UploadWindow_init(UploadWindow *p_self, uint32_t first_seq)
+{
+    if(p_self)
+    {
+        memset(p_self, 0, sizeof(UploadWindow));
+        p_self->next_seq = first_seq;
+        p_self->rto_ms   = UPLOAD_WINDOW_INITIAL_RTO_MS;
+    }
+}
+/******************************************************************************/
+UploadWindowSlot* UploadWindow_take(UploadWindow *p_self)
+{
+    if( p_self )
+    {
+        for(uint32_t ii=0U; ii<UPLOAD_WINDOW_NUM_SLOTS; ii++)
+        {
+            UploadWindowSlot *p_slot = &p_self->slots[ii];
+
+            if( !p_slot->is_used )
+            {
+                p_slot->is_used   = true;
+                p_slot->len       = 0U;
+                p_slot->seq       = p_self->next_seq;
+                p_slot->sent_ms   = 0U;
+                p_slot->num_sends = 0U;
+
+                p_self->next_seq++;
+                p_self->num_used++;
+
+                return p_slot;
+            }
+        }
+    }
+
+    return NULL;
+}
+/******************************************************************************/
+bool UploadWindow_append(UploadWindowSlot *p_slot, char const *p_buff, uint32_t len)
+{
+    if(
+            ( p_slot ) &&
+            ( ( p_buff ) || ( len == 0U ) ) &&
+            ( len <= UploadWindow_room(p_slot) )
+    )
+    {
+        memcpy(&p_slot->buff[p_slot->len], p_buff, len);
+        p_slot->len += len;
+
+        return true;
+    }
+
+    return false;
+}
+/******************************************************************************/
+uint32_t UploadWindow_room(UploadWindowSlot const *p_slot)
+{
+    return ( p_slot ) ? ( UPLOAD_WINDOW_SLOT_LEN - p_slot->len ) : 0U;
+}
+/******************************************************************************/
+void UploadWindow_cancel(UploadWindow *p_self, UploadWindowSlot *p_slot)
+{
+    if(
+            ( p_self ) &&
+            ( p_slot ) &&
+            ( p_slot->is_used )
+    )
+    {
+        /* Only the last sequence number taken can be handed back */
+        if( p_slot->seq == ( p_self->next_seq - 1U ) )
+        {
+            p_self->next_seq--;
+        }
+
+        free_slot__(p_self, p_slot);
+    }
+}
+/******************************************************************************/
+void UploadWindow_sent(UploadWindow *p_self, UploadWindowSlot *p_slot, uint32_t now_ms)
+{
+    if( ( p_self ) && ( p_slot ) && ( p_slot->is_used ) )
+    {
+        if( p_slot->num_sends > 0U )
+        {
+            p_self->num_resent++;
+        }
+
+        p_slot->num_sends++;
+        p_slot->sent_ms = now_ms;
+    }
+}
+/******************************************************************************/
+bool UploadWindow_ack(UploadWindow *p_self, uint32_t seq, uint32_t now_ms)
+{
+    if( p_self )
+    {
+        for(uint32_t ii=0U; ii<UPLOAD_WINDOW_NUM_SLOTS; ii++)
+        {
+            UploadWindowSlot *p_slot = &p_self->slots[ii];
+
+            if(
+                    ( p_slot->is_used ) &&
+                    ( p_slot->num_sends > 0U ) &&
+                    ( p_slot->seq == seq )
+            )
+            {
+                /* Karn -- only a datagram sent once gives a true round trip */
+                if( p_slot->num_sends == 1U )
+                {
+                    update_rto__(p_self, ( now_ms - p_slot->sent_ms ));
+                }
+
+                p_self->num_acked++;
+                free_slot__(p_self, p_slot);
+
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+/******************************************************************************/
+UploadWindowSlot* UploadWindow_next_due(UploadWindow *p_self, uint32_t now_ms)
+{
+    UploadWindowSlot *p_oldest=NULL;
+
+    if( p_self )
+    {
+        for(uint32_t ii=0U; ii<UPLOAD_WINDOW_NUM_SLOTS; ii++)
+        {
+            UploadWindowSlot *p_slot = &p_self->slots[ii];
+
+            if( !is_due__(p_self, p_slot, now_ms) )
+            {
+                continue;
+            }
+
+            if( p_slot->num_sends >= UPLOAD_WINDOW_MAX_SENDS )
+            {
+                p_self->num_expired++;
+                free_slot__(p_self, p_slot);
+            }
+            else if(
+                    ( p_oldest == NULL ) ||
+                    ( is_older__(p_slot->seq, p_oldest->seq) )
+            )
+            {
+                p_oldest = p_slot;
+            }
+            else
+            {
+                /* There is an older one */
+            }
+        }
+    }
+
+    return p_oldest;
+}
+/******************************************************************************/
+void UploadWindow_resend_all(UploadWindow *p_self, uint32_t now_ms)
+{
+    if( p_self )
+    {
+        for(uint32_t ii=0U; ii<UPLOAD_WINDOW_NUM_SLOTS; ii++)
+        {
+            UploadWindowSlot *p_slot = &p_self->slots[ii];
+
+            if( ( p_slot->is_used ) && ( p_slot->num_sends > 0U ) )
+            {
+                p_slot->sent_ms = now_ms - timeout_ms__(p_self, p_slot);
+            }
+        }
+    }
+}
+/******************************************************************************/
+uint32_t UploadWindow_get_num_used(UploadWindow const *p_self)
+{
+    return ( p_self ) ? p_self->num_used : 0U;
+}
+/******************************************************************************/
+bool UploadWindow_is_full(UploadWindow const *p_self)
+{
+    return ( p_self ) && ( p_self->num_used >= UPLOAD_WINDOW_NUM_SLOTS );
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+/* The timeout doubles with each send */
+static uint32_t timeout_ms__(UploadWindow const *p_self, UploadWindowSlot const *p_slot)
+{
+    uint32_t timeout_ms = p_self->rto_ms;
+
+    for(uint32_t ii=1U; ( ii < p_slot->num_sends ) && ( timeout_ms < UPLOAD_WINDOW_MAX_RTO_MS ); ii++)
+    {
+        timeout_ms *= 2U;
+    }
+
+    return ( timeout_ms < UPLOAD_WINDOW_MAX_RTO_MS ) ? timeout_ms : UPLOAD_WINDOW_MAX_RTO_MS;
+}
+/******************************************************************************/
+/* A datagram that has not been sent yet is due straight away */
+static bool is_due__(UploadWindow const *p_self, UploadWindowSlot const *p_slot, uint32_t now_ms)
+{
+    return ( p_slot->is_used ) &&
+           (
+                   ( p_slot->num_sends == 0U ) ||
+                   ( ( now_ms - p_slot->sent_ms ) >= timeout_ms__(p_self, p_slot) )
+           );
+}
+/******************************************************************************/
+/* Allows for the sequence number wrapping */
+static bool is_older__(uint32_t seq, uint32_t than_seq)
+{
+    return ( (int32_t) ( seq - than_seq ) < 0 );
+}
+/******************************************************************************/
+/* The timeout is twice the smoothed round trip (1/8 of each new sample) */
+static void update_rto__(UploadWindow *p_self, uint32_t rtt_ms)
+{
+    uint32_t rto_ms;
+
+    if( p_self->srtt_ms == 0U )
+    {
+        p_self->srtt_ms = ( rtt_ms > 0U ) ? rtt_ms : 1U;
+    }
+    else
+    {
+        p_self->srtt_ms = ( ( 7U * p_self->srtt_ms ) + rtt_ms ) / 8U;
+    }
+
+    rto_ms = 2U * p_self->srtt_ms;
+
+    if( rto_ms < UPLOAD_WINDOW_MIN_RTO_MS )
+    {
+        rto_ms = UPLOAD_WINDOW_MIN_RTO_MS;
+    }
+    else if( rto_ms > UPLOAD_WINDOW_MAX_RTO_MS )
+    {
+        rto_ms = UPLOAD_WINDOW_MAX_RTO_MS;
+    }
+    else
+    {
+        /* In range */
+    }
+
+    p_self->rto_ms = rto_ms;
+}
+/******************************************************************************/
+static void free_slot__(UploadWindow *p_self, UploadWindowSlot *p_slot)
+{
+    p_slot->is_used   = false;
+    p_slot->len       = 0U;
+    p_slot->num_sends = 0U;
+
+    if( p_self->num_used > 0U )
+    {
+        p_self->num_used--;
+    }
+}
+/******************************************************************************/
@@ -19,7 +19,6 @@
 
 #include "contiki.h"
 
-#include "dev/eeprom.h"
 #include "dev/watchdog.h"
 #include "nv_settings.h"
 #include "shell.h"
@@ -93,48 +92,30 @@ PROCESS_THREAD(C16174prog03_shell_factory_process, ev, data)
     static const uint16_t s_portnum=0xFFFFU;
     static const uint8_t s_unknown[10]={9U,'u','n','d','e','f','i','n','e','d'};
     static struct etimer etimer;
-    static const unsigned char buff[16] = {
-            0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU,
-            0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU
-    };
 
     PROCESS_BEGIN();
 
     if( strcmp(data, "reset") == 0 )
     {
-        static eeprom_addr_t addr;
-
         printf("factory reset\r\n");
 
-        /* erase EEPROM storage */
-        for(addr=0U; addr<256U; addr+=16U)
-        {
-            eeprom_write( addr, buff, sizeof(buff));
-            etimer_set(&etimer, (CLOCK_SECOND / 5) );
-            PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
-        }
-
-
+        /* Every setting, in one write to the EEPROM and one modem restart */
+        Store_begin();
         Store_write_cloud_ipv4(s_ip4_addr);
-        etimer_set(&etimer, (CLOCK_SECOND / 5) );
-        PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
         Store_write_cloud_portnum(&s_portnum);
-        etimer_set(&etimer, (CLOCK_SECOND / 5) );
-        PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
         Store_write_modem_apn(s_unknown);
-        etimer_set(&etimer, (CLOCK_SECOND / 5) );
-        PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
         Store_write_modem_username(s_unknown);
-        etimer_set(&etimer, (CLOCK_SECOND / 5) );
-        PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
         Store_write_modem_password(s_unknown);
-        etimer_set(&etimer, (CLOCK_SECOND / 5) );
-        PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
         Store_write_pan_ch(11U);
-        etimer_set(&etimer, (CLOCK_SECOND / 5) );
-        PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
         Store_write_pan_id(0xABCDU);
+        Store_commit();
 
+        /* Don't wait for the write-back -- the node is about to reboot */
+        if( !Store_write_back() )
+        {
+            shell_output_str(&factory_command,
+                     "Failed to write the settings to EEPROM", "");
+        }
 
         /* reboot */
         shell_output_str(&factory_command,
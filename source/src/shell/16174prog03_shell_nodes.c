@@ -21,6 +21,7 @@
 
 #include "net/ipv6/uip-ds6.h"
 #include "node-id.h"
+#include "resend_request.h"
 #include "sensor_data_pool.h"
 #include "sensor_node_list.h"
 #include "shell.h"
@@ -76,7 +77,8 @@
 *                               LOCAL FUNCTION PROTOTYPES
 *******************************************************************************/
 
-static bool display_node_info__(uint32_t index, SensorNode const *p_node);
+static bool display_node_info__(uint32_t index, SensorNode *p_node);
+static void display_node_ingest__(SensorNode const *p_node);
 
 
 
@@ -104,6 +106,8 @@ PROCESS_THREAD(C16174prog03_shell_nodes_process, ev, data)
 {
     PROCESS_BEGIN();
 
+    ResendRequestStats resend_stats;
+
     printf("nodes\r\n\r\n");
 
     printf("  size     = %lu\r\n", SNL_get_size());
@@ -113,6 +117,17 @@ PROCESS_THREAD(C16174prog03_shell_nodes_process, ev, data)
 
     printf("  free pool size   = %u\r\n", SensorDataPool_get_size());
     printf("  free pool lowest = %u\r\n", SensorDataPool_get_min_size());
+    printf("  lock timeouts    = %lu\r\n", SensorNode_get_num_lock_timeouts());
+    printf("  nodes ready      = %lu\r\n", SensorNode_get_num_ready());
+
+    ResendRequest_get_stats(&resend_stats);
+    printf("  resend requests  = sent=%lu,unsent=%lu,rate limited=%lu,resolved=%lu,given up=%lu,skipped=%lu\r\n",
+            resend_stats.num_sent,
+            resend_stats.num_unsent,
+            resend_stats.num_rate_limited,
+            resend_stats.num_resolved,
+            resend_stats.num_given_up,
+            resend_stats.num_skipped);
 
     printf("\r\nOK\r\n\r\n");
 
@@ -133,10 +148,14 @@ void C16174prog03_shell_nodes_init(void)
 *******************************************************************************/
 
 /******************************************************************************/
-static bool display_node_info__(uint32_t index, SensorNode const *p_node)
+static bool display_node_info__(uint32_t index, SensorNode *p_node)
 {
     if(p_node)
     {
+        SensorNodeInfo info;
+
+        (void) SensorNode_read_info(p_node, &info);
+
 #if DEBUG_FIFO_SEQUENCE_NUMBERS
         uint32_t first_seq32 = ( p_node->data_list.p_first ) ? p_node->data_list.p_first->seq32 : 0U;
         uint32_t last_seq32  = ( p_node->data_list.p_last  ) ? p_node->data_list.p_last->seq32  : 0U;
@@ -145,30 +164,61 @@ static bool display_node_info__(uint32_t index, SensorNode const *p_node)
         printf("  #%lu,", index);
         uip_debug_ipaddr_print(&p_node->ipaddr);
 #if DEBUG_FIFO_SEQUENCE_NUMBERS
-        printf(",%s,id=%04x,rx=%u,size=%u,seq=%u/%u/%u/%u\r\n",
-                SensorNode_get_status_string(p_node),
-                p_node->id16,
-                p_node->num_rx_packets,
+        printf(",%s,id=%04x,rx=%u,size=%u,dropped=%u,seq=%u/%u/%u/%u\r\n",
+                info.p_status,
+                info.id16,
+                info.num_rx_packets,
                 SensorNode_get_data_size(p_node),
+                SensorNode_get_num_dropped(p_node),
                 p_node->front_seq32,
                 first_seq32,
                 last_seq32,
                 SensorNode_received_to_seq32(p_node));
 #else
-        printf(",%s,id=%04Xh,waiting=%u,rx=%u,size=%u,front=%u,seq=%u,end=%u,%u mA RMS,%u s\r\n",
-                SensorNode_get_status_string(p_node),
-                p_node->id16,
-                p_node->num_samples_waiting,
-                p_node->num_rx_packets,
+        printf(",%s,id=%04Xh,waiting=%u,rx=%u,size=%u,dropped=%u,front=%u,seq=%u,end=%u,%u mA RMS,%u s\r\n",
+                info.p_status,
+                info.id16,
+                info.num_samples_waiting,
+                info.num_rx_packets,
                 SensorNode_get_data_size(p_node),
+                SensorNode_get_num_dropped(p_node),
                 p_node->front_seq32,
                 SensorNode_received_to_seq32(p_node),
                 p_node->end_seq32,
-                p_node->bulb_current_ma_rms,
-                SensorNode_seconds_since_last_msg_rx(p_node));
+                info.bulb_current_ma_rms,
+                (uint32_t) ( clock_seconds() - info.last_msg_rx_time ));
 #endif
+
+        display_node_ingest__(p_node);
     }
 
     return true;
 }
 /******************************************************************************/
+static void display_node_ingest__(SensorNode const *p_node)
+{
+    SensorNodeIngestStats ingest;
+
+    if( SensorNode_get_ingest_stats(p_node, &ingest) )
+    {
+        printf("      ingest: samples=%lu,rate=%lu.%02lu/s,dups=%lu,gaps=%lu,gap samples=%lu,max gap=%lu,reorder p50=%lu,p99=%lu,max=%lu,hist=",
+                ingest.num_samples,
+                ( ingest.samples_per_s_x100 / 100U ),
+                ( ingest.samples_per_s_x100 % 100U ),
+                ingest.num_duplicates,
+                ingest.num_gaps,
+                ingest.num_gap_samples,
+                ingest.max_gap,
+                SensorNode_reorder_depth_percentile(&ingest, 50U),
+                SensorNode_reorder_depth_percentile(&ingest, 99U),
+                ingest.max_reorder_depth);
+
+        for(uint32_t ii=0U; ii<SENSOR_NODE_REORDER_NUM_BUCKETS; ii++)
+        {
+            printf("%s%lu", ( ii == 0U ) ? "" : "/", ingest.reorder_hist[ii]);
+        }
+
+        printf("\r\n");
+    }
+}
+/******************************************************************************/
@@ -0,0 +1,201 @@
+/**
+ * @file  16174prog03_shell_tasks.c
+ * @brief Shell commands for 16174prog03
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "16174prog03_shell_tasks.h"
+
+#include <stdio.h>
+
+#include "contiki.h"
+
+#include "deferred_log.h"
+#include "shell.h"
+#include "task_profile.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+/* The CPU share is measured over this many seconds */
+#define WINDOW_S        1U
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+/* The samples at the start and end of the window */
+static TaskProfileSample  s_first;
+static TaskProfileSample  s_second;
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static void display_tasks__(bool is_sampled);
+static void display_processes__(uint32_t window_cycles);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+
+/******************************************************************************/
+PROCESS(C16174prog03_shell_tasks_process, "tasks");
+SHELL_COMMAND(tasks_command,
+          "tasks",
+          "tasks: print CPU share and stack use of the tasks and processes",
+          &C16174prog03_shell_tasks_process);
+/******************************************************************************/
+PROCESS_THREAD(C16174prog03_shell_tasks_process, ev, data)
+{
+    static struct etimer et;
+    static bool is_sampled;
+
+    /* Killed part way through the window -- don't leave the processes wrapped */
+    PROCESS_EXITHANDLER(TaskProfile_unhook_processes());
+
+    PROCESS_BEGIN();
+
+    /* The processes are only wrapped for the window */
+    TaskProfile_hook_processes();
+    is_sampled = TaskProfile_sample(&s_first);
+
+    etimer_set(&et, ( WINDOW_S * CLOCK_SECOND ));
+    PROCESS_WAIT_EVENT_UNTIL( etimer_expired(&et) );
+
+    is_sampled = ( TaskProfile_sample(&s_second) ) && ( is_sampled );
+    TaskProfile_unhook_processes();
+
+    printf("tasks\r\n\r\n");
+    printf("  window           = %lu s\r\n", (uint32_t) WINDOW_S);
+    printf("  log dropped      = %lu\r\n", DeferredLog_get_num_dropped());
+
+    display_tasks__(is_sampled);
+    display_processes__(s_second.counter - s_first.counter);
+
+    printf("\r\nOK\r\n\r\n");
+
+    PROCESS_END();
+}
+/******************************************************************************/
+void C16174prog03_shell_tasks_init(void)
+{
+    shell_register_command(&tasks_command);
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static void display_tasks__(bool is_sampled)
+{
+    if( !is_sampled )
+    {
+        printf("  tasks            = not available (configUSE_TRACE_FACILITY, or more than %lu tasks)\r\n",
+                (uint32_t) TASK_PROFILE_MAX_TASKS);
+        return;
+    }
+
+    printf("  tasks            = %lu\r\n", s_second.num_tasks);
+
+    for(uint32_t ii=0U; ii<s_second.num_tasks; ii++)
+    {
+        TaskProfileTask const *p_task = &s_second.tasks[ii];
+        uint32_t permille = TaskProfile_cpu_permille(&s_first, &s_second, ii);
+
+        printf("  %-16s pri=%lu,cpu=%lu.%lu%%,stack free=%lu bytes\r\n",
+                p_task->name,
+                p_task->priority,
+                ( permille / 10U ),
+                ( permille % 10U ),
+                p_task->stack_free_bytes);
+    }
+
+    if( s_second.total_run_time == s_first.total_run_time )
+    {
+        printf("  cpu              = not available (configGENERATE_RUN_TIME_STATS)\r\n");
+    }
+}
+/******************************************************************************/
+static void display_processes__(uint32_t window_cycles)
+{
+    TaskProfileProcess process;
+
+    printf("  processes        = %lu\r\n", TaskProfile_get_num_processes());
+
+    if( TaskProfile_get_num_unprofiled() > 0U )
+    {
+        printf("  not profiled     = %lu (more than %lu processes)\r\n",
+                TaskProfile_get_num_unprofiled(),
+                (uint32_t) TASK_PROFILE_MAX_PROCESSES);
+    }
+
+    /* The counts are for the window only */
+    for(uint32_t ii=0U; TaskProfile_get_process(ii, &process); ii++)
+    {
+        uint32_t permille = ( window_cycles > 0U ) ? (uint32_t) ( ( (uint64_t) process.cycles * 1000U ) / window_cycles ) : 0U;
+
+        printf("  %-24s events=%lu,cpu=%lu.%lu%%,max=%lu us\r\n",
+                PROCESS_NAME_STRING(process.p_process),
+                process.num_events,
+                ( permille / 10U ),
+                ( permille % 10U ),
+                TaskProfile_cycles_to_us(process.max_cycles));
+    }
+}
+/******************************************************************************/
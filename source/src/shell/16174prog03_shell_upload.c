@@ -0,0 +1,173 @@
+/**
+ * @file  16174prog03_shell_upload.c
+ * @brief Shell commands for 16174prog03
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "16174prog03_shell_upload.h"
+
+#include <stdio.h>
+
+#include "contiki.h"
+
+#include "sensor_node_list.h"
+#include "shell.h"
+#include "upload_metrics.h"
+
+
+#define DEBUG DEBUG_NONE
+#include "net-debug.h"
+#include "uip-debug.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static void display_lag__(UploadLagStats const *p_lag);
+static bool display_node_lag__(uint32_t index, SensorNode *p_node);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+
+/******************************************************************************/
+PROCESS(C16174prog03_shell_upload_process, "upload");
+SHELL_COMMAND(upload_command,
+          "upload",
+          "upload: print data upload metrics",
+          &C16174prog03_shell_upload_process);
+/******************************************************************************/
+PROCESS_THREAD(C16174prog03_shell_upload_process, ev, data)
+{
+    PROCESS_BEGIN();
+
+    UploadMetrics metrics;
+    uint32_t      window_s;
+
+    UploadMetrics_get(clock_seconds(), &metrics);
+    window_s = ( metrics.window_s > 0U ) ? metrics.window_s : 1U;
+
+    printf("upload\r\n\r\n");
+
+    printf("  bytes sent       = %llu\r\n", (unsigned long long) metrics.bytes_sent);
+    printf("  uploads          = %lu\r\n", metrics.num_uploads);
+    printf("  upload failures  = %lu\r\n", metrics.num_upload_failures);
+    printf("  retransmissions  = %lu\r\n", metrics.num_retransmissions);
+    printf("  unacked bytes    = %lu\r\n", metrics.unacked_bytes);
+    printf("  write ms max     = %lu\r\n", metrics.write_ms_max);
+    printf("  write ms mean    = %lu\r\n", (uint32_t) ( ( metrics.num_uploads > 0U ) ? ( metrics.write_ms_total / metrics.num_uploads ) : 0U ));
+    printf("  samples          = %lu\r\n", metrics.num_samples);
+    printf("  samples no time  = %lu\r\n", metrics.num_samples_no_time);
+    printf("  bytes/s          = %lu (last %lu s)\r\n", ( metrics.window_bytes / window_s ), window_s);
+    printf("  samples/s        = %lu.%02lu (last %lu s)\r\n",
+            ( metrics.window_samples / window_s ),
+            ( ( ( metrics.window_samples % window_s ) * 100U ) / window_s ),
+            window_s);
+
+    printf("  lag              = ");
+    display_lag__(&metrics.lag);
+
+    SNL_for_each_node(&display_node_lag__);
+
+    printf("\r\nOK\r\n\r\n");
+
+    PROCESS_END();
+}
+/******************************************************************************/
+void C16174prog03_shell_upload_init(void)
+{
+    shell_register_command(&upload_command);
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+static void display_lag__(UploadLagStats const *p_lag)
+{
+    printf("n=%lu,p50=%lu s,p90=%lu s,p99=%lu s,max=%lu s,mean=%lu s\r\n",
+            p_lag->num_samples,
+            UploadMetrics_lag_percentile_s(p_lag, 50U),
+            UploadMetrics_lag_percentile_s(p_lag, 90U),
+            UploadMetrics_lag_percentile_s(p_lag, 99U),
+            p_lag->lag_max_s,
+            UploadMetrics_lag_mean_s(p_lag));
+}
+/******************************************************************************/
+static bool display_node_lag__(uint32_t index, SensorNode *p_node)
+{
+    UploadLagStats lag;
+
+    if( ( p_node ) && ( UploadMetrics_get_node_lag(index, &lag) ) )
+    {
+        printf("  #%lu,", index);
+        uip_debug_ipaddr_print(&p_node->ipaddr);
+        printf(",");
+        display_lag__(&lag);
+    }
+
+    return true;
+}
+/******************************************************************************/
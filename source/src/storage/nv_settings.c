@@ -4,6 +4,20 @@
  *
  * @note
  * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ *
+ * The settings are read from the EEPROM once, into a mirror in RAM, and the
+ * Store_read_...() functions are served from the mirror. The mirror has its
+ * own CRC, and is read again from the EEPROM if the CRC doesn't match.
+ *
+ * The Store_write_...() functions update the mirror (or, between
+ * Store_begin() and Store_commit(), stage the change to be made by the
+ * commit), and Store_write_back() writes the changes to the EEPROM later.
+ *
+ * In the EEPROM, all the settings are kept in one block, with a version, a
+ * sequence number and a CRC. The block is written to the two slots in turn --
+ * the newest valid block is used, so a write that is cut short leaves the
+ * one before it. The first time, the settings are carried over from where
+ * they were kept before the block (each at its own address).
  */
 
 
@@ -14,12 +28,18 @@
 *******************************************************************************/
 #include "nv_settings.h"
 
+#include <stddef.h>
+#include <string.h>
+
 #include "alc_logger.h"
 #include "alc_number_utils.h"
 #include "alc_store_string_utils.h"
 #include "eeprom_arch.h"
+#include "FreeRTOS.h"
 #include "lib/crc16.h"
 #include "modem_ctrl.h"
+#include "stm32xxxx_hal.h"
+#include "task.h"
 
 
 
@@ -28,7 +48,17 @@
 *                               LOCAL DEFINES
 *******************************************************************************/
 
-/* Location of data in the EEPROM */
+/* The settings block -- written to each slot in turn */
+#define EEPROM_BLOCK_SLOT_0_ADDR            0U
+#define EEPROM_BLOCK_SLOT_1_ADDR            128U
+#define EEPROM_BLOCK_SLOT_LEN               128U
+#define NUM_EEPROM_BLOCK_SLOTS              2U
+
+#define NV_BLOCK_MAGIC                      0xA5U
+#define NV_BLOCK_VERSION                    1U
+
+
+/* Location of data in the EEPROM before the settings block */
 #define EEPROM_CLOUD_IPV4_ADDR              0U
 #define EEPROM_CLOUD_PORTNUM_ADDR           4U
 #define EEPROM_MODEM_APN_ADDR               32U
@@ -39,9 +69,18 @@
 
 
 /* Size of the data in the EEPROM */
-#define EEPROM_MODEM_APN_MAXLEN             31U
-#define EEPROM_MODEM_USERNAME_MAXLEN        31U
-#define EEPROM_MODEM_PASSWORD_MAXLEN        31U
+#define EEPROM_MODEM_APN_MAXLEN             STORE_MODEM_STRING_MAXLEN
+#define EEPROM_MODEM_USERNAME_MAXLEN        STORE_MODEM_STRING_MAXLEN
+#define EEPROM_MODEM_PASSWORD_MAXLEN        STORE_MODEM_STRING_MAXLEN
+
+
+/* A length byte, then the characters */
+#define NSTRING_BUFFLEN                     ( STORE_MODEM_STRING_MAXLEN + 1U )
+
+
+#define SETTING_BIT(setting)                ( 1UL << (uint32_t) (setting) )
+
+#define SETTING_FIELD(field)                offsetof(NvSettingsData, field), sizeof(((NvSettingsData*) 0)->field)
 
 
 
@@ -50,6 +89,11 @@
 *                               LOCAL CONSTANTS
 *******************************************************************************/
 
+static eeprom_addr_t const s_slot_addr[NUM_EEPROM_BLOCK_SLOTS] = {
+    EEPROM_BLOCK_SLOT_0_ADDR,
+    EEPROM_BLOCK_SLOT_1_ADDR
+};
+
 
 
 
@@ -65,12 +109,64 @@ typedef struct __attribute__((packed)) {
 } AlcStoreU16;
 
 
+typedef enum {
+    NV_CLOUD_IPV4 = 0,
+    NV_CLOUD_PORTNUM,
+    NV_MODEM_APN,
+    NV_MODEM_USERNAME,
+    NV_MODEM_PASSWORD,
+    NV_PAN_CH,
+    NV_PAN_ID,
+    NUM_NV_SETTINGS
+} NvSetting;
+
+
+typedef struct {
+    uint8_t  cloud_ipv4[4];
+    uint16_t cloud_portnum;
+    uint8_t  modem_apn[NSTRING_BUFFLEN];
+    uint8_t  modem_username[NSTRING_BUFFLEN];
+    uint8_t  modem_password[NSTRING_BUFFLEN];
+    uint16_t pan_ch;
+    uint16_t pan_id;
+    uint32_t valid;         /* SETTING_BIT() of each setting that has a value. */
+} NvSettingsData;
+
+
+/* The settings as kept in the EEPROM */
+typedef struct __attribute__((packed)) {
+    uint8_t         magic;
+    uint8_t         version;
+    uint16_t        seq;            /* One more than the block it replaced. */
+    NvSettingsData  data;
+    uint16_t        crc16;          /* Of everything before it. */
+} NvSettingsBlock;
+
+
+typedef struct {
+    char const *p_name;
+    uint32_t    offset;         /* In NvSettingsData. */
+    uint32_t    len;
+    bool        is_modem_conf;  /* The modem has to be restarted to use it. */
+} NvSettingInfo;
+
+
 
 
 /*******************************************************************************
 *                               LOCAL TABLES
 *******************************************************************************/
 
+static NvSettingInfo const s_setting_info[NUM_NV_SETTINGS] = {
+    [NV_CLOUD_IPV4]     = { "Cloud IP address",  SETTING_FIELD(cloud_ipv4),     true  },
+    [NV_CLOUD_PORTNUM]  = { "Cloud port number", SETTING_FIELD(cloud_portnum),  true  },
+    [NV_MODEM_APN]      = { "Modem APN",         SETTING_FIELD(modem_apn),      true  },
+    [NV_MODEM_USERNAME] = { "Modem username",    SETTING_FIELD(modem_username), true  },
+    [NV_MODEM_PASSWORD] = { "Modem password",    SETTING_FIELD(modem_password), true  },
+    [NV_PAN_CH]         = { "PAN Channel",       SETTING_FIELD(pan_ch),         false },
+    [NV_PAN_ID]         = { "PAN ID",            SETTING_FIELD(pan_id),         false },
+};
+
 
 
 
@@ -78,6 +174,26 @@ typedef struct __attribute__((packed)) {
 *                               LOCAL GLOBAL VARIABLES
 *******************************************************************************/
 
+/* Shared by the tasks -- only changed inside a critical section */
+static struct {
+    NvSettingsData  data;
+    uint16_t        crc16;
+    bool            is_loaded;
+    uint32_t        dirty;          /* SETTING_BIT() of each setting to write back. */
+    uint16_t        block_seq;      /* Of the newest block in the EEPROM... */
+    uint32_t        block_slot;     /* ...and the slot it is in. */
+    bool            has_block;
+} s_mirror;
+
+
+/* The changes staged since Store_begin() */
+static struct {
+    NvSettingsData  data;
+    uint32_t        staged;         /* SETTING_BIT() of each setting staged. */
+    uint32_t        last_write_ms;
+    bool            is_open;
+} s_transaction;
+
 
 
 
@@ -85,8 +201,19 @@ typedef struct __attribute__((packed)) {
 *                               LOCAL FUNCTION PROTOTYPES
 *******************************************************************************/
 
+static void load_mirror__(void);
+static bool read_block__(uint32_t slot, NvSettingsBlock *p_block);
+static void read_old_layout__(NvSettingsData *p_data);
+static uint16_t mirror_crc__(void);
+static bool read_setting__(NvSetting setting, void *p_value);
+static bool write_setting__(NvSetting setting, void const *p_value);
+static uint32_t apply__(NvSettingsData const *p_data, uint32_t settings);
+static void notify__(uint32_t changed);
+static bool read_nstring__(NvSetting setting, uint8_t *p_nstring, uint32_t maxlen);
+static bool read_nstring_str__(NvSetting setting, uint8_t *p_string, uint32_t maxlen);
+static bool write_nstring__(NvSetting setting, uint8_t const *p_nstring);
+static bool write_bytes_to_eeprom__(eeprom_addr_t address, uint8_t const *p_buff, uint32_t len);
 static bool read_u16_from_eeprom__(eeprom_addr_t address, uint16_t *p_value);
-static bool write_u16_to_eeprom__(eeprom_addr_t address, uint16_t value);
 
 
 
@@ -95,6 +222,15 @@ static bool write_u16_to_eeprom__(eeprom_addr_t address, uint16_t value);
 *                               LOCAL CONFIGURATION ERRORS
 *******************************************************************************/
 
+#if ( NSTRING_BUFFLEN > ( EEPROM_MODEM_USERNAME_ADDR - EEPROM_MODEM_APN_ADDR ) )
+#error "STORE_MODEM_STRING_MAXLEN is too long for the EEPROM layout"
+#endif
+
+/* The block's header, fields (allowing for padding) and CRC */
+#if ( ( 4U + ( 4U + 2U + ( 3U * NSTRING_BUFFLEN ) + 2U + 2U + 3U + 4U ) + 2U ) > EEPROM_BLOCK_SLOT_LEN )
+#error "The settings block doesn't fit in a slot"
+#endif
+
 
 
 
@@ -103,295 +239,675 @@ static bool write_u16_to_eeprom__(eeprom_addr_t address, uint16_t value);
 *******************************************************************************/
 
 /******************************************************************************/
-/** @brief Read the IPv4 address of the cloud server from EEPROM memory
+/** @brief Read the settings from EEPROM memory into the RAM mirror
  */
-bool Store_read_cloud_ipv4(uint8_t *p_buff4)
+void Store_init(void)
 {
-    bool success=false;
+    if(!s_mirror.is_loaded)
+    {
+        load_mirror__();
+    }
+}
+/******************************************************************************/
+/** @brief Start staging changes -- the Store_write_...() functions don't
+ *         change the settings until Store_commit()
+ *
+ *  If a transaction is already open the changes are added to it.
+ */
+void Store_begin(void)
+{
+    taskENTER_CRITICAL();
 
-    if(p_buff4)
+    if(!s_transaction.is_open)
     {
-        eeprom_read(EEPROM_CLOUD_IPV4_ADDR, p_buff4, 4);
+        memset(&s_transaction.data, 0, sizeof(s_transaction.data));
+        s_transaction.staged  = 0U;
+        s_transaction.is_open = true;
+    }
 
-        success = eeprom_last_op_success();
+    s_transaction.last_write_ms = HAL_GetTick();
 
-        if(!success)
-        {
-            /* Failed to read data */
-            memset(p_buff4, 0, 4);
-        }
+    taskEXIT_CRITICAL();
+}
+/******************************************************************************/
+/** @brief Make the staged changes, with one change notification
+ *
+ *  @return False if no transaction is open
+ */
+bool Store_commit(void)
+{
+    NvSettingsData data;
+    uint32_t staged;
+    uint32_t changed;
+
+    if(!s_mirror.is_loaded)
+    {
+        load_mirror__();
     }
 
-    return success;
+    taskENTER_CRITICAL();
+
+    if(!s_transaction.is_open)
+    {
+        taskEXIT_CRITICAL();
+        return false;
+    }
+
+    data   = s_transaction.data;
+    staged = s_transaction.staged;
+    s_transaction.is_open = false;
+
+    changed = apply__(&data, staged);
+
+    taskEXIT_CRITICAL();
+
+    notify__(changed);
+
+    return true;
 }
 /******************************************************************************/
-/** @brief Write the IPv4 address of the cloud server to EEPROM memory
+/** @brief Commit the transaction if nothing has been written to it for
+ *         idle_ms
  */
-bool Store_write_cloud_ipv4(uint8_t const *p_buff4)
+bool Store_commit_if_idle(uint32_t idle_ms)
 {
-    bool success=false;
+    bool is_idle;
 
-    if(p_buff4)
+    taskENTER_CRITICAL();
+
+    is_idle = ( s_transaction.is_open ) &&
+              ( ( HAL_GetTick() - s_transaction.last_write_ms ) >= idle_ms );
+
+    taskEXIT_CRITICAL();
+
+    return ( is_idle ) && Store_commit();
+}
+/******************************************************************************/
+/** @brief Drop the staged changes
+ */
+void Store_abort(void)
+{
+    taskENTER_CRITICAL();
+    s_transaction.is_open = false;
+    taskEXIT_CRITICAL();
+}
+/******************************************************************************/
+/** @brief Write the changed settings to EEPROM memory
+ *
+ *  The whole block is written, to the slot the newest block isn't in, and
+ *  read back. If that fails the settings stay changed, and are tried again
+ *  the next time.
+ */
+bool Store_write_back(void)
+{
+    NvSettingsBlock block;
+    NvSettingsBlock check;
+    uint32_t dirty;
+    uint32_t slot;
+    bool success;
+
+    taskENTER_CRITICAL();
+
+    dirty = s_mirror.dirty;
+    s_mirror.dirty = 0U;
+
+    block.data = s_mirror.data;
+    block.seq  = s_mirror.block_seq + 1U;
+
+    /* With no block yet, slot 1 goes first -- the only settings from before
+     * the block in that slot are the PAN's, and they have been read.
+     */
+    slot = ( s_mirror.has_block ) ? ( ( s_mirror.block_slot + 1U ) % NUM_EEPROM_BLOCK_SLOTS ) : 1U;
+
+    taskEXIT_CRITICAL();
+
+    if(dirty == 0U)
     {
-        if(eeprom_enable_write())
-        {
-            eeprom_write(EEPROM_CLOUD_IPV4_ADDR, p_buff4, 4);
+        return true;
+    }
 
-            success = eeprom_last_op_success();
-        }
+    block.magic   = NV_BLOCK_MAGIC;
+    block.version = NV_BLOCK_VERSION;
+    block.crc16   = crc16_data((unsigned char const*) &block, offsetof(NvSettingsBlock, crc16), 0U);
+
+    success = ( write_bytes_to_eeprom__(s_slot_addr[slot], (uint8_t const*) &block, sizeof(block)) ) &&
+              ( read_block__(slot, &check) ) &&
+              ( check.seq == block.seq );
 
-        eeprom_disable_write();
+    taskENTER_CRITICAL();
+
+    if(success)
+    {
+        s_mirror.block_seq  = block.seq;
+        s_mirror.block_slot = slot;
+        s_mirror.has_block  = true;
+    }
+    else
+    {
+        s_mirror.dirty |= dirty;
     }
 
+    taskEXIT_CRITICAL();
+
     if(success)
     {
-        AlcLogger_log_info("Cloud IP address updated in EEPROM");
-        ModemCtrl_conf_has_been_changed();
+        AlcLogger_log_printf(ALC_LOGGER_INFO, "Settings updated in EEPROM (slot %u, seq %u)", slot, block.seq);
     }
     else
     {
-        AlcLogger_log_error("Failed to store Cloud IP address in EEPROM");
+        AlcLogger_log_error("Failed to store the settings in EEPROM");
     }
 
     return success;
 }
 /******************************************************************************/
-/** @brief Read the port number of the cloud server from EEPROM memory
+bool Store_has_unwritten_changes(void)
+{
+    return ( s_mirror.dirty != 0U );
+}
+/******************************************************************************/
+/** @brief Read the IPv4 address of the cloud server
  */
-bool Store_read_cloud_portnum(uint16_t *p_portnum)
+bool Store_read_cloud_ipv4(uint8_t *p_buff4)
 {
     bool success=false;
 
-    if(p_portnum)
+    if(p_buff4)
     {
-        uint8_t buff[2];
-
-        eeprom_read(EEPROM_CLOUD_PORTNUM_ADDR, buff, sizeof(buff));
-
-        success = eeprom_last_op_success();
+        success = read_setting__(NV_CLOUD_IPV4, p_buff4);
 
-        if(success)
-        {
-            *p_portnum = ALC_MAKE16(buff[0], buff[1]);
-        }
-        else
+        if(!success)
         {
-            *p_portnum = 0U;
+            /* Failed to read data */
+            memset(p_buff4, 0, 4);
         }
     }
 
     return success;
 }
 /******************************************************************************/
-/** @brief Write the port number of the cloud server to EEPROM memory
+/** @brief Write the IPv4 address of the cloud server
  */
-bool Store_write_cloud_portnum(uint16_t const *p_portnum)
+bool Store_write_cloud_ipv4(uint8_t const *p_buff4)
+{
+    return ( p_buff4 ) && write_setting__(NV_CLOUD_IPV4, p_buff4);
+}
+/******************************************************************************/
+/** @brief Read the port number of the cloud server
+ */
+bool Store_read_cloud_portnum(uint16_t *p_portnum)
 {
     bool success=false;
 
     if(p_portnum)
     {
-        if(eeprom_enable_write())
-        {
-            uint8_t buff[2];
-
-            buff[0] = ALC_HI_BYTE(*p_portnum);
-            buff[1] = ALC_LO_BYTE(*p_portnum);
+        success = read_setting__(NV_CLOUD_PORTNUM, p_portnum);
 
-            eeprom_write(EEPROM_CLOUD_PORTNUM_ADDR, buff, sizeof(buff));
-
-            success = eeprom_last_op_success();
+        if(!success)
+        {
+            *p_portnum = 0U;
         }
-
-        eeprom_disable_write();
-    }
-
-    if(success)
-    {
-        AlcLogger_log_info("Cloud port number updated in EEPROM");
-        ModemCtrl_conf_has_been_changed();
-    }
-    else
-    {
-        AlcLogger_log_error("Failed to store Cloud port number in EEPROM");
     }
 
     return success;
 }
 /******************************************************************************/
+/** @brief Write the port number of the cloud server
+ */
+bool Store_write_cloud_portnum(uint16_t const *p_portnum)
+{
+    return ( p_portnum ) && write_setting__(NV_CLOUD_PORTNUM, p_portnum);
+}
+/******************************************************************************/
 bool Store_read_modem_apn(uint8_t *p_nstring, uint32_t maxlen)
 {
-    return eeprom_read_nstring(EEPROM_MODEM_APN_ADDR, p_nstring, maxlen);
+    return read_nstring__(NV_MODEM_APN, p_nstring, maxlen);
 }
 /******************************************************************************/
 bool Store_read_modem_apn_str(uint8_t *p_string, uint32_t maxlen)
 {
-    return eeprom_read_nstring_str(EEPROM_MODEM_APN_ADDR, p_string, maxlen);
+    return read_nstring_str__(NV_MODEM_APN, p_string, maxlen);
 }
 /******************************************************************************/
 bool Store_write_modem_apn(uint8_t const *p_nstring)
 {
-    bool success=false;
+    return write_nstring__(NV_MODEM_APN, p_nstring);
+}
+/******************************************************************************/
+bool Store_read_modem_username(uint8_t *p_nstring, uint32_t maxlen)
+{
+    return read_nstring__(NV_MODEM_USERNAME, p_nstring, maxlen);
+}
+/******************************************************************************/
+bool Store_read_modem_username_str(uint8_t *p_string, uint32_t maxlen)
+{
+    return read_nstring_str__(NV_MODEM_USERNAME, p_string, maxlen);
+}
+/******************************************************************************/
+bool Store_write_modem_username(uint8_t const *p_nstring)
+{
+    return write_nstring__(NV_MODEM_USERNAME, p_nstring);
+}
+/******************************************************************************/
+bool Store_read_modem_password(uint8_t *p_nstring, uint32_t maxlen)
+{
+    return read_nstring__(NV_MODEM_PASSWORD, p_nstring, maxlen);
+}
+/******************************************************************************/
+bool Store_read_modem_password_str(uint8_t *p_string, uint32_t maxlen)
+{
+    return read_nstring_str__(NV_MODEM_PASSWORD, p_string, maxlen);
+}
+/******************************************************************************/
+bool Store_write_modem_password(uint8_t const *p_nstring)
+{
+    return write_nstring__(NV_MODEM_PASSWORD, p_nstring);
+}
+/******************************************************************************/
+bool Store_read_pan_ch(uint16_t *p_pan_ch)
+{
+    return ( p_pan_ch ) && read_setting__(NV_PAN_CH, p_pan_ch);
+}
+/******************************************************************************/
+bool Store_write_pan_ch(uint16_t pan_ch)
+{
+    return write_setting__(NV_PAN_CH, &pan_ch);
+}
+/******************************************************************************/
+bool Store_read_pan_id(uint16_t *p_pan_id)
+{
+    return ( p_pan_id ) && read_setting__(NV_PAN_ID, p_pan_id);
+}
+/******************************************************************************/
+bool Store_write_pan_id(uint16_t pan_id)
+{
+    return write_setting__(NV_PAN_ID, &pan_id);
+}
+/******************************************************************************/
 
-    if( is_valid_nstring(p_nstring) )
-    {
-        uint8_t len = p_nstring[0] & 0xFFU;
 
-        if( len <= EEPROM_MODEM_APN_MAXLEN )
-        {
-            success = eeprom_write_nstring(EEPROM_MODEM_APN_ADDR, p_nstring);
-        }
-        else
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+/* Reads the newest valid block from the EEPROM -- or, if there isn't one, the
+ * settings from where they were kept before the block (they are then written
+ * back as a block).
+ */
+static void load_mirror__(void)
+{
+    NvSettingsData data;
+    NvSettingsBlock block;
+    uint16_t seq=0U;
+    uint32_t slot=0U;
+    bool has_block=false;
+
+    for(uint32_t ii=0U; ii<NUM_EEPROM_BLOCK_SLOTS; ii++)
+    {
+        /* Allows for the sequence number wrapping */
+        if(
+                ( read_block__(ii, &block) ) &&
+                (
+                        ( !has_block ) ||
+                        ( (int16_t) ( block.seq - seq ) > 0 )
+                )
+        )
         {
-            AlcLogger_log_error("Modem APN is too long");
+            data      = block.data;
+            seq       = block.seq;
+            slot      = ii;
+            has_block = true;
         }
     }
 
-    if(success)
+    if(!has_block)
     {
-        AlcLogger_log_info("Modem APN updated in EEPROM");
-        ModemCtrl_conf_has_been_changed();
+        read_old_layout__(&data);
     }
-    else
+
+    taskENTER_CRITICAL();
+
+    s_mirror.data       = data;
+    s_mirror.crc16      = mirror_crc__();
+    s_mirror.dirty      = ( has_block ) ? 0U : data.valid;
+    s_mirror.block_seq  = seq;
+    s_mirror.block_slot = slot;
+    s_mirror.has_block  = has_block;
+    s_mirror.is_loaded  = true;
+
+    taskEXIT_CRITICAL();
+
+    if( ( !has_block ) && ( data.valid != 0U ) )
     {
-        AlcLogger_log_error("Failed to store Modem APN in EEPROM");
+        AlcLogger_log_info("Settings carried over to the settings block");
     }
+}
+/******************************************************************************/
+static bool read_block__(uint32_t slot, NvSettingsBlock *p_block)
+{
+    eeprom_read(s_slot_addr[slot], (unsigned char*) p_block, sizeof(NvSettingsBlock));
 
-    return success;
+    return ( eeprom_last_op_success() ) &&
+           ( p_block->magic == NV_BLOCK_MAGIC ) &&
+           ( p_block->version == NV_BLOCK_VERSION ) &&
+           ( p_block->crc16 == crc16_data((unsigned char const*) p_block, offsetof(NvSettingsBlock, crc16), 0U) );
 }
 /******************************************************************************/
-bool Store_read_modem_username(uint8_t *p_nstring, uint32_t maxlen)
+/* Reads the same things, and treats the same failures as invalid, as reading
+ * each setting straight from the EEPROM used to.
+ */
+static void read_old_layout__(NvSettingsData *p_data)
 {
-    return eeprom_read_nstring(EEPROM_MODEM_USERNAME_ADDR, p_nstring, maxlen);
+    uint8_t buff[2];
+
+    memset(p_data, 0, sizeof(NvSettingsData));
+
+    eeprom_read(EEPROM_CLOUD_IPV4_ADDR, p_data->cloud_ipv4, sizeof(p_data->cloud_ipv4));
+
+    if( eeprom_last_op_success() )
+    {
+        p_data->valid |= SETTING_BIT(NV_CLOUD_IPV4);
+    }
+    else
+    {
+        memset(p_data->cloud_ipv4, 0, sizeof(p_data->cloud_ipv4));
+    }
+
+    eeprom_read(EEPROM_CLOUD_PORTNUM_ADDR, buff, sizeof(buff));
+
+    if( eeprom_last_op_success() )
+    {
+        p_data->cloud_portnum = ALC_MAKE16(buff[0], buff[1]);
+        p_data->valid |= SETTING_BIT(NV_CLOUD_PORTNUM);
+    }
+
+    if( eeprom_read_nstring(EEPROM_MODEM_APN_ADDR, p_data->modem_apn, EEPROM_MODEM_APN_MAXLEN) )
+    {
+        p_data->valid |= SETTING_BIT(NV_MODEM_APN);
+    }
+
+    if( eeprom_read_nstring(EEPROM_MODEM_USERNAME_ADDR, p_data->modem_username, EEPROM_MODEM_USERNAME_MAXLEN) )
+    {
+        p_data->valid |= SETTING_BIT(NV_MODEM_USERNAME);
+    }
+
+    if( eeprom_read_nstring(EEPROM_MODEM_PASSWORD_ADDR, p_data->modem_password, EEPROM_MODEM_PASSWORD_MAXLEN) )
+    {
+        p_data->valid |= SETTING_BIT(NV_MODEM_PASSWORD);
+    }
+
+    if( read_u16_from_eeprom__(EEPROM_RADIO_PAN_CH_ADDR, &p_data->pan_ch) )
+    {
+        p_data->valid |= SETTING_BIT(NV_PAN_CH);
+    }
+
+    if( read_u16_from_eeprom__(EEPROM_RADIO_PAN_ID_ADDR, &p_data->pan_id) )
+    {
+        p_data->valid |= SETTING_BIT(NV_PAN_ID);
+    }
 }
 /******************************************************************************/
-bool Store_read_modem_username_str(uint8_t *p_string, uint32_t maxlen)
+/* Call inside a critical section */
+static uint16_t mirror_crc__(void)
 {
-    return eeprom_read_nstring_str(EEPROM_MODEM_USERNAME_ADDR, p_string, maxlen);
+    return crc16_data((unsigned char const*) &s_mirror.data, sizeof(s_mirror.data), 0U);
 }
 /******************************************************************************/
-bool Store_write_modem_username(uint8_t const *p_nstring)
+/* Copies the setting out of the open transaction if it is staged there, so
+ * a setting reads back as written (the Bluetooth setters stage their writes).
+ * Otherwise copies it out of the mirror, which is read from the EEPROM first
+ * if it hasn't been yet, or its CRC shows it has been corrupted.
+ */
+static bool read_setting__(NvSetting setting, void *p_value)
 {
+    NvSettingInfo const *p_info = &s_setting_info[setting];
     bool success=false;
 
-    if( is_valid_nstring(p_nstring) )
+    for(uint32_t attempt=0U; attempt<2U; attempt++)
     {
-        uint8_t len = p_nstring[0] & 0xFFU;
+        bool is_ok;
 
-        if( len <= EEPROM_MODEM_USERNAME_MAXLEN )
+        taskENTER_CRITICAL();
+
+        if(
+                ( s_transaction.is_open ) &&
+                ( ( s_transaction.staged & SETTING_BIT(setting) ) != 0U )
+        )
         {
-            success = eeprom_write_nstring(EEPROM_MODEM_USERNAME_ADDR, p_nstring);
+            memcpy(p_value, &( (uint8_t const*) &s_transaction.data )[p_info->offset], p_info->len);
+            success = true;
+            is_ok   = true;
         }
         else
         {
-            AlcLogger_log_error("Modem username is too long");
+            is_ok = ( s_mirror.is_loaded ) && ( s_mirror.crc16 == mirror_crc__() );
+
+            if(is_ok)
+            {
+                success = ( ( s_mirror.data.valid & SETTING_BIT(setting) ) != 0U );
+
+                if(success)
+                {
+                    memcpy(p_value, &( (uint8_t const*) &s_mirror.data )[p_info->offset], p_info->len);
+                }
+            }
+        }
+
+        taskEXIT_CRITICAL();
+
+        if(is_ok)
+        {
+            break;
         }
+
+        if(s_mirror.is_loaded)
+        {
+            AlcLogger_log_error("NV settings in RAM are corrupt -- reading them from EEPROM");
+        }
+
+        load_mirror__();
     }
 
-    if(success)
+    return success;
+}
+/******************************************************************************/
+/* Stages the setting if a transaction is open, otherwise changes it straight
+ * away (a transaction of one).
+ */
+static bool write_setting__(NvSetting setting, void const *p_value)
+{
+    NvSettingInfo const *p_info = &s_setting_info[setting];
+    uint32_t changed=0U;
+
+    if(!s_mirror.is_loaded)
     {
-        AlcLogger_log_info("Modem username updated in EEPROM");
-        ModemCtrl_conf_has_been_changed();
+        load_mirror__();
+    }
+
+    taskENTER_CRITICAL();
+
+    if(s_transaction.is_open)
+    {
+        memcpy(&( (uint8_t*) &s_transaction.data )[p_info->offset], p_value, p_info->len);
+        s_transaction.staged       |= SETTING_BIT(setting);
+        s_transaction.last_write_ms = HAL_GetTick();
     }
     else
     {
-        AlcLogger_log_error("Failed to store Modem username in EEPROM");
+        NvSettingsData data;
+
+        memcpy(&( (uint8_t*) &data )[p_info->offset], p_value, p_info->len);
+        changed = apply__(&data, SETTING_BIT(setting));
     }
 
-    return success;
+    taskEXIT_CRITICAL();
+
+    notify__(changed);
+
+    return true;
 }
 /******************************************************************************/
-bool Store_read_modem_password(uint8_t *p_nstring, uint32_t maxlen)
+/* Copies the settings given into the mirror, and marks the ones that changed
+ * to be written back. Writing the value a setting already has does nothing.
+ * Call inside a critical section.
+ */
+static uint32_t apply__(NvSettingsData const *p_data, uint32_t settings)
 {
-    return eeprom_read_nstring(EEPROM_MODEM_PASSWORD_ADDR, p_nstring, maxlen);
+    uint32_t changed=0U;
+
+    for(uint32_t setting=0U; setting<NUM_NV_SETTINGS; setting++)
+    {
+        NvSettingInfo const *p_info = &s_setting_info[setting];
+        uint8_t *p_field            = &( (uint8_t*) &s_mirror.data )[p_info->offset];
+        uint8_t const *p_value      = &( (uint8_t const*) p_data )[p_info->offset];
+
+        if(
+                ( ( settings & SETTING_BIT(setting) ) != 0U ) &&
+                (
+                        ( ( s_mirror.data.valid & SETTING_BIT(setting) ) == 0U ) ||
+                        ( memcmp(p_field, p_value, p_info->len) != 0 )
+                )
+        )
+        {
+            memcpy(p_field, p_value, p_info->len);
+            changed |= SETTING_BIT(setting);
+        }
+    }
+
+    if(changed != 0U)
+    {
+        s_mirror.data.valid |= changed;
+        s_mirror.dirty      |= changed;
+        s_mirror.crc16       = mirror_crc__();
+    }
+
+    return changed;
 }
 /******************************************************************************/
-bool Store_read_modem_password_str(uint8_t *p_string, uint32_t maxlen)
+/* One notification for all the changes -- the modem is restarted once */
+static void notify__(uint32_t changed)
 {
-    return eeprom_read_nstring_str(EEPROM_MODEM_PASSWORD_ADDR, p_string, maxlen);
+    bool is_modem_conf=false;
+
+    for(uint32_t setting=0U; setting<NUM_NV_SETTINGS; setting++)
+    {
+        if( ( changed & SETTING_BIT(setting) ) != 0U )
+        {
+            AlcLogger_log_printf(ALC_LOGGER_INFO, "%s updated", s_setting_info[setting].p_name);
+
+            is_modem_conf = ( is_modem_conf ) || ( s_setting_info[setting].is_modem_conf );
+        }
+    }
+
+    if(is_modem_conf)
+    {
+        ModemCtrl_conf_has_been_changed();
+    }
 }
 /******************************************************************************/
-bool Store_write_modem_password(uint8_t const *p_nstring)
+/* The n-string is copied to p_nstring if it is no longer than maxlen
+ * characters (p_nstring holds maxlen + 1 bytes).
+ */
+static bool read_nstring__(NvSetting setting, uint8_t *p_nstring, uint32_t maxlen)
 {
+    uint8_t buff[NSTRING_BUFFLEN];
     bool success=false;
 
-    if( is_valid_nstring(p_nstring) )
+    if(p_nstring)
     {
-        uint8_t len = p_nstring[0] & 0xFFU;
+        success = ( read_setting__(setting, buff) ) &&
+                  ( buff[0] <= maxlen );
 
-        if( len <= EEPROM_MODEM_PASSWORD_MAXLEN )
+        if(success)
         {
-            success = eeprom_write_nstring(EEPROM_MODEM_PASSWORD_ADDR, p_nstring);
+            memcpy(p_nstring, buff, ( buff[0] + 1U ));
         }
         else
         {
-            AlcLogger_log_error("Modem password is too long");
+            p_nstring[0] = 0U;
         }
     }
 
-    if(success)
-    {
-        AlcLogger_log_info("Modem password updated in EEPROM");
-        ModemCtrl_conf_has_been_changed();
-    }
-    else
-    {
-        AlcLogger_log_error("Failed to store Modem password in EEPROM");
-    }
-
     return success;
 }
 /******************************************************************************/
-bool Store_read_pan_ch(uint16_t *p_pan_ch)
-{
-    return read_u16_from_eeprom__(EEPROM_RADIO_PAN_CH_ADDR, p_pan_ch);
-}
-/******************************************************************************/
-bool Store_write_pan_ch(uint16_t pan_ch)
+/* The n-string is copied to p_string as a C string, if it fits in maxlen
+ * bytes (with the terminator).
+ */
+static bool read_nstring_str__(NvSetting setting, uint8_t *p_string, uint32_t maxlen)
 {
-    bool success = write_u16_to_eeprom__(EEPROM_RADIO_PAN_CH_ADDR, pan_ch);
+    uint8_t buff[NSTRING_BUFFLEN];
+    bool success=false;
 
-    if(success)
+    if( ( p_string ) && ( maxlen > 0U ) )
     {
-        AlcLogger_log_info("PAN Channel updated in EEPROM");
-    }
-    else
-    {
-        AlcLogger_log_error("Failed to store PAN Channel in EEPROM");
+        success = ( read_setting__(setting, buff) ) &&
+                  ( buff[0] < maxlen );
+
+        if(success)
+        {
+            memcpy(p_string, &buff[1], buff[0]);
+            p_string[buff[0]] = '\0';
+        }
+        else
+        {
+            p_string[0] = '\0';
+        }
     }
 
     return success;
 }
 /******************************************************************************/
-bool Store_read_pan_id(uint16_t *p_pan_id)
+static bool write_nstring__(NvSetting setting, uint8_t const *p_nstring)
 {
-    return read_u16_from_eeprom__(EEPROM_RADIO_PAN_ID_ADDR, p_pan_id);
-}
-/******************************************************************************/
-bool Store_write_pan_id(uint16_t pan_id)
-{
-    bool success = write_u16_to_eeprom__(EEPROM_RADIO_PAN_ID_ADDR, pan_id);
+    bool success=false;
 
-    if(success)
+    if( is_valid_nstring(p_nstring) )
     {
-        AlcLogger_log_info("PAN ID updated in EEPROM");
+        uint8_t len = p_nstring[0] & 0xFFU;
+
+        if( len <= STORE_MODEM_STRING_MAXLEN )
+        {
+            /* Unused bytes are zero, so the same string always compares equal */
+            uint8_t buff[NSTRING_BUFFLEN];
+
+            memset(buff, 0, sizeof(buff));
+            memcpy(buff, p_nstring, ( len + 1U ));
+
+            success = write_setting__(setting, buff);
+        }
+        else
+        {
+            AlcLogger_log_printf(ALC_LOGGER_ERROR, "%s is too long", s_setting_info[setting].p_name);
+        }
     }
-    else
+
+    if(!success)
     {
-        AlcLogger_log_error("Failed to store PAN ID in EEPROM");
+        AlcLogger_log_printf(ALC_LOGGER_ERROR, "Failed to store %s", s_setting_info[setting].p_name);
     }
 
     return success;
 }
 /******************************************************************************/
+static bool write_bytes_to_eeprom__(eeprom_addr_t address, uint8_t const *p_buff, uint32_t len)
+{
+    bool success=false;
 
+    if(eeprom_enable_write())
+    {
+        eeprom_write(address, p_buff, len);
 
+        success = eeprom_last_op_success();
+    }
 
+    eeprom_disable_write();
 
-/*******************************************************************************
-*                               LOCAL FUNCTIONS
-*******************************************************************************/
-
+    return success;
+}
 /******************************************************************************/
 static bool read_u16_from_eeprom__(eeprom_addr_t address, uint16_t *p_value)
 {
@@ -417,24 +933,3 @@ static bool read_u16_from_eeprom__(eeprom_addr_t address, uint16_t *p_value)
     return success;
 }
 /******************************************************************************/
-static bool write_u16_to_eeprom__(eeprom_addr_t address, uint16_t value)
-{
-    bool success=false;
-
-    if(eeprom_enable_write())
-    {
-        AlcStoreU16 buff;
-
-        buff.data.value = value;
-        buff.crc16      = crc16_data((unsigned char const*) &buff.data, sizeof(buff.data), 0U);
-
-        eeprom_write(address, (unsigned char*) &buff, sizeof(buff));
-
-        success = eeprom_last_op_success();
-    }
-
-    eeprom_disable_write();
-
-    return success;
-}
-/******************************************************************************/
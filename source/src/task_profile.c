@@ -0,0 +1,334 @@
+/**
+ * @file  task_profile.c
+ * @brief Run-time profile of the RTOS tasks and the Contiki processes
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "task_profile.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "stm32xxxx_hal.h"
+#include "task.h"
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DEFINES
+*******************************************************************************/
+
+/* Unlocks the DWT registers on the Cortex-M7 */
+#define DWT_LAR_UNLOCK      0xC5ACCE55U
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONSTANTS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL DATA TYPES
+*******************************************************************************/
+
+typedef PT_THREAD((* ProcessThread)(struct pt *, process_event_t, process_data_t));
+
+
+
+
+/*******************************************************************************
+*                               LOCAL TABLES
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL GLOBAL VARIABLES
+*******************************************************************************/
+
+static struct {
+    TaskProfileProcess processes[TASK_PROFILE_MAX_PROCESSES];
+    ProcessThread      threads[TASK_PROFILE_MAX_PROCESSES];    /* The wrapped threads */
+    uint32_t           num_processes;
+    uint32_t           num_unprofiled;
+    bool               is_hooked;
+} s_profile;
+
+
+#if ( configUSE_TRACE_FACILITY == 1 )
+/* Only used by the Contiki task -- static to keep it off the stack */
+static TaskStatus_t s_task_status[TASK_PROFILE_MAX_TASKS];
+#endif
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTION PROTOTYPES
+*******************************************************************************/
+
+static PT_THREAD(profile_thread__(struct pt *p_pt, process_event_t ev, process_data_t data));
+static uint32_t find_process__(struct pt const *p_pt);
+
+
+
+
+/*******************************************************************************
+*                               LOCAL CONFIGURATION ERRORS
+*******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               GLOBAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+void TaskProfile_start_counter(void)
+{
+    if( ( DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk ) == 0U )
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->LAR          = DWT_LAR_UNLOCK;
+        DWT->CYCCNT       = 0U;
+        DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+}
+/******************************************************************************/
+uint32_t TaskProfile_get_counter(void)
+{
+    return DWT->CYCCNT;
+}
+/******************************************************************************/
+uint32_t TaskProfile_cycles_to_us(uint32_t cycles)
+{
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+
+    return ( cycles_per_us > 0U ) ? ( cycles / cycles_per_us ) : cycles;
+}
+/******************************************************************************/
+bool TaskProfile_sample(TaskProfileSample *p_sample)
+{
+#if ( configUSE_TRACE_FACILITY == 1 )
+    uint32_t total_run_time=0U;
+    UBaseType_t num_tasks;
+
+    if( p_sample == NULL )
+    {
+        return false;
+    }
+
+    memset(p_sample, 0, sizeof(TaskProfileSample));
+
+    /* Returns 0 if there are more tasks than the array holds */
+    num_tasks = uxTaskGetSystemState(s_task_status, TASK_PROFILE_MAX_TASKS, &total_run_time);
+    p_sample->counter = TaskProfile_get_counter();
+
+    if( num_tasks == 0U )
+    {
+        return false;
+    }
+
+    for(uint32_t ii=0U; ii<num_tasks; ii++)
+    {
+        TaskStatus_t const *p_status = &s_task_status[ii];
+        TaskProfileTask *p_task = &p_sample->tasks[ii];
+
+        strncpy(p_task->name, p_status->pcTaskName, ( TASK_PROFILE_NAME_LEN - 1U ));
+        p_task->number           = (uint32_t) p_status->xTaskNumber;
+        p_task->priority         = (uint32_t) p_status->uxCurrentPriority;
+        p_task->run_time         = p_status->ulRunTimeCounter;
+        p_task->stack_free_bytes = (uint32_t) ( p_status->usStackHighWaterMark * sizeof(StackType_t) );
+    }
+
+    p_sample->num_tasks      = (uint32_t) num_tasks;
+    p_sample->total_run_time = total_run_time;
+
+    return true;
+#else
+    (void) p_sample;
+
+    return false;
+#endif
+}
+/******************************************************************************/
+uint32_t TaskProfile_cpu_permille(TaskProfileSample const *p_first,
+                                  TaskProfileSample const *p_second,
+                                  uint32_t index)
+{
+    uint32_t run_time;
+    uint32_t total;
+
+    if(
+            ( p_first == NULL ) ||
+            ( p_second == NULL ) ||
+            ( index >= p_second->num_tasks )
+    )
+    {
+        return 0U;
+    }
+
+    run_time = p_second->tasks[index].run_time;
+    total    = p_second->total_run_time - p_first->total_run_time;
+
+    for(uint32_t ii=0U; ii<p_first->num_tasks; ii++)
+    {
+        if( p_first->tasks[ii].number == p_second->tasks[index].number )
+        {
+            run_time -= p_first->tasks[ii].run_time;
+            break;
+        }
+    }
+
+    if( total == 0U )
+    {
+        /* No run-time stats */
+        return 0U;
+    }
+
+    if( run_time > total )
+    {
+        run_time = total;
+    }
+
+    return (uint32_t) ( ( (uint64_t) run_time * 1000U ) / total );
+}
+/******************************************************************************/
+void TaskProfile_hook_processes(void)
+{
+    if( s_profile.is_hooked )
+    {
+        return;
+    }
+
+    TaskProfile_start_counter();
+
+    memset(&s_profile, 0, sizeof(s_profile));
+
+    for(struct process *p_process=process_list; p_process!=NULL; p_process=p_process->next)
+    {
+        if( s_profile.num_processes >= TASK_PROFILE_MAX_PROCESSES )
+        {
+            s_profile.num_unprofiled++;
+            continue;
+        }
+
+        s_profile.processes[s_profile.num_processes].p_process = p_process;
+        s_profile.threads[s_profile.num_processes] = p_process->thread;
+        s_profile.num_processes++;
+
+        p_process->thread = profile_thread__;
+    }
+
+    s_profile.is_hooked = true;
+}
+/******************************************************************************/
+void TaskProfile_unhook_processes(void)
+{
+    /* From the table rather than process_list -- a process that exited
+     * while it was wrapped gets its own thread back for when it restarts.
+     */
+    for(uint32_t ii=0U; ii<s_profile.num_processes; ii++)
+    {
+        s_profile.processes[ii].p_process->thread = s_profile.threads[ii];
+    }
+
+    s_profile.is_hooked = false;
+}
+/******************************************************************************/
+uint32_t TaskProfile_get_num_processes(void)
+{
+    return s_profile.num_processes;
+}
+/******************************************************************************/
+uint32_t TaskProfile_get_num_unprofiled(void)
+{
+    return s_profile.num_unprofiled;
+}
+/******************************************************************************/
+bool TaskProfile_get_process(uint32_t index, TaskProfileProcess *p_process)
+{
+    if( ( p_process ) && ( index < s_profile.num_processes ) )
+    {
+        *p_process = s_profile.processes[index];
+        return true;
+    }
+
+    return false;
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                               LOCAL FUNCTIONS
+*******************************************************************************/
+
+/******************************************************************************/
+/* Stands in for the thread of each wrapped process -- the pt is part of the
+ * process, so it says which process is being called. Only while profiling,
+ * so the search of the table is only paid for then.
+ */
+static PT_THREAD(profile_thread__(struct pt *p_pt, process_event_t ev, process_data_t data))
+{
+    uint32_t index = find_process__(p_pt);
+    TaskProfileProcess *p_process;
+    uint32_t start;
+    uint32_t cycles;
+    char ret;
+
+    if( index >= s_profile.num_processes )
+    {
+        /* Can't happen -- only the wrapped processes get here */
+        return PT_EXITED;
+    }
+
+    p_process = &s_profile.processes[index];
+
+    start  = TaskProfile_get_counter();
+    ret    = s_profile.threads[index](p_pt, ev, data);
+    cycles = TaskProfile_get_counter() - start;
+
+    p_process->num_events++;
+    p_process->cycles += cycles;
+
+    if( cycles > p_process->max_cycles )
+    {
+        p_process->max_cycles = cycles;
+    }
+
+    return ret;
+}
+/******************************************************************************/
+static uint32_t find_process__(struct pt const *p_pt)
+{
+    uint32_t ii;
+
+    for(ii=0U; ii<s_profile.num_processes; ii++)
+    {
+        if( &s_profile.processes[ii].p_process->pt == p_pt )
+        {
+            break;
+        }
+    }
+
+    return ii;
+}
+/******************************************************************************/
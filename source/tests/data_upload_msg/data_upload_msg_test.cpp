@@ -30,6 +30,7 @@ TEST_GROUP( test_data_upload_msg )
     TEST_SETUP()
     {
         // setup() is run before each test
+        CHECK_TRUE( SensorNode_init_locks() );
         memset(obuff, 0, sizeof(obuff));
     }
     /**************************************************************************/
@@ -109,6 +110,30 @@ TEST( test_data_upload_msg, prepare_node_msg3 )
     mock().checkExpectations();
 }
 /******************************************************************************/
+TEST( test_data_upload_msg, prepare_node_long_msg1 )
+{
+    SensorNode        sensor_node;
+    struct SensorData sensor_data[2];
+
+    SensorNode_init(&sensor_node);
+    memset(sensor_data, 0, sizeof(sensor_data));
+
+    uip_ip6addr(&sensor_node.ipaddr, 1, 2, 3, 4, 5, 6, 7, 8);
+
+    /* The second sample is a duplicate */
+    CHECK_TRUE( SensorNode_add_data(&sensor_node, &sensor_data[0]) );
+    CHECK_FALSE( SensorNode_add_data(&sensor_node, &sensor_data[1]) );
+    POINTERS_EQUAL(&sensor_data[0], SensorNode_remove_data(&sensor_node) );
+
+    prepare_node_long_msg(obuff, sizeof(obuff), &sensor_node);
+
+    STRCMP_EQUAL("nd,1:2:3:4:5:6:7:8,ok,0.0.0,0,0.000000,0.000000,0,0,0.00,1,0,0\r\n", obuff);
+
+    SensorNode_clear_ready_list();
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
 
 
 
@@ -122,10 +147,51 @@ TEST( test_data_upload_msg, prepare_data_msg1 )
 
     memset(&sensor_data, 0, sizeof(sensor_data));
 
-    prepare_data_msg(obuff, sizeof(obuff), &sensor_data);
+    LONGS_EQUAL( 27, prepare_data_msg(obuff, sizeof(obuff), &sensor_data) );
 
     STRCMP_EQUAL("da,0.00,0,0,0,0,0,0,0,0,0\r\n", obuff);
 
     mock().checkExpectations();
 }
 /******************************************************************************/
+TEST( test_data_upload_msg, prepare_data_msg_truncated )
+{
+    struct SensorData sensor_data;
+
+    memset(&sensor_data, 0, sizeof(sensor_data));
+
+    LONGS_EQUAL( 9, prepare_data_msg(obuff, 10U, &sensor_data) );
+
+    STRCMP_EQUAL("da,0.00,0", obuff);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                           Test Upload Metrics Message
+*******************************************************************************/
+TEST( test_data_upload_msg, prepare_upload_metrics_msg1 )
+{
+    UploadMetrics metrics;
+
+    memset(&metrics, 0, sizeof(metrics));
+
+    metrics.window_s            = 60U;
+    metrics.window_bytes        = 6030U;
+    metrics.window_samples      = 45U;
+    metrics.num_uploads         = 12U;
+    metrics.num_upload_failures = 1U;
+    metrics.num_retransmissions = 2U;
+    metrics.unacked_bytes       = 300U;
+
+    prepare_upload_metrics_msg(obuff, sizeof(obuff), &metrics);
+
+    STRCMP_EQUAL("um,100.50,0.75,12,1,2,300,0,0,0\r\n", obuff);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
@@ -0,0 +1,189 @@
+/**
+ * @file  deferred_log_test.cpp
+ * @brief Unit-tests for the deferred log ring
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "deferred_log.h"
+
+
+
+
+/*******************************************************************************
+*                                  Test Group
+*******************************************************************************/
+TEST_GROUP( test_deferred_log )
+{
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        DeferredLog_init();
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        mock().clear();
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                                    Tests
+*******************************************************************************/
+TEST( test_deferred_log, pop_empty )
+{
+    DeferredLogEntry entry;
+
+    CHECK_FALSE( DeferredLog_pop(&entry) );
+    CHECK_FALSE( DeferredLog_pop(nullptr) );
+}
+/******************************************************************************/
+TEST( test_deferred_log, pop_in_order )
+{
+    DeferredLogEntry entry;
+
+    DEFERRED_LOG(ALC_LOGGER_WARNING, LOG_ID_POOL_EMPTY);
+    DEFERRED_LOG1(ALC_LOGGER_ERROR, LOG_ID_DUC_BYTES_NOT_ACKED, 123U);
+
+    CHECK_TRUE( DeferredLog_pop(&entry) );
+    LONGS_EQUAL(LOG_ID_POOL_EMPTY, entry.id);
+    LONGS_EQUAL(ALC_LOGGER_WARNING, entry.level);
+    LONGS_EQUAL(0, entry.num_args);
+
+    CHECK_TRUE( DeferredLog_pop(&entry) );
+    LONGS_EQUAL(LOG_ID_DUC_BYTES_NOT_ACKED, entry.id);
+    LONGS_EQUAL(ALC_LOGGER_ERROR, entry.level);
+    LONGS_EQUAL(1, entry.num_args);
+    LONGS_EQUAL(123, entry.args[0]);
+
+    CHECK_FALSE( DeferredLog_pop(&entry) );
+}
+/******************************************************************************/
+TEST( test_deferred_log, full_ring_drops_and_counts )
+{
+    DeferredLogEntry entry;
+
+    for(uint32_t ii=0U; ii<( DEFERRED_LOG_RING_SIZE + 3U ); ii++)
+    {
+        DEFERRED_LOG1(ALC_LOGGER_INFO, LOG_ID_DUC_NODES_DELETED, ii);
+    }
+
+    LONGS_EQUAL(3, DeferredLog_get_num_dropped() );
+
+    /* The oldest are kept */
+    CHECK_TRUE( DeferredLog_pop(&entry) );
+    LONGS_EQUAL(0, entry.args[0]);
+
+    /* A slot is free again */
+    DEFERRED_LOG1(ALC_LOGGER_INFO, LOG_ID_DUC_NODES_DELETED, 1000U);
+    LONGS_EQUAL(3, DeferredLog_get_num_dropped() );
+}
+/******************************************************************************/
+TEST( test_deferred_log, ring_wraps )
+{
+    DeferredLogEntry entry;
+
+    for(uint32_t ii=0U; ii<( 3U * DEFERRED_LOG_RING_SIZE ); ii++)
+    {
+        DEFERRED_LOG1(ALC_LOGGER_INFO, LOG_ID_DUC_NODES_DELETED, ii);
+        CHECK_TRUE( DeferredLog_pop(&entry) );
+        LONGS_EQUAL(ii, entry.args[0]);
+    }
+
+    CHECK_FALSE( DeferredLog_pop(&entry) );
+    LONGS_EQUAL(0, DeferredLog_get_num_dropped() );
+}
+/******************************************************************************/
+TEST( test_deferred_log, format_with_args )
+{
+    DeferredLogEntry entry = {};
+    char str[DEFERRED_LOG_MAX_STR_LEN];
+
+    entry.id       = LOG_ID_DUC_DATAGRAMS_GIVEN_UP;
+    entry.num_args = 1U;
+    entry.args[0]  = 7U;
+
+    LONGS_EQUAL(65, DeferredLog_format(&entry, str, sizeof(str)) );
+    STRCMP_EQUAL("Data Upload Client gave up 7 datagrams not acknowledged by server", str);
+}
+/******************************************************************************/
+TEST( test_deferred_log, format_truncates )
+{
+    DeferredLogEntry entry = {};
+    char str[9];
+
+    entry.id = LOG_ID_POOL_EMPTY;
+
+    LONGS_EQUAL(8, DeferredLog_format(&entry, str, sizeof(str)) );
+    STRCMP_EQUAL("SensorDa", str);
+}
+/******************************************************************************/
+TEST( test_deferred_log, unknown_id )
+{
+    STRCMP_EQUAL("?", DeferredLog_get_format(NUM_DEFERRED_LOG_IDS) );
+}
+/******************************************************************************/
+TEST( test_deferred_log, flush_emits_at_level )
+{
+    DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_REGISTERED);
+    DEFERRED_LOG(ALC_LOGGER_WARNING, LOG_ID_POOL_EMPTY);
+    DEFERRED_LOG(ALC_LOGGER_ERROR, LOG_ID_DUC_SEND_FAILED);
+
+    mock().expectOneCall("AlcLogger_log_info");
+    mock().expectOneCall("AlcLogger_log_warning");
+    mock().expectOneCall("AlcLogger_log_error");
+
+    LONGS_EQUAL(3, DeferredLog_flush(10U) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_deferred_log, flush_stops_at_max )
+{
+    DeferredLogEntry entry;
+
+    DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_REGISTERED);
+    DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_CONNECTED);
+
+    mock().expectOneCall("AlcLogger_log_info");
+    LONGS_EQUAL(1, DeferredLog_flush(1U) );
+    mock().checkExpectations();
+
+    CHECK_TRUE( DeferredLog_pop(&entry) );
+    LONGS_EQUAL(LOG_ID_MODEM_CONNECTED, entry.id);
+}
+/******************************************************************************/
+TEST( test_deferred_log, flush_logs_dropped_once )
+{
+    for(uint32_t ii=0U; ii<( DEFERRED_LOG_RING_SIZE + 1U ); ii++)
+    {
+        DEFERRED_LOG(ALC_LOGGER_INFO, LOG_ID_MODEM_REGISTERED);
+    }
+
+    mock().expectNCalls(DEFERRED_LOG_RING_SIZE, "AlcLogger_log_info");
+    mock().expectOneCall("AlcLogger_log_warning");
+    DeferredLog_flush(DEFERRED_LOG_RING_SIZE);
+    mock().checkExpectations();
+
+    /* Nothing new dropped */
+    LONGS_EQUAL(0, DeferredLog_flush(DEFERRED_LOG_RING_SIZE) );
+    mock().checkExpectations();
+}
+/******************************************************************************/
@@ -0,0 +1,243 @@
+/**
+ * @file  modem_urc_matcher_test.cpp
+ * @brief Unit-tests for the modem URC matcher module
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <string.h>
+
+#include "modem_urc_matcher.h"
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+
+
+
+/*******************************************************************************
+*                                  Test Group
+*******************************************************************************/
+TEST_GROUP( test_modem_urc_matcher )
+{
+    ModemUrcMatcher matcher;
+
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        CHECK( ModemUrcMatcher_init() );
+        ModemUrcMatcher_reset(&matcher);
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        mock().clear();
+    }
+    /**************************************************************************/
+    /** @brief A utility function to feed a whole line into the matcher
+     *
+     * @return The token from the end of the line, or the first prefix token.
+     */
+    ModemToken feed_line__(char const *p_line)
+    {
+        for(size_t ii=0U; ii<strlen(p_line); ii++)
+        {
+            ModemToken token = ModemUrcMatcher_feed(&matcher, (uint8_t) p_line[ii]);
+
+            if( token != MODEM_TOKEN_NONE )
+            {
+                return token;
+            }
+        }
+
+        return ModemUrcMatcher_end_of_line(&matcher);
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+TEST( test_modem_urc_matcher, final_result_codes )
+{
+    LONGS_EQUAL( MODEM_TOKEN_OK,      feed_line__("OK") );
+    LONGS_EQUAL( MODEM_TOKEN_FAIL,    feed_line__("FAIL") );
+    LONGS_EQUAL( MODEM_TOKEN_ERROR,   feed_line__("ERROR") );
+    LONGS_EQUAL( MODEM_TOKEN_BUSY_P,  feed_line__("busy p...") );
+    LONGS_EQUAL( MODEM_TOKEN_SHUT_OK, feed_line__("SHUT OK") );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_modem_urc_matcher, whole_line_must_match )
+{
+    LONGS_EQUAL( MODEM_TOKEN_NONE, feed_line__("O") );
+    LONGS_EQUAL( MODEM_TOKEN_NONE, feed_line__("OKAY") );
+    LONGS_EQUAL( MODEM_TOKEN_NONE, feed_line__(" OK") );
+    LONGS_EQUAL( MODEM_TOKEN_NONE, feed_line__("+CSQ: 18,0") );
+    LONGS_EQUAL( MODEM_TOKEN_NONE, feed_line__("") );
+
+    /* A failed line must not affect the next one */
+    LONGS_EQUAL( MODEM_TOKEN_OK,   feed_line__("OK") );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_modem_urc_matcher, channel_is_captured )
+{
+    LONGS_EQUAL( MODEM_TOKEN_CONNECT_OK, feed_line__("5, CONNECT OK") );
+    LONGS_EQUAL( 5, ModemUrcMatcher_get_capture(&matcher, 0U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_CONNECT_FAIL, feed_line__("2, CONNECT FAIL") );
+    LONGS_EQUAL( 2, ModemUrcMatcher_get_capture(&matcher, 0U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_CLOSE_OK, feed_line__("5, CLOSE OK") );
+    LONGS_EQUAL( 5, ModemUrcMatcher_get_capture(&matcher, 0U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_CLOSED, feed_line__("1, CLOSED") );
+    LONGS_EQUAL( 1, ModemUrcMatcher_get_capture(&matcher, 0U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_SEND_OK, feed_line__("0, SEND OK") );
+    LONGS_EQUAL( 0, ModemUrcMatcher_get_capture(&matcher, 0U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_SEND_FAIL, feed_line__("12, SEND FAIL") );
+    LONGS_EQUAL( 12, ModemUrcMatcher_get_capture(&matcher, 0U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_DATA_ACCEPT, feed_line__("DATA ACCEPT:5,1024") );
+    LONGS_EQUAL( 5,    ModemUrcMatcher_get_capture(&matcher, 0U) );
+    LONGS_EQUAL( 1024, ModemUrcMatcher_get_capture(&matcher, 1U) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_modem_urc_matcher, single_connection_forms )
+{
+    LONGS_EQUAL( MODEM_TOKEN_CONNECT, feed_line__("CONNECT") );
+    LONGS_EQUAL( 0, ModemUrcMatcher_get_num_captures(&matcher) );
+
+    LONGS_EQUAL( MODEM_TOKEN_CONNECT_FAIL, feed_line__("CONNECT FAIL") );
+    LONGS_EQUAL( 0, ModemUrcMatcher_get_num_captures(&matcher) );
+
+    LONGS_EQUAL( MODEM_TOKEN_CLOSED, feed_line__("CLOSED") );
+    LONGS_EQUAL( 0, ModemUrcMatcher_get_num_captures(&matcher) );
+
+    LONGS_EQUAL( MODEM_TOKEN_CLOSE_OK, feed_line__("CLOSE OK") );
+    LONGS_EQUAL( 0, ModemUrcMatcher_get_num_captures(&matcher) );
+
+    LONGS_EQUAL( MODEM_TOKEN_CLOSED, feed_line__("5, CLOSED") );
+    LONGS_EQUAL( 1, ModemUrcMatcher_get_num_captures(&matcher) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_modem_urc_matcher, receive_fires_on_the_colon )
+{
+    char const *p_line = "+RECEIVE,5,1460:";
+
+    for(size_t ii=0U; ii<strlen(p_line)-1U; ii++)
+    {
+        LONGS_EQUAL( MODEM_TOKEN_NONE, ModemUrcMatcher_feed(&matcher, (uint8_t) p_line[ii]) );
+    }
+
+    LONGS_EQUAL( MODEM_TOKEN_RECEIVE, ModemUrcMatcher_feed(&matcher, ':') );
+    LONGS_EQUAL( 5,    ModemUrcMatcher_get_capture(&matcher, 0U) );
+    LONGS_EQUAL( 1460, ModemUrcMatcher_get_capture(&matcher, 1U) );
+
+    /* The rest of the line is ignored */
+    LONGS_EQUAL( MODEM_TOKEN_NONE, ModemUrcMatcher_feed(&matcher, 'O') );
+    LONGS_EQUAL( MODEM_TOKEN_NONE, ModemUrcMatcher_feed(&matcher, 'K') );
+    LONGS_EQUAL( MODEM_TOKEN_NONE, ModemUrcMatcher_end_of_line(&matcher) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_modem_urc_matcher, missing_digits_do_not_match )
+{
+    LONGS_EQUAL( MODEM_TOKEN_NONE, feed_line__(", CONNECT OK") );
+    LONGS_EQUAL( MODEM_TOKEN_NONE, feed_line__("+RECEIVE,5,:") );
+    LONGS_EQUAL( MODEM_TOKEN_NONE, feed_line__("X, SEND OK") );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_modem_urc_matcher, readiness_codes )
+{
+    LONGS_EQUAL( MODEM_TOKEN_RDY,        feed_line__("RDY") );
+    LONGS_EQUAL( MODEM_TOKEN_CALL_READY, feed_line__("Call Ready") );
+    LONGS_EQUAL( MODEM_TOKEN_SMS_READY,  feed_line__("SMS Ready") );
+
+    /* The URC has just the status, the reply to "AT+CREG?" has the mode first */
+    LONGS_EQUAL( MODEM_TOKEN_CREG, feed_line__("+CREG: 1") );
+    LONGS_EQUAL( 1, ModemUrcMatcher_get_num_captures(&matcher) );
+    LONGS_EQUAL( 1, ModemUrcMatcher_get_capture(&matcher, 0U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_CREG, feed_line__("+CREG: 1,5") );
+    LONGS_EQUAL( 2, ModemUrcMatcher_get_num_captures(&matcher) );
+    LONGS_EQUAL( 5, ModemUrcMatcher_get_capture(&matcher, 1U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_CGATT, feed_line__("+CGATT: 0") );
+    LONGS_EQUAL( 0, ModemUrcMatcher_get_capture(&matcher, 0U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_NONE, feed_line__("+CREG: ") );
+    LONGS_EQUAL( MODEM_TOKEN_NONE, feed_line__("Call Ready.") );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_modem_urc_matcher, ec2x_codes )
+{
+    LONGS_EQUAL( MODEM_TOKEN_CONNECT_OK, feed_line__("+QIOPEN: 5,0") );
+    LONGS_EQUAL( 5, ModemUrcMatcher_get_capture(&matcher, 0U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_CONNECT_FAIL, feed_line__("+QIOPEN: 5,566") );
+    LONGS_EQUAL( 2, ModemUrcMatcher_get_num_captures(&matcher) );
+    LONGS_EQUAL( 566, ModemUrcMatcher_get_capture(&matcher, 1U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_CLOSED, feed_line__("+QIURC: \"closed\",11") );
+    LONGS_EQUAL( 11, ModemUrcMatcher_get_capture(&matcher, 0U) );
+
+    /* The data follows the line, so it is only known at the end of the line */
+    LONGS_EQUAL( MODEM_TOKEN_RECEIVE_LINE, feed_line__("+QIURC: \"recv\",5,1460") );
+    LONGS_EQUAL( 5,    ModemUrcMatcher_get_capture(&matcher, 0U) );
+    LONGS_EQUAL( 1460, ModemUrcMatcher_get_capture(&matcher, 1U) );
+
+    /* No channel -- the driver knows which channel it was sending to */
+    LONGS_EQUAL( MODEM_TOKEN_SEND_OK,   feed_line__("SEND OK") );
+    LONGS_EQUAL( 0, ModemUrcMatcher_get_num_captures(&matcher) );
+    LONGS_EQUAL( MODEM_TOKEN_SEND_FAIL, feed_line__("SEND FAIL") );
+
+    LONGS_EQUAL( MODEM_TOKEN_SMS_READY, feed_line__("+QIND: SMS DONE") );
+
+    LONGS_EQUAL( MODEM_TOKEN_CREG, feed_line__("+CEREG: 1,5") );
+    LONGS_EQUAL( 5, ModemUrcMatcher_get_capture(&matcher, 1U) );
+
+    LONGS_EQUAL( MODEM_TOKEN_NONE, feed_line__("+QIURC: \"pdpdeact\",1") );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_modem_urc_matcher, capture_out_of_range )
+{
+    LONGS_EQUAL( MODEM_TOKEN_CLOSED, feed_line__("3, CLOSED") );
+    LONGS_EQUAL( 0, ModemUrcMatcher_get_capture(&matcher, 1U) );
+    LONGS_EQUAL( 0, ModemUrcMatcher_get_capture(&matcher, MODEM_URC_MATCHER_MAX_CAPTURES) );
+    LONGS_EQUAL( 0, ModemUrcMatcher_get_capture(nullptr, 0U) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_modem_urc_matcher, token_names )
+{
+    STRCMP_EQUAL( "OK",      ModemUrcMatcher_token_name(MODEM_TOKEN_OK) );
+    STRCMP_EQUAL( "RECEIVE", ModemUrcMatcher_token_name(MODEM_TOKEN_RECEIVE) );
+    STRCMP_EQUAL( "?",       ModemUrcMatcher_token_name(NUM_MODEM_TOKENS) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
@@ -0,0 +1,313 @@
+/**
+ * @file  resend_request_test.cpp
+ * @brief Unit-tests for the resend requests
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <string.h>
+
+#include "resend_request.h"
+#include "sensor_node_list.h"
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+
+
+
+/*******************************************************************************
+*                               Mock functions
+*******************************************************************************/
+static bool send_mock(uip_ipaddr_t const *p_ipaddr, uint16_t id16, uint32_t first_seq32, uint32_t count)
+{
+    (void) p_ipaddr;
+
+    return mock().actualCall("send")
+            .withParameter("id16", id16)
+            .withParameter("first_seq32", first_seq32)
+            .withParameter("count", count)
+            .returnBoolValueOrDefault(true);
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                                  Test Group
+*******************************************************************************/
+TEST_GROUP( test_resend_request )
+{
+    SensorNode         *p_sensor_node1;
+    SensorNode         *p_sensor_node2;
+    struct SensorData   data[8];
+    ResendRequestStats  stats;
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        SNL_init();
+        ResendRequest_init();
+        ResendRequest_set_send_fn(&send_mock);
+
+        p_sensor_node1 = create_node__(1U);
+        p_sensor_node2 = create_node__(2U);
+
+        memset(data, 0, sizeof(data));
+        memset(&stats, 0, sizeof(stats));
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        while( SensorNode_remove_data(p_sensor_node1) )
+        {
+        }
+        while( SensorNode_remove_data(p_sensor_node2) )
+        {
+        }
+
+        SensorNode_clear_ready_list();
+        mock().clear();
+    }
+    /**************************************************************************/
+    SensorNode* create_node__(uint16_t id)
+    {
+        uip_ipaddr_t ipaddr;
+        bool         was_created;
+
+        memset(&ipaddr, 0, sizeof(ipaddr));
+        ipaddr.u16[0] = id;
+
+        SensorNode *p_sensor_node = SNL_find(&ipaddr, true, &was_created);
+
+        CHECK( p_sensor_node != nullptr );
+        CHECK_TRUE( SensorNode_reset_data_stream(p_sensor_node, id, 1U) );
+
+        return p_sensor_node;
+    }
+    /**************************************************************************/
+    void add__(SensorNode *p_sensor_node, uint32_t index, uint32_t seq32)
+    {
+        data[index].seq32 = seq32;
+
+        (void) SensorNode_add_data(p_sensor_node, &data[index]);
+    }
+    /**************************************************************************/
+    void expect_send__(uint16_t id16, uint32_t first_seq32, uint32_t count)
+    {
+        mock().expectOneCall("send")
+                .withParameter("id16", id16)
+                .withParameter("first_seq32", first_seq32)
+                .withParameter("count", count);
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                                    Tests
+*******************************************************************************/
+TEST( test_resend_request, nothing_missing )
+{
+    add__(p_sensor_node1, 0, 1U);
+
+    ResendRequest_poll(0U);
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY);
+
+    ResendRequest_get_stats(&stats);
+    UNSIGNED_LONGS_EQUAL(0U, stats.num_sent);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_resend_request, waits_for_late_samples )
+{
+    add__(p_sensor_node1, 0, 1U);
+    add__(p_sensor_node1, 1, 4U);
+
+    ResendRequest_poll(0U);
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY - 1U);
+
+    /* The late samples arrive -- nothing is requested */
+    add__(p_sensor_node1, 2, 2U);
+    add__(p_sensor_node1, 3, 3U);
+
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY);
+
+    ResendRequest_get_stats(&stats);
+    UNSIGNED_LONGS_EQUAL(0U, stats.num_sent);
+    UNSIGNED_LONGS_EQUAL(1U, stats.num_resolved);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_resend_request, requests_and_repeats )
+{
+    add__(p_sensor_node1, 0, 1U);
+    add__(p_sensor_node1, 1, 4U);
+
+    ResendRequest_poll(0U);
+
+    expect_send__(1U, 2U, 2U);
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY);
+
+    /* Not again until the repeat delay */
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY + 1U);
+
+    /* One of the two has arrived */
+    add__(p_sensor_node1, 2, 2U);
+
+    expect_send__(1U, 3U, 1U);
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY + RESEND_REQUEST_REPEAT_DELAY);
+
+    ResendRequest_get_stats(&stats);
+    UNSIGNED_LONGS_EQUAL(2U, stats.num_sent);
+    UNSIGNED_LONGS_EQUAL(0U, stats.num_resolved);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_resend_request, one_run_per_node )
+{
+    add__(p_sensor_node1, 0, 1U);
+    add__(p_sensor_node1, 1, 3U);
+    add__(p_sensor_node1, 2, 5U);
+
+    ResendRequest_poll(0U);
+
+    /* Only the first run */
+    expect_send__(1U, 2U, 1U);
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_resend_request, rate_limited_across_nodes )
+{
+    add__(p_sensor_node1, 0, 1U);
+    add__(p_sensor_node1, 1, 3U);
+    add__(p_sensor_node2, 2, 1U);
+    add__(p_sensor_node2, 3, 3U);
+
+    ResendRequest_poll(0U);
+
+    expect_send__(1U, 2U, 1U);
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY);
+    mock().checkExpectations();
+
+    expect_send__(2U, 2U, 1U);
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY + RESEND_REQUEST_MIN_INTERVAL);
+
+    ResendRequest_get_stats(&stats);
+    UNSIGNED_LONGS_EQUAL(2U, stats.num_sent);
+    UNSIGNED_LONGS_EQUAL(1U, stats.num_rate_limited);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_resend_request, failed_send_is_tried_again )
+{
+    add__(p_sensor_node1, 0, 1U);
+    add__(p_sensor_node1, 1, 3U);
+
+    ResendRequest_poll(0U);
+
+    mock().expectOneCall("send").ignoreOtherParameters().andReturnValue(false);
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY);
+
+    expect_send__(1U, 2U, 1U);
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY + 1U);
+
+    ResendRequest_get_stats(&stats);
+    UNSIGNED_LONGS_EQUAL(1U, stats.num_sent);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_resend_request, long_run_is_capped )
+{
+    add__(p_sensor_node1, 0, 1U);
+    add__(p_sensor_node1, 1, ( RESEND_REQUEST_MAX_COUNT + 100U ));
+
+    ResendRequest_poll(0U);
+
+    expect_send__(1U, 2U, RESEND_REQUEST_MAX_COUNT);
+    ResendRequest_poll(RESEND_REQUEST_1ST_DELAY);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_resend_request, given_up_run_is_skipped )
+{
+    clock_time_t now = 0U;
+
+    add__(p_sensor_node1, 0, 3U);
+
+    ResendRequest_poll(now);
+    now += RESEND_REQUEST_1ST_DELAY;
+
+    for(uint32_t ii=0U; ii<RESEND_REQUEST_MAX_TX_COUNT; ii++)
+    {
+        expect_send__(1U, 1U, 2U);
+        ResendRequest_poll(now);
+        now += RESEND_REQUEST_REPEAT_DELAY;
+    }
+
+    /* Still held back by 1 and 2 */
+    UNSIGNED_LONGS_EQUAL(0U, SensorNode_received_to_seq32(p_sensor_node1) );
+
+    ResendRequest_poll(now);
+
+    ResendRequest_get_stats(&stats);
+    UNSIGNED_LONGS_EQUAL(RESEND_REQUEST_MAX_TX_COUNT, stats.num_sent);
+    UNSIGNED_LONGS_EQUAL(1U, stats.num_given_up);
+    UNSIGNED_LONGS_EQUAL(1U, stats.num_skipped);
+    UNSIGNED_LONGS_EQUAL(3U, SensorNode_received_to_seq32(p_sensor_node1) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_resend_request, run_is_kept_with_no_sender )
+{
+    clock_time_t now = 0U;
+
+    ResendRequest_set_send_fn(NULL);
+
+    add__(p_sensor_node1, 0, 3U);
+
+    ResendRequest_poll(now);
+    now += RESEND_REQUEST_1ST_DELAY;
+
+    for(uint32_t ii=0U; ii<( RESEND_REQUEST_MAX_TX_COUNT + 1U ); ii++)
+    {
+        ResendRequest_poll(now);
+        now += RESEND_REQUEST_REPEAT_DELAY;
+    }
+
+    ResendRequest_get_stats(&stats);
+    UNSIGNED_LONGS_EQUAL(( RESEND_REQUEST_MAX_TX_COUNT + 1U ), stats.num_unsent);
+    UNSIGNED_LONGS_EQUAL(0U, stats.num_given_up);
+    UNSIGNED_LONGS_EQUAL(0U, stats.num_skipped);
+    UNSIGNED_LONGS_EQUAL(0U, SensorNode_received_to_seq32(p_sensor_node1) );
+
+    /* Asked for as soon as there is a sender */
+    ResendRequest_set_send_fn(&send_mock);
+
+    expect_send__(1U, 1U, 2U);
+    ResendRequest_poll(now);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
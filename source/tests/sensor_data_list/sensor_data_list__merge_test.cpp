@@ -0,0 +1,189 @@
+/**
+ * @file  sensor_data_list__merge_test.cpp
+ * @brief Unit-tests for the merge function
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <algorithm>
+#include <iostream>
+#include <memory.h>
+#include <vector>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "sensor_data_list.h"
+
+
+
+
+/*******************************************************************************
+*                                  Test Group
+*******************************************************************************/
+TEST_GROUP( test_sensor_data_list__merge )
+{
+    SensorDataList list1;
+    SensorDataList batch1;
+    std::vector<struct SensorData> data1;
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        SensorDataList_init(&list1);
+        SensorDataList_init(&batch1);
+
+        // Room for every test, so the objects don't move
+        data1.resize(64);
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        mock().clear();
+    }
+    /**************************************************************************/
+    void fill__(SensorDataList &list, std::vector<uint32_t> const &source, uint32_t offset)
+    {
+        for(std::vector<uint32_t>::size_type ii = 0; ii != source.size(); ++ii)
+        {
+            struct SensorData &data = data1[offset + ii];
+
+            memset(&data, 0, sizeof(struct SensorData));
+            data.seq32 = source[ii];
+
+            SensorDataList_push_back(&list, &data);
+        }
+    }
+    /**************************************************************************/
+    void check_list__(SensorDataList const &list, std::vector<uint32_t> const &expected)
+    {
+        std::vector<uint32_t>::size_type count = 0;
+
+        for(auto iter = list.p_first; iter != NULL; iter = iter->p_next)
+        {
+            UNSIGNED_LONGS_EQUAL(expected[count], iter->seq32);
+            count++;
+        }
+
+        LONGS_EQUAL(expected.size(), count);
+
+        SensorDataList_check_links(&list);
+    }
+    /**************************************************************************/
+    uint32_t test_merge__(std::vector<uint32_t> const &existing, std::vector<uint32_t> const &batch)
+    {
+        fill__(list1, existing, 0);
+        fill__(batch1, batch, 32);
+
+        return SensorDataList_merge(&list1, &batch1);
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                                    Tests
+*******************************************************************************/
+TEST( test_sensor_data_list__merge, into_empty_list )
+{
+    UNSIGNED_LONGS_EQUAL(3U, test_merge__({}, {1,2,3}) );
+
+    check_list__(list1, {1,2,3});
+    check_list__(batch1, {});
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_data_list__merge, empty_batch )
+{
+    UNSIGNED_LONGS_EQUAL(0U, test_merge__({1,2,3}, {}) );
+
+    check_list__(list1, {1,2,3});
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_data_list__merge, after_the_end )
+{
+    UNSIGNED_LONGS_EQUAL(3U, test_merge__({1,2,3}, {4,5,6}) );
+
+    check_list__(list1, {1,2,3,4,5,6});
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_data_list__merge, before_the_front )
+{
+    UNSIGNED_LONGS_EQUAL(2U, test_merge__({5,6,7}, {1,2}) );
+
+    check_list__(list1, {1,2,5,6,7});
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_data_list__merge, interleaved )
+{
+    UNSIGNED_LONGS_EQUAL(4U, test_merge__({1,3,5,7}, {2,4,6,8}) );
+
+    check_list__(list1, {1,2,3,4,5,6,7,8});
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_data_list__merge, duplicates_are_left_in_the_batch )
+{
+    UNSIGNED_LONGS_EQUAL(2U, test_merge__({1,3,5}, {1,2,3,4}) );
+
+    check_list__(list1, {1,2,3,4,5});
+    check_list__(batch1, {1,3});
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_data_list__merge, duplicate_within_the_batch )
+{
+    UNSIGNED_LONGS_EQUAL(2U, test_merge__({}, {1,2,2}) );
+
+    check_list__(list1, {1,2});
+    check_list__(batch1, {2});
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_data_list__merge, batch_not_in_order )
+{
+    UNSIGNED_LONGS_EQUAL(4U, test_merge__({3,6}, {4,8,1,7}) );
+
+    check_list__(list1, {1,3,4,6,7,8});
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_data_list__merge, seq32_wraps )
+{
+    UNSIGNED_LONGS_EQUAL(3U, test_merge__({(uint32_t) -2,(uint32_t) -1}, {(uint32_t) -3,0,1}) );
+
+    check_list__(list1, {(uint32_t) -3,(uint32_t) -2,(uint32_t) -1,0,1});
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_data_list__merge, null_pointers )
+{
+    UNSIGNED_LONGS_EQUAL(0U, SensorDataList_merge(nullptr, &batch1) );
+    UNSIGNED_LONGS_EQUAL(0U, SensorDataList_merge(&list1, nullptr) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
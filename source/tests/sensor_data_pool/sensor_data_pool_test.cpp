@@ -15,6 +15,7 @@
 #include "CppUTest/TestHarness.h"
 #include "CppUTestExt/MockSupport.h"
 
+#include "deferred_log.h"
 #include "sensor_data_pool.h"
 
 
@@ -102,6 +103,10 @@ mock().expectOneCall("SensorDataPool_return").withOutputParameterReturning("p_da
 /******************************************************************************/
 TEST( test_sensor_data_pool, test_get_empty )
 {
+    DeferredLogEntry entry;
+
+    DeferredLog_init();
+
     auto p_obj = SensorDataPool_get();
 
     p_obj = SensorDataPool_get();
@@ -113,9 +118,14 @@ TEST( test_sensor_data_pool, test_get_empty )
     p_obj = SensorDataPool_get();
     p_obj = SensorDataPool_get();
 
-    mock().expectOneCall("AlcLogger_log_warning");
+    CHECK_FALSE( DeferredLog_pop(&entry) );
     p_obj = SensorDataPool_get();
 
+    /* The warning is left for the deferred log task */
+    CHECK_TRUE( DeferredLog_pop(&entry) );
+    LONGS_EQUAL(LOG_ID_POOL_EMPTY, entry.id);
+    LONGS_EQUAL(ALC_LOGGER_WARNING, entry.level);
+
     p_obj = SensorDataPool_get();
     POINTERS_EQUAL(nullptr, p_obj);
 
@@ -36,6 +36,7 @@ TEST_GROUP( test_sensor_node )
     TEST_SETUP()
     {
         // setup() is run before each test
+        CHECK_TRUE( SensorNode_init_locks() );
     }
     /**************************************************************************/
     TEST_TEARDOWN()
@@ -76,6 +77,7 @@ TEST_GROUP( test_sensor_node__max_pop_len )
     TEST_SETUP()
     {
         // setup() is run before each test
+        CHECK_TRUE( SensorNode_init_locks() );
         SensorNode_init(&sensor_node1);
     }
     /**************************************************************************/
@@ -177,3 +179,690 @@ TEST( test_sensor_node__max_pop_len, len10__broken_seq2 )
     mock().checkExpectations();
 }
 /******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                            Test Group dropped samples
+*******************************************************************************/
+TEST_GROUP( test_sensor_node__dropped )
+{
+    SensorNode        sensor_node1;
+    struct SensorData data[2];
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        CHECK_TRUE( SensorNode_init_locks() );
+        SensorNode_init(&sensor_node1);
+
+        memset(data, 0, sizeof(data));
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        SensorNode_clear_ready_list();
+        mock().clear();
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+TEST( test_sensor_node__dropped, none_after_init )
+{
+    UNSIGNED_LONGS_EQUAL(0U, SensorNode_get_num_dropped(&sensor_node1) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__dropped, added_is_not_dropped )
+{
+    data[0].seq32 = 1U;
+    data[1].seq32 = 2U;
+
+    CHECK_TRUE( SensorNode_add_data(&sensor_node1, &data[0]) );
+    CHECK_TRUE( SensorNode_add_data(&sensor_node1, &data[1]) );
+
+    UNSIGNED_LONGS_EQUAL(0U, SensorNode_get_num_dropped(&sensor_node1) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__dropped, duplicate_is_counted )
+{
+    data[0].seq32 = 1U;
+    data[1].seq32 = 1U;
+
+    CHECK_TRUE( SensorNode_add_data(&sensor_node1, &data[0]) );
+    CHECK_FALSE( SensorNode_add_data(&sensor_node1, &data[1]) );
+
+    UNSIGNED_LONGS_EQUAL(1U, SensorNode_get_num_dropped(&sensor_node1) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__dropped, null_pointer )
+{
+    UNSIGNED_LONGS_EQUAL(0U, SensorNode_get_num_dropped(nullptr) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                            Test Group read-info
+*******************************************************************************/
+TEST_GROUP( test_sensor_node__read_info )
+{
+    SensorNode     sensor_node1;
+    SensorNodeInfo info;
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        CHECK_TRUE( SensorNode_init_locks() );
+        SensorNode_init(&sensor_node1);
+
+        memset(&info, 0, sizeof(info));
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        mock().clear();
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+TEST( test_sensor_node__read_info, after_init )
+{
+    CHECK_TRUE( SensorNode_read_info(&sensor_node1, &info) );
+
+    STRCMP_EQUAL("ok", info.p_status);
+    CHECK_TRUE( info.is_dirty );
+    UNSIGNED_LONGS_EQUAL(0U, info.num_samples_waiting);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__read_info, after_update )
+{
+    SensorNode_begin_info_update(&sensor_node1);
+    sensor_node1.fw_version[0]       = 1U;
+    sensor_node1.fw_version[1]       = 2U;
+    sensor_node1.fw_version[2]       = 3U;
+    sensor_node1.num_samples_waiting = 1200U;
+    sensor_node1.bulb_current_ma_rms = 350U;
+    SensorNode_end_info_update(&sensor_node1);
+
+    SensorNode_mark_as_stale(&sensor_node1);
+
+    CHECK_TRUE( SensorNode_read_info(&sensor_node1, &info) );
+
+    UNSIGNED_LONGS_EQUAL(1U, info.fw_version[0]);
+    UNSIGNED_LONGS_EQUAL(2U, info.fw_version[1]);
+    UNSIGNED_LONGS_EQUAL(3U, info.fw_version[2]);
+    UNSIGNED_LONGS_EQUAL(1200U, info.num_samples_waiting);
+    UNSIGNED_LONGS_EQUAL(350U, info.bulb_current_ma_rms);
+    STRCMP_EQUAL("stale", info.p_status);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__read_info, setters )
+{
+    uint8_t const fw_version[3] = { 4U, 5U, 6U };
+
+    SensorNode_set_fw_version(&sensor_node1, fw_version);
+    SensorNode_set_stratum(&sensor_node1, 2U);
+    SensorNode_set_position(&sensor_node1, 51.5, -3.9);
+    SensorNode_set_bulb_current(&sensor_node1, 410U);
+    SensorNode_set_num_samples_waiting(&sensor_node1, 7U);
+    SensorNode_count_rx_packet(&sensor_node1);
+    SensorNode_count_rx_packet(&sensor_node1);
+
+    CHECK_TRUE( SensorNode_read_info(&sensor_node1, &info) );
+
+    MEMCMP_EQUAL(fw_version, info.fw_version, sizeof(fw_version));
+    UNSIGNED_LONGS_EQUAL(2U, info.stratum);
+    DOUBLES_EQUAL(51.5, info.lat, 0.0);
+    DOUBLES_EQUAL(-3.9, info.lon, 0.0);
+    UNSIGNED_LONGS_EQUAL(410U, info.bulb_current_ma_rms);
+    UNSIGNED_LONGS_EQUAL(7U, info.num_samples_waiting);
+    UNSIGNED_LONGS_EQUAL(2U, info.num_rx_packets);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__read_info, during_update )
+{
+    SensorNode_begin_info_update(&sensor_node1);
+    sensor_node1.num_samples_waiting = 5U;
+
+    CHECK_FALSE( SensorNode_read_info(&sensor_node1, &info) );
+
+    SensorNode_end_info_update(&sensor_node1);
+
+    CHECK_TRUE( SensorNode_read_info(&sensor_node1, &info) );
+    UNSIGNED_LONGS_EQUAL(5U, info.num_samples_waiting);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__read_info, null_pointers )
+{
+    CHECK_FALSE( SensorNode_read_info(nullptr, &info) );
+    CHECK_FALSE( SensorNode_read_info(&sensor_node1, nullptr) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                            Test Group add-data-batch
+*******************************************************************************/
+TEST_GROUP( test_sensor_node__add_data_batch )
+{
+    SensorNode            sensor_node1;
+    SensorDataList        batch1;
+    SensorNodeBatchResult result;
+    struct SensorData     data[8];
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        CHECK_TRUE( SensorNode_init_locks() );
+        SensorNode_init(&sensor_node1);
+        SensorDataList_init(&batch1);
+
+        memset(data, 0, sizeof(data));
+        memset(&result, 0, sizeof(result));
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        SensorNode_clear_ready_list();
+        mock().clear();
+    }
+    /**************************************************************************/
+    void add_to_batch__(uint32_t index, uint32_t seq32)
+    {
+        data[index].seq32 = seq32;
+
+        SensorDataList_push_back(&batch1, &data[index]);
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+TEST( test_sensor_node__add_data_batch, all_inserted )
+{
+    add_to_batch__(0, 1U);
+    add_to_batch__(1, 2U);
+    add_to_batch__(2, 3U);
+
+    CHECK_TRUE( SensorNode_add_data_batch(&sensor_node1, &batch1, &result) );
+
+    UNSIGNED_LONGS_EQUAL(3U, result.num_inserted);
+    UNSIGNED_LONGS_EQUAL(0U, result.num_duplicates);
+    UNSIGNED_LONGS_EQUAL(0U, result.num_out_of_window);
+    UNSIGNED_LONGS_EQUAL(3U, SensorNode_get_data_size(&sensor_node1) );
+    CHECK_TRUE( SensorDataList_is_empty(&batch1) );
+    UNSIGNED_LONGS_EQUAL(0U, SensorNode_get_num_dropped(&sensor_node1) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__add_data_batch, duplicates_left_in_batch )
+{
+    data[4].seq32 = 2U;
+    CHECK_TRUE( SensorNode_add_data(&sensor_node1, &data[4]) );
+
+    add_to_batch__(0, 1U);
+    add_to_batch__(1, 2U);
+    add_to_batch__(2, 3U);
+
+    CHECK_TRUE( SensorNode_add_data_batch(&sensor_node1, &batch1, &result) );
+
+    UNSIGNED_LONGS_EQUAL(2U, result.num_inserted);
+    UNSIGNED_LONGS_EQUAL(1U, result.num_duplicates);
+    UNSIGNED_LONGS_EQUAL(1U, SensorDataList_get_size(&batch1) );
+    POINTERS_EQUAL(&data[1], batch1.p_first);
+    UNSIGNED_LONGS_EQUAL(1U, SensorNode_get_num_dropped(&sensor_node1) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__add_data_batch, already_sent_is_out_of_window )
+{
+    sensor_node1.front_seq32 = 10U;
+
+    add_to_batch__(0, 8U);
+    add_to_batch__(1, 9U);
+    add_to_batch__(2, 10U);
+    add_to_batch__(3, 11U);
+
+    CHECK_TRUE( SensorNode_add_data_batch(&sensor_node1, &batch1, &result) );
+
+    UNSIGNED_LONGS_EQUAL(2U, result.num_inserted);
+    UNSIGNED_LONGS_EQUAL(0U, result.num_duplicates);
+    UNSIGNED_LONGS_EQUAL(2U, result.num_out_of_window);
+    UNSIGNED_LONGS_EQUAL(2U, SensorDataList_get_size(&batch1) );
+    UNSIGNED_LONGS_EQUAL(2U, SensorNode_max_pop_len(&sensor_node1, 99U) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__add_data_batch, null_pointers )
+{
+    CHECK_FALSE( SensorNode_add_data_batch(nullptr, &batch1, &result) );
+    CHECK_FALSE( SensorNode_add_data_batch(&sensor_node1, nullptr, &result) );
+
+    UNSIGNED_LONGS_EQUAL(0U, result.num_inserted);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                            Test Group ready-list
+*******************************************************************************/
+TEST_GROUP( test_sensor_node__ready_list )
+{
+    SensorNode        sensor_node1;
+    SensorNode        sensor_node2;
+    struct SensorData data[4];
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        CHECK_TRUE( SensorNode_init_locks() );
+        SensorNode_clear_ready_list();
+        SensorNode_init(&sensor_node1);
+        SensorNode_init(&sensor_node2);
+
+        memset(data, 0, sizeof(data));
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        SensorNode_clear_ready_list();
+        mock().clear();
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+TEST( test_sensor_node__ready_list, empty_after_init )
+{
+    UNSIGNED_LONGS_EQUAL(0U, SensorNode_get_num_ready() );
+    POINTERS_EQUAL(nullptr, SensorNode_pop_ready() );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ready_list, add_data_joins_once )
+{
+    data[0].seq32 = 1U;
+    data[1].seq32 = 2U;
+
+    CHECK_TRUE( SensorNode_add_data(&sensor_node1, &data[0]) );
+    CHECK_TRUE( SensorNode_add_data(&sensor_node1, &data[1]) );
+
+    UNSIGNED_LONGS_EQUAL(1U, SensorNode_get_num_ready() );
+    POINTERS_EQUAL(&sensor_node1, SensorNode_pop_ready() );
+    POINTERS_EQUAL(nullptr, SensorNode_pop_ready() );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ready_list, duplicate_does_not_join )
+{
+    data[0].seq32 = 1U;
+    data[1].seq32 = 1U;
+
+    CHECK_TRUE( SensorNode_add_data(&sensor_node1, &data[0]) );
+    POINTERS_EQUAL(&sensor_node1, SensorNode_pop_ready() );
+
+    CHECK_FALSE( SensorNode_add_data(&sensor_node1, &data[1]) );
+    UNSIGNED_LONGS_EQUAL(0U, SensorNode_get_num_ready() );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ready_list, oldest_first )
+{
+    data[0].seq32 = 1U;
+
+    SensorNode_mark_as_dirty(&sensor_node2);
+    CHECK_TRUE( SensorNode_add_data(&sensor_node1, &data[0]) );
+
+    UNSIGNED_LONGS_EQUAL(2U, SensorNode_get_num_ready() );
+    POINTERS_EQUAL(&sensor_node2, SensorNode_pop_ready() );
+    POINTERS_EQUAL(&sensor_node1, SensorNode_pop_ready() );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ready_list, put_back_goes_to_the_end )
+{
+    SensorNode_mark_as_ready(&sensor_node1);
+    SensorNode_mark_as_ready(&sensor_node2);
+
+    SensorNode_mark_as_ready(SensorNode_pop_ready());
+
+    POINTERS_EQUAL(&sensor_node2, SensorNode_pop_ready() );
+    POINTERS_EQUAL(&sensor_node1, SensorNode_pop_ready() );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ready_list, batch_joins )
+{
+    SensorDataList batch1;
+
+    SensorDataList_init(&batch1);
+    data[0].seq32 = 1U;
+    SensorDataList_push_back(&batch1, &data[0]);
+
+    CHECK_TRUE( SensorNode_add_data_batch(&sensor_node1, &batch1, nullptr) );
+
+    POINTERS_EQUAL(&sensor_node1, SensorNode_pop_ready() );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ready_list, destroy_leaves )
+{
+    SensorNode_mark_as_ready(&sensor_node1);
+    SensorNode_mark_as_ready(&sensor_node2);
+
+    CHECK_TRUE( SensorNode_destroy(&sensor_node2) );
+
+    UNSIGNED_LONGS_EQUAL(1U, SensorNode_get_num_ready() );
+    POINTERS_EQUAL(&sensor_node1, SensorNode_pop_ready() );
+    POINTERS_EQUAL(nullptr, SensorNode_pop_ready() );
+
+    /* and can join again */
+    SensorNode_mark_as_ready(&sensor_node2);
+    POINTERS_EQUAL(&sensor_node2, SensorNode_pop_ready() );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                            Test Group ingest statistics
+*******************************************************************************/
+TEST_GROUP( test_sensor_node__ingest )
+{
+    SensorNode            sensor_node1;
+    SensorNodeIngestStats stats;
+    SensorDataList        batch1;
+    struct SensorData     data[8];
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        CHECK_TRUE( SensorNode_init_locks() );
+        SensorNode_init(&sensor_node1);
+        SensorDataList_init(&batch1);
+
+        memset(data, 0, sizeof(data));
+        memset(&stats, 0, sizeof(stats));
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        SensorNode_clear_ready_list();
+        mock().clear();
+    }
+    /**************************************************************************/
+    void add__(uint32_t index, uint32_t seq32)
+    {
+        data[index].seq32 = seq32;
+
+        (void) SensorNode_add_data(&sensor_node1, &data[index]);
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+TEST( test_sensor_node__ingest, in_order )
+{
+    add__(0, 1U);
+    add__(1, 2U);
+    add__(2, 3U);
+
+    CHECK_TRUE( SensorNode_get_ingest_stats(&sensor_node1, &stats) );
+
+    UNSIGNED_LONGS_EQUAL(3U, stats.num_samples);
+    UNSIGNED_LONGS_EQUAL(3U, stats.reorder_hist[0]);
+    UNSIGNED_LONGS_EQUAL(0U, stats.num_gaps);
+    UNSIGNED_LONGS_EQUAL(0U, stats.num_duplicates);
+    UNSIGNED_LONGS_EQUAL(0U, SensorNode_reorder_depth_percentile(&stats, 100U) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ingest, gap_is_counted )
+{
+    add__(0, 1U);
+    add__(1, 5U);
+    add__(2, 6U);
+    add__(3, 8U);
+
+    CHECK_TRUE( SensorNode_get_ingest_stats(&sensor_node1, &stats) );
+
+    UNSIGNED_LONGS_EQUAL(2U, stats.num_gaps);
+    UNSIGNED_LONGS_EQUAL(4U, stats.num_gap_samples);
+    UNSIGNED_LONGS_EQUAL(3U, stats.max_gap);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ingest, late_sample_depth )
+{
+    add__(0, 1U);
+    add__(1, 5U);
+    add__(2, 3U);
+    add__(3, 4U);
+
+    CHECK_TRUE( SensorNode_get_ingest_stats(&sensor_node1, &stats) );
+
+    /* 3 is 2 behind 5 (bucket [2, 4)), 4 is 1 behind (bucket [1, 2)) */
+    UNSIGNED_LONGS_EQUAL(2U, stats.reorder_hist[0]);
+    UNSIGNED_LONGS_EQUAL(1U, stats.reorder_hist[1]);
+    UNSIGNED_LONGS_EQUAL(1U, stats.reorder_hist[2]);
+    UNSIGNED_LONGS_EQUAL(2U, stats.max_reorder_depth);
+    UNSIGNED_LONGS_EQUAL(0U, SensorNode_reorder_depth_percentile(&stats, 50U) );
+    UNSIGNED_LONGS_EQUAL(2U, SensorNode_reorder_depth_percentile(&stats, 100U) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ingest, duplicate_is_counted )
+{
+    add__(0, 1U);
+    add__(1, 1U);
+
+    CHECK_TRUE( SensorNode_get_ingest_stats(&sensor_node1, &stats) );
+
+    UNSIGNED_LONGS_EQUAL(2U, stats.num_samples);
+    UNSIGNED_LONGS_EQUAL(1U, stats.num_duplicates);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ingest, batch_is_counted )
+{
+    data[0].seq32 = 1U;
+    data[1].seq32 = 2U;
+    data[2].seq32 = 4U;
+    SensorDataList_push_back(&batch1, &data[0]);
+    SensorDataList_push_back(&batch1, &data[1]);
+    SensorDataList_push_back(&batch1, &data[2]);
+
+    CHECK_TRUE( SensorNode_add_data_batch(&sensor_node1, &batch1, NULL) );
+
+    CHECK_TRUE( SensorNode_get_ingest_stats(&sensor_node1, &stats) );
+
+    UNSIGNED_LONGS_EQUAL(3U, stats.num_samples);
+    UNSIGNED_LONGS_EQUAL(1U, stats.num_gaps);
+    UNSIGNED_LONGS_EQUAL(3U, stats.reorder_hist[0]);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ingest, reset_data_stream_starts_again )
+{
+    add__(0, 100U);
+
+    /* So the reset has nothing to return to the pool */
+    POINTERS_EQUAL(&data[0], SensorNode_remove_data(&sensor_node1) );
+
+    CHECK_TRUE( SensorNode_reset_data_stream(&sensor_node1, 1U, 1U) );
+
+    add__(1, 1U);
+
+    CHECK_TRUE( SensorNode_get_ingest_stats(&sensor_node1, &stats) );
+
+    UNSIGNED_LONGS_EQUAL(2U, stats.reorder_hist[0]);
+    UNSIGNED_LONGS_EQUAL(0U, stats.max_reorder_depth);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__ingest, null_pointers )
+{
+    CHECK_FALSE( SensorNode_get_ingest_stats(nullptr, &stats) );
+    CHECK_FALSE( SensorNode_get_ingest_stats(&sensor_node1, nullptr) );
+    UNSIGNED_LONGS_EQUAL(0U, SensorNode_reorder_depth_percentile(nullptr, 50U) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                                  Test Group
+*******************************************************************************/
+TEST_GROUP( test_sensor_node__missing )
+{
+    SensorNode        sensor_node1;
+    struct SensorData data[8];
+    uint32_t          first_seq32;
+    uint32_t          count;
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        CHECK_TRUE( SensorNode_init_locks() );
+        SensorNode_init(&sensor_node1);
+        (void) SensorNode_reset_data_stream(&sensor_node1, 1U, 1U);
+
+        memset(data, 0, sizeof(data));
+        first_seq32 = 0U;
+        count       = 0U;
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        while( SensorNode_remove_data(&sensor_node1) )
+        {
+        }
+
+        SensorNode_clear_ready_list();
+        mock().clear();
+    }
+    /**************************************************************************/
+    void add__(uint32_t index, uint32_t seq32)
+    {
+        data[index].seq32 = seq32;
+
+        (void) SensorNode_add_data(&sensor_node1, &data[index]);
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+TEST( test_sensor_node__missing, nothing_missing )
+{
+    CHECK_FALSE( SensorNode_get_first_missing(&sensor_node1, &first_seq32, &count) );
+
+    add__(0, 1U);
+    add__(1, 2U);
+
+    CHECK_FALSE( SensorNode_get_first_missing(&sensor_node1, &first_seq32, &count) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__missing, first_run )
+{
+    add__(0, 1U);
+    add__(1, 4U);
+    add__(2, 7U);
+
+    CHECK_TRUE( SensorNode_get_first_missing(&sensor_node1, &first_seq32, &count) );
+
+    UNSIGNED_LONGS_EQUAL(2U, first_seq32);
+    UNSIGNED_LONGS_EQUAL(2U, count);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__missing, missing_front )
+{
+    add__(0, 3U);
+
+    CHECK_TRUE( SensorNode_get_first_missing(&sensor_node1, &first_seq32, &count) );
+
+    UNSIGNED_LONGS_EQUAL(1U, first_seq32);
+    UNSIGNED_LONGS_EQUAL(2U, count);
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__missing, skip_only_at_front )
+{
+    add__(0, 1U);
+    add__(1, 4U);
+
+    /* 2 and 3 are behind 1 */
+    CHECK_FALSE( SensorNode_skip_missing(&sensor_node1, 2U, 2U) );
+
+    POINTERS_EQUAL(&data[0], SensorNode_remove_data(&sensor_node1) );
+
+    CHECK_TRUE( SensorNode_skip_missing(&sensor_node1, 2U, 2U) );
+    UNSIGNED_LONGS_EQUAL(4U, SensorNode_received_to_seq32(&sensor_node1) );
+    CHECK_FALSE( SensorNode_get_first_missing(&sensor_node1, &first_seq32, &count) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node__missing, null_pointers )
+{
+    CHECK_FALSE( SensorNode_get_first_missing(nullptr, &first_seq32, &count) );
+    CHECK_FALSE( SensorNode_get_first_missing(&sensor_node1, nullptr, &count) );
+    CHECK_FALSE( SensorNode_get_first_missing(&sensor_node1, &first_seq32, nullptr) );
+    CHECK_FALSE( SensorNode_skip_missing(nullptr, 1U, 1U) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
@@ -360,6 +360,39 @@ TEST( test_sensor_node_list, find_next_active_node__when__random_list )
     mock().checkExpectations();
 }
 /******************************************************************************/
+TEST( test_sensor_node_list, new_nodes_are_ready )
+{
+    std::vector<SensorNode*> nodes;
+
+    create_nodes__(nodes, 3);
+
+    UNSIGNED_LONGS_EQUAL(3U, SensorNode_get_num_ready() );
+    POINTERS_EQUAL(nodes[0], SensorNode_pop_ready() );
+    POINTERS_EQUAL(nodes[1], SensorNode_pop_ready() );
+    POINTERS_EQUAL(nodes[2], SensorNode_pop_ready() );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
+TEST( test_sensor_node_list, get_index )
+{
+    std::vector<SensorNode*> nodes;
+    SensorNode sensor_node1;
+    uint32_t index=99U;
+
+    create_nodes__(nodes, 3);
+    nodes[1]->is_used = false;
+
+    CHECK_TRUE( SNL_get_index(nodes[2], &index) );
+    UNSIGNED_LONGS_EQUAL(2U, index);
+
+    CHECK_FALSE( SNL_get_index(nodes[1], &index) );
+    CHECK_FALSE( SNL_get_index(&sensor_node1, &index) );
+    CHECK_FALSE( SNL_get_index(nullptr, &index) );
+
+    mock().checkExpectations();
+}
+/******************************************************************************/
 
 
 
@@ -384,6 +417,7 @@ TEST_GROUP( test_sensor_node_list__max_pop_len )
     TEST_SETUP()
     {
         // setup() is run before each test
+        CHECK_TRUE( SensorNode_init_locks() );
         SensorNode_init(&sensor_node1);
     }
     /**************************************************************************/
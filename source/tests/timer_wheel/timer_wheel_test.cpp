@@ -0,0 +1,200 @@
+/**
+ * @file  timer_wheel_test.cpp
+ * @brief Unit-tests for the timer wheel
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <vector>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "timer_wheel.h"
+
+
+
+
+/*******************************************************************************
+*                                  Test Group
+*******************************************************************************/
+static std::vector<TimerWheelEntry*> s_fired;
+static TimerWheel s_rearm_wheel;
+
+static void record_fired__(TimerWheelEntry *p_entry)
+{
+    s_fired.push_back(p_entry);
+}
+
+/* Re-arms itself one second on each time it fires */
+static void rearm_fired__(TimerWheelEntry *p_entry)
+{
+    s_fired.push_back(p_entry);
+    TimerWheel_arm(&s_rearm_wheel, p_entry, ( p_entry->deadline_s + 1U ));
+}
+
+/* Disarms the entry in its context when it fires */
+static void disarm_other_fired__(TimerWheelEntry *p_entry)
+{
+    s_fired.push_back(p_entry);
+    TimerWheel_disarm(&s_rearm_wheel, (TimerWheelEntry*) p_entry->p_context);
+}
+
+TEST_GROUP( test_timer_wheel )
+{
+    TimerWheel wheel1;
+    TimerWheelEntry entry1;
+    TimerWheelEntry entry2;
+    TimerWheelEntry entry3;
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        s_fired.clear();
+        TimerWheel_init(&wheel1, 1000U);
+        TimerWheelEntry_init(&entry1, &record_fired__, nullptr);
+        TimerWheelEntry_init(&entry2, &record_fired__, nullptr);
+        TimerWheelEntry_init(&entry3, &record_fired__, nullptr);
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        mock().clear();
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                                    Tests
+*******************************************************************************/
+TEST( test_timer_wheel, init )
+{
+    LONGS_EQUAL(0, TimerWheel_get_num_armed(&wheel1) );
+    CHECK_FALSE( TimerWheelEntry_is_armed(&entry1) );
+    LONGS_EQUAL(0, TimerWheel_advance(&wheel1, 2000U) );
+}
+/******************************************************************************/
+TEST( test_timer_wheel, fires_at_deadline )
+{
+    TimerWheel_arm(&wheel1, &entry1, 1010U);
+    CHECK_TRUE( TimerWheelEntry_is_armed(&entry1) );
+    LONGS_EQUAL(1, TimerWheel_get_num_armed(&wheel1) );
+
+    LONGS_EQUAL(0, TimerWheel_advance(&wheel1, 1009U) );
+    LONGS_EQUAL(1, TimerWheel_advance(&wheel1, 1010U) );
+
+    LONGS_EQUAL(1, s_fired.size() );
+    POINTERS_EQUAL(&entry1, s_fired[0]);
+    CHECK_FALSE( TimerWheelEntry_is_armed(&entry1) );
+    LONGS_EQUAL(0, TimerWheel_get_num_armed(&wheel1) );
+}
+/******************************************************************************/
+TEST( test_timer_wheel, fires_only_due_entries )
+{
+    TimerWheel_arm(&wheel1, &entry1, 1005U);
+    TimerWheel_arm(&wheel1, &entry2, 1020U);
+    TimerWheel_arm(&wheel1, &entry3, 1005U);
+
+    LONGS_EQUAL(2, TimerWheel_advance(&wheel1, 1010U) );
+    LONGS_EQUAL(1, TimerWheel_get_num_armed(&wheel1) );
+    CHECK_TRUE( TimerWheelEntry_is_armed(&entry2) );
+}
+/******************************************************************************/
+TEST( test_timer_wheel, entry_beyond_one_turn_waits )
+{
+    /* Same slot as 1005, but one turn of the wheel later */
+    TimerWheel_arm(&wheel1, &entry1, ( 1005U + TIMER_WHEEL_NUM_SLOTS ));
+
+    LONGS_EQUAL(0, TimerWheel_advance(&wheel1, 1006U) );
+    LONGS_EQUAL(0, TimerWheel_advance(&wheel1, ( 1004U + TIMER_WHEEL_NUM_SLOTS )) );
+    LONGS_EQUAL(1, TimerWheel_advance(&wheel1, ( 1005U + TIMER_WHEEL_NUM_SLOTS )) );
+}
+/******************************************************************************/
+TEST( test_timer_wheel, long_gap_fires_everything_due )
+{
+    TimerWheel_arm(&wheel1, &entry1, 1001U);
+    TimerWheel_arm(&wheel1, &entry2, ( 1000U + ( 3U * TIMER_WHEEL_NUM_SLOTS ) ));
+    TimerWheel_arm(&wheel1, &entry3, ( 1000U + ( 10U * TIMER_WHEEL_NUM_SLOTS ) ));
+
+    LONGS_EQUAL(2, TimerWheel_advance(&wheel1, ( 1000U + ( 5U * TIMER_WHEEL_NUM_SLOTS ) )) );
+    CHECK_TRUE( TimerWheelEntry_is_armed(&entry3) );
+}
+/******************************************************************************/
+TEST( test_timer_wheel, past_deadline_fires_on_next_second )
+{
+    TimerWheel_arm(&wheel1, &entry1, 900U);
+
+    LONGS_EQUAL(0, TimerWheel_advance(&wheel1, 1000U) );
+    LONGS_EQUAL(1, TimerWheel_advance(&wheel1, 1001U) );
+}
+/******************************************************************************/
+TEST( test_timer_wheel, rearm_moves_deadline )
+{
+    TimerWheel_arm(&wheel1, &entry1, 1005U);
+    TimerWheel_arm(&wheel1, &entry1, 1050U);
+    LONGS_EQUAL(1, TimerWheel_get_num_armed(&wheel1) );
+
+    LONGS_EQUAL(0, TimerWheel_advance(&wheel1, 1049U) );
+    LONGS_EQUAL(1, TimerWheel_advance(&wheel1, 1050U) );
+}
+/******************************************************************************/
+TEST( test_timer_wheel, disarm )
+{
+    TimerWheel_arm(&wheel1, &entry1, 1005U);
+    TimerWheel_arm(&wheel1, &entry2, 1005U);
+    TimerWheel_arm(&wheel1, &entry3, 1005U);
+
+    /* From the middle of the slot, then from its head */
+    TimerWheel_disarm(&wheel1, &entry2);
+    TimerWheel_disarm(&wheel1, &entry3);
+    TimerWheel_disarm(&wheel1, &entry1);
+    TimerWheel_disarm(&wheel1, &entry1);
+
+    LONGS_EQUAL(0, TimerWheel_get_num_armed(&wheel1) );
+    LONGS_EQUAL(0, TimerWheel_advance(&wheel1, 1010U) );
+}
+/******************************************************************************/
+TEST( test_timer_wheel, clock_wraps )
+{
+    TimerWheel_init(&wheel1, 0xFFFFFFF0U);
+    TimerWheel_arm(&wheel1, &entry1, 0x00000005U);
+
+    LONGS_EQUAL(0, TimerWheel_advance(&wheel1, 0xFFFFFFFFU) );
+    LONGS_EQUAL(1, TimerWheel_advance(&wheel1, 0x00000005U) );
+}
+/******************************************************************************/
+TEST( test_timer_wheel, callback_can_rearm )
+{
+    TimerWheel_init(&s_rearm_wheel, 1000U);
+    TimerWheelEntry_init(&entry1, &rearm_fired__, nullptr);
+    TimerWheel_arm(&s_rearm_wheel, &entry1, 1001U);
+
+    LONGS_EQUAL(10, TimerWheel_advance(&s_rearm_wheel, 1010U) );
+    CHECK_TRUE( TimerWheelEntry_is_armed(&entry1) );
+    LONGS_EQUAL(1011, entry1.deadline_s);
+}
+/******************************************************************************/
+TEST( test_timer_wheel, callback_can_disarm_another )
+{
+    TimerWheel_init(&s_rearm_wheel, 1000U);
+    TimerWheelEntry_init(&entry1, &disarm_other_fired__, &entry2);
+    TimerWheel_arm(&s_rearm_wheel, &entry2, 1005U);
+    TimerWheel_arm(&s_rearm_wheel, &entry1, 1005U);
+
+    LONGS_EQUAL(1, TimerWheel_advance(&s_rearm_wheel, 1005U) );
+    POINTERS_EQUAL(&entry1, s_fired[0]);
+    LONGS_EQUAL(0, TimerWheel_get_num_armed(&s_rearm_wheel) );
+}
+/******************************************************************************/
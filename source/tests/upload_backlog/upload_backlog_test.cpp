@@ -0,0 +1,215 @@
+/**
+ * @file  upload_backlog_test.cpp
+ * @brief Unit-tests for the backlog of uploads waiting to be acknowledged
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "upload_backlog.h"
+
+
+
+
+/*******************************************************************************
+*                                  Test Group
+*******************************************************************************/
+TEST_GROUP( test_upload_backlog )
+{
+    UploadBacklog backlog1;
+    uint32_t      sent;         /* The channel's byte count */
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        UploadBacklog_init(&backlog1);
+        sent = 0U;
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        mock().clear();
+    }
+    /**************************************************************************/
+    void send_one(char const *p_str)
+    {
+        uint32_t len = strlen(p_str);
+
+        CHECK_TRUE( UploadBacklog_append(&backlog1, p_str, len) );
+        sent += len;
+        UploadBacklog_push(&backlog1, sent);
+    }
+    /**************************************************************************/
+    void check_upload(uint32_t index, char const *p_str)
+    {
+        uint32_t len=0U;
+        char const *p_upload = UploadBacklog_get(&backlog1, index, &len);
+
+        CHECK( p_upload != nullptr );
+        LONGS_EQUAL(strlen(p_str), len);
+        MEMCMP_EQUAL(p_str, p_upload, len);
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                                    Tests
+*******************************************************************************/
+TEST( test_upload_backlog, init )
+{
+    CHECK_TRUE( UploadBacklog_is_empty(&backlog1) );
+    LONGS_EQUAL(UPLOAD_BACKLOG_LEN, UploadBacklog_room(&backlog1) );
+    POINTERS_EQUAL(nullptr, UploadBacklog_get(&backlog1, 0U, nullptr) );
+    LONGS_EQUAL(0, UploadBacklog_ack(&backlog1, 100U) );
+}
+/******************************************************************************/
+TEST( test_upload_backlog, upload_is_fragments_in_order )
+{
+    CHECK_TRUE( UploadBacklog_append(&backlog1, "nd,1\r\n", 6U) );
+    CHECK_TRUE( UploadBacklog_append(&backlog1, "da,2\r\n", 6U) );
+    UploadBacklog_push(&backlog1, 12U);
+
+    LONGS_EQUAL(1, UploadBacklog_get_num_uploads(&backlog1) );
+    check_upload(0U, "nd,1\r\nda,2\r\n");
+    LONGS_EQUAL(( UPLOAD_BACKLOG_LEN - 12U ), UploadBacklog_room(&backlog1) );
+}
+/******************************************************************************/
+TEST( test_upload_backlog, append_is_all_or_nothing )
+{
+    static char big[UPLOAD_BACKLOG_LEN];
+
+    memset(big, 'x', sizeof(big));
+
+    CHECK_TRUE( UploadBacklog_append(&backlog1, "nd\r\n", 4U) );
+    CHECK_FALSE( UploadBacklog_append(&backlog1, big, ( UPLOAD_BACKLOG_LEN - 3U )) );
+    CHECK_TRUE( UploadBacklog_append(&backlog1, big, ( UPLOAD_BACKLOG_LEN - 4U )) );
+    LONGS_EQUAL(0, UploadBacklog_room(&backlog1) );
+}
+/******************************************************************************/
+TEST( test_upload_backlog, cancel_drops_new_upload )
+{
+    send_one("nd,1\r\n");
+
+    CHECK_TRUE( UploadBacklog_append(&backlog1, "nd,2\r\n", 6U) );
+    UploadBacklog_cancel(&backlog1);
+
+    /* Nothing to push */
+    UploadBacklog_push(&backlog1, 100U);
+
+    LONGS_EQUAL(1, UploadBacklog_get_num_uploads(&backlog1) );
+    LONGS_EQUAL(( UPLOAD_BACKLOG_LEN - 6U ), UploadBacklog_room(&backlog1) );
+}
+/******************************************************************************/
+TEST( test_upload_backlog, ack_frees_uploads_it_covers )
+{
+    send_one("nd,1\r\n");       /* ends at 6 */
+    send_one("nd,22\r\n");      /* ends at 13 */
+    send_one("nd,333\r\n");     /* ends at 21 */
+
+    /* Part of the second upload is not enough */
+    LONGS_EQUAL(1, UploadBacklog_ack(&backlog1, 10U) );
+    LONGS_EQUAL(2, UploadBacklog_get_num_uploads(&backlog1) );
+    check_upload(0U, "nd,22\r\n");
+    check_upload(1U, "nd,333\r\n");
+
+    LONGS_EQUAL(2, UploadBacklog_ack(&backlog1, 21U) );
+    CHECK_TRUE( UploadBacklog_is_empty(&backlog1) );
+    LONGS_EQUAL(UPLOAD_BACKLOG_LEN, UploadBacklog_room(&backlog1) );
+}
+/******************************************************************************/
+TEST( test_upload_backlog, ack_keeps_new_upload )
+{
+    send_one("nd,1\r\n");
+
+    CHECK_TRUE( UploadBacklog_append(&backlog1, "nd,2\r\n", 6U) );
+    LONGS_EQUAL(1, UploadBacklog_ack(&backlog1, 6U) );
+    UploadBacklog_push(&backlog1, 12U);
+
+    check_upload(0U, "nd,2\r\n");
+}
+/******************************************************************************/
+TEST( test_upload_backlog, ack_allows_for_count_wrapping )
+{
+    sent = 0xFFFFFFF0U;
+    send_one("nd,1\r\n");
+    send_one("nd,2\r\nda,3\r\nda,4\r\n");   /* wraps */
+
+    LONGS_EQUAL(1, UploadBacklog_ack(&backlog1, 0xFFFFFFF8U) );
+    LONGS_EQUAL(0, UploadBacklog_ack(&backlog1, 1U) );
+    LONGS_EQUAL(1, UploadBacklog_ack(&backlog1, 8U) );
+}
+/******************************************************************************/
+TEST( test_upload_backlog, full_when_out_of_entries )
+{
+    for(uint32_t ii=0U; ii<UPLOAD_BACKLOG_MAX_UPLOADS; ii++)
+    {
+        send_one("x");
+    }
+
+    LONGS_EQUAL(0, UploadBacklog_room(&backlog1) );
+    CHECK_FALSE( UploadBacklog_append(&backlog1, "x", 1U) );
+
+    UploadBacklog_ack(&backlog1, 1U);
+    LONGS_EQUAL(( UPLOAD_BACKLOG_LEN - UPLOAD_BACKLOG_MAX_UPLOADS + 1U ), UploadBacklog_room(&backlog1) );
+}
+/******************************************************************************/
+/* Quick send -- the modem took two uploads, and the link dropped before the
+ * server acknowledged either. Both are sent again on the next link, and are
+ * kept until that link's acks cover them.
+ */
+TEST( test_upload_backlog, link_lost_with_two_uploads_in_flight )
+{
+    send_one("nd,1\r\nda,10\r\n");      /* ends at 13 */
+    send_one("nd,2\r\nda,20\r\n");      /* ends at 26 */
+
+    /* Only the first half of the first upload got there */
+    LONGS_EQUAL(0, UploadBacklog_ack(&backlog1, 6U) );
+    UploadBacklog_link_lost(&backlog1);
+
+    /* The next link's count starts again -- it can't free the old uploads */
+    LONGS_EQUAL(0, UploadBacklog_ack(&backlog1, 100U) );
+    LONGS_EQUAL(2, UploadBacklog_get_num_uploads(&backlog1) );
+    check_upload(0U, "nd,1\r\nda,10\r\n");
+    check_upload(1U, "nd,2\r\nda,20\r\n");
+
+    /* Sent again, after 30 bytes of something else */
+    UploadBacklog_sent(&backlog1, 0U, 43U);
+    UploadBacklog_sent(&backlog1, 1U, 56U);
+
+    LONGS_EQUAL(1, UploadBacklog_ack(&backlog1, 50U) );
+    check_upload(0U, "nd,2\r\nda,20\r\n");
+
+    LONGS_EQUAL(1, UploadBacklog_ack(&backlog1, 56U) );
+    CHECK_TRUE( UploadBacklog_is_empty(&backlog1) );
+}
+/******************************************************************************/
+TEST( test_upload_backlog, link_lost_during_resend )
+{
+    send_one("nd,1\r\n");
+    send_one("nd,2\r\n");
+    UploadBacklog_link_lost(&backlog1);
+
+    /* Only the first got sent again before the next link was lost too */
+    UploadBacklog_sent(&backlog1, 0U, 6U);
+
+    LONGS_EQUAL(1, UploadBacklog_ack(&backlog1, 100U) );
+    LONGS_EQUAL(1, UploadBacklog_get_num_uploads(&backlog1) );
+    check_upload(0U, "nd,2\r\n");
+}
+/******************************************************************************/
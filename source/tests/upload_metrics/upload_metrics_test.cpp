@@ -0,0 +1,187 @@
+/**
+ * @file  upload_metrics_test.cpp
+ * @brief Unit-tests for the upload metrics
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "upload_metrics.h"
+
+
+
+
+/*******************************************************************************
+*                                  Test Group
+*******************************************************************************/
+TEST_GROUP( test_upload_metrics )
+{
+    UploadMetrics  metrics;
+    UploadLagStats lag;
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        UploadMetrics_init(1000U);
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        mock().clear();
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                                    Tests
+*******************************************************************************/
+TEST( test_upload_metrics, init )
+{
+    UploadMetrics_get(1000U, &metrics);
+
+    LONGS_EQUAL(0, metrics.num_uploads);
+    LONGS_EQUAL(0, metrics.num_samples);
+    LONGS_EQUAL(0, metrics.window_bytes);
+    LONGS_EQUAL(1, metrics.window_s);
+    LONGS_EQUAL(0, UploadMetrics_lag_percentile_s(&metrics.lag, 50U));
+}
+/******************************************************************************/
+TEST( test_upload_metrics, counts_uploads )
+{
+    UploadMetrics_upload_done(1000U, 100U, 20U, true);
+    UploadMetrics_upload_done(1001U, 50U, 40U, false);
+    UploadMetrics_retransmission();
+    UploadMetrics_set_unacked(30U);
+
+    UploadMetrics_get(1001U, &metrics);
+
+    LONGS_EQUAL(100, metrics.bytes_sent);
+    LONGS_EQUAL(2, metrics.num_uploads);
+    LONGS_EQUAL(1, metrics.num_upload_failures);
+    LONGS_EQUAL(1, metrics.num_retransmissions);
+    LONGS_EQUAL(30, metrics.unacked_bytes);
+    LONGS_EQUAL(40, metrics.write_ms_max);
+    LONGS_EQUAL(60, metrics.write_ms_total);
+}
+/******************************************************************************/
+TEST( test_upload_metrics, window_drops_old_seconds )
+{
+    UploadMetrics_upload_done(1000U, 100U, 0U, true);
+    UploadMetrics_upload_done(1010U, 10U, 0U, true);
+
+    UploadMetrics_get(1010U, &metrics);
+    LONGS_EQUAL(110, metrics.window_bytes);
+    LONGS_EQUAL(11, metrics.window_s);
+
+    UploadMetrics_get(( 1000U + UPLOAD_METRICS_RATE_WINDOW_S ), &metrics);
+    LONGS_EQUAL(10, metrics.window_bytes);
+    LONGS_EQUAL(UPLOAD_METRICS_RATE_WINDOW_S, metrics.window_s);
+
+    /* The slot for 1000 is used again */
+    UploadMetrics_upload_done(( 1000U + UPLOAD_METRICS_RATE_WINDOW_S ), 1U, 0U, true);
+    UploadMetrics_get(( 1000U + UPLOAD_METRICS_RATE_WINDOW_S ), &metrics);
+    LONGS_EQUAL(11, metrics.window_bytes);
+}
+/******************************************************************************/
+TEST( test_upload_metrics, lag_histogram )
+{
+    /* 90 samples with no lag, 10 with 100 s */
+    for(uint32_t ii=0U; ii<90U; ii++)
+    {
+        UploadMetrics_sample_uploaded(1000U, 0U, 5000U, 5000U);
+    }
+    for(uint32_t ii=0U; ii<10U; ii++)
+    {
+        UploadMetrics_sample_uploaded(1000U, 0U, 4900U, 5000U);
+    }
+
+    UploadMetrics_get(1000U, &metrics);
+
+    LONGS_EQUAL(100, metrics.num_samples);
+    LONGS_EQUAL(100, metrics.window_samples);
+    LONGS_EQUAL(0, UploadMetrics_lag_percentile_s(&metrics.lag, 50U));
+    LONGS_EQUAL(0, UploadMetrics_lag_percentile_s(&metrics.lag, 90U));
+    LONGS_EQUAL(100, UploadMetrics_lag_percentile_s(&metrics.lag, 99U));
+    LONGS_EQUAL(100, metrics.lag.lag_max_s);
+    LONGS_EQUAL(10, UploadMetrics_lag_mean_s(&metrics.lag));
+}
+/******************************************************************************/
+TEST( test_upload_metrics, percentile_is_top_of_bucket )
+{
+    /* 5 and 6 s both fall in [4, 8) */
+    UploadMetrics_sample_uploaded(1000U, 0U, 995U, 1000U);
+    UploadMetrics_sample_uploaded(1000U, 0U, 994U, 1000U);
+    UploadMetrics_sample_uploaded(1000U, 0U, 900U, 1000U);
+
+    UploadMetrics_get(1000U, &metrics);
+
+    LONGS_EQUAL(7, UploadMetrics_lag_percentile_s(&metrics.lag, 50U));
+    LONGS_EQUAL(100, UploadMetrics_lag_percentile_s(&metrics.lag, 100U));
+}
+/******************************************************************************/
+TEST( test_upload_metrics, no_time_is_counted_without_lag )
+{
+    UploadMetrics_sample_uploaded(1000U, 0U, 5000U, 0U);
+    UploadMetrics_sample_uploaded(1000U, 0U, 0U, 5000U);
+
+    UploadMetrics_get(1000U, &metrics);
+
+    LONGS_EQUAL(2, metrics.num_samples);
+    LONGS_EQUAL(2, metrics.num_samples_no_time);
+    LONGS_EQUAL(0, metrics.lag.num_samples);
+}
+/******************************************************************************/
+TEST( test_upload_metrics, future_timestamp_has_no_lag )
+{
+    UploadMetrics_sample_uploaded(1000U, 0U, 5010U, 5000U);
+
+    UploadMetrics_get(1000U, &metrics);
+
+    LONGS_EQUAL(1, metrics.lag.lag_hist[0]);
+    LONGS_EQUAL(0, metrics.lag.lag_max_s);
+}
+/******************************************************************************/
+TEST( test_upload_metrics, per_node_lag )
+{
+    UploadMetrics_sample_uploaded(1000U, 1U, 4990U, 5000U);
+    UploadMetrics_sample_uploaded(1000U, 2U, 5000U, 5000U);
+
+    CHECK_TRUE( UploadMetrics_get_node_lag(1U, &lag) );
+    LONGS_EQUAL(1, lag.num_samples);
+    LONGS_EQUAL(10, lag.lag_max_s);
+
+    UploadMetrics_reset_node(1U);
+
+    CHECK_TRUE( UploadMetrics_get_node_lag(1U, &lag) );
+    LONGS_EQUAL(0, lag.num_samples);
+
+    CHECK_TRUE( UploadMetrics_get_node_lag(2U, &lag) );
+    LONGS_EQUAL(1, lag.num_samples);
+
+    CHECK_FALSE( UploadMetrics_get_node_lag(SENSOR_NODE_LIST_SIZE, &lag) );
+}
+/******************************************************************************/
+TEST( test_upload_metrics, long_lag_goes_in_last_bucket )
+{
+    UploadMetrics_sample_uploaded(1000U, 0U, 1U, 0x7FFFFFFFU);
+
+    UploadMetrics_get(1000U, &metrics);
+
+    LONGS_EQUAL(1, metrics.lag.lag_hist[UPLOAD_METRICS_NUM_LAG_BUCKETS - 1U]);
+    LONGS_EQUAL(0x7FFFFFFE, UploadMetrics_lag_percentile_s(&metrics.lag, 50U));
+}
+/******************************************************************************/
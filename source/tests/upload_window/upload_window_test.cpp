@@ -0,0 +1,246 @@
+/**
+ * @file  upload_window_test.cpp
+ * @brief Unit-tests for the window of datagrams waiting to be acknowledged
+ *
+ * @note
+ * Copyright (C) 2017, Digitrol Ltd, Swansea, Wales. All rights reserved.
+ */
+
+
+
+
+/*******************************************************************************
+*                               INCLUDE FILES
+*******************************************************************************/
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "upload_window.h"
+
+
+
+
+/*******************************************************************************
+*                                  Test Group
+*******************************************************************************/
+TEST_GROUP( test_upload_window )
+{
+    UploadWindow window1;
+    /**************************************************************************/
+    TEST_SETUP()
+    {
+        // setup() is run before each test
+        UploadWindow_init(&window1, 100U);
+    }
+    /**************************************************************************/
+    TEST_TEARDOWN()
+    {
+        // teardown() is run after each test
+        mock().clear();
+    }
+    /**************************************************************************/
+    UploadWindowSlot* send_one(uint32_t now_ms)
+    {
+        UploadWindowSlot *p_slot = UploadWindow_take(&window1);
+
+        CHECK( p_slot != nullptr );
+        CHECK_TRUE( UploadWindow_append(p_slot, "nd,1\r\n", 6U) );
+        UploadWindow_sent(&window1, p_slot, now_ms);
+
+        return p_slot;
+    }
+    /**************************************************************************/
+};
+/******************************************************************************/
+
+
+
+
+/*******************************************************************************
+*                                    Tests
+*******************************************************************************/
+TEST( test_upload_window, init )
+{
+    LONGS_EQUAL(0, UploadWindow_get_num_used(&window1) );
+    CHECK_FALSE( UploadWindow_is_full(&window1) );
+    POINTERS_EQUAL(nullptr, UploadWindow_next_due(&window1, 0U) );
+    CHECK_FALSE( UploadWindow_ack(&window1, 100U, 0U) );
+}
+/******************************************************************************/
+TEST( test_upload_window, take_gives_next_seq )
+{
+    UploadWindowSlot *p_slot1 = UploadWindow_take(&window1);
+    UploadWindowSlot *p_slot2 = UploadWindow_take(&window1);
+
+    LONGS_EQUAL(100, p_slot1->seq);
+    LONGS_EQUAL(101, p_slot2->seq);
+    LONGS_EQUAL(0, p_slot1->len);
+    LONGS_EQUAL(2, UploadWindow_get_num_used(&window1) );
+}
+/******************************************************************************/
+TEST( test_upload_window, append_stops_at_slot_len )
+{
+    static char big[UPLOAD_WINDOW_SLOT_LEN];
+    UploadWindowSlot *p_slot = UploadWindow_take(&window1);
+
+    memset(big, 'x', sizeof(big));
+
+    CHECK_TRUE( UploadWindow_append(p_slot, "id\r\n", 4U) );
+    LONGS_EQUAL(( UPLOAD_WINDOW_SLOT_LEN - 4U ), UploadWindow_room(p_slot) );
+
+    /* All or nothing */
+    CHECK_FALSE( UploadWindow_append(p_slot, big, ( UPLOAD_WINDOW_SLOT_LEN - 3U )) );
+    LONGS_EQUAL(4, p_slot->len);
+
+    CHECK_TRUE( UploadWindow_append(p_slot, big, ( UPLOAD_WINDOW_SLOT_LEN - 4U )) );
+    LONGS_EQUAL(0, UploadWindow_room(p_slot) );
+    MEMCMP_EQUAL("id\r\nxx", p_slot->buff, 6U);
+}
+/******************************************************************************/
+TEST( test_upload_window, full_until_acked )
+{
+    for(uint32_t ii=0U; ii<UPLOAD_WINDOW_NUM_SLOTS; ii++)
+    {
+        send_one(0U);
+    }
+
+    CHECK_TRUE( UploadWindow_is_full(&window1) );
+    POINTERS_EQUAL(nullptr, UploadWindow_take(&window1) );
+
+    CHECK_TRUE( UploadWindow_ack(&window1, 102U, 100U) );
+    CHECK_FALSE( UploadWindow_is_full(&window1) );
+
+    /* The freed slot gets the next sequence number, not the acked one */
+    LONGS_EQUAL(( 100U + UPLOAD_WINDOW_NUM_SLOTS ), UploadWindow_take(&window1)->seq);
+}
+/******************************************************************************/
+TEST( test_upload_window, duplicate_ack_is_ignored )
+{
+    send_one(0U);
+
+    CHECK_TRUE( UploadWindow_ack(&window1, 100U, 100U) );
+    CHECK_FALSE( UploadWindow_ack(&window1, 100U, 200U) );
+    LONGS_EQUAL(1, window1.num_acked);
+}
+/******************************************************************************/
+TEST( test_upload_window, cancel_hands_back_seq )
+{
+    UploadWindowSlot *p_slot = UploadWindow_take(&window1);
+
+    UploadWindow_cancel(&window1, p_slot);
+
+    LONGS_EQUAL(0, UploadWindow_get_num_used(&window1) );
+    LONGS_EQUAL(100, UploadWindow_take(&window1)->seq);
+}
+/******************************************************************************/
+TEST( test_upload_window, not_sent_is_due_now )
+{
+    UploadWindowSlot *p_slot = UploadWindow_take(&window1);
+
+    POINTERS_EQUAL(p_slot, UploadWindow_next_due(&window1, 0U) );
+
+    UploadWindow_sent(&window1, p_slot, 0U);
+    LONGS_EQUAL(0, window1.num_resent);
+}
+/******************************************************************************/
+TEST( test_upload_window, resend_after_timeout_with_backoff )
+{
+    UploadWindowSlot *p_slot = send_one(1000U);
+
+    POINTERS_EQUAL(nullptr, UploadWindow_next_due(&window1, ( 1000U + UPLOAD_WINDOW_INITIAL_RTO_MS - 1U )) );
+    POINTERS_EQUAL(p_slot, UploadWindow_next_due(&window1, ( 1000U + UPLOAD_WINDOW_INITIAL_RTO_MS )) );
+
+    /* Sent again -- now waits twice as long */
+    UploadWindow_sent(&window1, p_slot, 5000U);
+    LONGS_EQUAL(1, window1.num_resent);
+
+    POINTERS_EQUAL(nullptr, UploadWindow_next_due(&window1, ( 5000U + ( 2U * UPLOAD_WINDOW_INITIAL_RTO_MS ) - 1U )) );
+    POINTERS_EQUAL(p_slot, UploadWindow_next_due(&window1, ( 5000U + ( 2U * UPLOAD_WINDOW_INITIAL_RTO_MS ) )) );
+}
+/******************************************************************************/
+TEST( test_upload_window, oldest_due_first )
+{
+    UploadWindowSlot *p_slot1 = send_one(0U);
+    UploadWindowSlot *p_slot2 = send_one(0U);
+
+    /* Free the first slot, so the next datagram goes in front of slot 2 */
+    UploadWindow_ack(&window1, p_slot1->seq, 10U);
+    UploadWindowSlot *p_slot3 = send_one(10U);
+
+    POINTERS_EQUAL(p_slot1, p_slot3);
+    POINTERS_EQUAL(p_slot2, UploadWindow_next_due(&window1, 100000U) );
+}
+/******************************************************************************/
+TEST( test_upload_window, oldest_allows_for_seq_wrap )
+{
+    UploadWindow_init(&window1, 0xFFFFFFFFU);
+
+    UploadWindowSlot *p_slot1 = send_one(0U);
+    UploadWindowSlot *p_slot2 = send_one(0U);
+
+    LONGS_EQUAL(0, p_slot2->seq);
+    POINTERS_EQUAL(p_slot1, UploadWindow_next_due(&window1, 100000U) );
+}
+/******************************************************************************/
+TEST( test_upload_window, given_up_after_max_sends )
+{
+    UploadWindowSlot *p_slot = send_one(0U);
+    uint32_t now_ms = 0U;
+
+    for(uint32_t ii=1U; ii<UPLOAD_WINDOW_MAX_SENDS; ii++)
+    {
+        now_ms += UPLOAD_WINDOW_MAX_RTO_MS;
+        POINTERS_EQUAL(p_slot, UploadWindow_next_due(&window1, now_ms) );
+        UploadWindow_sent(&window1, p_slot, now_ms);
+    }
+
+    now_ms += UPLOAD_WINDOW_MAX_RTO_MS;
+    POINTERS_EQUAL(nullptr, UploadWindow_next_due(&window1, now_ms) );
+    LONGS_EQUAL(1, window1.num_expired);
+    LONGS_EQUAL(0, UploadWindow_get_num_used(&window1) );
+}
+/******************************************************************************/
+TEST( test_upload_window, rto_follows_round_trip )
+{
+    UploadWindowSlot *p_slot = send_one(0U);
+
+    /* First sample: twice the round trip */
+    UploadWindow_ack(&window1, p_slot->seq, 800U);
+    LONGS_EQUAL(800, window1.srtt_ms);
+    LONGS_EQUAL(1600, window1.rto_ms);
+
+    /* Not below the minimum */
+    UploadWindow_init(&window1, 0U);
+    p_slot = send_one(1000U);
+    UploadWindow_ack(&window1, p_slot->seq, 1010U);
+    LONGS_EQUAL(UPLOAD_WINDOW_MIN_RTO_MS, window1.rto_ms);
+}
+/******************************************************************************/
+TEST( test_upload_window, retransmitted_ack_does_not_change_rto )
+{
+    UploadWindowSlot *p_slot = send_one(0U);
+
+    UploadWindow_sent(&window1, p_slot, 5000U);
+    UploadWindow_ack(&window1, p_slot->seq, 5010U);
+
+    LONGS_EQUAL(0, window1.srtt_ms);
+    LONGS_EQUAL(UPLOAD_WINDOW_INITIAL_RTO_MS, window1.rto_ms);
+}
+/******************************************************************************/
+TEST( test_upload_window, resend_all_makes_sent_due )
+{
+    UploadWindowSlot *p_slot1 = send_one(0U);
+    UploadWindowSlot *p_slot2 = send_one(0U);
+
+    UploadWindow_sent(&window1, p_slot2, UPLOAD_WINDOW_INITIAL_RTO_MS);
+
+    UploadWindow_resend_all(&window1, 10U);
+
+    POINTERS_EQUAL(p_slot1, UploadWindow_next_due(&window1, 10U) );
+    UploadWindow_sent(&window1, p_slot1, 10U);
+    POINTERS_EQUAL(p_slot2, UploadWindow_next_due(&window1, 10U) );
+    LONGS_EQUAL(2, p_slot2->num_sends);
+}
+/******************************************************************************/